@@ -1,7 +1,7 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome import pins
-from esphome.components.esp32 import add_idf_component
+from esphome.components.esp32 import add_idf_component, add_idf_sdkconfig_option
 from esphome.const import CONF_ID, CONF_FREQUENCY
 
 CODEOWNERS = ["@dev-rbdimmer"]
@@ -13,6 +13,9 @@ CONF_RBDIMMER_ID = "rbdimmer_id"
 CONF_PHASES = "phases"
 CONF_PHASE = "phase"
 CONF_ZERO_CROSS_PIN = "zero_cross_pin"
+CONF_CPU_CORE = "cpu_core"
+CONF_INTERRUPT_PRIORITY = "interrupt_priority"
+CONF_FAST_BOOT = "fast_boot"
 
 rbdimmer_ns = cg.esphome_ns.namespace("rbdimmer")
 RBDimmerHub = rbdimmer_ns.class_("RBDimmerHub", cg.Component)
@@ -32,6 +35,9 @@ CONFIG_SCHEMA = cv.All(
             cv.Optional(CONF_PHASES): cv.ensure_list(PHASE_SCHEMA),
             cv.Optional(CONF_ZERO_CROSS_PIN): pins.internal_gpio_input_pin_number,
             cv.Optional(CONF_FREQUENCY, default=0): cv.int_range(min=0, max=65),
+            cv.Optional(CONF_CPU_CORE, default=-1): cv.int_range(min=-1, max=1),
+            cv.Optional(CONF_INTERRUPT_PRIORITY, default=0): cv.int_range(min=0, max=3),
+            cv.Optional(CONF_FAST_BOOT, default=False): cv.boolean,
         }
     ).extend(cv.COMPONENT_SCHEMA),
     cv.has_at_least_one_key(CONF_PHASES, CONF_ZERO_CROSS_PIN),
@@ -41,6 +47,10 @@ CONFIG_SCHEMA = cv.All(
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
+    cg.add(var.set_rt_affinity(config[CONF_CPU_CORE], config[CONF_INTERRUPT_PRIORITY]))
+    if config[CONF_FAST_BOOT]:
+        # Calibration and channel state in NVS (ESPHome has initialised it)
+        add_idf_sdkconfig_option("CONFIG_RBDIMMER_PERSIST", True)
 
     if CONF_PHASES in config:
         for phase_conf in config[CONF_PHASES]:
@@ -16,6 +16,14 @@ RBDimmerLight = rbdimmer_ns.class_("RBDimmerLight", light.LightOutput, cg.Compon
 
 CONF_PIN = "pin"
 CONF_CURVE = "curve"
+CONF_OUTPUT = "output"
+CONF_EASING = "easing"
+CONF_NATIVE_TRANSITION = "native_transition"
+CONF_ZC_SYNC = "zc_sync"
+CONF_MODE = "mode"
+CONF_SOFT_START = "soft_start"
+CONF_GATE = "gate"
+CONF_PULSE_WIDTH = "pulse_width"
 
 CURVE_OPTIONS = {
     "linear": 0,
@@ -23,6 +31,31 @@ CURVE_OPTIONS = {
     "logarithmic": 2,
 }
 
+OUTPUT_OPTIONS = {
+    "timer": 0,
+    "mcpwm": 1,
+}
+
+MODE_OPTIONS = {
+    "phase": 0,
+    "burst": 1,
+    "trailing": 2,
+}
+
+GATE_OPTIONS = {
+    "pulse": 0,
+    "hold": 1,
+    "train": 2,
+}
+
+EASING_OPTIONS = {
+    "linear": 0,
+    "ease_in": 1,
+    "ease_out": 2,
+    "ease_in_out": 3,
+    "exponential": 4,
+}
+
 CONFIG_SCHEMA = (
     light.BRIGHTNESS_ONLY_LIGHT_SCHEMA.extend(
         {
@@ -31,6 +64,17 @@ CONFIG_SCHEMA = (
             cv.Required(CONF_PIN): pins.internal_gpio_output_pin_number,
             cv.Optional(CONF_PHASE, default=0): cv.int_range(min=0, max=3),
             cv.Optional(CONF_CURVE, default="rms"): cv.enum(CURVE_OPTIONS, lower=True),
+            cv.Optional(CONF_OUTPUT, default="timer"): cv.enum(OUTPUT_OPTIONS, lower=True),
+            cv.Optional(CONF_MODE, default="phase"): cv.enum(MODE_OPTIONS, lower=True),
+            cv.Optional(CONF_SOFT_START, default=0): cv.int_range(min=0, max=65535),
+            cv.Optional(CONF_GATE, default="pulse"): cv.enum(GATE_OPTIONS, lower=True),
+            cv.Optional(CONF_PULSE_WIDTH, default="0us"): cv.All(
+                cv.positive_time_period_microseconds,
+                cv.Range(max=cv.TimePeriod(microseconds=2000)),
+            ),
+            cv.Optional(CONF_EASING, default="linear"): cv.enum(EASING_OPTIONS, lower=True),
+            cv.Optional(CONF_NATIVE_TRANSITION, default=True): cv.boolean,
+            cv.Optional(CONF_ZC_SYNC, default=False): cv.boolean,
             cv.Optional(CONF_GAMMA_CORRECT, default=1.0): cv.positive_float,
             cv.Optional(
                 CONF_DEFAULT_TRANSITION_LENGTH, default="1s"
@@ -50,3 +94,11 @@ async def to_code(config):
     cg.add(var.set_pin(config[CONF_PIN]))
     cg.add(var.set_phase(config[CONF_PHASE]))
     cg.add(var.set_curve(config[CONF_CURVE]))
+    cg.add(var.set_output(config[CONF_OUTPUT]))
+    cg.add(var.set_mode(config[CONF_MODE]))
+    cg.add(var.set_soft_start(config[CONF_SOFT_START]))
+    cg.add(var.set_gate(config[CONF_GATE]))
+    cg.add(var.set_pulse_width(config[CONF_PULSE_WIDTH].total_microseconds))
+    cg.add(var.set_easing(config[CONF_EASING]))
+    cg.add(var.set_native_transition(config[CONF_NATIVE_TRANSITION]))
+    cg.add(var.set_zc_sync(config[CONF_ZC_SYNC]))
@@ -26,8 +26,19 @@ class RBDimmerHub : public Component {
     this->phases_.push_back({phase, pin, frequency});
   }
 
+  void set_rt_affinity(int8_t core, uint8_t intr_priority) {
+    this->rt_core_ = core;
+    this->rt_intr_priority_ = intr_priority;
+  }
+
   void setup() override {
-    rbdimmer_err_t err = rbdimmer_init();
+    rbdimmer_err_t err = rbdimmer_set_rt_affinity(this->rt_core_, this->rt_intr_priority_);
+    if (err != RBDIMMER_OK) {
+      ESP_LOGE(TAG_HUB, "cpu_core %d is not available on this chip", this->rt_core_);
+      this->mark_failed();
+      return;
+    }
+    err = rbdimmer_init();
     if (err != RBDIMMER_OK) {
       ESP_LOGE(TAG_HUB, "Failed to initialize rbdimmer library: %d", err);
       this->mark_failed();
@@ -63,6 +74,13 @@ class RBDimmerHub : public Component {
       ESP_LOGCONFIG(TAG_HUB, "  Phase %d: ZC pin=%d, freq=%d Hz",
                     phase.phase, phase.pin, phase.frequency);
     }
+    if (this->rt_core_ >= 0) {
+      ESP_LOGCONFIG(TAG_HUB, "  Real-time core: %d, interrupt priority: %d",
+                    this->rt_core_, this->rt_intr_priority_);
+    }
+    if (RBDIMMER_PERSIST) {
+      ESP_LOGCONFIG(TAG_HUB, "  Fast boot: calibration and levels restored from NVS");
+    }
   }
 
   float get_setup_priority() const override { return setup_priority::HARDWARE; }
@@ -71,6 +89,8 @@ class RBDimmerHub : public Component {
 
  protected:
   std::vector<PhaseConfig> phases_;
+  int8_t rt_core_{-1};
+  uint8_t rt_intr_priority_{0};
   bool initialized_{false};
 };
 
@@ -3,6 +3,8 @@
 #include "esphome/core/component.h"
 #include "esphome/core/log.h"
 #include "esphome/components/light/light_output.h"
+#include "esphome/components/light/light_state.h"
+#include "esphome/components/light/light_transformer.h"
 #include "rbdimmer_hub.h"
 
 extern "C" {
@@ -14,12 +16,44 @@ namespace rbdimmer {
 
 static const char *const TAG_LIGHT = "rbdimmer.light";
 
+class RBDimmerLight;
+
+// Hands an ESPHome transition to the library fade engine once, at start().
+// apply() stays silent until the end, so LightState does not call
+// write_state() on every loop while the library steps the fade itself.
+class RBDimmerTransformer : public light::LightTransformer {
+ public:
+  explicit RBDimmerTransformer(RBDimmerLight *light) : light_(light) {}
+
+  void start() override;
+
+  optional<light::LightColorValues> apply() override {
+    if (this->get_progress_() < 1.0f)
+      return {};
+    return this->target_values_;
+  }
+
+  bool publish_at_end() override { return true; }
+  bool is_transition() override { return true; }
+
+ protected:
+  RBDimmerLight *light_;
+};
+
 class RBDimmerLight : public light::LightOutput, public Component {
  public:
   void set_hub(RBDimmerHub *hub) { this->hub_ = hub; }
   void set_pin(uint8_t pin) { this->pin_ = pin; }
   void set_phase(uint8_t phase) { this->phase_ = phase; }
   void set_curve(uint8_t curve) { this->curve_ = static_cast<rbdimmer_curve_t>(curve); }
+  void set_output(uint8_t output) { this->output_ = static_cast<rbdimmer_output_t>(output); }
+  void set_mode(uint8_t mode) { this->mode_ = static_cast<rbdimmer_mode_t>(mode); }
+  void set_soft_start(uint16_t half_cycles) { this->soft_start_ = half_cycles; }
+  void set_gate(uint8_t gate) { this->gate_ = static_cast<rbdimmer_gate_t>(gate); }
+  void set_pulse_width(uint16_t width_us) { this->pulse_width_ = width_us; }
+  void set_easing(uint8_t easing) { this->easing_ = static_cast<rbdimmer_easing_t>(easing); }
+  void set_native_transition(bool native) { this->native_transition_ = native; }
+  void set_zc_sync(bool zc_sync) { this->zc_sync_ = zc_sync; }
 
   void setup() override {
     if (this->hub_ == nullptr || !this->hub_->is_initialized()) {
@@ -33,6 +67,11 @@ class RBDimmerLight : public light::LightOutput, public Component {
         .phase = this->phase_,
         .initial_level = 0,
         .curve_type = this->curve_,
+        .output = this->output_,
+        .mode = this->mode_,
+        .soft_start_half_cycles = this->soft_start_,
+        .gate = this->gate_,
+        .pulse_width_us = this->pulse_width_,
     };
 
     rbdimmer_err_t err = rbdimmer_create_channel(&config, &this->channel_);
@@ -46,6 +85,31 @@ class RBDimmerLight : public light::LightOutput, public Component {
              this->pin_, this->phase_, this->curve_);
   }
 
+  void setup_state(light::LightState *state) override { this->state_ = state; }
+
+  std::unique_ptr<light::LightTransformer> create_default_transition() override {
+    if (!this->native_transition_)
+      return light::LightOutput::create_default_transition();
+    return make_unique<RBDimmerTransformer>(this);
+  }
+
+  // Start a library transition to @p brightness (0..1, gamma applied).
+  void start_transition(float brightness, uint32_t length_ms) {
+    if (this->channel_ == nullptr)
+      return;
+    uint16_t level = to_q16(brightness);
+    if (this->zc_sync_) {
+      rbdimmer_set_level_transition_zc(this->channel_, level, length_ms);
+    } else {
+      rbdimmer_set_level_transition_eased(this->channel_, level, length_ms, this->easing_);
+    }
+    // The final write_state() of this transition lands on the same level —
+    // it must not cut the library fade short.
+    this->pending_target_ = level;
+  }
+
+  float get_gamma() const { return this->state_ != nullptr ? this->state_->get_gamma_correct() : 0.0f; }
+
   light::LightTraits get_traits() override {
     auto traits = light::LightTraits();
     traits.set_supported_color_modes({light::ColorMode::BRIGHTNESS});
@@ -59,11 +123,14 @@ class RBDimmerLight : public light::LightOutput, public Component {
     float brightness;
     state->current_values_as_brightness(&brightness);
 
-    // Library uses integer 0-100 range; use round() to avoid float truncation
-    // (e.g. 1.0f * 100.0f = 99.9999... would truncate to 99 without rounding)
-    uint8_t level = static_cast<uint8_t>(roundf(brightness * 100.0f));
-    if (level > 100) level = 100;
-    rbdimmer_set_level(this->channel_, level);
+    uint16_t level = to_q16(brightness);
+    if (this->pending_target_ >= 0) {
+      bool landing = this->pending_target_ == level;
+      this->pending_target_ = -1;
+      if (landing)
+        return;  // library fade is already heading there
+    }
+    rbdimmer_set_level_q16(this->channel_, level);
   }
 
   void dump_config() override {
@@ -71,6 +138,25 @@ class RBDimmerLight : public light::LightOutput, public Component {
     ESP_LOGCONFIG(TAG_LIGHT, "  Pin: %d", this->pin_);
     ESP_LOGCONFIG(TAG_LIGHT, "  Phase: %d", this->phase_);
     ESP_LOGCONFIG(TAG_LIGHT, "  Curve: %d", this->curve_);
+    ESP_LOGCONFIG(TAG_LIGHT, "  Output: %s", this->output_ == RBDIMMER_OUTPUT_MCPWM ? "mcpwm" : "timer");
+    static const char *const MODES[] = {"phase", "burst", "trailing"};
+    ESP_LOGCONFIG(TAG_LIGHT, "  Mode: %s", MODES[this->mode_ <= RBDIMMER_MODE_TRAILING ? this->mode_ : 0]);
+    if (this->soft_start_ != 0) {
+      ESP_LOGCONFIG(TAG_LIGHT, "  Soft start: %u half-cycles", this->soft_start_);
+    }
+    static const char *const GATES[] = {"pulse", "hold", "train"};
+    ESP_LOGCONFIG(TAG_LIGHT, "  Gate: %s", GATES[this->gate_ <= RBDIMMER_GATE_TRAIN ? this->gate_ : 0]);
+    if (this->pulse_width_ != 0) {
+      ESP_LOGCONFIG(TAG_LIGHT, "  Pulse width: %u us", this->pulse_width_);
+    }
+    ESP_LOGCONFIG(TAG_LIGHT, "  Native transition: %s", YESNO(this->native_transition_));
+    if (this->native_transition_) {
+      if (this->zc_sync_) {
+        ESP_LOGCONFIG(TAG_LIGHT, "  Transition: zero-cross synchronised");
+      } else {
+        ESP_LOGCONFIG(TAG_LIGHT, "  Easing: %d", this->easing_);
+      }
+    }
   }
 
   float get_setup_priority() const override { return setup_priority::HARDWARE - 1.0f; }
@@ -85,12 +171,38 @@ class RBDimmerLight : public light::LightOutput, public Component {
   }
 
  protected:
+  // 16-bit level keeps fades smooth; round() avoids float truncation
+  // (1.0f * 65535.0f must map to full level).
+  static uint16_t to_q16(float brightness) {
+    float scaled = roundf(brightness * static_cast<float>(RBDIMMER_LEVEL_Q16_MAX));
+    if (scaled < 0.0f) scaled = 0.0f;
+    if (scaled > RBDIMMER_LEVEL_Q16_MAX) scaled = RBDIMMER_LEVEL_Q16_MAX;
+    return static_cast<uint16_t>(scaled);
+  }
+
   RBDimmerHub *hub_{nullptr};
+  light::LightState *state_{nullptr};
   uint8_t pin_{0};
   uint8_t phase_{0};
   rbdimmer_curve_t curve_{RBDIMMER_CURVE_RMS};
+  rbdimmer_output_t output_{RBDIMMER_OUTPUT_TIMER};
+  rbdimmer_mode_t mode_{RBDIMMER_MODE_PHASE};
+  uint16_t soft_start_{0};
+  rbdimmer_gate_t gate_{RBDIMMER_GATE_PULSE};
+  uint16_t pulse_width_{0};  // 0 = RBDIMMER_DEFAULT_PULSE_WIDTH_US
   rbdimmer_channel_t *channel_{nullptr};
+  rbdimmer_easing_t easing_{RBDIMMER_EASING_LINEAR};
+  bool native_transition_{true};
+  bool zc_sync_{false};
+  int32_t pending_target_{-1};  // level of the running library transition, -1 = none
 };
 
+inline void RBDimmerTransformer::start() {
+  // as_brightness() folds in the on/off state, so turning off fades to 0
+  float brightness;
+  this->target_values_.as_brightness(&brightness, this->light_->get_gamma());
+  this->light_->start_transition(brightness, this->length_);
+}
+
 }  // namespace rbdimmer
 }  // namespace esphome
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+
 #include "esphome/core/component.h"
 #include "esphome/core/log.h"
 #include "esphome/components/sensor/sensor.h"
@@ -15,12 +18,40 @@ namespace rbdimmer {
 
 static const char *const TAG_SENSOR = "rbdimmer.sensor";
 
+// Sub-sensor that only publishes when its value moved by at least the
+// deadband (0 = every update), so idle diagnostics cost no API traffic.
+struct DeadbandSensor {
+  sensor::Sensor *sens{nullptr};
+  uint8_t phase{0};
+  float deadband{0.0f};
+  float last{NAN};
+
+  void publish(float value) {
+    if (this->sens == nullptr || std::isnan(value)) {
+      return;
+    }
+    if (this->deadband > 0.0f && !std::isnan(this->last) &&
+        std::fabs(value - this->last) < this->deadband) {
+      return;
+    }
+    this->last = value;
+    this->sens->publish_state(value);
+  }
+};
+
+// Percentile of one library timing histogram.  Each sensor keeps its own
+// previous snapshot, so sensors on different phases never share a baseline.
+struct TimingSensor : DeadbandSensor {
+  rbdimmer_histogram_t prev{};
+};
+
 class RBDimmerSensor : public PollingComponent {
  public:
   void set_hub(RBDimmerHub *hub) { this->hub_ = hub; }
 
-  void set_ac_frequency_sensor(sensor::Sensor *sens) { this->ac_frequency_sensor_ = sens; }
-  void set_ac_frequency_phase(uint8_t phase) { this->ac_frequency_phase_ = phase; }
+  void set_ac_frequency_sensor(sensor::Sensor *sens) { this->ac_frequency_.sens = sens; }
+  void set_ac_frequency_phase(uint8_t phase) { this->ac_frequency_.phase = phase; }
+  void set_ac_frequency_deadband(float deadband) { this->ac_frequency_.deadband = deadband; }
 
   void set_level_sensor(sensor::Sensor *sens) { this->level_sensor_ = sens; }
   void set_level_light(RBDimmerLight *light) { this->level_light_ = light; }
@@ -28,11 +59,31 @@ class RBDimmerSensor : public PollingComponent {
   void set_firing_delay_sensor(sensor::Sensor *sens) { this->firing_delay_sensor_ = sens; }
   void set_firing_delay_light(RBDimmerLight *light) { this->firing_delay_light_ = light; }
 
+  // Health diagnostics: sensor, phase, deadband
+  void set_fire_jitter_p50_sensor(sensor::Sensor *sens, uint8_t phase, float deadband) {
+    this->fire_jitter_p50_ = {{sens, phase, deadband}};
+  }
+  void set_fire_jitter_p99_sensor(sensor::Sensor *sens, uint8_t phase, float deadband) {
+    this->fire_jitter_p99_ = {{sens, phase, deadband}};
+  }
+  void set_zc_latency_sensor(sensor::Sensor *sens, uint8_t phase, float deadband) {
+    this->zc_latency_ = {{sens, phase, deadband}};
+  }
+  void set_rejected_edges_sensor(sensor::Sensor *sens, uint8_t phase, float deadband) {
+    this->rejected_edges_ = {sens, phase, deadband};
+  }
+  void set_synthesized_edges_sensor(sensor::Sensor *sens, uint8_t phase, float deadband) {
+    this->synthesized_edges_ = {sens, phase, deadband};
+  }
+  void set_missed_firings_sensor(sensor::Sensor *sens, uint8_t phase, float deadband) {
+    this->missed_firings_ = {sens, phase, deadband};
+  }
+
   void update() override {
-    if (this->ac_frequency_sensor_ != nullptr) {
-      uint16_t freq = rbdimmer_get_frequency(this->ac_frequency_phase_);
-      if (freq > 0) {
-        this->ac_frequency_sensor_->publish_state(static_cast<float>(freq));
+    if (this->ac_frequency_.sens != nullptr) {
+      uint16_t centihz = rbdimmer_get_frequency_centihz(this->ac_frequency_.phase);
+      if (centihz > 0) {
+        this->ac_frequency_.publish(centihz / 100.0f);
       }
     }
 
@@ -49,30 +100,116 @@ class RBDimmerSensor : public PollingComponent {
         this->firing_delay_sensor_->publish_state(static_cast<float>(rbdimmer_get_delay(ch)));
       }
     }
+
+    this->update_edge_counters_();
+    this->update_timing_();
   }
 
   void dump_config() override {
     ESP_LOGCONFIG(TAG_SENSOR, "RBDimmer Sensors:");
-    if (this->ac_frequency_sensor_)
+    if (this->ac_frequency_.sens)
       ESP_LOGCONFIG(TAG_SENSOR, "  AC Frequency (phase %d): %s",
-                    this->ac_frequency_phase_, this->ac_frequency_sensor_->get_name().c_str());
+                    this->ac_frequency_.phase, this->ac_frequency_.sens->get_name().c_str());
     if (this->level_sensor_)
       ESP_LOGCONFIG(TAG_SENSOR, "  Level: %s", this->level_sensor_->get_name().c_str());
     if (this->firing_delay_sensor_)
       ESP_LOGCONFIG(TAG_SENSOR, "  Firing Delay: %s", this->firing_delay_sensor_->get_name().c_str());
+    for (const DeadbandSensor *d : this->diagnostics_()) {
+      if (d->sens)
+        ESP_LOGCONFIG(TAG_SENSOR, "  %s (phase %d, deadband %.2f)",
+                      d->sens->get_name().c_str(), d->phase, d->deadband);
+    }
+    if (RBDIMMER_INSTRUMENT == 0 &&
+        (this->fire_jitter_p50_.sens || this->fire_jitter_p99_.sens || this->zc_latency_.sens))
+      ESP_LOGW(TAG_SENSOR, "  Timing sensors need CONFIG_RBDIMMER_INSTRUMENT=y; they stay unknown");
   }
 
  protected:
+  std::array<const DeadbandSensor *, 6> diagnostics_() const {
+    return {&this->fire_jitter_p50_, &this->fire_jitter_p99_, &this->zc_latency_,
+            &this->rejected_edges_, &this->synthesized_edges_, &this->missed_firings_};
+  }
+
+  void update_edge_counters_() {
+    rbdimmer_zc_stats_t st;
+    if (this->rejected_edges_.sens &&
+        rbdimmer_get_zero_cross_stats(this->rejected_edges_.phase, &st) == RBDIMMER_OK)
+      this->rejected_edges_.publish(static_cast<float>(st.rejected));
+    if (this->synthesized_edges_.sens &&
+        rbdimmer_get_zero_cross_stats(this->synthesized_edges_.phase, &st) == RBDIMMER_OK)
+      this->synthesized_edges_.publish(static_cast<float>(st.synthesized));
+    if (this->missed_firings_.sens &&
+        rbdimmer_get_zero_cross_stats(this->missed_firings_.phase, &st) == RBDIMMER_OK)
+      this->missed_firings_.publish(static_cast<float>(st.missed));
+  }
+
+  // The library histograms are cumulative; percentiles are taken over the
+  // samples added since the previous update so a bad minute is not averaged
+  // away by a good week.
+  void update_timing_() {
+    update_percentile_(this->fire_jitter_p50_, &rbdimmer_timing_stats_t::fire_late_us, 0.50f);
+    update_percentile_(this->fire_jitter_p99_, &rbdimmer_timing_stats_t::fire_late_us, 0.99f);
+    update_percentile_(this->zc_latency_, &rbdimmer_timing_stats_t::zc_latency_us, 0.99f);
+  }
+
+  static void update_percentile_(TimingSensor &s,
+                                 rbdimmer_histogram_t rbdimmer_timing_stats_t::*hist, float q) {
+    rbdimmer_timing_stats_t t;
+    if (s.sens == nullptr || rbdimmer_get_timing_stats(s.phase, &t) != RBDIMMER_OK) {
+      return;
+    }
+    s.publish(percentile_(t.*hist, s.prev, q));
+    s.prev = t.*hist;
+  }
+
+  // Quantile @p q of the samples in @p cur that are not in @p prev, linearly
+  // interpolated inside the log2 bucket.  NAN when nothing new was recorded.
+  static float percentile_(const rbdimmer_histogram_t &cur, const rbdimmer_histogram_t &prev,
+                           float q) {
+    // rbdimmer_reset_timing_stats() (or a re-registered phase) in between:
+    // some bucket went down.  Take @p cur whole rather than underflow.
+    bool reset = cur.count < prev.count;
+    for (int i = 0; i < RBDIMMER_TIMING_BUCKETS && !reset; i++) {
+      reset = cur.buckets[i] < prev.buckets[i];
+    }
+    uint32_t n = reset ? cur.count : cur.count - prev.count;
+    if (n == 0) {
+      return NAN;
+    }
+    float rank = q * n;
+    uint32_t cum = 0;
+    for (int i = 0; i < RBDIMMER_TIMING_BUCKETS; i++) {
+      uint32_t d = reset ? cur.buckets[i] : cur.buckets[i] - prev.buckets[i];
+      if (d == 0 || cum + d < rank) {
+        cum += d;
+        continue;
+      }
+      float lo = i == 0 ? 0.0f : static_cast<float>(1u << (i - 1));
+      float hi = i == 0 ? 0.0f
+               : i == RBDIMMER_TIMING_BUCKETS - 1 ? static_cast<float>(cur.max)
+                                                  : static_cast<float>((1u << i) - 1);
+      float v = lo + (hi - lo) * ((rank - cum) / d);
+      return std::fmin(v, static_cast<float>(cur.max));
+    }
+    return static_cast<float>(cur.max);
+  }
+
   RBDimmerHub *hub_{nullptr};
 
-  sensor::Sensor *ac_frequency_sensor_{nullptr};
-  uint8_t ac_frequency_phase_{0};
+  DeadbandSensor ac_frequency_;
 
   sensor::Sensor *level_sensor_{nullptr};
   RBDimmerLight *level_light_{nullptr};
 
   sensor::Sensor *firing_delay_sensor_{nullptr};
   RBDimmerLight *firing_delay_light_{nullptr};
+
+  TimingSensor fire_jitter_p50_;
+  TimingSensor fire_jitter_p99_;
+  TimingSensor zc_latency_;
+  DeadbandSensor rejected_edges_;
+  DeadbandSensor synthesized_edges_;
+  DeadbandSensor missed_firings_;
 };
 
 }  // namespace rbdimmer
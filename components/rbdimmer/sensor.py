@@ -1,12 +1,14 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import sensor
+from esphome.components.esp32 import add_idf_sdkconfig_option
 from esphome.const import (
     CONF_ID,
     UNIT_HERTZ,
     UNIT_PERCENT,
     DEVICE_CLASS_FREQUENCY,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
     ENTITY_CATEGORY_DIAGNOSTIC,
 )
 
@@ -18,23 +20,33 @@ CONF_AC_FREQUENCY = "ac_frequency"
 CONF_LEVEL = "level"
 CONF_FIRING_DELAY = "firing_delay"
 CONF_LIGHT_ID = "light_id"
+CONF_DEADBAND = "deadband"
+CONF_FIRE_JITTER_P50 = "fire_jitter_p50"
+CONF_FIRE_JITTER_P99 = "fire_jitter_p99"
+CONF_ZC_LATENCY = "zc_latency"
+CONF_REJECTED_EDGES = "rejected_edges"
+CONF_SYNTHESIZED_EDGES = "synthesized_edges"
+CONF_MISSED_FIRINGS = "missed_firings"
 
 ICON_SINE_WAVE = "mdi:sine-wave"
 ICON_BRIGHTNESS = "mdi:brightness-percent"
 ICON_TIMER = "mdi:timer-outline"
+ICON_PULSE = "mdi:pulse"
+ICON_COUNTER = "mdi:counter"
 
 RBDimmerSensor = rbdimmer_ns.class_("RBDimmerSensor", cg.PollingComponent)
 RBDimmerLight = rbdimmer_ns.class_("RBDimmerLight")
 
 AC_FREQUENCY_SCHEMA = sensor.sensor_schema(
     unit_of_measurement=UNIT_HERTZ,
-    accuracy_decimals=0,
+    accuracy_decimals=2,
     device_class=DEVICE_CLASS_FREQUENCY,
     state_class=STATE_CLASS_MEASUREMENT,
     icon=ICON_SINE_WAVE,
 ).extend(
     {
         cv.Optional(CONF_PHASE, default=0): cv.int_range(min=0, max=3),
+        cv.Optional(CONF_DEADBAND, default=0.02): cv.positive_float,
     }
 )
 
@@ -60,17 +72,51 @@ FIRING_DELAY_SCHEMA = sensor.sensor_schema(
     }
 )
 
-CONFIG_SCHEMA = (
-    cv.Schema(
+
+def diagnostic_schema(unit, icon, state_class, deadband):
+    """Per-phase diagnostic sub-sensor, published only past its deadband."""
+    kwargs = {"unit_of_measurement": unit} if unit is not None else {}
+    return sensor.sensor_schema(
+        **kwargs,
+        accuracy_decimals=0,
+        state_class=state_class,
+        icon=icon,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    ).extend(
         {
-            cv.GenerateID(): cv.declare_id(RBDimmerSensor),
-            cv.GenerateID(CONF_RBDIMMER_ID): cv.use_id(RBDimmerHub),
-            cv.Optional(CONF_AC_FREQUENCY): AC_FREQUENCY_SCHEMA,
-            cv.Optional(CONF_LEVEL): LEVEL_SCHEMA,
-            cv.Optional(CONF_FIRING_DELAY): FIRING_DELAY_SCHEMA,
+            cv.Optional(CONF_PHASE, default=0): cv.int_range(min=0, max=3),
+            cv.Optional(CONF_DEADBAND, default=deadband): cv.positive_float,
         }
-    ).extend(cv.polling_component_schema("60s"))
-)
+    )
+
+
+# key → (schema, needs CONFIG_RBDIMMER_INSTRUMENT)
+DIAGNOSTICS = {
+    CONF_FIRE_JITTER_P50: (
+        diagnostic_schema("us", ICON_PULSE, STATE_CLASS_MEASUREMENT, 2.0), True),
+    CONF_FIRE_JITTER_P99: (
+        diagnostic_schema("us", ICON_PULSE, STATE_CLASS_MEASUREMENT, 5.0), True),
+    CONF_ZC_LATENCY: (
+        diagnostic_schema("us", ICON_PULSE, STATE_CLASS_MEASUREMENT, 2.0), True),
+    CONF_REJECTED_EDGES: (
+        diagnostic_schema(None, ICON_COUNTER, STATE_CLASS_TOTAL_INCREASING, 1.0), False),
+    CONF_SYNTHESIZED_EDGES: (
+        diagnostic_schema(None, ICON_COUNTER, STATE_CLASS_TOTAL_INCREASING, 1.0), False),
+    CONF_MISSED_FIRINGS: (
+        diagnostic_schema(None, ICON_COUNTER, STATE_CLASS_TOTAL_INCREASING, 1.0), False),
+}
+
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(RBDimmerSensor),
+        cv.GenerateID(CONF_RBDIMMER_ID): cv.use_id(RBDimmerHub),
+        cv.Optional(CONF_AC_FREQUENCY): AC_FREQUENCY_SCHEMA,
+        cv.Optional(CONF_LEVEL): LEVEL_SCHEMA,
+        cv.Optional(CONF_FIRING_DELAY): FIRING_DELAY_SCHEMA,
+        **{cv.Optional(key): schema for key, (schema, _) in DIAGNOSTICS.items()},
+    }
+).extend(cv.polling_component_schema("60s"))
 
 
 async def to_code(config):
@@ -84,6 +130,7 @@ async def to_code(config):
         sens = await sensor.new_sensor(freq_conf)
         cg.add(var.set_ac_frequency_sensor(sens))
         cg.add(var.set_ac_frequency_phase(freq_conf.get(CONF_PHASE, 0)))
+        cg.add(var.set_ac_frequency_deadband(freq_conf[CONF_DEADBAND]))
 
     if CONF_LEVEL in config:
         level_conf = config[CONF_LEVEL]
@@ -98,3 +145,12 @@ async def to_code(config):
         cg.add(var.set_firing_delay_sensor(sens))
         light_var = await cg.get_variable(delay_conf[CONF_LIGHT_ID])
         cg.add(var.set_firing_delay_light(light_var))
+
+    for key, (_, instrumented) in DIAGNOSTICS.items():
+        if key not in config:
+            continue
+        conf = config[key]
+        sens = await sensor.new_sensor(conf)
+        cg.add(getattr(var, f"set_{key}_sensor")(sens, conf[CONF_PHASE], conf[CONF_DEADBAND]))
+        if instrumented:
+            add_idf_sdkconfig_option("CONFIG_RBDIMMER_INSTRUMENT", True)
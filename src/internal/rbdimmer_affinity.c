@@ -0,0 +1,116 @@
+/**
+ * @file rbdimmer_affinity.c
+ * @brief Core placement and interrupt priority of the real-time work
+ * @internal
+ *
+ * Implements rbdimmer_set_rt_affinity() (public API, declared in
+ * rbdimmerESP32.h).
+ *
+ * Why a core matters: on ESP32 / S3 Wi-Fi and Bluetooth run on core 0 and
+ * keep it busy in bursts.  A zero-cross ISR allocated there waits behind
+ * them, and every microsecond of that lands in the firing angle.  Moving
+ * the interrupts and the fade engine to core 1 leaves only the priority of
+ * other core-1 interrupts in the way; RBDIMMER_RT_INTR_PRIORITY removes
+ * that too.
+ *
+ * Interrupts are placed by allocating them on the target core through
+ * esp_ipc_call_blocking(); there is no API to move an allocated interrupt.
+ */
+
+#include "rbdimmer_affinity.h"
+#include "rbdimmer_hal.h"
+#include "esp_intr_alloc.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if RBDIMMER_HAL_RT_CORES > 1
+  #include "esp_ipc.h"
+#endif
+
+#define TAG "RBDIMMER"
+
+static int8_t  rt_core          = RBDIMMER_RT_CORE;
+static uint8_t rt_intr_priority = RBDIMMER_RT_INTR_PRIORITY;
+
+/** Core of the esp_timer interrupt (gate timers of the esp_timer backend). */
+#if defined(CONFIG_ESP_TIMER_ISR_AFFINITY_CPU1)
+  #define ESP_TIMER_ISR_CORE   1
+#elif defined(CONFIG_ESP_TIMER_ISR_AFFINITY_NO_AFFINITY)
+  #define ESP_TIMER_ISR_CORE   (-1)
+#else
+  #define ESP_TIMER_ISR_CORE   0   // CPU0 choice, and IDF versions without the option
+#endif
+
+#if RBDIMMER_HAL_RT_CORES > 1
+typedef struct {
+    esp_err_t (*fn)(void* arg);
+    void*     arg;
+    esp_err_t err;
+} ipc_call_t;
+
+static void ipc_trampoline(void* arg) {
+    ipc_call_t* call = (ipc_call_t*)arg;
+    call->err = call->fn(call->arg);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Internal API
+// ---------------------------------------------------------------------------
+
+int8_t rbdimmer_affinity_core(void) {
+    return rt_core;
+}
+
+int rbdimmer_affinity_task_core(void) {
+    return rt_core >= 0 ? rt_core : 0;
+}
+
+int rbdimmer_affinity_intr_priority(void) {
+    return rt_intr_priority;
+}
+
+int rbdimmer_affinity_intr_flags(void) {
+    static const int level_flags[] = {
+        0, ESP_INTR_FLAG_LEVEL1, ESP_INTR_FLAG_LEVEL2, ESP_INTR_FLAG_LEVEL3,
+    };
+    return level_flags[rt_intr_priority];
+}
+
+esp_err_t rbdimmer_affinity_call(esp_err_t (*fn)(void* arg), void* arg) {
+#if RBDIMMER_HAL_RT_CORES > 1
+    if (rt_core >= 0 && rt_core != (int8_t)xPortGetCoreID()) {
+        ipc_call_t call = { fn, arg, ESP_FAIL };
+        esp_err_t err = esp_ipc_call_blocking((uint32_t)rt_core, ipc_trampoline, &call);
+        return err != ESP_OK ? err : call.err;
+    }
+#endif
+    return fn(arg);
+}
+
+void rbdimmer_affinity_init(void) {
+    if (rt_core < 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "Real-time work on core %d, interrupt level %d",
+             rt_core, rt_intr_priority);
+#if !RBDIMMER_HAL_USE_GPTIMER && RBDIMMER_HAL_RT_CORES > 1
+    if (ESP_TIMER_ISR_CORE != rt_core) {
+        ESP_LOGW(TAG, "esp_timer interrupt (gate timers) is not on core %d — "
+                      "set ESP_TIMER_ISR_AFFINITY or use the GPTimer backend", rt_core);
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_set_rt_affinity(int8_t core, uint8_t intr_priority) {
+    if (core < -1 || core >= RBDIMMER_HAL_RT_CORES || intr_priority > 3) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rt_core          = core;
+    rt_intr_priority = intr_priority;
+    return RBDIMMER_OK;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file rbdimmer_affinity.h
+ * @brief Core placement and interrupt priority of the real-time work
+ * @internal
+ *
+ * ESP-IDF binds an interrupt to the core that allocates it.  The modules
+ * that allocate one — GPIO ISR service (rbdimmer_zerocross.c), GPTimer
+ * scheduler (rbdimmer_scheduler.c), MCPWM capture (rbdimmer_zc_capture.c) —
+ * run that call through rbdimmer_affinity_call(), which executes it on the
+ * configured core.  The fade engine task is pinned to the same core.
+ *
+ * Set from RBDIMMER_RT_CORE / RBDIMMER_RT_INTR_PRIORITY (Kconfig) or
+ * rbdimmer_set_rt_affinity() (public API, declared in rbdimmerESP32.h).
+ */
+
+#ifndef RBDIMMER_AFFINITY_H
+#define RBDIMMER_AFFINITY_H
+
+#include <stdint.h>
+#include "rbdimmerESP32.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Configured core, or -1 when the real-time work is not pinned. */
+int8_t rbdimmer_affinity_core(void);
+
+/** @brief Core for the fade engine task: the configured one, else CPU0 (Fix 1.6). */
+int rbdimmer_affinity_task_core(void);
+
+/** @brief Configured interrupt level 1-3, or 0 for the driver default. */
+int rbdimmer_affinity_intr_priority(void);
+
+/** @brief ESP_INTR_FLAG_LEVELn for the configured level, 0 for the default. */
+int rbdimmer_affinity_intr_flags(void);
+
+/**
+ * @brief Run @p fn on the configured core and return its result.
+ *
+ * Calls @p fn directly when the work is not pinned, the caller already runs
+ * on that core or the chip has one core; otherwise through esp_ipc on the
+ * IPC task of the target core (small stack: keep @p fn to a driver call).
+ * Task context only.
+ */
+esp_err_t rbdimmer_affinity_call(esp_err_t (*fn)(void* arg), void* arg);
+
+/**
+ * @brief Log the placement and warn when the esp_timer interrupt (gate timers
+ * of the esp_timer backend) runs on another core.  Called from rbdimmer_init().
+ */
+void rbdimmer_affinity_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_AFFINITY_H */
@@ -3,78 +3,752 @@
  * @brief Dimmer channel lifecycle, control, and zero-cross firing
  * @internal
  *
- * Owns dimmer_manager and on_zero_cross_phase (ISR phase-trigger).
+ * Owns dimmer_manager, the per-phase firing schedules and
+ * on_zero_cross_phase (ISR phase-trigger).
  * Implements all public channel API declared in rbdimmerESP32.h:
- *   create/delete, set_level, set_active, set_curve, getters, update_all.
+ *   create/delete, set_level, set_active, set_curve, set_custom_curve,
+ *   getters, update_all.
+ *
+ * Every change that affects firing (level, curve, active flag, channel
+ * create/delete) rebuilds the delay-sorted schedule of the affected phase in
+ * task context and publishes it to the ISR with a double-buffered swap.
+ * RBDIMMER_OUTPUT_MCPWM channels never enter the schedule; their changes go
+ * straight to the peripheral (rbdimmer_mcpwm.c).
+ *
+ * Channel storage: a static pool of RBDIMMER_MAX_CHANNELS slots (no heap,
+ * no fragmentation on long-running nodes; with RBDIMMER_STATIC_ALLOC the
+ * slot timers are created up front too).  Slots in use sit in an intrusive
+ * doubly-linked list of their phase, free slots on a free list, and a
+ * gpio → slot map catches duplicate pins — create, delete and the per-phase
+ * walks never scan the whole table.  Each reuse bumps the slot generation
+ * behind rbdimmer_channel_id_t.
+ *
+ * ZC-synchronised fades are started and stopped through a per-phase
+ * single-producer / single-consumer command ring: API callers (serialised by
+ * manager_mutex) post, on_zero_cross_phase drains it before it adopts the
+ * schedule.  The ISR is the only writer of the zc_fade_* fields and never
+ * writes current_delay, so neither side takes a spinlock for them.
+ *
+ * Soft start rides on the same ring: a channel leaving OFF gets a ZC fade
+ * from the dark end of the half-cycle to its delay (soft_start_begin), so
+ * the ISR ramps the angle with no task involved.
+ *
+ * Phase-group members (rbdimmer_group.c) may fire from another line's
+ * detector: update_channel_delay() shifts their delay by the line lag and
+ * wraps it into the detector's half-cycle, so the ISR sees an ordinary
+ * schedule entry.
+ *
+ * Burst-fire channels (RBDIMMER_MODE_BURST) have no firing delay.  They sit
+ * in the delay-0 part of the schedule with a duty and a rotation offset, and
+ * on_zero_cross_phase switches their gates directly: one decision per mains
+ * cycle, the gate held from the crossing through both half-cycles.
+ *
+ * Trailing-edge channels (RBDIMMER_MODE_TRAILING) are delay-0 entries as
+ * well: current_delay is the cut-off, written into the entry as a gate hold
+ * from the crossing.  on_zero_cross_phase raises their gates in Pass 1, so
+ * the only timed event is the release.
+ *
+ * Gate drive: every entry carries its channel's pulse width and, for
+ * RBDIMMER_GATE_HOLD / _TRAIN, the hold release just before the next
+ * crossing.  schedule_finalize() turns them into release times and a release
+ * order, so a longer gate costs no extra event.
+ *
+ * Mains drift: the ZC ISR compares the tracked half-cycle with the one the
+ * phase's delays were computed for.  Past FREQ_RESCALE_US it flags the phase
+ * and kicks an esp_timer (task dispatch) that recomputes only that phase.
  */
 
 #include "rbdimmer_channel.h"
 #include "rbdimmer_hal.h"
 #include "rbdimmer_zerocross.h"
 #include "rbdimmer_timer.h"
+#include "rbdimmer_scheduler.h"
+#include "rbdimmer_mcpwm.h"
 #include "rbdimmer_curves.h"
+#include "rbdimmer_transition.h"
+#include "rbdimmer_persist.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
 #include "esp_attr.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <stdlib.h>
 #include <string.h>
 
 #define TAG "RBDIMMER"
 
+// Channels whose delays differ by no more than this share one firing event.
+#ifdef CONFIG_RBDIMMER_GATE_BATCH_WINDOW_US
+#  define GATE_BATCH_WINDOW_US  CONFIG_RBDIMMER_GATE_BATCH_WINDOW_US
+#else
+#  define GATE_BATCH_WINDOW_US  0
+#endif
+
+// Half-cycle change that triggers a rescale of the phase's channel delays.
+#ifdef CONFIG_RBDIMMER_FREQ_RESCALE_US
+#  define FREQ_RESCALE_US  CONFIG_RBDIMMER_FREQ_RESCALE_US
+#else
+#  define FREQ_RESCALE_US  10
+#endif
+
 // ---------------------------------------------------------------------------
 // Module-private state
 // ---------------------------------------------------------------------------
 
+// Channel storage.  DRAM_ATTR: the ISR dereferences channels through the
+// phase schedule.
+static DRAM_ATTR rbdimmer_channel_t channel_pool[RBDIMMER_MAX_CHANNELS];
+
+// Task-side channel registry.  Since the per-phase schedule was introduced
+// the ISR never walks these lists, so they need no spinlock —
+// manager_mutex serialises API callers.
+static struct {
+    rbdimmer_channel_t* phase_head[RBDIMMER_MAX_PHASES];  // in-use slots per phase
+    rbdimmer_channel_t* free_head;                        // free slots via list_next
+    uint8_t count;
+} dimmer_manager;
+
+// O(1) duplicate check: gate gpio → pool slot, -1 = free.  A slot keeps its
+// pin until the channel is fully released.
+static int8_t gpio_to_slot[GPIO_NUM_MAX];
+
+#define CHANNEL_ID(ch)  ((rbdimmer_channel_id_t)(((ch)->generation << 8) | (ch)->slot))
+
+// Serialises dimmer_manager mutation and schedule rebuilds between tasks.
+// Statically allocated: created once in rbdimmer_channel_manager_init().
+static StaticSemaphore_t manager_mutex_buf;
+static SemaphoreHandle_t manager_mutex = NULL;
+
+// Staged changes of the open batch (rbdimmer_batch_*).  Owned by the task
+// that called rbdimmer_batch_begin() until rbdimmer_batch_commit();
+// batch_index is also cleared by rbdimmer_delete_channel(), so it is only
+// touched under manager_mutex.  An entry whose generation no longer matches
+// its slot belongs to a deleted channel and is dropped.
+// Lock order: batch_mutex → fade_mutex → manager_mutex.
+#define BATCH_OP_LEVEL  0x01
+#define BATCH_OP_CURVE  0x02
+
+static struct {
+    rbdimmer_channel_t* channel;
+    uint8_t generation;                          // channel->generation when staged
+    uint16_t level_q16;
+    rbdimmer_curve_t curve_type;
+    uint8_t ops;                                 // BATCH_OP_* bits
+} batch_ops[RBDIMMER_MAX_CHANNELS];
+static uint8_t      batch_count;
+static uint8_t      batch_index[RBDIMMER_MAX_CHANNELS];   // pool slot → batch_ops, 0xFF = none
+static TaskHandle_t batch_owner = NULL;
+
+static StaticSemaphore_t batch_mutex_buf;
+static SemaphoreHandle_t batch_mutex = NULL;
+
+// Frequency-drift rescale.  phase_half_cycle_us: half-cycle the delays of
+// each phase were last computed for (written by the task, read by the ISR).
+// rescale_pending: phases flagged by the ISR, drained by rescale_timer_cb.
+static DRAM_ATTR uint32_t phase_half_cycle_us[RBDIMMER_MAX_PHASES];
+static DRAM_ATTR uint32_t rescale_pending;
+static DRAM_ATTR esp_timer_handle_t rescale_timer = NULL;
+
+// Firings per phase still in TIMER_STATE_DELAY when the next crossing
+// reset them (timer starved or delay past the half-cycle).  ISR-only writer.
+static DRAM_ATTR uint32_t phase_missed[RBDIMMER_MAX_PHASES];
+
+// Burst-fire rotation of each phase (ISR-only).  cycle counts mains cycles;
+// a channel with duty D and offset O conducts in every cycle c where
+// c * D + O carries past 2^16 — Bresenham over whole cycles, so both
+// half-cycles of a cycle conduct and the load sees no DC.  held: burst gates
+// switched on at the last crossing, cleared at the next one even if the
+// channel has left the schedule since.
+static DRAM_ATTR struct {
+    uint16_t cycle;
+    bool     second_half;
+    uint64_t held;
+} burst_state[RBDIMMER_MAX_PHASES];
+
+// Double-buffered per-phase firing schedule.
+//
+// state bit 0 (SCHED_OWNER)   — index of the buffer the ISR is reading
+// state bit 1 (SCHED_PENDING) — the other buffer holds a newer schedule
+//
+// Task (publish): atomically clear PENDING — from then on the ISR cannot
+//   switch buffers — rebuild buf[!owner], then set PENDING.
+// ISR (acquire): if PENDING, flip OWNER and clear PENDING in one CAS.
+// The ISR therefore never sees a half-written schedule and the task never
+// writes the buffer the ISR is stepping through.
+#define SCHED_OWNER    0x1u
+#define SCHED_PENDING  0x2u
+
 // DRAM_ATTR: read by on_zero_cross_phase() in GPIO ISR context.
 // Without it, a cache-miss during flash write (NVS/OTA) could cause an exception.
 static DRAM_ATTR struct {
-    rbdimmer_channel_t* channels[RBDIMMER_MAX_CHANNELS];
-    uint8_t count;
-} dimmer_manager;
+    rbdimmer_phase_schedule_t buf[2];
+    uint32_t state;
+} phase_schedules[RBDIMMER_MAX_PHASES];
+
+// Per-phase command ring, task → ZC ISR.  head and tail are free-running:
+// head is written only by the task holding manager_mutex (the single
+// producer, whatever task or core it runs on), tail only by the phase ISR.
+// Slot contents are published by the release store of head.
+#define ZC_CMD_RING_LEN    16u               // per phase, power of two
+#define ZC_CMD_FADE_START  0
+#define ZC_CMD_FADE_STOP   1
+
+_Static_assert((ZC_CMD_RING_LEN & (ZC_CMD_RING_LEN - 1)) == 0,
+               "ZC_CMD_RING_LEN must be a power of two");
+
+typedef struct {
+    rbdimmer_channel_t* channel;
+    uint8_t  generation;                         // channel->generation when posted
+    uint8_t  op;                                 // ZC_CMD_*
+    uint32_t steps;                              // FADE_START: half-cycles
+    uint32_t start_q16;                          // FADE_START: first delay [µs << 16]
+    int32_t  step_q16;                           // FADE_START: increment [µs << 16]
+    uint32_t final_delay;                        // FADE_START: delay after the last step [µs]
+} zc_cmd_t;
+
+// DRAM_ATTR: drained by on_zero_cross_phase() in GPIO ISR context.
+static DRAM_ATTR struct {
+    zc_cmd_t slots[ZC_CMD_RING_LEN];
+    uint32_t head;                               // next slot to write (task)
+    uint32_t tail;                               // next slot to read (ISR)
+} zc_cmd_rings[RBDIMMER_MAX_PHASES];
+
+// Forward declarations
+static bool update_channel_delay(rbdimmer_channel_t* channel);
+static uint32_t curve_delay(const rbdimmer_channel_t* channel, uint16_t level_q16,
+                            uint32_t half_cycle_us);
+static void schedule_publish(uint8_t phase);
+static void schedule_wait_adopted(uint8_t phase);
+static void channel_commit(rbdimmer_channel_t* channel);
+static rbdimmer_err_t channel_stage(rbdimmer_channel_t* channel, uint8_t ops,
+                                    uint16_t level_q16, rbdimmer_curve_t curve_type,
+                                    bool* dirty);
+static rbdimmer_err_t zc_fade_stop(rbdimmer_channel_t* channel, bool* stopped);
+static bool zc_fade_running(rbdimmer_channel_t* channel);
+static uint32_t zc_fade_position(const rbdimmer_channel_t* channel);
+static uint32_t soft_start_origin(rbdimmer_channel_t* channel);
+static void soft_start_begin(rbdimmer_channel_t* channel, uint32_t origin);
+static void channels_recompute(uint32_t phase_mask);
+
+// ---------------------------------------------------------------------------
+// Schedule ordering (task context, and ISR for ZC-synchronised fades)
+// ---------------------------------------------------------------------------
+
+// Insertion sort by delay — O(n) for the nearly-sorted arrays a fade step
+// produces.  IRAM_ATTR: also called from on_zero_cross_phase().
+static IRAM_ATTR void schedule_sort(rbdimmer_phase_schedule_t* sched) {
+    for (int i = 1; i < sched->count; i++) {
+        rbdimmer_fire_entry_t entry = sched->entries[i];
+        int j = i;
+        while (j > 0 && sched->entries[j - 1].delay_us > entry.delay_us) {
+            sched->entries[j] = sched->entries[j - 1];
+            j--;
+        }
+        sched->entries[j] = entry;
+    }
+}
 
-// Spinlock protecting dimmer_manager.channels[] and .count.
-// Task side:  portENTER_CRITICAL / portEXIT_CRITICAL
-// (ISR side does not acquire this lock — see delete_channel comments)
-// DRAM_ATTR required because portMUX is touched in ISR-adjacent paths.
-static DRAM_ATTR portMUX_TYPE dimmer_spinlock = portMUX_INITIALIZER_UNLOCKED;
+// Insert entry @p idx into the first @p groups slots of release_order, by
+// release time — O(1) per group for equal widths.
+static IRAM_ATTR void release_insert(rbdimmer_phase_schedule_t* sched, uint8_t groups,
+                                     uint8_t idx) {
+    int j = groups;
+    while (j > 0 && sched->entries[sched->release_order[j - 1]].release_us >
+                    sched->entries[idx].release_us) {
+        sched->release_order[j] = sched->release_order[j - 1];
+        j--;
+    }
+    sched->release_order[j] = idx;
+}
 
-// Forward declaration
-static void update_channel_delay(rbdimmer_channel_t* channel);
+// Derive fire_start, reset_mask, release times and the firing groups from
+// the sorted entries (see rbdimmer_phase_schedule_t).  Delay-0 entries are
+// never fired; each is its own (inert) group so every entry has a defined
+// group_len.  A hold that would end before the pulse does gets the pulse.
+static IRAM_ATTR void schedule_finalize(rbdimmer_phase_schedule_t* sched) {
+    uint8_t n = sched->count;
+    uint8_t zero = 0;
+    uint64_t reset = 0;
+    uint64_t burst = 0;
+    uint64_t trailing = 0;
+    for (int i = 0; i < n; i++) {
+        reset |= sched->entries[i].gpio_mask;
+        if (sched->entries[i].delay_us == 0) {
+            zero++;
+            if (sched->entries[i].burst_duty_q16 != 0) {
+                burst |= sched->entries[i].gpio_mask;
+            }
+            if (sched->entries[i].trailing && sched->entries[i].hold_us != 0) {
+                trailing |= sched->entries[i].gpio_mask;
+            }
+        }
+    }
+    sched->fire_start    = zero;
+    sched->reset_mask    = reset;
+    sched->burst_mask    = burst;
+    sched->trailing_mask = trailing;
+
+    for (int i = 0; i < n; i++) {
+        rbdimmer_fire_entry_t* entry = &sched->entries[i];
+        entry->group_len  = (i < zero) ? 1 : 0;
+        entry->release_us = entry->delay_us + entry->pulse_us;
+        if (entry->hold_us > entry->release_us) {
+            entry->release_us = entry->hold_us;
+        }
+    }
+    uint8_t groups = 0;
+    for (int i = 0; i < zero; i++) {
+        if (sched->entries[i].gpio_mask & trailing) {
+            release_insert(sched, groups++, (uint8_t)i);
+        }
+    }
+    int lead = zero;
+    while (lead < n) {
+        rbdimmer_fire_entry_t* leader = &sched->entries[lead];
+        int end = lead + 1;
+        while (end < n && !leader->train && !sched->entries[end].train &&
+               sched->entries[end].delay_us - leader->delay_us <= GATE_BATCH_WINDOW_US) {
+            uint32_t r = sched->entries[end].release_us;
+            uint32_t skew = (r > leader->release_us) ? r - leader->release_us
+                                                     : leader->release_us - r;
+            if (skew > GATE_BATCH_WINDOW_US) {
+                break;
+            }
+            end++;
+        }
+        leader->group_len = (uint8_t)(end - lead);
+        release_insert(sched, groups++, (uint8_t)lead);
+        lead = end;
+    }
+    sched->group_count = groups;
+}
 
 // ---------------------------------------------------------------------------
 // ISR phase-trigger
 // ---------------------------------------------------------------------------
 
+// Apply the commands posted since the last crossing of this phase.  A
+// command for a slot that was deleted and reused since is dropped.
+static IRAM_ATTR void zc_cmd_drain(uint8_t phase) {
+    uint32_t head = __atomic_load_n(&zc_cmd_rings[phase].head, __ATOMIC_ACQUIRE);
+    uint32_t tail = zc_cmd_rings[phase].tail;
+    if (tail == head) {
+        return;
+    }
+    for (; tail != head; tail++) {
+        const zc_cmd_t* cmd = &zc_cmd_rings[phase].slots[tail & (ZC_CMD_RING_LEN - 1)];
+        rbdimmer_channel_t* ch = cmd->channel;
+        if (ch->generation != cmd->generation) {
+            continue;
+        }
+        if (cmd->op == ZC_CMD_FADE_START) {
+            ch->zc_fade_delay_q16   = cmd->start_q16;
+            ch->zc_fade_step_q16    = cmd->step_q16;
+            ch->zc_fade_final_delay = cmd->final_delay;
+            ch->zc_fade_steps       = cmd->steps;
+        } else {
+            ch->zc_fade_steps = 0;
+        }
+    }
+    __atomic_store_n(&zc_cmd_rings[phase].tail, tail, __ATOMIC_RELEASE);
+}
+
+// Advance every ZC-synchronised fade of this phase by one half-cycle and
+// restore the schedule order if any delay moved.  Every schedule built after
+// a fade was posted already holds its final delay (the task sets
+// current_delay to the target), so the last step only has to land there.
+static IRAM_ATTR void zc_fade_step(uint8_t phase, rbdimmer_phase_schedule_t* sched) {
+    bool any = false;
+    for (int i = 0; i < sched->count; i++) {
+        if (sched->entries[i].channel->zc_fade_steps != 0) {
+            any = true;
+            break;
+        }
+    }
+    if (!any) {
+        return;
+    }
+#if RBDIMMER_HAL_USE_GPTIMER
+    // The alarm ISR may still be finishing the previous half-cycle on the
+    // other core — detach it before entries move.
+    rbdimmer_sched_halt_phase(phase);
+#else
+    (void)phase;
+#endif
+
+    for (int i = 0; i < sched->count; i++) {
+        rbdimmer_fire_entry_t* entry = &sched->entries[i];
+        rbdimmer_channel_t* ch = entry->channel;
+        if (ch->zc_fade_steps == 0) {
+            continue;
+        }
+        if (--ch->zc_fade_steps == 0) {
+            entry->delay_us = ch->zc_fade_final_delay;
+        } else {
+            ch->zc_fade_delay_q16 += (uint32_t)ch->zc_fade_step_q16;
+            entry->delay_us = ch->zc_fade_delay_q16 >> 16;
+        }
+    }
+
+    schedule_sort(sched);
+    schedule_finalize(sched);
+}
+
+// Switch on the burst-fire gates that conduct in this half-cycle.  The first
+// half-cycle of a mains cycle decides, the second repeats that decision for
+// the channels still in the schedule; a channel added in between waits for
+// the next cycle.  Called right after Pass 1 cleared the gates.
+static IRAM_ATTR void burst_fire(uint8_t phase, const rbdimmer_phase_schedule_t* sched) {
+    uint64_t on = 0;
+    if (burst_state[phase].second_half) {
+        on = burst_state[phase].held & sched->burst_mask;
+    } else if (sched->burst_mask != 0) {
+        uint16_t c = ++burst_state[phase].cycle;
+        for (int i = 0; i < sched->fire_start; i++) {
+            const rbdimmer_fire_entry_t* entry = &sched->entries[i];
+            uint16_t duty = entry->burst_duty_q16;
+            if (duty == RBDIMMER_LEVEL_Q16_MAX ||
+                (uint16_t)((uint32_t)c * duty + entry->burst_offset_q16) < duty) {
+                on |= entry->gpio_mask;
+            }
+        }
+    }
+    burst_state[phase].second_half = !burst_state[phase].second_half;
+    burst_state[phase].held = on;
+    if (on != 0) {
+        rbdimmer_hal_gate_set_mask(on);
+    }
+}
+
+// Trailing edge: gates on at the crossing, their release event (cut-off) is
+// armed in Pass 2.  A gate still on from the last half-cycle stays on.
+static IRAM_ATTR void trailing_fire(const rbdimmer_phase_schedule_t* sched) {
+    if (sched->trailing_mask == 0) {
+        return;
+    }
+    for (int i = 0; i < sched->fire_start; i++) {
+        if (sched->entries[i].gpio_mask & sched->trailing_mask) {
+            sched->entries[i].channel->timer_state = TIMER_STATE_PULSE_ON;
+        }
+    }
+    rbdimmer_hal_gate_set_mask(sched->trailing_mask);
+}
+
+// Adopt a freshly published schedule (if any) and return the current one.
+static IRAM_ATTR rbdimmer_phase_schedule_t* schedule_acquire(uint8_t phase) {
+    uint32_t st = __atomic_load_n(&phase_schedules[phase].state, __ATOMIC_ACQUIRE);
+    while (st & SCHED_PENDING) {
+        uint32_t next = (st ^ SCHED_OWNER) & SCHED_OWNER;
+        if (__atomic_compare_exchange_n(&phase_schedules[phase].state, &st, next,
+                                        false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            st = next;
+        }
+    }
+    return &phase_schedules[phase].buf[st & SCHED_OWNER];
+}
+
 // Called from zero-cross ISR for every zero-crossing on a given phase.
+// Reads only the precomputed schedule of its own phase — no scan of the
+// channel table, no is_active / phase checks.
+// Commands are drained first, so a fade posted together with a schedule
+// is started in the same half-cycle that adopts it.
 // Two-pass design:
 //   Pass 1 — immediately stop all timers and drive all TRIAC GPIOs LOW so
-//             every channel on this phase is reset at the same ZC instant.
+//             every channel on this phase is reset at the same ZC instant;
+//             then switch on the burst-fire gates of this half-cycle and
+//             the trailing-edge gates.
 //   Pass 2 — arm the delay timers now that all outputs are safely deasserted.
+//             GPTimer backend: hand the sorted schedule to the phase
+//             scheduler, which arms its single alarm.
 // IRAM_ATTR: runs directly in GPIO ISR context.
-static IRAM_ATTR void on_zero_cross_phase(uint8_t phase) {
-    // Pass 1: GPIO LOW for all active channels on this phase
-    for (int i = 0; i < dimmer_manager.count; i++) {
-        rbdimmer_channel_t* channel = dimmer_manager.channels[i];
-        if (channel->is_active && channel->phase == phase) {
-
-            esp_timer_stop(channel->delay_timer);
-            esp_timer_stop(channel->pulse_timer);
-            gpio_set_level((gpio_num_t)channel->gpio_pin, 0);
-            channel->timer_state = TIMER_STATE_IDLE;
+static IRAM_ATTR void on_zero_cross_phase(uint8_t phase, uint32_t half_cycle_us,
+                                          uint32_t cross_time) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    zc_cmd_drain(phase);
+    rbdimmer_phase_schedule_t* sched = schedule_acquire(phase);
+
+    // Pass 1: GPIO LOW for all active channels on this phase (one store)
+    for (int i = 0; i < sched->count; i++) {
+        rbdimmer_channel_t* channel = sched->entries[i].channel;
+#if !RBDIMMER_HAL_USE_GPTIMER
+        esp_timer_stop(channel->delay_timer);
+        esp_timer_stop(channel->pulse_timer);
+#endif
+        if (channel->timer_state == TIMER_STATE_DELAY) {
+            phase_missed[phase]++;
         }
+        channel->timer_state = TIMER_STATE_IDLE;
     }
-    // Pass 2: arm delay timers
-    for (int i = 0; i < dimmer_manager.count; i++) {
-        rbdimmer_channel_t* channel = dimmer_manager.channels[i];
-        if (channel->is_active && channel->phase == phase) {
-            if (channel->current_delay > 0) {
-                esp_timer_start_once(channel->delay_timer, channel->current_delay);
-                channel->timer_state = TIMER_STATE_DELAY;
-            }
+    rbdimmer_hal_gate_clear_mask((sched->reset_mask & ~sched->trailing_mask) |
+                                 burst_state[phase].held);
+    burst_fire(phase, sched);
+    trailing_fire(sched);
+
+    // Outputs are safe — now move fading delays for this half-cycle
+    zc_fade_step(phase, sched);
+
+#if RBDIMMER_HAL_USE_GPTIMER
+    // Pass 2: one ordered event list, one hardware alarm
+    rbdimmer_sched_arm_phase(phase, sched, cross_time);
+#else
+    // Pass 2: arm the leader's delay timer of every firing group
+    // (entries with delay 0 are skipped by fire_start)
+    for (int i = sched->fire_start; i < sched->count; i++) {
+        const rbdimmer_fire_entry_t* entry = &sched->entries[i];
+        entry->channel->timer_state = TIMER_STATE_DELAY;
+        if (entry->group_len != 0) {
+            entry->channel->armed_entry = entry;
+        }
+    }
+    // Delays count from cross_time, not from now: subtract what already passed
+    int32_t elapsed = (int32_t)((uint32_t)esp_timer_get_time() - cross_time);
+    // Trailing edge: the gate is on already, only the cut-off is timed
+    for (int i = 0; i < sched->fire_start && sched->trailing_mask != 0; i++) {
+        const rbdimmer_fire_entry_t* entry = &sched->entries[i];
+        if ((entry->gpio_mask & sched->trailing_mask) == 0) {
+            continue;
+        }
+        int32_t remaining = (int32_t)entry->release_us - elapsed;
+        entry->channel->armed_entry = entry;
+#if RBDIMMER_INSTRUMENT
+        entry->channel->armed_due = cross_time + entry->release_us;
+#endif
+        esp_timer_start_once(entry->channel->pulse_timer,
+                             (uint64_t)(remaining > 1 ? remaining : 1));
+    }
+    for (int i = sched->fire_start; i < sched->count; i += sched->entries[i].group_len) {
+        const rbdimmer_fire_entry_t* entry = &sched->entries[i];
+        int32_t remaining = (int32_t)entry->delay_us - elapsed;
+#if RBDIMMER_INSTRUMENT
+        entry->channel->armed_due = cross_time + entry->delay_us;
+#endif
+        esp_timer_start_once(entry->channel->delay_timer,
+                             (uint64_t)(remaining > 1 ? remaining : 1));
+    }
+#endif
+
+    // Gates are armed — now check whether the mains drifted away from the
+    // half-cycle this phase's delays were computed for.
+    uint32_t applied = phase_half_cycle_us[phase];
+    uint32_t drift = (half_cycle_us > applied) ? half_cycle_us - applied
+                                               : applied - half_cycle_us;
+    if (drift > FREQ_RESCALE_US && rescale_timer != NULL &&
+        (__atomic_fetch_or(&rescale_pending, 1u << phase, __ATOMIC_RELAXED) &
+         (1u << phase)) == 0) {
+        esp_timer_start_once(rescale_timer, 0);
+    }
+}
+
+// esp_timer task context: recompute the phases flagged by the ISR.  Waits
+// for manager_mutex, which API calls hold only for a schedule rebuild.
+static void rescale_timer_cb(void* arg) {
+    (void)arg;
+    uint32_t mask = __atomic_exchange_n(&rescale_pending, 0, __ATOMIC_ACQ_REL);
+    if (mask == 0) {
+        return;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    channels_recompute(mask);
+    xSemaphoreGive(manager_mutex);
+}
+
+// ---------------------------------------------------------------------------
+// Schedule build / publish (task context)
+// ---------------------------------------------------------------------------
+
+// Collect the active software-output channels of @p phase into @p out and
+// order them by delay.  Caller holds manager_mutex.
+// Burst-fire channels get evenly spaced rotation offsets, so channels at
+// the same level take turns instead of conducting in the same cycles.
+static void schedule_build(rbdimmer_phase_schedule_t* out, uint8_t phase) {
+    uint8_t n = 0;
+    uint8_t bursts = 0;
+    for (rbdimmer_channel_t* channel = dimmer_manager.phase_head[phase];
+         channel != NULL; channel = channel->list_next) {
+        if (!channel->is_active || channel->output != RBDIMMER_OUTPUT_TIMER) {
+            continue;
+        }
+        bool trailing = (channel->mode == RBDIMMER_MODE_TRAILING);
+        out->entries[n].gpio_mask = 1ULL << channel->gpio_pin;
+        out->entries[n].delay_us  = trailing ? 0 : channel->current_delay;
+        out->entries[n].channel   = channel;
+        out->entries[n].burst_duty_q16 = (channel->mode == RBDIMMER_MODE_BURST)
+                                         ? channel->burst_duty_q16 : 0;
+        // Trailing edge: a hold from the crossing to the cut-off
+        out->entries[n].pulse_us  = trailing ? 0 : channel->pulse_us;
+        out->entries[n].hold_us   = trailing ? (uint16_t)channel->current_delay
+                                             : channel->hold_us;
+        out->entries[n].train     = (channel->gate == RBDIMMER_GATE_TRAIN);
+        out->entries[n].trailing  = trailing;
+        if (out->entries[n].burst_duty_q16 != 0) {
+            bursts++;
+        }
+        n++;
+    }
+    uint8_t rank = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (out->entries[i].burst_duty_q16 != 0) {
+            out->entries[i].burst_offset_q16 = (uint16_t)(((uint32_t)rank << 16) / bursts);
+            rank++;
         }
     }
+    out->count = n;
+    schedule_sort(out);
+    schedule_finalize(out);
+}
+
+// Rebuild the schedule of @p phase and hand it to the ISR.  The ISR picks it
+// up at the next zero-crossing.  Caller holds manager_mutex.
+static void schedule_publish(uint8_t phase) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    uint32_t st = __atomic_fetch_and(&phase_schedules[phase].state,
+                                     ~SCHED_PENDING, __ATOMIC_ACQ_REL);
+    uint32_t back = (st & SCHED_OWNER) ^ SCHED_OWNER;
+    schedule_build(&phase_schedules[phase].buf[back], phase);
+    __atomic_fetch_or(&phase_schedules[phase].state, SCHED_PENDING,
+                      __ATOMIC_RELEASE);
+}
+
+// Two half-cycles of @p phase in ticks: how long the task waits for the ISR
+// before it assumes the phase has no mains signal.
+static TickType_t phase_wait_ticks(uint8_t phase) {
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
+    uint32_t half_cycle_us = (zc != NULL) ? zc->half_cycle_us : 10000;
+    return pdMS_TO_TICKS((2 * half_cycle_us) / 1000) + 1;
+}
+
+// Block until the ISR has adopted the last published schedule of @p phase,
+// i.e. no ISR path can still reference a channel removed from it.  Bounded
+// by two half-cycles so a phase without mains signal cannot hang the caller
+// (the ISR adopts any pending schedule before touching channels).
+static void schedule_wait_adopted(uint8_t phase) {
+    TickType_t timeout = phase_wait_ticks(phase);
+    TickType_t start   = xTaskGetTickCount();
+
+    while ((__atomic_load_n(&phase_schedules[phase].state, __ATOMIC_ACQUIRE)
+            & SCHED_PENDING) != 0) {
+        if ((xTaskGetTickCount() - start) > timeout) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Command ring (task context, caller holds manager_mutex)
+// ---------------------------------------------------------------------------
+
+// True while the command ring of @p phase has no free slot.
+static bool zc_cmd_full(uint8_t phase) {
+    return zc_cmd_rings[phase].head -
+           __atomic_load_n(&zc_cmd_rings[phase].tail, __ATOMIC_ACQUIRE) >= ZC_CMD_RING_LEN;
+}
+
+// Wait for a free slot in the command ring of @p phase, at most two
+// half-cycles (phase without mains signal).  Called WITHOUT manager_mutex —
+// rescale_timer_cb() waits for it on the esp_timer task, behind which the
+// gate timers of a task-dispatch build queue.  Only a hint: another
+// producer can take the slot before the caller posts.
+static void zc_cmd_wait_space(uint8_t phase) {
+    TickType_t timeout = phase_wait_ticks(phase);
+    TickType_t start   = xTaskGetTickCount();
+    while (zc_cmd_full(phase) && (xTaskGetTickCount() - start) <= timeout) {
+        vTaskDelay(1);
+    }
+}
+
+// Queue @p cmd for the phase ISR of @p channel.  Never waits: false, and
+// the command is not posted, if the ring is full (more than
+// ZC_CMD_RING_LEN commands for the phase within one half-cycle, or no
+// mains signal).
+static bool zc_cmd_post(rbdimmer_channel_t* channel, zc_cmd_t* cmd) {
+    uint8_t phase = channel->phase;
+    uint32_t head = zc_cmd_rings[phase].head;
+    if (zc_cmd_full(phase)) {
+        ESP_LOGW(TAG, "Phase %d command queue full (no zero-cross?)", phase);
+        return false;
+    }
+    cmd->channel    = channel;
+    cmd->generation = channel->generation;
+    zc_cmd_rings[phase].slots[head & (ZC_CMD_RING_LEN - 1)] = *cmd;
+    __atomic_store_n(&zc_cmd_rings[phase].head, head + 1, __ATOMIC_RELEASE);
+    channel->zc_fade_seq = head + 1;
+    return true;
+}
+
+// True once the ISR has taken the last command posted for @p channel.
+static bool zc_cmd_applied(const rbdimmer_channel_t* channel) {
+    uint32_t tail = __atomic_load_n(&zc_cmd_rings[channel->phase].tail, __ATOMIC_ACQUIRE);
+    return (int32_t)(tail - channel->zc_fade_seq) >= 0;
+}
+
+// ---------------------------------------------------------------------------
+// Channel pool (task context, caller holds manager_mutex)
+// ---------------------------------------------------------------------------
+
+// True if @p channel is a live slot of the pool.
+static bool channel_valid(const rbdimmer_channel_t* channel) {
+    uintptr_t offset = (uintptr_t)channel - (uintptr_t)channel_pool;
+    return channel != NULL && offset < sizeof(channel_pool) &&
+           offset % sizeof(rbdimmer_channel_t) == 0 && channel->in_use;
+}
+
+// Take a free slot: zeroed, next generation, linked into @p phase.
+static rbdimmer_channel_t* channel_alloc(uint8_t phase, uint8_t gpio_pin) {
+    rbdimmer_channel_t* channel = dimmer_manager.free_head;
+    if (channel == NULL) {
+        return NULL;
+    }
+    dimmer_manager.free_head = channel->list_next;
+
+    uint8_t slot       = channel->slot;
+    uint8_t generation = (uint8_t)(channel->generation + 1);
+    memset(channel, 0, sizeof(*channel));
+    channel->slot       = slot;
+    channel->generation = generation ? generation : 1;
+    channel->in_use     = true;
+    channel->gpio_pin   = gpio_pin;
+    channel->phase      = phase;
+
+    channel->list_next = dimmer_manager.phase_head[phase];
+    if (channel->list_next != NULL) {
+        channel->list_next->list_prev = channel;
+    }
+    dimmer_manager.phase_head[phase] = channel;
+    gpio_to_slot[gpio_pin] = (int8_t)slot;
+    dimmer_manager.count++;
+    return channel;
+}
+
+// Take @p channel out of its phase list; the slot stays reserved (pin
+// included) until channel_release().
+static void channel_unlink(rbdimmer_channel_t* channel) {
+    if (channel->list_prev != NULL) {
+        channel->list_prev->list_next = channel->list_next;
+    } else {
+        dimmer_manager.phase_head[channel->phase] = channel->list_next;
+    }
+    if (channel->list_next != NULL) {
+        channel->list_next->list_prev = channel->list_prev;
+    }
+    channel->list_prev = NULL;
+    channel->list_next = NULL;
+    channel->in_use    = false;
+    dimmer_manager.count--;
+}
+
+// Return an unlinked slot to the free list.
+static void channel_release(rbdimmer_channel_t* channel) {
+    gpio_to_slot[channel->gpio_pin] = -1;
+    channel->list_next = dimmer_manager.free_head;
+    dimmer_manager.free_head = channel;
 }
 
 // ---------------------------------------------------------------------------
@@ -83,13 +757,64 @@ static IRAM_ATTR void on_zero_cross_phase(uint8_t phase) {
 
 rbdimmer_err_t rbdimmer_channel_manager_init(void) {
     memset(&dimmer_manager, 0, sizeof(dimmer_manager));
+    memset(gpio_to_slot, -1, sizeof(gpio_to_slot));
+    memset(batch_index, 0xFF, sizeof(batch_index));
+    // Build the free list; generations survive re-init so old ids stay stale
+    for (int i = RBDIMMER_MAX_CHANNELS - 1; i >= 0; i--) {
+        channel_pool[i].slot      = (uint8_t)i;
+        channel_pool[i].in_use    = false;
+        channel_pool[i].list_prev = NULL;
+        channel_pool[i].list_next = dimmer_manager.free_head;
+        dimmer_manager.free_head  = &channel_pool[i];
+    }
+    memset(phase_schedules, 0, sizeof(phase_schedules));
+    memset(zc_cmd_rings, 0, sizeof(zc_cmd_rings));
+    memset(phase_half_cycle_us, 0, sizeof(phase_half_cycle_us));
+    memset(phase_missed, 0, sizeof(phase_missed));
+    memset(burst_state, 0, sizeof(burst_state));
+    rescale_pending = 0;
+    if (manager_mutex == NULL) {
+        manager_mutex = xSemaphoreCreateMutexStatic(&manager_mutex_buf);
+    }
+    if (batch_mutex == NULL) {
+        batch_mutex = xSemaphoreCreateMutexStatic(&batch_mutex_buf);
+    }
+    if (rescale_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback        = rescale_timer_cb,
+            .arg             = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name            = "dimmer_rescale",
+        };
+        if (esp_timer_create(&args, &rescale_timer) != ESP_OK) {
+            ESP_LOGW(TAG, "No rescale timer: call rbdimmer_update_all() after frequency changes");
+            rescale_timer = NULL;
+        }
+    }
+    // RBDIMMER_STATIC_ALLOC: per-slot esp_timers now, not at channel create
+    if (rbdimmer_timer_pool_init(channel_pool, RBDIMMER_MAX_CHANNELS) != RBDIMMER_OK) {
+        ESP_LOGE(TAG, "Failed to create channel timers");
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
     rbdimmer_zc_set_phase_trigger(on_zero_cross_phase);
     return RBDIMMER_OK;
 }
 
 void rbdimmer_channel_manager_deinit(void) {
-    while (dimmer_manager.count > 0) {
-        rbdimmer_delete_channel(dimmer_manager.channels[0]);
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        while (dimmer_manager.phase_head[p] != NULL) {
+            rbdimmer_delete_channel(dimmer_manager.phase_head[p]);
+        }
+    }
+#if RBDIMMER_HAL_USE_GPTIMER
+    rbdimmer_sched_deinit();
+#endif
+    rbdimmer_timer_pool_deinit();
+    if (rescale_timer != NULL) {
+        esp_timer_handle_t timer = rescale_timer;
+        rescale_timer = NULL;           // ISR stops kicking it
+        esp_timer_stop(timer);
+        esp_timer_delete(timer);
     }
 }
 
@@ -104,10 +829,28 @@ rbdimmer_err_t rbdimmer_create_channel(rbdimmer_config_t* config,
         return RBDIMMER_ERR_INVALID_ARG;
     }
 
-    // W6: check capacity BEFORE allocating any resources
-    if (dimmer_manager.count >= RBDIMMER_MAX_CHANNELS) {
-        ESP_LOGE(TAG, "Maximum number of channels reached (%d)", RBDIMMER_MAX_CHANNELS);
-        return RBDIMMER_ERR_NO_MEMORY;
+    if (config->output != RBDIMMER_OUTPUT_TIMER &&
+        (config->output != RBDIMMER_OUTPUT_MCPWM || !RBDIMMER_HAL_HAS_MCPWM)) {
+        ESP_LOGE(TAG, "Output backend %d not supported on this chip", config->output);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+
+    if (config->mode != RBDIMMER_MODE_PHASE && config->mode != RBDIMMER_MODE_TRAILING &&
+        (config->mode != RBDIMMER_MODE_BURST || config->output != RBDIMMER_OUTPUT_TIMER)) {
+        ESP_LOGE(TAG, "Firing mode %d not supported with output %d",
+                 config->mode, config->output);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+
+    uint16_t pulse_us = config->pulse_width_us ? config->pulse_width_us
+                                               : RBDIMMER_DEFAULT_PULSE_WIDTH_US;
+    if (config->gate > RBDIMMER_GATE_TRAIN || pulse_us > RBDIMMER_PULSE_WIDTH_MAX_US ||
+        (config->gate == RBDIMMER_GATE_TRAIN &&
+         (!RBDIMMER_HAL_USE_GPTIMER || config->output != RBDIMMER_OUTPUT_TIMER ||
+          pulse_us >= RBDIMMER_GATE_TRAIN_PERIOD_US))) {
+        ESP_LOGE(TAG, "Gate drive %d with %u us pulses not supported with output %d",
+                 config->gate, pulse_us, config->output);
+        return RBDIMMER_ERR_INVALID_ARG;
     }
 
     if (!RBDIMMER_HAL_IS_OUTPUT_GPIO(config->gpio_pin)) {
@@ -116,26 +859,30 @@ rbdimmer_err_t rbdimmer_create_channel(rbdimmer_config_t* config,
         return RBDIMMER_ERR_INVALID_ARG;
     }
 
-    // W3: reject duplicate GPIO — two channels on the same pin would fight
-    // over the TRIAC gate and produce undefined hardware behaviour.
-    for (int i = 0; i < dimmer_manager.count; i++) {
-        if (dimmer_manager.channels[i]->gpio_pin == config->gpio_pin) {
-            ESP_LOGE(TAG, "GPIO %d is already used by channel %d",
-                     config->gpio_pin, i);
-            return RBDIMMER_ERR_ALREADY_EXIST;
-        }
-    }
-
     rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(config->phase);
     if (zc == NULL) {
         ESP_LOGE(TAG, "Phase %d not registered", config->phase);
         return RBDIMMER_ERR_NOT_FOUND;
     }
 
-    rbdimmer_channel_t* new_channel =
-        (rbdimmer_channel_t*)malloc(sizeof(rbdimmer_channel_t));
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+
+    // W3: reject duplicate GPIO — two channels on the same pin would fight
+    // over the TRIAC gate and produce undefined hardware behaviour.
+    if (gpio_to_slot[config->gpio_pin] >= 0) {
+        xSemaphoreGive(manager_mutex);
+        ESP_LOGE(TAG, "GPIO %d is already used by channel %d",
+                 config->gpio_pin, gpio_to_slot[config->gpio_pin]);
+        return RBDIMMER_ERR_ALREADY_EXIST;
+    }
+
+    // W6: check capacity BEFORE allocating any resources.  The slot is
+    // linked into the phase list already — schedule_build() skips it until
+    // is_active is set below.
+    rbdimmer_channel_t* new_channel = channel_alloc(config->phase, config->gpio_pin);
     if (new_channel == NULL) {
-        ESP_LOGE(TAG, "Memory allocation failed");
+        xSemaphoreGive(manager_mutex);
+        ESP_LOGE(TAG, "Maximum number of channels reached (%d)", RBDIMMER_MAX_CHANNELS);
         return RBDIMMER_ERR_NO_MEMORY;
     }
 
@@ -147,47 +894,79 @@ rbdimmer_err_t rbdimmer_create_channel(rbdimmer_config_t* config,
         .intr_type      = GPIO_INTR_DISABLE
     };
     if (gpio_config(&io_conf) != ESP_OK) {
+        channel_unlink(new_channel);
+        channel_release(new_channel);
+        xSemaphoreGive(manager_mutex);
         ESP_LOGE(TAG, "GPIO configuration failed");
-        free(new_channel);
         return RBDIMMER_ERR_GPIO_FAILED;
     }
 
     gpio_set_level((gpio_num_t)config->gpio_pin, 0);
 
-    if (rbdimmer_timer_create(new_channel) != RBDIMMER_OK) {
+    // Timer backend needs pin and phase (GPTimer scheduler is per phase)
+    new_channel->output   = config->output;
+    new_channel->mode     = config->mode;
+    new_channel->gate     = (config->mode == RBDIMMER_MODE_PHASE) ? config->gate
+                                                                  : RBDIMMER_GATE_PULSE;
+    new_channel->pulse_us = pulse_us;
+    new_channel->mcpwm    = NULL;
+    if (new_channel->output == RBDIMMER_OUTPUT_MCPWM) {
+        rbdimmer_err_t err = rbdimmer_mcpwm_create(new_channel, zc->pin);
+        if (err != RBDIMMER_OK) {
+            channel_unlink(new_channel);
+            channel_release(new_channel);
+            xSemaphoreGive(manager_mutex);
+            return err;
+        }
+    } else if (rbdimmer_timer_create(new_channel) != RBDIMMER_OK) {
+        channel_unlink(new_channel);
+        channel_release(new_channel);
+        xSemaphoreGive(manager_mutex);
         ESP_LOGE(TAG, "Failed to create timers");
-        free(new_channel);
         return RBDIMMER_ERR_TIMER_FAILED;
     }
 
-    new_channel->gpio_pin          = config->gpio_pin;
-    new_channel->phase             = config->phase;
-    new_channel->level_percent     = config->initial_level > 100 ? 100
-                                                                  : config->initial_level;
+    // Fast boot: the gate's last level and curve win over the config
+    uint16_t level_q16 = RBDIMMER_CURVES_PCT_TO_Q16(config->initial_level > 100
+                                                    ? 100 : config->initial_level);
+    rbdimmer_curve_t curve = config->curve_type;
+    if (rbdimmer_persist_channel(config->gpio_pin, config->phase, &level_q16, &curve)) {
+        ESP_LOGI(TAG, "Restored level %u/65535, curve %d on pin %d",
+                 level_q16, curve, config->gpio_pin);
+    }
+    new_channel->level_q16         = level_q16;
+    new_channel->level_percent     = RBDIMMER_CURVES_Q16_TO_PCT(level_q16);
     new_channel->prev_level_percent = 255; // force update on first run
-    new_channel->curve_type        = config->curve_type;
-    new_channel->is_active         = true;
-    new_channel->needs_update      = true;
+    new_channel->curve_type        = curve;
+    new_channel->custom_curve      = RBDIMMER_CUSTOM_CURVE_NONE;
+    new_channel->needs_update      = false;
     new_channel->timer_state       = TIMER_STATE_IDLE;
-    new_channel->transition_task   = NULL;
-    new_channel->current_delay     = rbdimmer_curves_level_to_delay(
-        new_channel->level_percent,
-        zc->half_cycle_us,
-        new_channel->curve_type
-    );
+    new_channel->armed_entry       = NULL;
+    new_channel->fade_slot         = RBDIMMER_FADE_SLOT_NONE;
+    new_channel->zc_fade_steps     = 0;
+    new_channel->zc_fade_delay_q16 = 0;
+    new_channel->zc_fade_step_q16  = 0;
+    new_channel->zc_fade_final_delay = 0;
+    new_channel->zc_fade_armed     = false;
+    new_channel->soft_start        = config->soft_start_half_cycles;
+    if (new_channel->mode == RBDIMMER_MODE_BURST) {
+        new_channel->current_delay  = 0;             // never timer-fired
+        new_channel->burst_duty_q16 = new_channel->level_q16;
+    } else {
+        new_channel->needs_update   = true;          // delay and gate hold
+        update_channel_delay(new_channel);
+    }
 
     ESP_LOGI(TAG, "Initial delay: %"PRIu32" us, half-cycle: %"PRIu32" us",
              new_channel->current_delay, (uint32_t)zc->half_cycle_us);
 
-    // C4/C5 fix: write pointer then increment count inside a critical section.
-    // portENTER_CRITICAL disables interrupts on this core (prevents ISR) and
-    // acquires the spinlock (prevents concurrent task access from other core).
-    // It also provides a full CPU memory barrier on both Xtensa and RISC-V,
-    // which a plain compiler barrier (__asm__ volatile) does not.
-    portENTER_CRITICAL(&dimmer_spinlock);
-    dimmer_manager.channels[dimmer_manager.count] = new_channel;
-    dimmer_manager.count++;
-    portEXIT_CRITICAL(&dimmer_spinlock);
+    // The ISR only sees the channel once the rebuilt schedule is published,
+    // so the struct is fully initialised before any ISR can reach it.
+    new_channel->is_active = true;
+    soft_start_begin(new_channel, 0);
+    channel_commit(new_channel);
+
+    xSemaphoreGive(manager_mutex);
 
     *channel = new_channel;
 
@@ -201,70 +980,233 @@ rbdimmer_err_t rbdimmer_delete_channel(rbdimmer_channel_t* channel) {
         return RBDIMMER_ERR_INVALID_ARG;
     }
 
-    // Step 1: Deactivate — on_zero_cross_phase() checks is_active before
-    // touching timers, so after this write the ISR will skip this channel
-    // on every subsequent zero-crossing.
-    channel->is_active = false;
+    // The fade engine must not step a channel that is being freed
+    rbdimmer_transition_cancel(channel);
 
-    // Step 2: Stop timers so no further callbacks can fire.
-    // If the ISR already started a timer cycle before seeing is_active=false,
-    // delay_timer_callback will check timer_state==TIMER_STATE_DELAY and
-    // find TIMER_STATE_IDLE (set below), returning without effect.
-    esp_timer_stop(channel->delay_timer);
-    esp_timer_stop(channel->pulse_timer);
-    gpio_set_level((gpio_num_t)channel->gpio_pin, 0);
-    channel->timer_state = TIMER_STATE_IDLE;
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
 
-    // Step 3: Locate channel in manager (array not yet modified, safe to read).
-    int index = -1;
-    for (int i = 0; i < dimmer_manager.count; i++) {
-        if (dimmer_manager.channels[i] == channel) {
-            index = i;
-            break;
-        }
-    }
-    if (index == -1) {
+    // Step 1: Validate the handle — O(1), the pool slot knows its state.
+    if (!channel_valid(channel)) {
+        xSemaphoreGive(manager_mutex);
         return RBDIMMER_ERR_NOT_FOUND;
     }
+    // A staged entry of an open batch dies with the channel; a channel
+    // re-created in this slot gets an entry of its own.
+    batch_index[channel->slot] = 0xFF;
+
+    // Step 2: Remove from the phase list and publish a schedule without it.
+    // From the next zero-crossing on the ISR no longer references it.
+    // The fade stop is best effort: should it not be posted, the command
+    // generation check drops the fade once the slot is reused.
+    bool stopped;
+    zc_fade_stop(channel, &stopped);
+    channel->is_active = false;
+    channel_unlink(channel);
 
-    // Step 4: Compact array inside critical section.
-    // portENTER_CRITICAL disables interrupts on this core (prevents the GPIO
-    // ISR from running here) and acquires the spinlock (prevents a concurrent
-    // task on the other core from modifying the array at the same time).
-    portENTER_CRITICAL(&dimmer_spinlock);
-    for (int i = index; i < (int)dimmer_manager.count - 1; i++) {
-        dimmer_manager.channels[i] = dimmer_manager.channels[i + 1];
+    if (channel->output == RBDIMMER_OUTPUT_MCPWM) {
+        // Never referenced by the ISR — release the peripheral and go.
+        rbdimmer_mcpwm_delete(channel);
+        channel_release(channel);
+        xSemaphoreGive(manager_mutex);
+        return RBDIMMER_OK;
     }
-    dimmer_manager.count--;
-    portEXIT_CRITICAL(&dimmer_spinlock);
+    schedule_publish(channel->phase);
+
+    xSemaphoreGive(manager_mutex);
 
-    // Step 5: Delete timer handles and free memory outside the critical section
+    // Step 3: Stop timers so no further callbacks can fire.
+    // If the ISR already started a timer cycle before the new schedule was
+    // adopted, delay_timer_callback will check timer_state==TIMER_STATE_DELAY
+    // and find TIMER_STATE_IDLE (set below), returning without effect.
+    // The gate is driven LOW last so a callback racing with the stop cannot
+    // leave it HIGH.
+    // timer_state is one word the ISR only moves forward from DELAY; this
+    // cancel must act within the running half-cycle, so it is not queued.
+    rbdimmer_timer_stop(channel);
+    __atomic_store_n(&channel->timer_state, TIMER_STATE_IDLE, __ATOMIC_RELEASE);
+    gpio_set_level((gpio_num_t)channel->gpio_pin, 0);
+
+    // Step 4: Wait until the ISR has switched to the new schedule — until
+    // then the old buffer may still point at this channel.
+    schedule_wait_adopted(channel->phase);
+
+    // Step 5: Delete timer handles and return the slot to the pool
     // (esp_timer_delete may call into the FreeRTOS heap allocator).
     rbdimmer_timer_delete(channel);
-    free(channel);
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    channel_release(channel);
+    xSemaphoreGive(manager_mutex);
     return RBDIMMER_OK;
 }
 
+// ---------------------------------------------------------------------------
+// Public API — lookup
+// ---------------------------------------------------------------------------
+
+rbdimmer_channel_id_t rbdimmer_get_channel_id(rbdimmer_channel_t* channel) {
+    if (manager_mutex == NULL) {
+        return RBDIMMER_CHANNEL_ID_NONE;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    rbdimmer_channel_id_t id = channel_valid(channel) ? CHANNEL_ID(channel)
+                                                      : RBDIMMER_CHANNEL_ID_NONE;
+    xSemaphoreGive(manager_mutex);
+    return id;
+}
+
+rbdimmer_channel_t* rbdimmer_get_channel_by_id(rbdimmer_channel_id_t id) {
+    uint8_t slot = (uint8_t)(id & 0xFF);
+    if (manager_mutex == NULL || slot >= RBDIMMER_MAX_CHANNELS) {
+        return NULL;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    rbdimmer_channel_t* channel = &channel_pool[slot];
+    if (!channel->in_use || CHANNEL_ID(channel) != id) {
+        channel = NULL;               // deleted, or slot reused since
+    }
+    xSemaphoreGive(manager_mutex);
+    return channel;
+}
+
+rbdimmer_channel_t* rbdimmer_get_channel_by_gpio(uint8_t gpio_pin) {
+    if (manager_mutex == NULL || gpio_pin >= GPIO_NUM_MAX) {
+        return NULL;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    int8_t slot = gpio_to_slot[gpio_pin];
+    rbdimmer_channel_t* channel = NULL;
+    if (slot >= 0 && channel_pool[slot].in_use) {
+        channel = &channel_pool[slot];
+    }
+    xSemaphoreGive(manager_mutex);
+    return channel;
+}
+
 // ---------------------------------------------------------------------------
 // Public API — control
 // ---------------------------------------------------------------------------
 
 rbdimmer_err_t rbdimmer_set_level(rbdimmer_channel_t* channel,
                                    uint8_t level_percent) {
+    if (level_percent > 100) {
+        level_percent = 100;
+    }
+    return rbdimmer_set_level_q16(channel, RBDIMMER_CURVES_PCT_TO_Q16(level_percent));
+}
+
+rbdimmer_err_t rbdimmer_set_level_q16(rbdimmer_channel_t* channel,
+                                       uint16_t level_q16) {
     if (channel == NULL) {
         return RBDIMMER_ERR_INVALID_ARG;
     }
-    if (level_percent > 100) {
-        level_percent = 100;
+    // An explicit level always wins over a running transition
+    rbdimmer_transition_cancel(channel);
+    return rbdimmer_channel_set_level_q16(channel, level_q16);
+}
+
+rbdimmer_err_t rbdimmer_channel_set_level_q16(rbdimmer_channel_t* channel,
+                                              uint16_t level_q16) {
+    if (channel == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
     }
-    if (channel->level_percent != level_percent) {
+    if (!channel->zc_fade_armed && channel->level_q16 == level_q16) {
+        return RBDIMMER_OK;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    // level_q16 already holds the target of a ZC fade — stopping one halfway
+    // must republish the schedule even if the delay does not change.
+    uint32_t origin = soft_start_origin(channel);
+    bool stopped;
+    rbdimmer_err_t err = zc_fade_stop(channel, &stopped);
+    if (err == RBDIMMER_OK && (stopped || channel->level_q16 != level_q16)) {
         channel->prev_level_percent = channel->level_percent;
-        channel->level_percent      = level_percent;
+        channel->level_q16          = level_q16;
+        channel->level_percent      = RBDIMMER_CURVES_Q16_TO_PCT(level_q16);
         channel->needs_update       = true;
-        if (channel->is_active) {
-            update_channel_delay(channel);
+        if (channel->is_active && (update_channel_delay(channel) || stopped)) {
+            soft_start_begin(channel, origin);
+            channel_commit(channel);
         }
     }
+    xSemaphoreGive(manager_mutex);
+    return err;
+}
+
+rbdimmer_err_t rbdimmer_set_level_transition_zc(rbdimmer_channel_t* channel,
+                                                uint16_t level_q16,
+                                                uint32_t transition_ms) {
+    if (channel == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    if (channel->output != RBDIMMER_OUTPUT_TIMER || channel->line_lag_q16 != 0 ||
+        channel->mode != RBDIMMER_MODE_PHASE) {
+        // The peripheral latches compares on its own sync — no ISR to step it.
+        // A lagged group member's delay wraps, a straight line would not.
+        // A burst channel has no delay to step, a trailing-edge one a cut-off.
+        return rbdimmer_set_level_transition(channel,
+                                             RBDIMMER_CURVES_Q16_TO_PCT(level_q16),
+                                             transition_ms);
+    }
+    rbdimmer_transition_cancel(channel);
+    zc_cmd_wait_space(channel->phase);   // before the mutex, zc_cmd_post() does not wait
+
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(channel->phase);
+    uint32_t half_cycle_us = (zc != NULL) ? zc->half_cycle_us : 10000;
+    uint32_t target = curve_delay(channel, level_q16, half_cycle_us);
+    uint32_t steps = (uint32_t)(((uint64_t)transition_ms * 1000) / half_cycle_us);
+    uint32_t from = zc_fade_position(channel);   // a running ZC fade continues from here
+
+    if (steps == 0 || !channel->is_active || from == target) {
+        // Nothing to step per half-cycle: apply like rbdimmer_set_level()
+        uint32_t origin = soft_start_origin(channel);
+        bool stopped;
+        rbdimmer_err_t err = zc_fade_stop(channel, &stopped);
+        if (err == RBDIMMER_OK) {
+            channel->prev_level_percent = channel->level_percent;
+            channel->level_q16          = level_q16;
+            channel->level_percent      = RBDIMMER_CURVES_Q16_TO_PCT(level_q16);
+            channel->needs_update       = true;
+            if (channel->is_active && (update_channel_delay(channel) || stopped)) {
+                soft_start_begin(channel, origin);
+                channel_commit(channel);
+            }
+        }
+        xSemaphoreGive(manager_mutex);
+        return err;
+    }
+
+    // Delay 0 means OFF, not "fire at the crossing": fade from / to the
+    // latest firing point instead so the ramp stays monotonic.
+    uint32_t dark = half_cycle_us - channel->pulse_us;
+    uint32_t start = (from != 0) ? from : dark;
+    uint32_t end   = (target != 0) ? target : dark;
+    int32_t step = (int32_t)((((int64_t)end - (int64_t)start) * 65536) / (int64_t)steps);
+
+    zc_cmd_t cmd = {
+        .op          = ZC_CMD_FADE_START,
+        .steps       = steps,
+        .start_q16   = start << 16,
+        .step_q16    = step,
+        .final_delay = target,
+    };
+    if (!zc_cmd_post(channel, &cmd)) {
+        xSemaphoreGive(manager_mutex);
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+    channel->zc_fade_armed = true;
+    channel->zc_fade_soft  = false;
+    channel->zc_fade_start = from;
+
+    // Schedules built from here on carry the target; the ISR overrides the
+    // entry until its last step lands on it, so no republish is needed.
+    channel->prev_level_percent = channel->level_percent;
+    channel->level_q16          = level_q16;
+    channel->level_percent      = RBDIMMER_CURVES_Q16_TO_PCT(level_q16);
+    channel->current_delay      = target;
+    channel->needs_update       = false;
+
+    xSemaphoreGive(manager_mutex);
     return RBDIMMER_OK;
 }
 
@@ -273,14 +1215,56 @@ rbdimmer_err_t rbdimmer_set_curve(rbdimmer_channel_t* channel,
     if (channel == NULL) {
         return RBDIMMER_ERR_INVALID_ARG;
     }
+    rbdimmer_err_t err = RBDIMMER_OK;
     if (curve_type != channel->curve_type) {
-        channel->curve_type   = curve_type;
+        xSemaphoreTake(manager_mutex, portMAX_DELAY);
+        uint32_t origin = soft_start_origin(channel);
+        bool stopped;           // fade delays were computed with the old curve
+        err = zc_fade_stop(channel, &stopped);
+        if (err == RBDIMMER_OK) {
+            channel->curve_type   = curve_type;
+            channel->needs_update = true;
+            ESP_LOGI(TAG, "Setting curve type to %d", curve_type);
+            if (channel->is_active && (update_channel_delay(channel) || stopped)) {
+                soft_start_begin(channel, origin);
+                channel_commit(channel);
+            }
+        }
+        xSemaphoreGive(manager_mutex);
+    }
+    return err;
+}
+
+rbdimmer_err_t rbdimmer_set_custom_curve(rbdimmer_channel_t* channel,
+                                          rbdimmer_custom_curve_t curve) {
+    if (channel == NULL || !rbdimmer_curves_custom_valid(curve)) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    uint32_t origin = soft_start_origin(channel);
+    bool stopped;
+    rbdimmer_err_t err = zc_fade_stop(channel, &stopped);
+    if (err == RBDIMMER_OK) {
+        channel->curve_type   = RBDIMMER_CURVE_CUSTOM;
+        channel->custom_curve = curve;
         channel->needs_update = true;
-        ESP_LOGI(TAG, "Setting curve type to %d", curve_type);
-        if (channel->is_active) {
-            update_channel_delay(channel);
+        ESP_LOGI(TAG, "Setting custom curve %d", curve);
+        if (channel->is_active && (update_channel_delay(channel) || stopped)) {
+            soft_start_begin(channel, origin);
+            channel_commit(channel);
         }
     }
+    xSemaphoreGive(manager_mutex);
+    return err;
+}
+
+rbdimmer_err_t rbdimmer_set_soft_start(rbdimmer_channel_t* channel, uint16_t half_cycles) {
+    if (channel == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    channel->soft_start = half_cycles;    // a running ramp keeps its length
+    xSemaphoreGive(manager_mutex);
     return RBDIMMER_OK;
 }
 
@@ -289,28 +1273,309 @@ rbdimmer_err_t rbdimmer_set_active(rbdimmer_channel_t* channel, bool active) {
         return RBDIMMER_ERR_INVALID_ARG;
     }
     if (channel->is_active != active) {
-        channel->is_active    = active;
-        channel->needs_update = true;
+        xSemaphoreTake(manager_mutex, portMAX_DELAY);
+        // A disabled channel leaves the schedule; its fade would freeze
+        bool stopped;
+        rbdimmer_err_t err = zc_fade_stop(channel, &stopped);
+        if (err != RBDIMMER_OK) {
+            xSemaphoreGive(manager_mutex);
+            return err;
+        }
+        channel->is_active = active;
         ESP_LOGI(TAG, "Setting channel active state to %d", active);
-        if (!active) {
+        if (active) {
+            // Level/curve may have changed while disabled
+            channel->needs_update = true;
+            update_channel_delay(channel);
+            soft_start_begin(channel, 0);
+        }
+        channel_commit(channel);
+        xSemaphoreGive(manager_mutex);
+
+        if (!active && channel->output == RBDIMMER_OUTPUT_TIMER) {
+            // Immediate cancel of this half-cycle, as in rbdimmer_delete_channel()
+            rbdimmer_timer_stop(channel);
+            __atomic_store_n(&channel->timer_state, TIMER_STATE_IDLE, __ATOMIC_RELEASE);
             gpio_set_level((gpio_num_t)channel->gpio_pin, 0);
-            esp_timer_stop(channel->delay_timer);
-            esp_timer_stop(channel->pulse_timer);
-            channel->timer_state = TIMER_STATE_IDLE;
         }
     }
     return RBDIMMER_OK;
 }
 
 rbdimmer_err_t rbdimmer_update_all(void) {
-    for (int i = 0; i < dimmer_manager.count; i++) {
-        if (dimmer_manager.channels[i]->is_active) {
-            update_channel_delay(dimmer_manager.channels[i]);
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    channels_recompute((1u << RBDIMMER_MAX_PHASES) - 1);
+    xSemaphoreGive(manager_mutex);
+    return RBDIMMER_OK;
+}
+
+// Recalculate every active channel of the phases in @p phase_mask against
+// the current half-cycle and publish each changed phase once.
+// Caller holds manager_mutex.
+static void channels_recompute(uint32_t phase_mask) {
+    bool dirty[RBDIMMER_MAX_PHASES] = { false };
+
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase((uint8_t)p);
+        if ((phase_mask & (1u << p)) && zc != NULL) {
+            phase_half_cycle_us[p] = zc->half_cycle_us;
+        }
+    }
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        if ((phase_mask & (1u << p)) == 0) {
+            continue;
+        }
+        for (rbdimmer_channel_t* channel = dimmer_manager.phase_head[p];
+             channel != NULL; channel = channel->list_next) {
+            // A ZC fade keeps the target it was started with
+            if (channel->is_active && !zc_fade_running(channel)) {
+                channel->needs_update = true;
+                if (update_channel_delay(channel)) {
+                    if (channel->output == RBDIMMER_OUTPUT_MCPWM) {
+                        rbdimmer_mcpwm_apply(channel);
+                    } else {
+                        dirty[p] = true;
+                    }
+                }
+            }
+        }
+    }
+    // One rebuild per phase, however many channels changed
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        if (dirty[p]) {
+            schedule_publish((uint8_t)p);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API — batch update
+// ---------------------------------------------------------------------------
+
+// Apply a level and / or curve (BATCH_OP_* in @p ops) to @p channel and
+// flag its phase in @p dirty instead of publishing.  MCPWM channels are
+// applied at once.  RBDIMMER_ERR_TIMER_FAILED leaves the channel unchanged.
+// Caller holds manager_mutex.
+static rbdimmer_err_t channel_stage(rbdimmer_channel_t* channel, uint8_t ops,
+                                    uint16_t level_q16, rbdimmer_curve_t curve_type,
+                                    bool* dirty) {
+    uint32_t origin = soft_start_origin(channel);
+    bool stopped;
+    if (zc_fade_stop(channel, &stopped) != RBDIMMER_OK) {
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+    if (ops & BATCH_OP_LEVEL) {
+        channel->prev_level_percent = channel->level_percent;
+        channel->level_q16          = level_q16;
+        channel->level_percent      = RBDIMMER_CURVES_Q16_TO_PCT(level_q16);
+    }
+    if (ops & BATCH_OP_CURVE) {
+        channel->curve_type = curve_type;
+    }
+    channel->needs_update = true;
+    if (channel->is_active && (update_channel_delay(channel) || stopped)) {
+        if (channel->output == RBDIMMER_OUTPUT_MCPWM) {
+            rbdimmer_mcpwm_apply(channel);
+        } else {
+            soft_start_begin(channel, origin);
+            dirty[channel->phase] = true;
         }
     }
     return RBDIMMER_OK;
 }
 
+rbdimmer_err_t rbdimmer_batch_begin(void) {
+    if (batch_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    if (batch_owner == xTaskGetCurrentTaskHandle()) {
+        return RBDIMMER_ERR_ALREADY_EXIST;  // nested begin would self-deadlock
+    }
+    xSemaphoreTake(batch_mutex, portMAX_DELAY);
+    batch_owner = xTaskGetCurrentTaskHandle();
+    batch_count = 0;
+    return RBDIMMER_OK;
+}
+
+// True if staged entry @p i still belongs to the channel it was staged
+// for — same check as channel_valid(), plus the slot generation.
+static bool batch_live(int i) {
+    rbdimmer_channel_t* channel = batch_ops[i].channel;
+    return channel_valid(channel) && channel->generation == batch_ops[i].generation;
+}
+
+// Drop the entries of deleted channels and rebuild batch_index.
+static void batch_compact(void) {
+    uint8_t n = 0;
+    for (int i = 0; i < batch_count; i++) {
+        if (batch_live(i)) {
+            batch_ops[n] = batch_ops[i];
+            batch_index[batch_ops[n].channel->slot] = n;
+            n++;
+        }
+    }
+    batch_count = n;
+}
+
+// Staging slot of @p channel in the open batch, -1 if the caller does not
+// own the batch or the handle is not a live channel.  Caller holds
+// manager_mutex.  One live entry per pool slot: when deleted channels have
+// used up the table, their entries are dropped to make room.
+static int batch_slot(rbdimmer_channel_t* channel) {
+    if (batch_owner != xTaskGetCurrentTaskHandle() || !channel_valid(channel)) {
+        return -1;
+    }
+    uint8_t i = batch_index[channel->slot];
+    if (i != 0xFF) {
+        return i;
+    }
+    if (batch_count >= RBDIMMER_MAX_CHANNELS) {
+        batch_compact();
+    }
+    batch_index[channel->slot] = batch_count;
+    batch_ops[batch_count].channel    = channel;
+    batch_ops[batch_count].generation = channel->generation;
+    batch_ops[batch_count].ops        = 0;
+    return batch_count++;
+}
+
+rbdimmer_err_t rbdimmer_batch_set_level_q16(rbdimmer_channel_t* channel,
+                                             uint16_t level_q16) {
+    if (manager_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    int slot = batch_slot(channel);
+    if (slot >= 0) {
+        batch_ops[slot].level_q16 = level_q16;
+        batch_ops[slot].ops      |= BATCH_OP_LEVEL;
+    }
+    xSemaphoreGive(manager_mutex);
+    return slot >= 0 ? RBDIMMER_OK : RBDIMMER_ERR_INVALID_ARG;
+}
+
+rbdimmer_err_t rbdimmer_batch_set_level(rbdimmer_channel_t* channel,
+                                         uint8_t level_percent) {
+    if (level_percent > 100) {
+        level_percent = 100;
+    }
+    return rbdimmer_batch_set_level_q16(channel, RBDIMMER_CURVES_PCT_TO_Q16(level_percent));
+}
+
+rbdimmer_err_t rbdimmer_batch_set_curve(rbdimmer_channel_t* channel,
+                                         rbdimmer_curve_t curve_type) {
+    if (manager_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    int slot = batch_slot(channel);
+    if (slot >= 0) {
+        batch_ops[slot].curve_type = curve_type;
+        batch_ops[slot].ops       |= BATCH_OP_CURVE;
+    }
+    xSemaphoreGive(manager_mutex);
+    return slot >= 0 ? RBDIMMER_OK : RBDIMMER_ERR_INVALID_ARG;
+}
+
+rbdimmer_err_t rbdimmer_batch_commit(void) {
+    if (batch_owner != xTaskGetCurrentTaskHandle()) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    bool dirty[RBDIMMER_MAX_PHASES] = { false };
+    rbdimmer_err_t err = RBDIMMER_OK;
+
+    // Explicit levels win over running fades, as in rbdimmer_set_level().
+    // Not under manager_mutex (lock order): a channel deleted right after the
+    // check loses nothing, its fade is cancelled on delete anyway.
+    for (int i = 0; i < batch_count; i++) {
+        if (batch_live(i)) {
+            rbdimmer_transition_cancel(batch_ops[i].channel);
+        }
+    }
+
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    for (int i = 0; i < batch_count; i++) {
+        rbdimmer_channel_t* channel = batch_ops[i].channel;
+        batch_index[channel->slot] = 0xFF;
+        if (!batch_live(i)) {
+            continue;                 // deleted while staged, maybe re-created
+        }
+        if (channel_stage(channel, batch_ops[i].ops, batch_ops[i].level_q16,
+                          batch_ops[i].curve_type, dirty) != RBDIMMER_OK) {
+            err = RBDIMMER_ERR_TIMER_FAILED;  // left unchanged, fade keeps running
+        }
+    }
+    // One schedule per phase: every staged change of a phase is adopted by
+    // the ISR at the same zero-crossing.
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        if (dirty[p]) {
+            schedule_publish((uint8_t)p);
+        }
+    }
+    xSemaphoreGive(manager_mutex);
+
+    batch_count = 0;
+    batch_owner = NULL;
+    xSemaphoreGive(batch_mutex);
+    return err;
+}
+
+// ---------------------------------------------------------------------------
+// Internal API — phase groups
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_channel_set_levels_q16(rbdimmer_channel_t* const* channels,
+                                               uint8_t count, uint16_t level_q16) {
+    if (channels == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    bool dirty[RBDIMMER_MAX_PHASES] = { false };
+    rbdimmer_err_t err = RBDIMMER_OK;
+
+    for (uint8_t i = 0; i < count; i++) {
+        rbdimmer_transition_cancel(channels[i]);
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < count; i++) {
+        if (!channel_valid(channels[i])) {
+            err = RBDIMMER_ERR_NOT_FOUND;
+            continue;
+        }
+        if (channel_stage(channels[i], BATCH_OP_LEVEL, level_q16,
+                          channels[i]->curve_type, dirty) != RBDIMMER_OK) {
+            err = RBDIMMER_ERR_TIMER_FAILED;
+        }
+    }
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        if (dirty[p]) {
+            schedule_publish((uint8_t)p);
+        }
+    }
+    xSemaphoreGive(manager_mutex);
+    return err;
+}
+
+rbdimmer_err_t rbdimmer_channel_set_timing(rbdimmer_channel_t* channel,
+                                           uint16_t lag_q16, int16_t skew_us) {
+    if (channel == NULL || channel->output != RBDIMMER_OUTPUT_TIMER) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_transition_cancel(channel);
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    bool stopped;               // a ZC fade was stepping unshifted delays
+    rbdimmer_err_t err = zc_fade_stop(channel, &stopped);
+    if (err == RBDIMMER_OK) {
+        channel->line_lag_q16 = lag_q16;
+        channel->skew_us      = skew_us;
+        channel->needs_update = true;
+        if (channel->is_active && (update_channel_delay(channel) || stopped)) {
+            channel_commit(channel);
+        }
+    }
+    xSemaphoreGive(manager_mutex);
+    return err;
+}
+
 // ---------------------------------------------------------------------------
 // Public API — getters
 // ---------------------------------------------------------------------------
@@ -320,6 +1585,11 @@ uint8_t rbdimmer_get_level(rbdimmer_channel_t* channel) {
     return channel->level_percent;
 }
 
+uint16_t rbdimmer_get_level_q16(rbdimmer_channel_t* channel) {
+    if (channel == NULL) return 0;
+    return channel->level_q16;
+}
+
 bool rbdimmer_is_active(rbdimmer_channel_t* channel) {
     if (channel == NULL) return false;
     return channel->is_active;
@@ -332,28 +1602,228 @@ rbdimmer_curve_t rbdimmer_get_curve(rbdimmer_channel_t* channel) {
 
 uint32_t rbdimmer_get_delay(rbdimmer_channel_t* channel) {
     if (channel == NULL) return 0;
-    return channel->current_delay;
+    return zc_fade_position(channel);
+}
+
+uint32_t rbdimmer_channel_get_missed(uint8_t phase) {
+    if (phase >= RBDIMMER_MAX_PHASES) return 0;
+    return phase_missed[phase];
+}
+
+void rbdimmer_channel_for_each_state(rbdimmer_channel_state_cb_t fn, void* ctx) {
+    if (fn == NULL || manager_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(manager_mutex, portMAX_DELAY);
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        for (rbdimmer_channel_t* channel = dimmer_manager.phase_head[p];
+             channel != NULL; channel = channel->list_next) {
+            fn(ctx, channel->gpio_pin, channel->phase, channel->curve_type,
+               channel->level_q16);
+        }
+    }
+    xSemaphoreGive(manager_mutex);
 }
 
 // ---------------------------------------------------------------------------
 // Internal helpers
 // ---------------------------------------------------------------------------
 
-static void update_channel_delay(rbdimmer_channel_t* channel) {
-    if (!channel->needs_update) {
+// True while a ZC fade posted for @p channel is queued or still stepping.
+// Caller holds manager_mutex.
+static bool zc_fade_running(rbdimmer_channel_t* channel) {
+    if (!channel->zc_fade_armed) {
+        return false;
+    }
+    if (zc_cmd_applied(channel) && channel->zc_fade_steps == 0) {
+        channel->zc_fade_armed = false;   // last step done
+        return false;
+    }
+    return true;
+}
+
+// Delay the gate fires at now: the ISR's fade position while a ZC fade
+// steps, its start while the fade is still queued, else current_delay.
+static uint32_t zc_fade_position(const rbdimmer_channel_t* channel) {
+    if (!channel->zc_fade_armed) {
+        return channel->current_delay;
+    }
+    if (!zc_cmd_applied(channel)) {
+        return channel->zc_fade_start;
+    }
+    if (channel->zc_fade_steps != 0) {
+        return channel->zc_fade_delay_q16 >> 16;
+    }
+    return channel->current_delay;
+}
+
+// Post a stop for a running ZC fade of @p channel.  The ISR leaves the entry
+// at its last fade step until it adopts the next schedule, so the caller must
+// republish the phase when *stopped is set.  RBDIMMER_ERR_TIMER_FAILED if
+// the command could not be queued.  Caller holds manager_mutex.
+static rbdimmer_err_t zc_fade_stop(rbdimmer_channel_t* channel, bool* stopped) {
+    *stopped = zc_fade_running(channel);
+    if (!*stopped) {
+        return RBDIMMER_OK;
+    }
+    zc_cmd_t cmd = { .op = ZC_CMD_FADE_STOP };
+    if (!zc_cmd_post(channel, &cmd)) {
+        *stopped = false;
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+    channel->zc_fade_armed = false;
+    return RBDIMMER_OK;
+}
+
+// Where a soft start would ramp from if the change about to be applied
+// turns @p channel on: 0 when it is OFF, the current angle while a soft
+// start is still ramping (the change continues it), else UINT32_MAX.
+// Call before zc_fade_stop().  Caller holds manager_mutex.
+static uint32_t soft_start_origin(rbdimmer_channel_t* channel) {
+    if (channel->soft_start == 0) {
+        return UINT32_MAX;
+    }
+    if (!channel->is_active || zc_fade_position(channel) == 0) {
+        return 0;
+    }
+    if (zc_fade_running(channel) && channel->zc_fade_soft) {
+        return zc_fade_position(channel);
+    }
+    return UINT32_MAX;
+}
+
+// Ramp @p channel from @p origin (0 = the dark end of the half-cycle) to its
+// new current_delay over soft_start half-cycles, stepped by the ZC ISR.
+// Call after update_channel_delay() and before the schedule is published.
+// Nothing to ramp when the target is not brighter than the origin; a full
+// command ring applies the level at once.  Caller holds manager_mutex.
+static void soft_start_begin(rbdimmer_channel_t* channel, uint32_t origin) {
+    uint32_t target = channel->current_delay;
+    if (origin == UINT32_MAX || channel->soft_start == 0 || target == 0 ||
+        channel->output != RBDIMMER_OUTPUT_TIMER || channel->mode != RBDIMMER_MODE_PHASE ||
+        channel->line_lag_q16 != 0 || !channel->is_active) {
         return;
     }
     rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(channel->phase);
-    if (zc == NULL) {
+    uint32_t half_cycle_us = (zc != NULL) ? zc->half_cycle_us : 10000;
+    uint32_t start = (origin != 0) ? origin : half_cycle_us - channel->pulse_us;
+    if (start <= target) {
         return;
     }
-    uint32_t new_delay = rbdimmer_curves_level_to_delay(
-        channel->level_percent,
-        zc->half_cycle_us,
-        channel->curve_type
-    );
-    if (new_delay != channel->current_delay) {
-        channel->current_delay = new_delay;
+    uint32_t steps = channel->soft_start;
+    zc_cmd_t cmd = {
+        .op          = ZC_CMD_FADE_START,
+        .steps       = steps,
+        .start_q16   = start << 16,
+        .step_q16    = (int32_t)((((int64_t)target - (int64_t)start) * 65536) / (int64_t)steps),
+        .final_delay = target,
+    };
+    if (!zc_cmd_post(channel, &cmd)) {
+        return;
     }
+    channel->zc_fade_armed = true;
+    channel->zc_fade_soft  = true;
+    channel->zc_fade_start = origin;
+}
+
+// Make a changed delay / active flag take effect: rebuild the phase schedule
+// for software output, or update the peripheral for MCPWM output.
+// Caller holds manager_mutex.
+static void channel_commit(rbdimmer_channel_t* channel) {
+    if (channel->output == RBDIMMER_OUTPUT_MCPWM) {
+        rbdimmer_mcpwm_apply(channel);
+    } else {
+        schedule_publish(channel->phase);
+    }
+}
+
+// Firing delay of a phase-group member, counted from its detector's crossing.
+// @p delay counts from the crossing of the member's own line, which comes
+// lag_q16 of a half-cycle later; past the detector's next crossing the
+// firing wraps into the current half-cycle (one firing per half-cycle
+// either way).  The pulse must not straddle the detector crossing, where
+// Pass 1 clears every gate of the phase: such a firing moves up to one pulse
+// width (@p pulse_us) earlier.
+static uint32_t member_delay(uint32_t delay, uint32_t half_cycle_us,
+                             uint16_t lag_q16, int16_t skew_us, uint16_t pulse_us) {
+    int32_t h = (int32_t)half_cycle_us;
+    int32_t d = (int32_t)delay + skew_us +
+                (int32_t)(((uint64_t)half_cycle_us * lag_q16) >> 16);
+    if (d >= h) {
+        d -= h;
+    }
+    int32_t latest = h - pulse_us - 1;
+    if (d > latest) {
+        d = latest;
+    }
+    return (uint32_t)(d > 1 ? d : 1);   // 0 would mean off
+}
+
+// Curve delay of @p level_q16 for this channel.  The curve leaves room for
+// the default pulse; a longer pulse of the channel moves the latest firing
+// point earlier.  Trailing edge: the cut-off.
+static uint32_t curve_delay(const rbdimmer_channel_t* channel, uint16_t level_q16,
+                            uint32_t half_cycle_us) {
+    if (channel->mode == RBDIMMER_MODE_TRAILING) {
+        return rbdimmer_curves_level_q16_to_cutoff(
+            level_q16, half_cycle_us, channel->curve_type, channel->custom_curve);
+    }
+    uint32_t delay = rbdimmer_curves_level_q16_to_delay(
+        level_q16, half_cycle_us, channel->curve_type, channel->custom_curve);
+    if (delay + channel->pulse_us > half_cycle_us) {
+        delay = half_cycle_us - channel->pulse_us;
+    }
+    return delay;
+}
+
+// Gate hold release of a channel firing at @p delay: RBDIMMER_GATE_HOLD_GUARD_US
+// before the next crossing of its own line — the detector's, or for a group
+// member that wrapped, its own line's crossing later in this half-cycle.
+static uint16_t gate_hold_end(const rbdimmer_channel_t* channel, uint32_t delay,
+                              uint32_t half_cycle_us) {
+    if (channel->gate == RBDIMMER_GATE_PULSE) {
+        return 0;
+    }
+    uint32_t end = half_cycle_us;
+    uint32_t lag_us = (uint32_t)(((uint64_t)half_cycle_us * channel->line_lag_q16) >> 16);
+    if (lag_us > delay) {
+        end = lag_us;
+    }
+    return (end > RBDIMMER_GATE_HOLD_GUARD_US) ? (uint16_t)(end - RBDIMMER_GATE_HOLD_GUARD_US) : 0;
+}
+
+// Recalculate the firing delay and gate hold.  Returns true if current_delay
+// or hold_us (burst fire: the duty) changed and the phase schedule must be
+// republished.  Caller holds manager_mutex.
+static bool update_channel_delay(rbdimmer_channel_t* channel) {
+    if (!channel->needs_update) {
+        return false;
+    }
+    if (channel->mode == RBDIMMER_MODE_BURST) {
+        // The level is the share of conducting cycles; no curve, no delay
+        channel->needs_update = false;
+        if (channel->burst_duty_q16 == channel->level_q16) {
+            return false;
+        }
+        channel->burst_duty_q16 = channel->level_q16;
+        return true;
+    }
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(channel->phase);
+    if (zc == NULL) {
+        return false;
+    }
+    uint32_t new_delay = curve_delay(channel, channel->level_q16, zc->half_cycle_us);
+    if (new_delay != 0 && (channel->line_lag_q16 != 0 || channel->skew_us != 0)) {
+        new_delay = member_delay(new_delay, zc->half_cycle_us,
+                                 channel->line_lag_q16, channel->skew_us,
+                                 channel->pulse_us);
+    }
+    uint16_t hold = gate_hold_end(channel, new_delay, zc->half_cycle_us);
     channel->needs_update = false;
+    if (new_delay == channel->current_delay && hold == channel->hold_us) {
+        return false;
+    }
+    channel->current_delay = new_delay;
+    channel->hold_us       = hold;
+    return true;
 }
@@ -36,6 +36,66 @@ rbdimmer_err_t rbdimmer_channel_manager_init(void);
  */
 void rbdimmer_channel_manager_deinit(void);
 
+/**
+ * @brief Apply a Q16 level without cancelling a running fade.
+ *
+ * Used by the fade engine (rbdimmer_transition.c) for every step; the
+ * public rbdimmer_set_level*() calls cancel the fade first and then land
+ * here.  Takes manager_mutex.
+ *
+ * @return RBDIMMER_OK or RBDIMMER_ERR_INVALID_ARG (NULL channel)
+ */
+rbdimmer_err_t rbdimmer_channel_set_level_q16(rbdimmer_channel_t* channel,
+                                              uint16_t level_q16);
+
+/**
+ * @brief Apply one Q16 level to several channels in one pass.
+ *
+ * Used by phase groups (rbdimmer_group.c).  Cancels transitions, recomputes
+ * every delay under one manager_mutex hold and publishes each affected phase
+ * once, like rbdimmer_batch_commit().  Invalid handles are skipped.
+ *
+ * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG, RBDIMMER_ERR_NOT_FOUND (a
+ *         handle was skipped) or RBDIMMER_ERR_TIMER_FAILED (a ZC fade could
+ *         not be stopped; that channel is unchanged)
+ */
+rbdimmer_err_t rbdimmer_channel_set_levels_q16(rbdimmer_channel_t* const* channels,
+                                               uint8_t count, uint16_t level_q16);
+
+/**
+ * @brief Time a software-output channel as a phase-group member.
+ *
+ * @p lag_q16: fraction of a half-cycle by which the member's line crosses
+ * after the channel's detector (0 = the detector's own line).  @p skew_us:
+ * offset added to every non-zero firing delay.  Recomputes and republishes
+ * the delay.  Takes manager_mutex.
+ *
+ * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG (NULL or MCPWM output) or
+ *         RBDIMMER_ERR_TIMER_FAILED
+ */
+rbdimmer_err_t rbdimmer_channel_set_timing(rbdimmer_channel_t* channel,
+                                           uint16_t lag_q16, int16_t skew_us);
+
+/**
+ * @brief Firings of @p phase that never happened (rbdimmer_zc_stats_t.missed).
+ *
+ * Counted by on_zero_cross_phase() for every channel whose delay event was
+ * still pending at the next crossing.  0 for an invalid phase.
+ */
+uint32_t rbdimmer_channel_get_missed(uint8_t phase);
+
+/** @brief Receives one channel of rbdimmer_channel_for_each_state(). */
+typedef void (*rbdimmer_channel_state_cb_t)(void* ctx, uint8_t gpio, uint8_t phase,
+                                            rbdimmer_curve_t curve, uint16_t level_q16);
+
+/**
+ * @brief Report gate pin, phase, curve and Q16 level of every channel.
+ *
+ * Used by the NVS persistence layer (rbdimmer_persist.c).  Runs @p fn under
+ * manager_mutex, so it must not call the channel API.  Task context.
+ */
+void rbdimmer_channel_for_each_state(rbdimmer_channel_state_cb_t fn, void* ctx);
+
 #ifdef __cplusplus
 }
 #endif
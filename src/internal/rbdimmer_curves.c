@@ -6,97 +6,259 @@
  * Pure math — no GPIO, no timers, no FreeRTOS.
  * Tables are computed once at init time to avoid floating-point math in the
  * ISR path.
+ *
+ * Levels are Q16 (0 … RBDIMMER_LEVEL_Q16_MAX).  Each table holds the firing
+ * delay as a Q16 fraction of the half-cycle at 2^CURVE_LUT_BITS + 1 evenly
+ * spaced levels; a lookup interpolates linearly between two neighbours and
+ * scales by the half-cycle with one multiply, so the same tables serve every
+ * mains frequency.  The percent API maps onto this path.
+ *
+ * Trailing-edge channels read the same tables mirrored: their cut-off is
+ * the half-cycle minus the leading-edge delay of the level, which conducts
+ * the same share of the half-cycle's energy.  The leading-edge clamps
+ * become a minimum on-time of one pulse width and an off-time of at least
+ * RBDIMMER_MIN_DELAY_US before the crossing.
+ *
+ * Custom curves are expanded from user breakpoints into the same dense
+ * format at registration, so RBDIMMER_CURVE_CUSTOM costs the same lookup as
+ * the built-in curves.
  */
 
 #include "rbdimmer_curves.h"
 #include <math.h>
+#include <stdlib.h>
+
+// Table resolution: 2^CURVE_LUT_BITS intervals between level 0 and full.
+#ifdef CONFIG_RBDIMMER_CURVE_LUT_BITS
+#  define CURVE_LUT_BITS  CONFIG_RBDIMMER_CURVE_LUT_BITS
+#else
+#  define CURVE_LUT_BITS  10
+#endif
+#define CURVE_LUT_SIZE   ((1 << CURVE_LUT_BITS) + 1)
+#define CURVE_LUT_SHIFT  (16 - CURVE_LUT_BITS)
+#define CURVE_LUT_FRAC   ((1u << CURVE_LUT_SHIFT) - 1u)
+
+// Configurable via Kconfig; Arduino fallback values match tested defaults.
+#ifdef CONFIG_RBDIMMER_LEVEL_MAX
+#  define LEVEL_MAX_PCT  CONFIG_RBDIMMER_LEVEL_MAX
+#else
+#  define LEVEL_MAX_PCT  99
+#endif
+#ifdef CONFIG_RBDIMMER_LEVEL_MIN
+#  define LEVEL_MIN_PCT  CONFIG_RBDIMMER_LEVEL_MIN
+#else
+#  define LEVEL_MIN_PCT  3
+#endif
+
+#ifdef CONFIG_RBDIMMER_MAX_CUSTOM_CURVES
+#  define MAX_CUSTOM_CURVES  CONFIG_RBDIMMER_MAX_CUSTOM_CURVES
+#else
+#  define MAX_CUSTOM_CURVES  4
+#endif
+
+#define LEVEL_MAX_Q16  RBDIMMER_CURVES_PCT_TO_Q16(LEVEL_MAX_PCT)
+#define LEVEL_MIN_Q16  RBDIMMER_CURVES_PCT_TO_Q16(LEVEL_MIN_PCT)
 
 // ---------------------------------------------------------------------------
-// Lookup tables (101 entries: indices 0..100 = brightness percent)
+// Lookup tables (Q16 delay fraction; index i = level i / 2^CURVE_LUT_BITS)
+// LINEAR needs no table: delay fraction = full - level.
 // ---------------------------------------------------------------------------
 
-static uint8_t table_linear[101];
-static uint8_t table_rms[101];
-static uint8_t table_log[101];
+static uint16_t table_rms[CURVE_LUT_SIZE];
+static uint16_t table_log[CURVE_LUT_SIZE];
+
+// Custom curve slots: a handle is the slot index.  A slot is claimed with a
+// compare-and-swap of the fully built table, so concurrent registrations
+// need no lock and readers never see a partially expanded curve.
+static uint16_t* custom_tables[MAX_CUSTOM_CURVES];
+
+#if RBDIMMER_STATIC_ALLOC
+// Backing store of the custom slots instead of malloc.  A registration
+// claims its slot in custom_claimed first, expands into it, then publishes
+// the table pointer — readers still only ever see complete tables.
+static uint16_t custom_storage[MAX_CUSTOM_CURVES][CURVE_LUT_SIZE];
+static uint32_t custom_claimed;
+#endif
+
+static uint16_t fraction_to_q16(float delay_fraction) {
+    if (delay_fraction <= 0.0f) {
+        return 0;
+    }
+    if (delay_fraction >= 1.0f) {
+        return RBDIMMER_LEVEL_Q16_MAX;
+    }
+    return (uint16_t)lroundf(delay_fraction * (float)RBDIMMER_LEVEL_Q16_MAX);
+}
+
+// Interpolated delay fraction of @p level in @p table.
+static uint32_t table_lookup(const uint16_t* table, uint16_t level) {
+    uint32_t idx  = (uint32_t)level >> CURVE_LUT_SHIFT;
+    uint32_t frac = (uint32_t)level & CURVE_LUT_FRAC;
+    int32_t  a    = table[idx];
+    int32_t  b    = table[idx + 1];
+    return (uint32_t)(a + (((b - a) * (int32_t)frac) >> CURVE_LUT_SHIFT));
+}
+
+static const uint16_t* custom_table_get(rbdimmer_custom_curve_t curve) {
+    if (curve >= MAX_CUSTOM_CURVES) {
+        return NULL;
+    }
+    return __atomic_load_n(&custom_tables[curve], __ATOMIC_ACQUIRE);
+}
+
+// Breakpoint table → dense table, linear between breakpoints, flat outside.
+static void custom_expand(uint16_t* table, const rbdimmer_curve_point_t* points,
+                          uint8_t count) {
+    uint8_t seg = 0;
+    for (int i = 0; i < CURVE_LUT_SIZE; i++) {
+        uint32_t level = (uint32_t)i << CURVE_LUT_SHIFT;
+        if (level > RBDIMMER_LEVEL_Q16_MAX) {
+            level = RBDIMMER_LEVEL_Q16_MAX;
+        }
+        if (level <= points[0].level_q16) {
+            table[i] = points[0].delay_q16;
+            continue;
+        }
+        if (level >= points[count - 1].level_q16) {
+            table[i] = points[count - 1].delay_q16;
+            continue;
+        }
+        while (level > points[seg + 1].level_q16) {
+            seg++;
+        }
+        int32_t x0 = points[seg].level_q16,  x1 = points[seg + 1].level_q16;
+        int32_t y0 = points[seg].delay_q16,  y1 = points[seg + 1].delay_q16;
+        table[i] = (uint16_t)(y0 + (int32_t)(((int64_t)(y1 - y0) * ((int32_t)level - x0)) / (x1 - x0)));
+    }
+}
 
 // ---------------------------------------------------------------------------
 // Public API
 // ---------------------------------------------------------------------------
 
 void rbdimmer_curves_init(void) {
-    // Linear: delay is simply (100 - level)%
-    for (int i = 0; i <= 100; i++) {
-        table_linear[i] = (uint8_t)(100 - i);
-    }
+    for (int i = 0; i < CURVE_LUT_SIZE; i++) {
+        float level_normalized = (float)i / (float)(CURVE_LUT_SIZE - 1);
 
-    // RMS-compensated: angle = arccos(sqrt(level_normalized)) / pi
-    for (int i = 0; i <= 100; i++) {
-        float level_normalized = i / 100.0f;
+        // RMS-compensated: angle = arccos(sqrt(level_normalized)) / pi
         if (level_normalized <= 0.0f) {
-            table_rms[i] = 100;
+            table_rms[i] = RBDIMMER_LEVEL_Q16_MAX;
         } else if (level_normalized >= 1.0f) {
             table_rms[i] = 0;
         } else {
             float angle_rad = acosf(sqrtf(level_normalized));
-            float delay_percent = angle_rad / (float)M_PI;
-            table_rms[i] = (uint8_t)roundf(delay_percent * 100.0f);
+            table_rms[i] = fraction_to_q16(angle_rad / (float)M_PI);
         }
-    }
 
-    // Logarithmic: perceptually linear for human eye
-    for (int i = 0; i <= 100; i++) {
-        float level_normalized = i / 100.0f;
+        // Logarithmic: perceptually linear for human eye
         if (level_normalized <= 0.0f) {
-            table_log[i] = 100;
+            table_log[i] = RBDIMMER_LEVEL_Q16_MAX;
         } else if (level_normalized >= 1.0f) {
             table_log[i] = 0;
         } else {
             float log_value = log10f(1.0f + 9.0f * level_normalized) / log10f(10.0f);
-            float delay_percent = 1.0f - log_value;
-            table_log[i] = (uint8_t)roundf(delay_percent * 100.0f);
+            table_log[i] = fraction_to_q16(1.0f - log_value);
         }
     }
 }
 
-uint32_t rbdimmer_curves_level_to_delay(uint8_t level_percent,
-                                         uint32_t half_cycle_us,
-                                         rbdimmer_curve_t curve_type) {
-    // Configurable via Kconfig; Arduino fallback values match tested defaults.
-#ifdef CONFIG_RBDIMMER_LEVEL_MAX
-#  define LEVEL_MAX_PCT  CONFIG_RBDIMMER_LEVEL_MAX
+void rbdimmer_curves_deinit(void) {
+    for (int i = 0; i < MAX_CUSTOM_CURVES; i++) {
+        uint16_t* table = __atomic_exchange_n(&custom_tables[i], NULL, __ATOMIC_ACQ_REL);
+#if !RBDIMMER_STATIC_ALLOC
+        free(table);
 #else
-#  define LEVEL_MAX_PCT  99
+        (void)table;
 #endif
-#ifdef CONFIG_RBDIMMER_LEVEL_MIN
-#  define LEVEL_MIN_PCT  CONFIG_RBDIMMER_LEVEL_MIN
+    }
+#if RBDIMMER_STATIC_ALLOC
+    __atomic_store_n(&custom_claimed, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+rbdimmer_err_t rbdimmer_curves_register_custom(const rbdimmer_curve_point_t* points,
+                                                uint8_t count,
+                                                rbdimmer_custom_curve_t* curve) {
+    if (points == NULL || curve == NULL ||
+        count < 2 || count > RBDIMMER_CUSTOM_CURVE_MAX_POINTS) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    for (int i = 1; i < count; i++) {
+        if (points[i].level_q16 <= points[i - 1].level_q16) {
+            return RBDIMMER_ERR_INVALID_ARG;
+        }
+    }
+
+#if RBDIMMER_STATIC_ALLOC
+    for (int i = 0; i < MAX_CUSTOM_CURVES; i++) {
+        uint32_t bit = 1u << i;
+        if (__atomic_fetch_or(&custom_claimed, bit, __ATOMIC_ACQ_REL) & bit) {
+            continue;
+        }
+        custom_expand(custom_storage[i], points, count);
+        __atomic_store_n(&custom_tables[i], custom_storage[i], __ATOMIC_RELEASE);
+        *curve = (rbdimmer_custom_curve_t)i;
+        return RBDIMMER_OK;
+    }
+    return RBDIMMER_ERR_NO_MEMORY;
 #else
-#  define LEVEL_MIN_PCT  3
+    uint16_t* table = (uint16_t*)malloc(CURVE_LUT_SIZE * sizeof(uint16_t));
+    if (table == NULL) {
+        return RBDIMMER_ERR_NO_MEMORY;
+    }
+    custom_expand(table, points, count);
+
+    for (int i = 0; i < MAX_CUSTOM_CURVES; i++) {
+        uint16_t* expected = NULL;
+        if (__atomic_compare_exchange_n(&custom_tables[i], &expected, table, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            *curve = (rbdimmer_custom_curve_t)i;
+            return RBDIMMER_OK;
+        }
+    }
+    free(table);
+    return RBDIMMER_ERR_NO_MEMORY;
 #endif
+}
 
-    if (level_percent >= 100) {
-        level_percent = LEVEL_MAX_PCT;  // map 100% → max delay (~100 us @ 50 Hz)
+bool rbdimmer_curves_custom_valid(rbdimmer_custom_curve_t curve) {
+    return custom_table_get(curve) != NULL;
+}
+
+uint32_t rbdimmer_curves_level_q16_to_delay(uint16_t level_q16,
+                                             uint32_t half_cycle_us,
+                                             rbdimmer_curve_t curve_type,
+                                             rbdimmer_custom_curve_t custom) {
+    if (level_q16 > LEVEL_MAX_Q16) {
+        level_q16 = LEVEL_MAX_Q16;  // map 100% → max delay (~100 us @ 50 Hz)
     }
-    if (level_percent < LEVEL_MIN_PCT) {
+    if (level_q16 < LEVEL_MIN_Q16) {
         // Too close to end of half-cycle — TRIAC fires unreliably. Treat as OFF.
         return 0;
     }
 
-    uint8_t delay_percent;
+    uint32_t delay_q16;
     switch (curve_type) {
         case RBDIMMER_CURVE_RMS:
-            delay_percent = table_rms[level_percent];
+            delay_q16 = table_lookup(table_rms, level_q16);
             break;
         case RBDIMMER_CURVE_LOGARITHMIC:
-            delay_percent = table_log[level_percent];
+            delay_q16 = table_lookup(table_log, level_q16);
+            break;
+        case RBDIMMER_CURVE_CUSTOM: {
+            // No curve assigned — falls back to LINEAR
+            const uint16_t* table = custom_table_get(custom);
+            delay_q16 = (table != NULL) ? table_lookup(table, level_q16)
+                                        : (uint32_t)(RBDIMMER_LEVEL_Q16_MAX - level_q16);
             break;
+        }
         case RBDIMMER_CURVE_LINEAR:
-        case RBDIMMER_CURVE_CUSTOM:  // not yet implemented — falls back to LINEAR
         default:
-            delay_percent = table_linear[level_percent];
+            delay_q16 = RBDIMMER_LEVEL_Q16_MAX - level_q16;
             break;
     }
 
-    uint32_t delay_us = (half_cycle_us * delay_percent) / 100;
+    uint32_t delay_us = (uint32_t)(((uint64_t)half_cycle_us * delay_q16) >> 16);
 
     if (delay_us < RBDIMMER_MIN_DELAY_US) {
         delay_us = RBDIMMER_MIN_DELAY_US;
@@ -107,3 +269,25 @@ uint32_t rbdimmer_curves_level_to_delay(uint8_t level_percent,
 
     return delay_us;
 }
+
+uint32_t rbdimmer_curves_level_to_delay(uint8_t level_percent,
+                                         uint32_t half_cycle_us,
+                                         rbdimmer_curve_t curve_type) {
+    if (level_percent > 100) {
+        level_percent = 100;
+    }
+    return rbdimmer_curves_level_q16_to_delay(RBDIMMER_CURVES_PCT_TO_Q16(level_percent),
+                                              half_cycle_us, curve_type,
+                                              RBDIMMER_CUSTOM_CURVE_NONE);
+}
+
+uint32_t rbdimmer_curves_level_q16_to_cutoff(uint16_t level_q16,
+                                              uint32_t half_cycle_us,
+                                              rbdimmer_curve_t curve_type,
+                                              rbdimmer_custom_curve_t custom) {
+    // sin² is symmetric about the half-cycle centre: conducting [0, h - d)
+    // delivers what conducting [d, h) does, so every table serves both edges.
+    uint32_t delay_us = rbdimmer_curves_level_q16_to_delay(level_q16, half_cycle_us,
+                                                           curve_type, custom);
+    return (delay_us != 0) ? half_cycle_us - delay_us : 0;
+}
@@ -4,26 +4,57 @@
  * @internal
  *
  * Pure math module — no hardware dependencies.
- * Manages pre-computed lookup tables for three curve types and
- * converts a brightness percentage to a microsecond firing delay.
+ * Manages pre-computed lookup tables for three curve types plus registered
+ * custom curves, and converts a Q16 (or percent) brightness level to a
+ * microsecond firing delay (trailing edge: a cut-off).
  */
 
 #ifndef RBDIMMER_CURVES_H
 #define RBDIMMER_CURVES_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "rbdimmerESP32.h"   // rbdimmer_curve_t, RBDIMMER_MIN_DELAY_US, RBDIMMER_DEFAULT_PULSE_WIDTH_US
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Percent (0-100) → Q16 level, rounded. */
+#define RBDIMMER_CURVES_PCT_TO_Q16(pct) \
+    ((uint16_t)(((uint32_t)(pct) * RBDIMMER_LEVEL_Q16_MAX + 50u) / 100u))
+
+/** Q16 level → percent (0-100), rounded. */
+#define RBDIMMER_CURVES_Q16_TO_PCT(q16) \
+    ((uint8_t)(((uint32_t)(q16) * 100u + RBDIMMER_LEVEL_Q16_MAX / 2u) / RBDIMMER_LEVEL_Q16_MAX))
+
 /**
  * @brief Pre-compute all brightness curve lookup tables.
  * Must be called once during rbdimmer_init().
  */
 void rbdimmer_curves_init(void);
 
+/**
+ * @brief Free all registered custom curves. Called from rbdimmer_deinit().
+ */
+void rbdimmer_curves_deinit(void);
+
+/**
+ * @brief Expand a breakpoint table into a dense custom-curve table.
+ *
+ * Task context; allocates the table once.  Lookups never allocate.
+ *
+ * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG (bad table) or
+ *         RBDIMMER_ERR_NO_MEMORY (heap, or all CONFIG_RBDIMMER_MAX_CUSTOM_CURVES
+ *         slots in use)
+ */
+rbdimmer_err_t rbdimmer_curves_register_custom(const rbdimmer_curve_point_t* points,
+                                                uint8_t count,
+                                                rbdimmer_custom_curve_t* curve);
+
+/** @brief true if @p curve is a registered custom curve handle. */
+bool rbdimmer_curves_custom_valid(rbdimmer_custom_curve_t curve);
+
 /**
  * @brief Convert brightness level to TRIAC firing delay.
  *
@@ -36,6 +67,38 @@ uint32_t rbdimmer_curves_level_to_delay(uint8_t level_percent,
                                          uint32_t half_cycle_us,
                                          rbdimmer_curve_t curve_type);
 
+/**
+ * @brief Convert a Q16 brightness level to TRIAC firing delay.
+ *
+ * Interpolates the curve table between its two nearest entries — delay
+ * resolution is no longer bound to 1% of the half-cycle.  Integer-only.
+ *
+ * @param level_q16      Brightness 0 … RBDIMMER_LEVEL_Q16_MAX
+ * @param half_cycle_us  Mains half-cycle duration in microseconds
+ * @param curve_type     Selected brightness curve
+ * @param custom         Custom curve handle used for RBDIMMER_CURVE_CUSTOM
+ *                       (RBDIMMER_CUSTOM_CURVE_NONE → LINEAR)
+ * @return               Delay in microseconds (clamped to safe range), 0 = OFF
+ */
+uint32_t rbdimmer_curves_level_q16_to_delay(uint16_t level_q16,
+                                             uint32_t half_cycle_us,
+                                             rbdimmer_curve_t curve_type,
+                                             rbdimmer_custom_curve_t custom);
+
+/**
+ * @brief Convert a Q16 brightness level to a trailing-edge cut-off.
+ *
+ * The gate is on from the zero-crossing to the cut-off.  Uses the curve
+ * tables mirrored (cut-off = half-cycle − leading-edge delay), which
+ * delivers the same power as the leading-edge angle of that level.
+ *
+ * @return Cut-off in microseconds after the crossing, 0 = OFF
+ */
+uint32_t rbdimmer_curves_level_q16_to_cutoff(uint16_t level_q16,
+                                              uint32_t half_cycle_us,
+                                              rbdimmer_curve_t curve_type,
+                                              rbdimmer_custom_curve_t custom);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,293 @@
+/**
+ * @file rbdimmer_group.c
+ * @brief Phase groups: one logical load across several mains lines
+ * @internal
+ *
+ * A 3-phase heater bank is three (or more) TRIACs, one per line, that
+ * should follow one level.  Each member becomes a channel of the detector
+ * it fires from:
+ *   - own detector  — the member's line has its own zero-cross input;
+ *   - inferred      — no detector on that line: the member fires from the
+ *                     reference detector, its delay shifted by the line lag
+ *                     (120° / 240° for L2 / L3) of the tracked half-cycle.
+ * TRIACs fire in both halves of the cycle, so only the lag modulo 180°
+ * matters: 120° is 2/3 of a half-cycle, 240° is 1/3.
+ *
+ * Members firing from the same detector at the same lag would switch at
+ * one instant; stagger_us spreads them symmetrically around the level's
+ * delay (mean power unchanged as long as no member clamps).
+ *
+ * Level changes go through rbdimmer_channel_set_levels_q16(): all members
+ * are recomputed under one manager_mutex hold and every detector phase is
+ * published once, so all members of a phase switch at the same crossing.
+ *
+ * Storage: a static pool of RBDIMMER_MAX_GROUPS; group_mutex guards it.
+ * Lock order: group_mutex → fade_mutex → manager_mutex.
+ */
+
+#include "rbdimmer_group.h"
+#include "rbdimmer_channel.h"
+#include "rbdimmer_zerocross.h"
+#include "rbdimmer_curves.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#define TAG "RBDIMMER"
+
+// ---------------------------------------------------------------------------
+// Module-private state
+// ---------------------------------------------------------------------------
+
+static rbdimmer_group_t group_pool[RBDIMMER_MAX_GROUPS];
+
+static StaticSemaphore_t group_mutex_buf;
+static SemaphoreHandle_t group_mutex = NULL;
+
+// True if @p group is a live slot of the pool.  Caller holds group_mutex.
+static bool group_valid(const rbdimmer_group_t* group) {
+    uintptr_t offset = (uintptr_t)group - (uintptr_t)group_pool;
+    return group != NULL && offset < sizeof(group_pool) &&
+           offset % sizeof(rbdimmer_group_t) == 0 && group->in_use;
+}
+
+// Line lag as a fraction of a half-cycle (lag mod 180°).
+static uint16_t lag_to_q16(uint16_t lag_deg) {
+    return (uint16_t)(((lag_deg % 180u) * 65536u) / 180u);
+}
+
+// Line lag of member @p i behind its detector, Q16 of a half-cycle.
+static uint16_t member_lag_q16(const rbdimmer_group_t* group, uint8_t i) {
+    return (group->member_phase[i] == RBDIMMER_GROUP_PHASE_INFER)
+        ? lag_to_q16(group->member_lag_deg[i]) : 0;
+}
+
+// Delete the first @p count member channels of @p group.
+static void group_release(rbdimmer_group_t* group, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        rbdimmer_delete_channel(group->members[i]);
+        group->members[i] = NULL;
+    }
+    group->in_use = false;
+}
+
+// ---------------------------------------------------------------------------
+// Module lifecycle
+// ---------------------------------------------------------------------------
+
+void rbdimmer_group_init(void) {
+    memset(group_pool, 0, sizeof(group_pool));
+    if (group_mutex == NULL) {
+        group_mutex = xSemaphoreCreateMutexStatic(&group_mutex_buf);
+    }
+}
+
+void rbdimmer_group_deinit(void) {
+    if (group_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    memset(group_pool, 0, sizeof(group_pool));  // channels go with the channel manager
+    xSemaphoreGive(group_mutex);
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_group_create(const rbdimmer_group_config_t* config,
+                                      rbdimmer_group_t** group) {
+    if (config == NULL || group == NULL || group_mutex == NULL ||
+        config->member_count == 0 || config->member_count > RBDIMMER_GROUP_MAX_MEMBERS) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    for (uint8_t i = 0; i < config->member_count; i++) {
+        const rbdimmer_group_member_t* m = &config->members[i];
+        uint8_t phase = (m->phase == RBDIMMER_GROUP_PHASE_INFER) ? config->reference_phase
+                                                                 : m->phase;
+        if (m->lag_deg >= 360) {
+            return RBDIMMER_ERR_INVALID_ARG;
+        }
+        if (rbdimmer_zc_get_by_phase(phase) == NULL) {
+            ESP_LOGE(TAG, "Group member %d: phase %d not registered", i, phase);
+            return RBDIMMER_ERR_NOT_FOUND;
+        }
+    }
+
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    rbdimmer_group_t* g = NULL;
+    for (int i = 0; i < RBDIMMER_MAX_GROUPS; i++) {
+        if (!group_pool[i].in_use) {
+            g = &group_pool[i];
+            break;
+        }
+    }
+    if (g == NULL) {
+        xSemaphoreGive(group_mutex);
+        ESP_LOGE(TAG, "Maximum number of groups reached (%d)", RBDIMMER_MAX_GROUPS);
+        return RBDIMMER_ERR_NO_MEMORY;
+    }
+    memset(g, 0, sizeof(*g));
+    g->in_use          = true;
+    g->reference_phase = config->reference_phase;
+
+    // Members start dark: none may fire unshifted before its timing is set
+    for (uint8_t i = 0; i < config->member_count; i++) {
+        const rbdimmer_group_member_t* m = &config->members[i];
+        bool inferred = m->phase == RBDIMMER_GROUP_PHASE_INFER;
+        rbdimmer_config_t cfg = {
+            .gpio_pin      = m->gpio_pin,
+            .phase         = inferred ? config->reference_phase : m->phase,
+            .initial_level = 0,
+            .curve_type    = config->curve_type,
+            .output        = RBDIMMER_OUTPUT_TIMER,
+        };
+        rbdimmer_err_t err = rbdimmer_create_channel(&cfg, &g->members[i]);
+        if (err != RBDIMMER_OK) {
+            group_release(g, i);
+            xSemaphoreGive(group_mutex);
+            return err;
+        }
+        g->member_phase[i]   = m->phase;
+        g->member_lag_deg[i] = inferred ? (m->lag_deg != 0 ? m->lag_deg : (uint16_t)(120u * i))
+                                        : 0;
+        g->count = (uint8_t)(i + 1);
+    }
+
+    // Stagger: spread the members that share a detector and a lag
+    for (uint8_t i = 0; i < g->count; i++) {
+        uint16_t lag = member_lag_q16(g, i);
+        int rank = 0, peers = 0;
+        for (uint8_t j = 0; j < g->count; j++) {
+            if (g->members[j]->phase == g->members[i]->phase && member_lag_q16(g, j) == lag) {
+                rank  += (j < i);
+                peers += 1;
+            }
+        }
+        int16_t skew = (int16_t)(((2 * rank - (peers - 1)) * (int)config->stagger_us) / 2);
+        rbdimmer_err_t err = rbdimmer_channel_set_timing(g->members[i], lag, skew);
+        if (err != RBDIMMER_OK) {
+            group_release(g, g->count);
+            xSemaphoreGive(group_mutex);
+            return err;
+        }
+    }
+
+    uint8_t level = config->initial_level > 100 ? 100 : config->initial_level;
+    g->level_q16 = RBDIMMER_CURVES_PCT_TO_Q16(level);
+    rbdimmer_channel_set_levels_q16(g->members, g->count, g->level_q16);
+    xSemaphoreGive(group_mutex);
+
+    *group = g;
+    ESP_LOGI(TAG, "Phase group of %d members on reference phase %d",
+             g->count, g->reference_phase);
+    return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_group_delete(rbdimmer_group_t* group) {
+    if (group_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    if (!group_valid(group)) {
+        xSemaphoreGive(group_mutex);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    group_release(group, group->count);
+    xSemaphoreGive(group_mutex);
+    return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_group_set_level(rbdimmer_group_t* group, uint8_t level_percent) {
+    if (level_percent > 100) {
+        level_percent = 100;
+    }
+    return rbdimmer_group_set_level_q16(group, RBDIMMER_CURVES_PCT_TO_Q16(level_percent));
+}
+
+rbdimmer_err_t rbdimmer_group_set_level_q16(rbdimmer_group_t* group, uint16_t level_q16) {
+    if (group_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    if (!group_valid(group)) {
+        xSemaphoreGive(group_mutex);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    group->level_q16 = level_q16;
+    rbdimmer_err_t err = rbdimmer_channel_set_levels_q16(group->members, group->count,
+                                                         level_q16);
+    xSemaphoreGive(group_mutex);
+    return err;
+}
+
+rbdimmer_err_t rbdimmer_group_set_active(rbdimmer_group_t* group, bool active) {
+    if (group_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    if (!group_valid(group)) {
+        xSemaphoreGive(group_mutex);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_err_t err = RBDIMMER_OK;
+    for (uint8_t i = 0; i < group->count; i++) {
+        rbdimmer_err_t e = rbdimmer_set_active(group->members[i], active);
+        err = (err == RBDIMMER_OK) ? e : err;
+    }
+    xSemaphoreGive(group_mutex);
+    return err;
+}
+
+uint16_t rbdimmer_group_get_level_q16(rbdimmer_group_t* group) {
+    if (group == NULL) return 0;
+    return group->level_q16;
+}
+
+rbdimmer_channel_t* rbdimmer_group_get_channel(rbdimmer_group_t* group, uint8_t member) {
+    if (group_mutex == NULL) {
+        return NULL;
+    }
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    rbdimmer_channel_t* channel = (group_valid(group) && member < group->count)
+                                  ? group->members[member] : NULL;
+    xSemaphoreGive(group_mutex);
+    return channel;
+}
+
+rbdimmer_err_t rbdimmer_group_get_phase_lag(rbdimmer_group_t* group, uint8_t member,
+                                             uint16_t* lag_deg) {
+    if (lag_deg == NULL || group_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(group_mutex, portMAX_DELAY);
+    if (!group_valid(group) || member >= group->count) {
+        xSemaphoreGive(group_mutex);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    uint8_t phase = group->member_phase[member];
+    if (phase == RBDIMMER_GROUP_PHASE_INFER) {
+        *lag_deg = group->member_lag_deg[member] % 180;
+        xSemaphoreGive(group_mutex);
+        return RBDIMMER_OK;
+    }
+    rbdimmer_zero_cross_t* ref = rbdimmer_zc_get_by_phase(group->reference_phase);
+    rbdimmer_zero_cross_t* zc  = rbdimmer_zc_get_by_phase(phase);
+    xSemaphoreGive(group_mutex);
+    if (ref == NULL || zc == NULL || ref->last_cross_time == 0 || zc->last_cross_time == 0 ||
+        !ref->frequency_measured) {
+        return RBDIMMER_ERR_NOT_FOUND;
+    }
+    // Both detectors keep moving — one snapshot each is enough for a diagnostic
+    int32_t half_cycle = (int32_t)ref->half_cycle_us;
+    uint32_t t_ref = ref->last_cross_time - (uint32_t)(int32_t)ref->offset_us[ref->polarity];
+    uint32_t t_m   = zc->last_cross_time - (uint32_t)(int32_t)zc->offset_us[zc->polarity];
+    int32_t lag_us = (int32_t)(t_m - t_ref) % half_cycle;
+    if (lag_us < 0) {
+        lag_us += half_cycle;
+    }
+    *lag_deg = (uint16_t)((((uint32_t)lag_us * 180u + (uint32_t)half_cycle / 2) /
+                           (uint32_t)half_cycle) % 180u);
+    return RBDIMMER_OK;
+}
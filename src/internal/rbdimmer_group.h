@@ -0,0 +1,35 @@
+/**
+ * @file rbdimmer_group.h
+ * @brief Phase groups: one logical load across several mains lines
+ * @internal
+ *
+ * Implements rbdimmer_group_*() declared in rbdimmerESP32.h on top of the
+ * channel manager: every member is an ordinary software-output channel,
+ * timed through rbdimmer_channel_set_timing() and driven with
+ * rbdimmer_channel_set_levels_q16().
+ */
+
+#ifndef RBDIMMER_GROUP_H
+#define RBDIMMER_GROUP_H
+
+#include "rbdimmerESP32.h"    // rbdimmer_err_t, rbdimmer_group_t
+#include "rbdimmer_types.h"   // struct rbdimmer_group_s
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Reset the group pool. Called from rbdimmer_init(). */
+void rbdimmer_group_init(void);
+
+/**
+ * @brief Release every group.  Called from rbdimmer_deinit() before the
+ *        channel manager deletes the member channels.
+ */
+void rbdimmer_group_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_GROUP_H */
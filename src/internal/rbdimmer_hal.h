@@ -9,7 +9,8 @@
  * Instead it:
  *   1. Documents per-chip limits (GPIO count, output pins, core count)
  *   2. Provides validated GPIO-check macros used by channel and zerocross modules
- *   3. Emits compile-time warnings for chip-specific concerns
+ *   3. Provides mask-based gate writes that hide the per-chip register layout
+ *   4. Emits compile-time warnings for chip-specific concerns
  *
  * -------------------------------------------------------------------------
  * Chip quick-reference (ESP-IDF v5.x, verified against soc_caps.h)
@@ -36,11 +37,26 @@
  *   - Others:  SYSTIMER (64-bit system timer)
  * There is NO fixed per-channel hardware resource limit.
  * Each dimmer channel consumes 2 esp_timer handles (delay + pulse timer),
- * allocated from heap.  Practical limit is heap size and IRAM budget.
+ * allocated from heap — with CONFIG_RBDIMMER_STATIC_ALLOC once per channel
+ * slot at init.  Practical limit is heap size and IRAM budget.
  *
- * General-purpose timers (gptimer): NOT used by this library.
- *   ESP32/S2/S3: 4 timers (2 groups × 2)
- *   ESP32-C3/C6: 2 timers (1 group × 2)
+ * General-purpose timers (gptimer): used only by the optional GPTimer
+ * scheduler backend (CONFIG_RBDIMMER_TIMER_BACKEND_GPTIMER), one per phase:
+ *   ESP32/S2/S3: 4 timers (2 groups × 2) → up to 4 phases
+ *   ESP32-C3/C6: 2 timers (1 group × 2) → up to 2 phases
+ * Registering a channel on a phase beyond that limit returns
+ * RBDIMMER_ERR_TIMER_FAILED.
+ *
+ * MCPWM: used only by channels created with RBDIMMER_OUTPUT_MCPWM.  Each such
+ * channel takes one timer + operator + generator and one GPIO sync source:
+ *   ESP32/S3:  2 groups × 3 → up to 6 MCPWM channels
+ *   ESP32-C6:  1 group  × 3 → up to 3 MCPWM channels
+ *   ESP32-S2/C3: no MCPWM — RBDIMMER_OUTPUT_MCPWM returns RBDIMMER_ERR_INVALID_ARG
+ *
+ * MCPWM capture (CONFIG_RBDIMMER_ZC_HW_CAPTURE): one capture channel per
+ * zero-cross input, 3 per group (ESP32/S3: 6, C6: 3).  Phases beyond that,
+ * chips without MCPWM and IDF < 5.1 (no capture timer resolution) keep the
+ * GPIO ISR.
  *
  * -------------------------------------------------------------------------
  * Single-core notes (ESP32-S2, C3, C6)
@@ -52,13 +68,27 @@
  *
  * Cross-core race condition (Fix 1.6) cannot occur on single-core chips,
  * but the pinning incurs no cost and keeps the code uniform.
+ *
+ * -------------------------------------------------------------------------
+ * Real-time core (CONFIG_RBDIMMER_RT_CORE, rbdimmer_set_rt_affinity)
+ * -------------------------------------------------------------------------
+ * An interrupt runs on the core that allocated it.  With a core chosen, the
+ * GPIO ISR service, the GPTimer scheduler and MCPWM capture interrupts are
+ * allocated there through esp_ipc, and the fade task is pinned to it.
+ * The esp_timer interrupt is set up by ESP-IDF at boot
+ * (CONFIG_ESP_TIMER_ISR_AFFINITY, CONFIG_ESP_TIMER_INTERRUPT_LEVEL).
+ * Single-core chips and FREERTOS_UNICORE builds accept core 0 only.
  */
 
 #ifndef RBDIMMER_HAL_H
 #define RBDIMMER_HAL_H
 
+#include <stdint.h>
 #include "driver/gpio.h"    /* GPIO_IS_VALID_OUTPUT_GPIO, GPIO_IS_VALID_GPIO  */
 #include "soc/soc_caps.h"   /* SOC_CPU_CORES_NUM, SOC_GPIO_PIN_COUNT          */
+#include "soc/soc.h"        /* REG_WRITE                                      */
+#include "soc/gpio_reg.h"   /* GPIO_OUT_W1TS_REG, GPIO_OUT1_W1TS_REG          */
+#include "esp_idf_version.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -94,6 +124,59 @@ extern "C" {
     (((pin) < (uint8_t)SOC_GPIO_PIN_COUNT) && \
      ((((uint64_t)1U << (pin)) & (uint64_t)SOC_GPIO_VALID_GPIO_MASK) != 0U))
 
+// ---------------------------------------------------------------------------
+// Coalesced gate writes — one register store per 32-pin bank
+// ---------------------------------------------------------------------------
+//
+// GPIO_OUT_W1TS/W1TC set/clear every output whose bit is 1 in a single store,
+// so all TRIAC gates of a firing group switch in the same bus cycle.
+// Bank 1 (GPIO 32+) exists on ESP32, S2 and S3 only; on C3/C6 every output
+// GPIO is in bank 0.  Pins driven this way must be plain GPIO outputs (no
+// peripheral routed through the GPIO matrix) — gpio_config() in
+// rbdimmer_create_channel() guarantees that.
+//
+// always_inline: callers are IRAM_ATTR ISR paths; an out-of-line copy of a
+// static inline function could otherwise be placed in flash.
+
+/** @brief Drive HIGH every gate GPIO whose bit is set in @p mask. */
+static inline __attribute__((always_inline)) void rbdimmer_hal_gate_set_mask(uint64_t mask) {
+    if ((uint32_t)mask != 0U) {
+        REG_WRITE(GPIO_OUT_W1TS_REG, (uint32_t)mask);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if ((uint32_t)(mask >> 32) != 0U) {
+        REG_WRITE(GPIO_OUT1_W1TS_REG, (uint32_t)(mask >> 32));
+    }
+#endif
+}
+
+/** @brief Drive LOW every gate GPIO whose bit is set in @p mask. */
+static inline __attribute__((always_inline)) void rbdimmer_hal_gate_clear_mask(uint64_t mask) {
+    if ((uint32_t)mask != 0U) {
+        REG_WRITE(GPIO_OUT_W1TC_REG, (uint32_t)mask);
+    }
+#if SOC_GPIO_PIN_COUNT > 32
+    if ((uint32_t)(mask >> 32) != 0U) {
+        REG_WRITE(GPIO_OUT1_W1TC_REG, (uint32_t)(mask >> 32));
+    }
+#endif
+}
+
+/**
+ * @brief Input level of @p pin read straight from GPIO_IN / GPIO_IN1.
+ *
+ * ISR-safe replacement for gpio_get_level(), which is not guaranteed to be
+ * IRAM-resident.
+ */
+static inline __attribute__((always_inline)) uint32_t rbdimmer_hal_gpio_read(uint8_t pin) {
+#if SOC_GPIO_PIN_COUNT > 32
+    if (pin >= 32) {
+        return (REG_READ(GPIO_IN1_REG) >> (pin - 32)) & 1U;
+    }
+#endif
+    return (REG_READ(GPIO_IN_REG) >> pin) & 1U;
+}
+
 // ---------------------------------------------------------------------------
 // Core count (compile-time constant from soc_caps.h)
 // ---------------------------------------------------------------------------
@@ -108,6 +191,63 @@ extern "C" {
   #define RBDIMMER_HAL_SINGLE_CORE 0
 #endif
 
+/**
+ * Cores the real-time work can be pinned to (rbdimmer_set_rt_affinity):
+ * 1 on single-core chips and with CONFIG_FREERTOS_UNICORE, where esp_ipc
+ * is not available either.
+ */
+#if RBDIMMER_HAL_SINGLE_CORE || defined(CONFIG_FREERTOS_UNICORE)
+  #define RBDIMMER_HAL_RT_CORES    1
+#else
+  #define RBDIMMER_HAL_RT_CORES    RBDIMMER_HAL_CPU_CORES
+#endif
+
+/**
+ * 1 when GPTimer and MCPWM capture configs take an intr_priority, so
+ * RBDIMMER_RT_INTR_PRIORITY reaches their interrupts.  Older IDF versions
+ * only raise the GPIO ISR service (allocation flags).
+ */
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+  #define RBDIMMER_HAL_HAS_INTR_PRIORITY 1
+#else
+  #define RBDIMMER_HAL_HAS_INTR_PRIORITY 0
+#endif
+
+// ---------------------------------------------------------------------------
+// Firing timer backend
+// ---------------------------------------------------------------------------
+
+/**
+ * 1 when the single-GPTimer-per-phase scheduler drives the TRIAC gates,
+ * 0 for the default two-esp_timer-per-channel backend.  Arduino builds have
+ * no Kconfig and always use esp_timer.
+ */
+#if defined(CONFIG_RBDIMMER_TIMER_BACKEND_GPTIMER) && SOC_GPTIMER_SUPPORTED
+  #define RBDIMMER_HAL_USE_GPTIMER 1
+#else
+  #define RBDIMMER_HAL_USE_GPTIMER 0
+#endif
+
+/**
+ * 1 when the chip has an MCPWM peripheral (RBDIMMER_OUTPUT_MCPWM available).
+ */
+#if SOC_MCPWM_SUPPORTED
+  #define RBDIMMER_HAL_HAS_MCPWM 1
+#else
+  #define RBDIMMER_HAL_HAS_MCPWM 0
+#endif
+
+/**
+ * 1 when zero-cross edges are timestamped by the MCPWM capture unit instead
+ * of esp_timer_get_time() in the GPIO ISR.
+ */
+#if defined(CONFIG_RBDIMMER_ZC_HW_CAPTURE) && SOC_MCPWM_SUPPORTED && \
+    ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+  #define RBDIMMER_HAL_USE_ZC_CAPTURE 1
+#else
+  #define RBDIMMER_HAL_USE_ZC_CAPTURE 0
+#endif
+
 // ---------------------------------------------------------------------------
 // Compile-time advisory checks
 // ---------------------------------------------------------------------------
@@ -135,6 +275,17 @@ extern "C" {
   #endif
 #endif
 
+/*
+ * The scheduler calls gptimer_get_raw_count() / gptimer_set_alarm_action()
+ * from ISR context; without these options they live in flash.
+ */
+#if RBDIMMER_HAL_USE_GPTIMER
+  #if !defined(CONFIG_GPTIMER_CTRL_FUNC_IN_IRAM) || !defined(CONFIG_GPTIMER_ISR_IRAM_SAFE)
+    #warning "rbdimmerESP32: GPTimer backend needs CONFIG_GPTIMER_CTRL_FUNC_IN_IRAM " \
+             "and CONFIG_GPTIMER_ISR_IRAM_SAFE — enable them in menuconfig."
+  #endif
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,195 @@
+/**
+ * @file rbdimmer_instrument.c
+ * @brief Timing histograms of the zero-cross and gate hot paths
+ * @internal
+ *
+ * Implements rbdimmer_get_timing_stats() and rbdimmer_reset_timing_stats()
+ * (public API, declared in rbdimmerESP32.h).
+ *
+ * A sample costs one count-leading-zeros, five adds and two stores to the
+ * block's sequence counter — no lock, no branch on the reader.  Bucket i > 0
+ * holds values 2^(i-1) … 2^i - 1, bucket 0 holds 0, the last one everything
+ * above.
+ *
+ * Snapshots use the sequence counter: odd while the writer is inside the
+ * block, bumped again when done.  The reader copies the block and retries if
+ * the counter was odd or moved.  A reset is only requested by the task; the
+ * writer clears the block on its next sample, so the ISR stays the sole
+ * writer.
+ */
+
+#include "rbdimmer_instrument.h"
+
+#if RBDIMMER_INSTRUMENT
+
+#include "esp_attr.h"
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    volatile uint32_t seq;            // odd = writer inside
+    volatile uint8_t  reset;          // task → writer: clear before next sample
+    rbdimmer_histogram_t latency;
+    rbdimmer_histogram_t jitter;
+    rbdimmer_histogram_t isr_cycles;
+} zc_block_t;
+
+typedef struct {
+    volatile uint32_t seq;
+    volatile uint8_t  reset;
+    rbdimmer_histogram_t fire;
+    rbdimmer_histogram_t release;
+} gate_block_t;
+
+// DRAM_ATTR: written from ISR context.
+static DRAM_ATTR zc_block_t   zc_blocks[RBDIMMER_MAX_PHASES];
+static DRAM_ATTR gate_block_t gate_blocks[RBDIMMER_MAX_PHASES];
+
+// ---------------------------------------------------------------------------
+// ISR-context writers
+// ---------------------------------------------------------------------------
+
+static IRAM_ATTR void hist_add(rbdimmer_histogram_t* h, uint32_t v) {
+    uint32_t bucket = (v == 0) ? 0 : 32 - (uint32_t)__builtin_clz(v);
+    if (bucket >= RBDIMMER_TIMING_BUCKETS) {
+        bucket = RBDIMMER_TIMING_BUCKETS - 1;
+    }
+    if (h->count == 0 || v < h->min) {
+        h->min = v;
+    }
+    if (v > h->max) {
+        h->max = v;
+    }
+    h->count++;
+    h->sum += v;
+    h->buckets[bucket]++;
+}
+
+// Enter the block (sequence odd); applies a pending reset.
+static IRAM_ATTR uint32_t write_begin(volatile uint32_t* seq, volatile uint8_t* reset,
+                                      void* hist, size_t hist_size) {
+    uint32_t s = *seq + 1;
+    __atomic_store_n(seq, s, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (*reset) {
+        memset(hist, 0, hist_size);
+        *reset = 0;
+    }
+    return s;
+}
+
+static IRAM_ATTR void write_end(volatile uint32_t* seq, uint32_t s) {
+    __atomic_store_n(seq, s + 1, __ATOMIC_RELEASE);
+}
+
+#define ZC_HISTS(b)    (&(b)->latency), (sizeof(*(b)) - offsetof(zc_block_t, latency))
+#define GATE_HISTS(b)  (&(b)->fire), (sizeof(*(b)) - offsetof(gate_block_t, fire))
+
+void IRAM_ATTR rbdimmer_instr_zc_latency(uint8_t phase, uint32_t latency_us) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    zc_block_t* b = &zc_blocks[phase];
+    uint32_t s = write_begin(&b->seq, &b->reset, ZC_HISTS(b));
+    hist_add(&b->latency, latency_us);
+    write_end(&b->seq, s);
+}
+
+void IRAM_ATTR rbdimmer_instr_zc_jitter(uint8_t phase, uint32_t jitter_us) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    zc_block_t* b = &zc_blocks[phase];
+    uint32_t s = write_begin(&b->seq, &b->reset, ZC_HISTS(b));
+    hist_add(&b->jitter, jitter_us);
+    write_end(&b->seq, s);
+}
+
+void IRAM_ATTR rbdimmer_instr_zc_isr_cycles(uint8_t phase, uint32_t cycles) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    zc_block_t* b = &zc_blocks[phase];
+    uint32_t s = write_begin(&b->seq, &b->reset, ZC_HISTS(b));
+    hist_add(&b->isr_cycles, cycles);
+    write_end(&b->seq, s);
+}
+
+void IRAM_ATTR rbdimmer_instr_gate_fire(uint8_t phase, int32_t late_us) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    gate_block_t* b = &gate_blocks[phase];
+    uint32_t s = write_begin(&b->seq, &b->reset, GATE_HISTS(b));
+    hist_add(&b->fire, late_us > 0 ? (uint32_t)late_us : 0);
+    write_end(&b->seq, s);
+}
+
+void IRAM_ATTR rbdimmer_instr_gate_release(uint8_t phase, int32_t late_us) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    gate_block_t* b = &gate_blocks[phase];
+    uint32_t s = write_begin(&b->seq, &b->reset, GATE_HISTS(b));
+    hist_add(&b->release, late_us > 0 ? (uint32_t)late_us : 0);
+    write_end(&b->seq, s);
+}
+
+// ---------------------------------------------------------------------------
+// Task-context readers
+// ---------------------------------------------------------------------------
+
+// Consistent copy of @p size bytes at @p src, guarded by @p seq.
+static void snapshot(volatile const uint32_t* seq, const void* src, void* dst, size_t size) {
+    for (;;) {
+        uint32_t s1 = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (s1 & 1) {
+            continue;                 // writer inside — a few µs at most
+        }
+        memcpy(dst, src, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(seq, __ATOMIC_RELAXED) == s1) {
+            return;
+        }
+    }
+}
+
+rbdimmer_err_t rbdimmer_get_timing_stats(uint8_t phase, rbdimmer_timing_stats_t* stats) {
+    if (phase >= RBDIMMER_MAX_PHASES || stats == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_histogram_t zc[3];
+    rbdimmer_histogram_t gate[2];
+    snapshot(&zc_blocks[phase].seq, &zc_blocks[phase].latency, zc, sizeof(zc));
+    snapshot(&gate_blocks[phase].seq, &gate_blocks[phase].fire, gate, sizeof(gate));
+    stats->zc_latency_us   = zc[0];
+    stats->zc_jitter_us    = zc[1];
+    stats->zc_isr_cycles   = zc[2];
+    stats->fire_late_us    = gate[0];
+    stats->release_late_us = gate[1];
+    return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_reset_timing_stats(uint8_t phase) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    zc_blocks[phase].reset   = 1;
+    gate_blocks[phase].reset = 1;
+    return RBDIMMER_OK;
+}
+
+#else /* !RBDIMMER_INSTRUMENT */
+
+rbdimmer_err_t rbdimmer_get_timing_stats(uint8_t phase, rbdimmer_timing_stats_t* stats) {
+    (void)phase;
+    (void)stats;
+    return RBDIMMER_ERR_INVALID_ARG;
+}
+
+rbdimmer_err_t rbdimmer_reset_timing_stats(uint8_t phase) {
+    (void)phase;
+    return RBDIMMER_ERR_INVALID_ARG;
+}
+
+#endif /* RBDIMMER_INSTRUMENT */
@@ -0,0 +1,69 @@
+/**
+ * @file rbdimmer_instrument.h
+ * @brief Timing histograms of the zero-cross and gate hot paths
+ * @internal
+ *
+ * Enabled with CONFIG_RBDIMMER_INSTRUMENT (RBDIMMER_INSTRUMENT == 1).  The
+ * record functions are called from ISR context by rbdimmer_zerocross.c,
+ * rbdimmer_timer.c and rbdimmer_scheduler.c; readers take a snapshot with
+ * rbdimmer_get_timing_stats() (public API, declared in rbdimmerESP32.h).
+ *
+ * Every phase has two blocks with exactly one writer context each:
+ *   zc    — the zero-cross ISR of the phase (GPIO or capture)
+ *   gate  — the timer backend (esp_timer callbacks, or the GPTimer scheduler
+ *           under its spinlock)
+ * so a sequence counter per block is enough for lock-free snapshots.
+ *
+ * Disabled builds get empty inline stubs — call sites need no #if.
+ */
+
+#ifndef RBDIMMER_INSTRUMENT_H
+#define RBDIMMER_INSTRUMENT_H
+
+#include <stdint.h>
+#include "rbdimmerESP32.h"    // RBDIMMER_INSTRUMENT, rbdimmer_timing_stats_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if RBDIMMER_INSTRUMENT
+
+/** @brief Hardware-latched edge → ISR entry, µs (capture input only). */
+void rbdimmer_instr_zc_latency(uint8_t phase, uint32_t latency_us);
+
+/** @brief |edge interval − tracked half-cycle|, µs (accepted real edges). */
+void rbdimmer_instr_zc_jitter(uint8_t phase, uint32_t jitter_us);
+
+/** @brief Zero-cross ISR execution time, CPU cycles. */
+void rbdimmer_instr_zc_isr_cycles(uint8_t phase, uint32_t cycles);
+
+/** @brief Gate switched @p late_us after its scheduled time (negative = early, counted as 0). */
+void rbdimmer_instr_gate_fire(uint8_t phase, int32_t late_us);
+void rbdimmer_instr_gate_release(uint8_t phase, int32_t late_us);
+
+#else
+
+static inline void rbdimmer_instr_zc_latency(uint8_t phase, uint32_t latency_us) {
+    (void)phase; (void)latency_us;
+}
+static inline void rbdimmer_instr_zc_jitter(uint8_t phase, uint32_t jitter_us) {
+    (void)phase; (void)jitter_us;
+}
+static inline void rbdimmer_instr_zc_isr_cycles(uint8_t phase, uint32_t cycles) {
+    (void)phase; (void)cycles;
+}
+static inline void rbdimmer_instr_gate_fire(uint8_t phase, int32_t late_us) {
+    (void)phase; (void)late_us;
+}
+static inline void rbdimmer_instr_gate_release(uint8_t phase, int32_t late_us) {
+    (void)phase; (void)late_us;
+}
+
+#endif /* RBDIMMER_INSTRUMENT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_INSTRUMENT_H */
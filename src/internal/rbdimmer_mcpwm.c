@@ -0,0 +1,251 @@
+/**
+ * @file rbdimmer_mcpwm.c
+ * @brief MCPWM gate-pulse output backend (RBDIMMER_OUTPUT_MCPWM)
+ * @internal
+ *
+ * Per channel:
+ *   gpio sync src (ZC pin, rising edge) ──► timer (1 MHz, count up, phase 0)
+ *   operator ── cmp_fire    : UP == delay          → gate HIGH
+ *            ── cmp_release : UP == delay + width  → gate LOW
+ *                             (gate hold: UP == hold end)
+ *   trailing edge: cmp_fire at tick 1, cmp_release at the cut-off
+ *            ── timer FULL  : counter wrapped      → gate LOW (safety)
+ *
+ * The timer period is far longer than a mains half-cycle, so every ZC edge
+ * resets the counter before it wraps.  If the mains disappears the counter
+ * wraps every ~65 ms and keeps pulsing — harmless, the TRIAC carries no
+ * current without mains voltage.
+ *
+ * Unlike the software path there is no ZC_DEBOUNCE noise gate: a spike on
+ * the ZC line restarts the counter immediately.  Use a clean ZC signal.
+ */
+
+#include "rbdimmer_mcpwm.h"
+#include "rbdimmer_hal.h"
+#include "rbdimmer_zerocross.h"
+
+#if RBDIMMER_HAL_HAS_MCPWM
+
+#include "driver/mcpwm_prelude.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TAG "RBDIMMER"
+
+// 1 tick = 1 µs — delays from rbdimmer_curves are already in µs.
+#define MCPWM_RESOLUTION_HZ  1000000
+
+// Must exceed the longest half-cycle (45 Hz → 11111 µs) and stay below the
+// 16-bit counter limit.
+#define MCPWM_PERIOD_TICKS   65000
+
+struct rbdimmer_mcpwm_out_s {
+    mcpwm_timer_handle_t timer;
+    mcpwm_sync_handle_t  sync;
+    mcpwm_oper_handle_t  oper;
+    mcpwm_cmpr_handle_t  cmp_fire;
+    mcpwm_cmpr_handle_t  cmp_release;
+    mcpwm_gen_handle_t   gen;
+    bool                 enabled;        // timer enabled (must disable before delete)
+};
+
+#if RBDIMMER_STATIC_ALLOC
+// One output per channel pool slot instead of calloc.  The driver objects
+// behind the handles are still allocated by ESP-IDF at channel creation.
+static struct rbdimmer_mcpwm_out_s out_pool[RBDIMMER_MAX_CHANNELS];
+#endif
+
+// ---------------------------------------------------------------------------
+// Internal helpers
+// ---------------------------------------------------------------------------
+
+// Free whatever part of @p out was allocated — used for both rollback and
+// regular deletion.
+static void mcpwm_out_release(struct rbdimmer_mcpwm_out_s* out) {
+    if (out->enabled) {
+        mcpwm_timer_start_stop(out->timer, MCPWM_TIMER_STOP_FULL);
+        mcpwm_timer_disable(out->timer);
+        out->enabled = false;
+    }
+    if (out->gen)         { mcpwm_del_generator(out->gen);          out->gen = NULL; }
+    if (out->cmp_release) { mcpwm_del_comparator(out->cmp_release); out->cmp_release = NULL; }
+    if (out->cmp_fire)    { mcpwm_del_comparator(out->cmp_fire);    out->cmp_fire = NULL; }
+    if (out->oper)        { mcpwm_del_operator(out->oper);          out->oper = NULL; }
+    if (out->timer)       { mcpwm_del_timer(out->timer);            out->timer = NULL; }
+    if (out->sync)        { mcpwm_del_sync_src(out->sync);          out->sync = NULL; }
+}
+
+// Build the full chain in MCPWM group @p group.
+static esp_err_t mcpwm_out_build(struct rbdimmer_mcpwm_out_s* out, int group,
+                                 uint8_t gate_pin, uint8_t zc_pin) {
+    esp_err_t err;
+
+    mcpwm_timer_config_t timer_config = {
+        .group_id      = group,
+        .clk_src       = MCPWM_TIMER_CLK_SRC_DEFAULT,
+        .resolution_hz = MCPWM_RESOLUTION_HZ,
+        .count_mode    = MCPWM_TIMER_COUNT_MODE_UP,
+        .period_ticks  = MCPWM_PERIOD_TICKS,
+    };
+    if ((err = mcpwm_new_timer(&timer_config, &out->timer)) != ESP_OK) return err;
+
+    // Sync on the detector edge of the phase; BOTH and HALF_WAVE phases
+    // sync on the rising edge (no pulse-centre estimate in hardware)
+    uint8_t edge = rbdimmer_zc_get_edge_by_pin(zc_pin);
+    mcpwm_gpio_sync_src_config_t sync_config = {
+        .group_id = group,
+        .gpio_num = zc_pin,
+        .flags.active_neg = (edge == RBDIMMER_EDGE_FALLING),
+    };
+    if ((err = mcpwm_new_gpio_sync_src(&sync_config, &out->sync)) != ESP_OK) return err;
+
+    // The sync source re-configures the ZC pin as a plain input, which drops
+    // the edge interrupt installed by rbdimmer_register_zero_cross().  The
+    // software ZC path (frequency measurement, other channels) needs it back.
+    rbdimmer_zc_restore_intr(zc_pin);
+
+    mcpwm_timer_sync_phase_config_t phase_config = {
+        .sync_src    = out->sync,
+        .count_value = 0,
+        .direction   = MCPWM_TIMER_DIRECTION_UP,
+    };
+    if ((err = mcpwm_timer_set_phase_on_sync(out->timer, &phase_config)) != ESP_OK) return err;
+
+    mcpwm_operator_config_t oper_config = {
+        .group_id = group,
+    };
+    if ((err = mcpwm_new_operator(&oper_config, &out->oper)) != ESP_OK) return err;
+    if ((err = mcpwm_operator_connect_timer(out->oper, out->timer)) != ESP_OK) return err;
+
+    // Latch new compare values on the ZC sync: a delay change never splits
+    // a half-cycle into two different firing angles.
+    mcpwm_comparator_config_t cmp_config = {
+        .flags.update_cmp_on_sync = true,
+    };
+    if ((err = mcpwm_new_comparator(out->oper, &cmp_config, &out->cmp_fire)) != ESP_OK) return err;
+    if ((err = mcpwm_new_comparator(out->oper, &cmp_config, &out->cmp_release)) != ESP_OK) return err;
+
+    mcpwm_generator_config_t gen_config = {
+        .gen_gpio_num = gate_pin,
+    };
+    if ((err = mcpwm_new_generator(out->oper, &gen_config, &out->gen)) != ESP_OK) return err;
+
+    // Gate stays LOW until rbdimmer_mcpwm_apply() releases the force
+    mcpwm_generator_set_force_level(out->gen, 0, true);
+
+    if ((err = mcpwm_generator_set_action_on_compare_event(out->gen,
+            MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP,
+                                           out->cmp_fire, MCPWM_GEN_ACTION_HIGH))) != ESP_OK) return err;
+    if ((err = mcpwm_generator_set_action_on_compare_event(out->gen,
+            MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP,
+                                           out->cmp_release, MCPWM_GEN_ACTION_LOW))) != ESP_OK) return err;
+    if ((err = mcpwm_generator_set_action_on_timer_event(out->gen,
+            MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP,
+                                         MCPWM_TIMER_EVENT_FULL, MCPWM_GEN_ACTION_LOW))) != ESP_OK) return err;
+
+    if ((err = mcpwm_timer_enable(out->timer)) != ESP_OK) return err;
+    out->enabled = true;
+    return mcpwm_timer_start_stop(out->timer, MCPWM_TIMER_START_NO_STOP);
+}
+
+// ---------------------------------------------------------------------------
+// Public (internal) API
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_mcpwm_create(rbdimmer_channel_t* channel, uint8_t zc_pin) {
+#if RBDIMMER_STATIC_ALLOC
+    struct rbdimmer_mcpwm_out_s* out = &out_pool[channel->slot];
+    memset(out, 0, sizeof(*out));
+#else
+    struct rbdimmer_mcpwm_out_s* out =
+        (struct rbdimmer_mcpwm_out_s*)calloc(1, sizeof(*out));
+    if (out == NULL) {
+        return RBDIMMER_ERR_NO_MEMORY;
+    }
+#endif
+
+    // First group with a free timer / operator / sync source wins
+    for (int group = 0; group < SOC_MCPWM_GROUPS; group++) {
+        if (mcpwm_out_build(out, group, channel->gpio_pin, zc_pin) == ESP_OK) {
+            channel->mcpwm = out;
+            ESP_LOGI(TAG, "MCPWM output on pin %d (group %d, sync GPIO %d)",
+                     channel->gpio_pin, group, zc_pin);
+            return RBDIMMER_OK;
+        }
+        mcpwm_out_release(out);
+    }
+
+#if !RBDIMMER_STATIC_ALLOC
+    free(out);
+#endif
+    ESP_LOGE(TAG, "No free MCPWM resources for pin %d", channel->gpio_pin);
+    return RBDIMMER_ERR_TIMER_FAILED;
+}
+
+void rbdimmer_mcpwm_apply(rbdimmer_channel_t* channel) {
+    struct rbdimmer_mcpwm_out_s* out = channel->mcpwm;
+    if (out == NULL) {
+        return;
+    }
+    uint32_t delay = channel->current_delay;
+    if (!channel->is_active || delay == 0) {
+        mcpwm_generator_set_force_level(out->gen, 0, true);
+        return;
+    }
+    uint32_t fire    = delay;
+    uint32_t release = delay + channel->pulse_us;
+    if (channel->hold_us > release) {
+        release = channel->hold_us;       // RBDIMMER_GATE_HOLD
+    }
+    if (channel->mode == RBDIMMER_MODE_TRAILING) {
+        fire    = 1;                      // first tick after the sync
+        release = delay;                  // cut-off
+    }
+    mcpwm_comparator_set_compare_value(out->cmp_fire, fire);
+    mcpwm_comparator_set_compare_value(out->cmp_release, release);
+    mcpwm_generator_set_force_level(out->gen, -1, true);
+}
+
+void rbdimmer_mcpwm_delete(rbdimmer_channel_t* channel) {
+    struct rbdimmer_mcpwm_out_s* out = channel->mcpwm;
+    if (out == NULL) {
+        return;
+    }
+    mcpwm_generator_set_force_level(out->gen, 0, true);
+    mcpwm_out_release(out);
+#if !RBDIMMER_STATIC_ALLOC
+    free(out);
+#endif
+    channel->mcpwm = NULL;
+
+    // Route the pin back to the GPIO output register, driven LOW
+    gpio_config_t io_conf = {
+        .pin_bit_mask   = (1ULL << channel->gpio_pin),
+        .mode           = GPIO_MODE_OUTPUT,
+        .pull_up_en     = GPIO_PULLUP_DISABLE,
+        .pull_down_en   = GPIO_PULLDOWN_DISABLE,
+        .intr_type      = GPIO_INTR_DISABLE
+    };
+    gpio_set_level((gpio_num_t)channel->gpio_pin, 0);
+    gpio_config(&io_conf);
+}
+
+#else /* !RBDIMMER_HAL_HAS_MCPWM */
+
+rbdimmer_err_t rbdimmer_mcpwm_create(rbdimmer_channel_t* channel, uint8_t zc_pin) {
+    (void)channel;
+    (void)zc_pin;
+    return RBDIMMER_ERR_INVALID_ARG;
+}
+
+void rbdimmer_mcpwm_apply(rbdimmer_channel_t* channel) {
+    (void)channel;
+}
+
+void rbdimmer_mcpwm_delete(rbdimmer_channel_t* channel) {
+    (void)channel;
+}
+
+#endif /* RBDIMMER_HAL_HAS_MCPWM */
@@ -0,0 +1,59 @@
+/**
+ * @file rbdimmer_mcpwm.h
+ * @brief MCPWM gate-pulse output backend (RBDIMMER_OUTPUT_MCPWM)
+ * @internal
+ *
+ * One MCPWM timer per channel is hardware-synchronised to the zero-cross GPIO
+ * of the channel's phase.  Two comparators set the gate HIGH at current_delay
+ * and LOW at current_delay + pulse_us (or at hold_us) — no ISR, no
+ * esp_timer and no CPU instruction per pulse, so firing is unaffected by
+ * Wi-Fi or flash-cache stalls.  The task context only rewrites the compare
+ * values when the delay changes; they are latched on the next sync edge.
+ *
+ * All functions return RBDIMMER_ERR_INVALID_ARG / do nothing unless
+ * RBDIMMER_HAL_HAS_MCPWM is 1.
+ */
+
+#ifndef RBDIMMER_MCPWM_H
+#define RBDIMMER_MCPWM_H
+
+#include "rbdimmerESP32.h"    // rbdimmer_err_t
+#include "rbdimmer_types.h"   // rbdimmer_channel_t (full struct)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocate and start the MCPWM resources of @p channel.
+ *
+ * Uses channel->gpio_pin as generator output and @p zc_pin as sync input.
+ * The gate starts forced LOW; call rbdimmer_mcpwm_apply() to release it.
+ * On success channel->mcpwm is set.
+ *
+ * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG (no MCPWM on this chip),
+ *         RBDIMMER_ERR_NO_MEMORY or RBDIMMER_ERR_TIMER_FAILED (no free
+ *         MCPWM timer/operator/sync source in any group)
+ */
+rbdimmer_err_t rbdimmer_mcpwm_create(rbdimmer_channel_t* channel, uint8_t zc_pin);
+
+/**
+ * @brief Push current_delay / is_active of @p channel to the peripheral.
+ *
+ * Inactive channels and delay 0 (OFF) force the gate LOW; otherwise the
+ * comparators are updated and take effect at the next zero-crossing.
+ * Task context; caller holds manager_mutex.
+ */
+void rbdimmer_mcpwm_apply(rbdimmer_channel_t* channel);
+
+/**
+ * @brief Stop and free the MCPWM resources; the pin is returned to a plain
+ *        GPIO output driven LOW.  Clears channel->mcpwm.
+ */
+void rbdimmer_mcpwm_delete(rbdimmer_channel_t* channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_MCPWM_H */
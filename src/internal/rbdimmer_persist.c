@@ -0,0 +1,421 @@
+/**
+ * @file rbdimmer_persist.c
+ * @brief Fast-boot store of calibration and channel state in NVS
+ * @internal
+ *
+ * Implements rbdimmer_persist_flush() (public API, declared in
+ * rbdimmerESP32.h).
+ *
+ * Why: without it every boot spends 50 half-cycles (~0.5 s) acquiring the
+ * mains frequency while channels fire against the 10000 µs default, and
+ * lights come back at whatever level the application passes to
+ * rbdimmer_create_channel().  With the stored half-cycle the first valid
+ * zero-cross already fires at the right angle.
+ *
+ * One blob ("state" in namespace "rbdimmer") holds a record per phase
+ * (tracked half-cycle, detector offsets) and per gate pin (phase, curve,
+ * Q16 level).  Records of phases and pins that are not set up are carried
+ * over, so a channel created late, or not at all this boot, keeps its
+ * state.  A blob of another layout (version, RBDIMMER_MAX_* sizes) is
+ * ignored.
+ *
+ * Flash wear: a worker task samples the state every
+ * RBDIMMER_PERSIST_INTERVAL_MS and writes only a snapshot that differs from
+ * the stored one and equals the previous sample — i.e. one that has been
+ * stable for an interval.  The half-cycle is rewritten only when it moved
+ * more than RBDIMMER_PERSIST_DEADBAND_US, so tracker noise never reaches
+ * the flash.  A phase whose stored period is still being verified keeps its
+ * record.
+ *
+ * Why a task, not an esp_timer callback: a write is a flash program and
+ * maybe a page erase, many ms.  Without ESP_TIMER_ISR dispatch (Arduino)
+ * the gate, watchdog, half-wave and rescale timers all run on the one
+ * esp_timer task, and every firing behind a write would come late.  The
+ * worker runs at PERSIST_TASK_PRIO, below everything that times a gate.
+ *
+ * Locking: nvs_mutex → manager_mutex → persist_mutex.  nvs_mutex serialises
+ * the worker and rbdimmer_persist_flush() for a whole write; the channels
+ * are sampled (manager_mutex) and merged (persist_mutex) briefly, and NVS
+ * is written with only nvs_mutex held, so channel and phase setup never
+ * waits for the flash.  Channel creation takes persist_mutex under
+ * manager_mutex, in the same order.
+ *
+ * RBDIMMER_STATIC_ALLOC: the worker runs on a static stack and TCB and
+ * parks between rbdimmer_deinit() and the next rbdimmer_init() instead of
+ * exiting, as the fade engine does.
+ */
+
+#include "rbdimmer_persist.h"
+
+#if RBDIMMER_PERSIST
+
+#include "rbdimmer_channel.h"
+#include "rbdimmer_zerocross.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#define TAG "RBDIMMER"
+
+// Sampling period of the worker task; a change is written once it has
+// been stable for one period.
+#ifdef CONFIG_RBDIMMER_PERSIST_INTERVAL_MS
+#  define PERSIST_INTERVAL_MS  CONFIG_RBDIMMER_PERSIST_INTERVAL_MS
+#else
+#  define PERSIST_INTERVAL_MS  5000
+#endif
+
+// Half-cycle change (µs) worth a rewrite of the phase record.
+#ifdef CONFIG_RBDIMMER_PERSIST_DEADBAND_US
+#  define PERSIST_DEADBAND_US  CONFIG_RBDIMMER_PERSIST_DEADBAND_US
+#else
+#  define PERSIST_DEADBAND_US  10
+#endif
+
+// Worker task: below the fade engine, above idle.  The stack covers the
+// NVS write path plus one blob.
+#define PERSIST_TASK_PRIO        1
+#define PERSIST_TASK_STACK_SIZE  3072
+
+#define PERSIST_NAMESPACE  "rbdimmer"
+#define PERSIST_KEY        "state"
+#define PERSIST_VERSION    1
+#define PERSIST_NO_GPIO    0xFF
+
+typedef struct {
+    uint32_t period_q8;            // tracked half-cycle [µs << 8], 0 = none
+    int16_t  offset_us[2];         // detector offsets per polarity
+} persist_phase_t;
+
+typedef struct {
+    uint8_t  gpio;                 // gate pin, PERSIST_NO_GPIO = free record
+    uint8_t  phase;
+    uint8_t  curve;                // rbdimmer_curve_t
+    uint8_t  reserved;
+    uint16_t level_q16;
+} persist_channel_t;
+
+typedef struct {
+    uint8_t version;
+    uint8_t max_phases;
+    uint8_t max_channels;
+    uint8_t reserved;
+    persist_phase_t   phases[RBDIMMER_MAX_PHASES];
+    persist_channel_t channels[RBDIMMER_MAX_CHANNELS];
+} persist_blob_t;
+
+// stored: what NVS holds (seeds phases and channels).  sampled: the last
+// worker sample, a write candidate once the next one matches it.
+static persist_blob_t stored;
+static persist_blob_t sampled;
+
+static nvs_handle_t nvs         = 0;
+static bool         nvs_open_ok = false;    // under nvs_mutex
+
+static StaticSemaphore_t persist_mutex_buf; // stored, sampled
+static SemaphoreHandle_t persist_mutex = NULL;
+static StaticSemaphore_t nvs_mutex_buf;     // nvs, nvs_open_ok, one write at a time
+static SemaphoreHandle_t nvs_mutex = NULL;
+
+static TaskHandle_t  persist_task = NULL;
+static volatile bool persist_run  = false;  // sample every interval, else park / exit
+
+#if RBDIMMER_STATIC_ALLOC
+static StaticTask_t persist_task_tcb;
+static StackType_t  persist_task_stack[PERSIST_TASK_STACK_SIZE];  // IDF: depth in bytes
+#endif
+
+// ---------------------------------------------------------------------------
+// Snapshot
+// ---------------------------------------------------------------------------
+
+static void blob_clear(persist_blob_t* blob) {
+    memset(blob, 0, sizeof(*blob));
+    blob->version      = PERSIST_VERSION;
+    blob->max_phases   = RBDIMMER_MAX_PHASES;
+    blob->max_channels = RBDIMMER_MAX_CHANNELS;
+    for (int i = 0; i < RBDIMMER_MAX_CHANNELS; i++) {
+        blob->channels[i].gpio = PERSIST_NO_GPIO;
+    }
+}
+
+typedef struct {
+    persist_channel_t live[RBDIMMER_MAX_CHANNELS];
+    uint8_t count;
+} live_channels_t;
+
+static void collect_channel(void* ctx, uint8_t gpio, uint8_t phase,
+                            rbdimmer_curve_t curve, uint16_t level_q16) {
+    live_channels_t* lc = (live_channels_t*)ctx;
+    if (lc->count < RBDIMMER_MAX_CHANNELS) {
+        lc->live[lc->count++] = (persist_channel_t){
+            .gpio = gpio, .phase = phase, .curve = (uint8_t)curve, .level_q16 = level_q16,
+        };
+    }
+}
+
+// Live state merged over @p base.  Caller holds persist_mutex; @p lc was
+// collected before it was taken.
+static void snapshot(persist_blob_t* out, const persist_blob_t* base,
+                     const live_channels_t* lc) {
+    *out = *base;
+
+    for (uint8_t p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(p);
+        if (zc == NULL || !zc->frequency_measured || zc->seeded) {
+            continue;                  // nothing (new) to store yet
+        }
+        persist_phase_t* rec = &out->phases[p];
+        uint32_t half     = (zc->period_q8 + 128) >> 8;
+        uint32_t previous = (rec->period_q8 + 128) >> 8;
+        if (rec->period_q8 == 0 || half > previous + PERSIST_DEADBAND_US ||
+            half + PERSIST_DEADBAND_US < previous) {
+            rec->period_q8 = zc->period_q8;
+        }
+        rec->offset_us[0] = zc->offset_us[0];
+        rec->offset_us[1] = zc->offset_us[1];
+    }
+
+    // Live channels take their pin's record, else a free one, else one of
+    // a pin without a channel this boot.
+    bool live_rec[RBDIMMER_MAX_CHANNELS] = { false };
+    for (uint8_t i = 0; i < lc->count; i++) {
+        int slot = -1;
+        for (int r = 0; r < RBDIMMER_MAX_CHANNELS && slot < 0; r++) {
+            if (out->channels[r].gpio == lc->live[i].gpio) {
+                slot = r;
+            }
+        }
+        for (int r = 0; r < RBDIMMER_MAX_CHANNELS && slot < 0; r++) {
+            if (out->channels[r].gpio == PERSIST_NO_GPIO) {
+                slot = r;
+            }
+        }
+        for (int r = 0; r < RBDIMMER_MAX_CHANNELS && slot < 0; r++) {
+            if (!live_rec[r]) {
+                slot = r;
+            }
+        }
+        if (slot >= 0) {
+            out->channels[slot] = lc->live[i];
+            live_rec[slot] = true;
+        }
+    }
+}
+
+// Sample the live state and write it if it differs from the stored one.
+// @p settled (worker): only a sample equal to the previous one, i.e. stable
+// for an interval; else at once (rbdimmer_persist_flush()).  Task context.
+static rbdimmer_err_t persist_write(bool settled) {
+    if (nvs_mutex == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(nvs_mutex, portMAX_DELAY);
+    if (!nvs_open_ok) {
+        xSemaphoreGive(nvs_mutex);
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    live_channels_t lc = { .count = 0 };
+    rbdimmer_channel_for_each_state(collect_channel, &lc);
+
+    persist_blob_t now;
+    xSemaphoreTake(persist_mutex, portMAX_DELAY);
+    snapshot(&now, &stored, &lc);
+    bool write = memcmp(&now, &stored, sizeof(now)) != 0 &&
+                 (!settled || memcmp(&now, &sampled, sizeof(now)) == 0);
+    sampled = now;
+    xSemaphoreGive(persist_mutex);
+
+    rbdimmer_err_t result = RBDIMMER_OK;
+    if (write) {
+        esp_err_t err = nvs_set_blob(nvs, PERSIST_KEY, &now, sizeof(now));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        if (err == ESP_OK) {
+            xSemaphoreTake(persist_mutex, portMAX_DELAY);
+            stored = now;
+            xSemaphoreGive(persist_mutex);
+        } else {
+            ESP_LOGW(TAG, "NVS write failed: 0x%x", (unsigned)err);
+            result = RBDIMMER_ERR_NO_MEMORY;
+        }
+    }
+    xSemaphoreGive(nvs_mutex);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// FreeRTOS task
+// ---------------------------------------------------------------------------
+
+// Sample every interval while persist_run.  A notification cuts the wait
+// short (rbdimmer_persist_deinit()).
+static void persist_task_fn(void* arg) {
+    (void)arg;
+#if RBDIMMER_STATIC_ALLOC
+    for (;;) {
+        while (!persist_run) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // parked until rbdimmer_init()
+        }
+#endif
+        while (persist_run) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PERSIST_INTERVAL_MS));
+            if (persist_run) {
+                persist_write(true);
+            }
+        }
+#if RBDIMMER_STATIC_ALLOC
+    }
+#else
+    persist_task = NULL;
+    vTaskDelete(NULL);
+#endif
+}
+
+static bool persist_task_start(void) {
+    persist_run = true;
+#if RBDIMMER_STATIC_ALLOC
+    if (persist_task != NULL) {
+        xTaskNotifyGive(persist_task);                 // unpark
+        return true;
+    }
+    persist_task = xTaskCreateStaticPinnedToCore(
+        persist_task_fn, "dimmer_persist", PERSIST_TASK_STACK_SIZE, NULL,
+        PERSIST_TASK_PRIO, persist_task_stack, &persist_task_tcb, tskNO_AFFINITY);
+#else
+    if (persist_task != NULL) {
+        return true;                                   // still running
+    }
+    if (xTaskCreatePinnedToCore(persist_task_fn, "dimmer_persist", PERSIST_TASK_STACK_SIZE,
+                                NULL, PERSIST_TASK_PRIO, &persist_task,
+                                tskNO_AFFINITY) != pdPASS) {
+        persist_task = NULL;
+    }
+#endif
+    if (persist_task == NULL) {
+        persist_run = false;
+    }
+    return persist_task != NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Internal API
+// ---------------------------------------------------------------------------
+
+void rbdimmer_persist_init(void) {
+    if (persist_mutex == NULL) {
+        persist_mutex = xSemaphoreCreateMutexStatic(&persist_mutex_buf);
+    }
+    if (nvs_mutex == NULL) {
+        nvs_mutex = xSemaphoreCreateMutexStatic(&nvs_mutex_buf);
+    }
+    blob_clear(&stored);
+
+    esp_err_t err = nvs_open(PERSIST_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "NVS not available (0x%x), state is not persisted", (unsigned)err);
+        return;
+    }
+    xSemaphoreTake(nvs_mutex, portMAX_DELAY);
+    nvs_open_ok = true;
+    xSemaphoreGive(nvs_mutex);
+
+    persist_blob_t blob;
+    size_t size = sizeof(blob);
+    err = nvs_get_blob(nvs, PERSIST_KEY, &blob, &size);
+    if (err == ESP_OK && size == sizeof(blob) && blob.version == PERSIST_VERSION &&
+        blob.max_phases == RBDIMMER_MAX_PHASES && blob.max_channels == RBDIMMER_MAX_CHANNELS) {
+        stored = blob;
+        ESP_LOGI(TAG, "Restored calibration and channel state from NVS");
+    } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Stored state unusable (0x%x), starting fresh", (unsigned)err);
+    }
+    sampled = stored;
+
+    if (!persist_task_start()) {
+        ESP_LOGW(TAG, "No persist task: state is written by rbdimmer_persist_flush() only");
+    }
+}
+
+void rbdimmer_persist_deinit(void) {
+    if (persist_task != NULL) {
+        persist_run = false;
+        xTaskNotifyGive(persist_task);
+#if !RBDIMMER_STATIC_ALLOC
+        // The task exits after a write in progress
+        for (int i = 0; i < 50 && persist_task != NULL; i++) {
+            vTaskDelay(pdMS_TO_TICKS(10) + 1);
+        }
+#endif
+    }
+    if (nvs_mutex == NULL) {
+        return;
+    }
+    rbdimmer_persist_flush();           // waits for a write of the worker
+    xSemaphoreTake(nvs_mutex, portMAX_DELAY);
+    if (nvs_open_ok) {
+        nvs_close(nvs);
+        nvs_open_ok = false;
+    }
+    xSemaphoreGive(nvs_mutex);
+}
+
+bool rbdimmer_persist_phase(uint8_t phase, uint32_t* period_q8, int16_t* offset_us) {
+    if (phase >= RBDIMMER_MAX_PHASES || period_q8 == NULL || persist_mutex == NULL) {
+        return false;
+    }
+    xSemaphoreTake(persist_mutex, portMAX_DELAY);
+    const persist_phase_t* rec = &stored.phases[phase];
+    bool found = rec->period_q8 != 0;
+    if (found) {
+        *period_q8 = rec->period_q8;
+        if (offset_us != NULL) {
+            offset_us[0] = rec->offset_us[0];
+            offset_us[1] = rec->offset_us[1];
+        }
+    }
+    xSemaphoreGive(persist_mutex);
+    return found;
+}
+
+bool rbdimmer_persist_channel(uint8_t gpio, uint8_t phase, uint16_t* level_q16,
+                              rbdimmer_curve_t* curve) {
+    if (level_q16 == NULL || curve == NULL || persist_mutex == NULL) {
+        return false;
+    }
+    bool found = false;
+    xSemaphoreTake(persist_mutex, portMAX_DELAY);
+    for (int r = 0; r < RBDIMMER_MAX_CHANNELS; r++) {
+        const persist_channel_t* rec = &stored.channels[r];
+        if (rec->gpio == gpio && rec->phase == phase) {
+            *level_q16 = rec->level_q16;
+            if (rec->curve != RBDIMMER_CURVE_CUSTOM) {
+                *curve = (rbdimmer_curve_t)rec->curve;
+            }
+            found = true;
+            break;
+        }
+    }
+    xSemaphoreGive(persist_mutex);
+    return found;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_persist_flush(void) {
+    return persist_write(false);
+}
+
+#else /* !RBDIMMER_PERSIST */
+
+rbdimmer_err_t rbdimmer_persist_flush(void) {
+    return RBDIMMER_ERR_INVALID_ARG;
+}
+
+#endif /* RBDIMMER_PERSIST */
@@ -0,0 +1,86 @@
+/**
+ * @file rbdimmer_persist.h
+ * @brief Fast-boot store of calibration and channel state in NVS
+ * @internal
+ *
+ * Enabled with CONFIG_RBDIMMER_PERSIST (RBDIMMER_PERSIST == 1).  Keeps the
+ * tracked half-cycle and detector offsets of every phase and the level and
+ * curve of every gate pin in one NVS blob.  rbdimmer_zerocross.c seeds a
+ * registered phase from it, rbdimmer_channel.c a created channel; the
+ * tracker then verifies the stored period in the background.
+ *
+ * Writes are coalesced: a low-priority worker task samples the live state
+ * every RBDIMMER_PERSIST_INTERVAL_MS and commits it only once it has been
+ * unchanged for a whole interval, so fades and slider drags cost one write.
+ * Nothing of it runs on the esp_timer task that may dispatch gate timers.
+ * rbdimmer_persist_flush() (public API, declared in rbdimmerESP32.h) writes
+ * at once.
+ *
+ * Disabled builds get empty inline stubs — call sites need no #if.
+ */
+
+#ifndef RBDIMMER_PERSIST_H
+#define RBDIMMER_PERSIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rbdimmerESP32.h"    // RBDIMMER_PERSIST, rbdimmer_curve_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if RBDIMMER_PERSIST
+
+/**
+ * @brief Open the NVS namespace, load the stored state and start the
+ *        worker task.  Called from rbdimmer_init(); persistence stays off
+ *        (with a warning) when NVS is not initialised.
+ */
+void rbdimmer_persist_init(void);
+
+/** @brief Stop the worker, write pending changes and close NVS.  Called from rbdimmer_deinit(). */
+void rbdimmer_persist_deinit(void);
+
+/**
+ * @brief Stored calibration of @p phase.
+ *
+ * @param period_q8  Receives the half-cycle [µs << 8]
+ * @param offset_us  Receives the positive / negative detector offsets, or
+ *                   NULL to leave the offsets alone
+ * @return true if the phase has a stored period
+ */
+bool rbdimmer_persist_phase(uint8_t phase, uint32_t* period_q8, int16_t* offset_us);
+
+/**
+ * @brief Stored state of the gate on @p gpio, if it was on @p phase.
+ *
+ * Overwrites @p level_q16 and, unless the stored curve is
+ * RBDIMMER_CURVE_CUSTOM (slot ids are not stable across boots), @p curve.
+ * @return true if a record was applied
+ */
+bool rbdimmer_persist_channel(uint8_t gpio, uint8_t phase, uint16_t* level_q16,
+                              rbdimmer_curve_t* curve);
+
+#else
+
+static inline void rbdimmer_persist_init(void) {}
+static inline void rbdimmer_persist_deinit(void) {}
+static inline bool rbdimmer_persist_phase(uint8_t phase, uint32_t* period_q8,
+                                          int16_t* offset_us) {
+    (void)phase; (void)period_q8; (void)offset_us;
+    return false;
+}
+static inline bool rbdimmer_persist_channel(uint8_t gpio, uint8_t phase, uint16_t* level_q16,
+                                            rbdimmer_curve_t* curve) {
+    (void)gpio; (void)phase; (void)level_q16; (void)curve;
+    return false;
+}
+
+#endif /* RBDIMMER_PERSIST */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_PERSIST_H */
@@ -0,0 +1,364 @@
+/**
+ * @file rbdimmer_scheduler.c
+ * @brief Single-GPTimer firing scheduler (one hardware timer per phase)
+ * @internal
+ *
+ * One free-running 1 MHz GPTimer per phase replaces the two esp_timer
+ * one-shots per channel.  The channel layer hands over the delay-sorted
+ * phase schedule (built in task context) at every zero-crossing.  Fires
+ * come in entry order; releases follow the schedule's release_order, since
+ * pulse widths and gate holds differ per channel.  A merge of the two
+ * cursors (next_fire / next_release) walks every event of the half-cycle in
+ * time order — O(channels) per half-cycle, one alarm ISR per firing group,
+ * no esp_timer list locking.  Gates of a group switch with one
+ * GPIO_OUT_W1TS/W1TC store (rbdimmer_hal_gate_*_mask).
+ *
+ * RBDIMMER_GATE_TRAIN entries add a cursor each: between fire and release
+ * the gate toggles after the pulse width and the rest of
+ * RBDIMMER_GATE_TRAIN_PERIOD_US on the same alarm, no extra timer.
+ *
+ * Trailing-edge entries are raised by the zero-cross ISR itself and sit
+ * before fire_start, so they only add a release event (their cutoff).
+ *
+ * Requires CONFIG_GPTIMER_CTRL_FUNC_IN_IRAM (gptimer_get_raw_count and
+ * gptimer_set_alarm_action are called from ISR) and CONFIG_GPTIMER_ISR_IRAM_SAFE;
+ * both are selected by the Kconfig backend choice.
+ *
+ * The alarm interrupt is allocated on the real-time core at its priority
+ * (rbdimmer_affinity.c).
+ */
+
+#include "rbdimmer_scheduler.h"
+#include "rbdimmer_hal.h"
+#include "rbdimmer_instrument.h"
+#include "rbdimmer_affinity.h"
+
+#if RBDIMMER_HAL_USE_GPTIMER
+
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+#define TAG "RBDIMMER"
+
+// 1 tick = 1 µs — delays from rbdimmer_curves are already in µs.
+#define SCHED_RESOLUTION_HZ  1000000
+
+// Events closer than this to "now" are executed in the current ISR instead of
+// arming a new alarm: the alarm ISR entry cost is larger than the wait.
+#define SCHED_LEAD_US        2
+
+// ---------------------------------------------------------------------------
+// Module-private state
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t  entry;                                      // Pulse-train entry
+    bool     high;                                       // Gate on at the moment
+    uint32_t next_us;                                    // Next toggle, UINT32_MAX = done
+} sched_train_t;
+
+typedef struct {
+    gptimer_handle_t timer;                              // NULL = phase unused
+    uint64_t zc_count;                                   // GPTimer count at the crossing
+    const rbdimmer_phase_schedule_t* sched;              // schedule of this half-cycle
+    uint8_t count;                                       // sched->count snapshot
+    uint8_t next_fire;                                   // first entry not yet fired
+    uint8_t group_count;                                 // sched->group_count snapshot
+    uint8_t next_release;                                // first release_order slot not yet released
+    uint8_t train_count;                                 // Pulse trains of this half-cycle
+    sched_train_t trains[RBDIMMER_MAX_CHANNELS];
+} sched_phase_t;
+
+// DRAM_ATTR: walked by the GPTimer alarm ISR and the GPIO ISR.
+static DRAM_ATTR sched_phase_t sched_phases[RBDIMMER_MAX_PHASES];
+
+// Serialises the alarm ISR and the zero-cross ISR when their interrupts
+// were allocated on different cores.  Held only for one event step.
+static DRAM_ATTR portMUX_TYPE sched_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// ---------------------------------------------------------------------------
+// ISR helpers
+// ---------------------------------------------------------------------------
+
+static IRAM_ATTR void sched_set_alarm(sched_phase_t* sp, uint32_t at_us) {
+    gptimer_alarm_config_t alarm = {
+        .alarm_count = sp->zc_count + at_us,
+        .reload_count = 0,
+        .flags.auto_reload_on_alarm = false,
+    };
+    gptimer_set_alarm_action(sp->timer, &alarm);
+}
+
+// Execute every event that is due and arm the alarm for the next one.
+// next_fire / release_order always point at group leaders; one event covers
+// the whole group (trains are never grouped).  On a tie a release goes
+// first, then a train step.  Caller holds sched_spinlock.
+static IRAM_ATTR void sched_run(sched_phase_t* sp) {
+    for (;;) {
+        const rbdimmer_phase_schedule_t* sched = sp->sched;
+        uint32_t fire_t = (sp->next_fire < sp->count)
+            ? sched->entries[sp->next_fire].delay_us : UINT32_MAX;
+        uint32_t release_t = (sp->next_release < sp->group_count)
+            ? sched->entries[sched->release_order[sp->next_release]].release_us
+            : UINT32_MAX;
+        sched_train_t* train = NULL;
+        uint32_t train_t = UINT32_MAX;
+        for (uint8_t k = 0; k < sp->train_count; k++) {
+            if (sp->trains[k].next_us < train_t) {
+                train_t = sp->trains[k].next_us;
+                train   = &sp->trains[k];
+            }
+        }
+        uint32_t next_t = release_t;
+        if (train_t < next_t) {
+            next_t = train_t;
+        }
+        if (fire_t < next_t) {
+            next_t = fire_t;
+        }
+        if (next_t == UINT32_MAX) {
+            return;  // half-cycle complete — alarm stays idle until next ZC
+        }
+
+        // Signed: a negative detector offset puts the crossing ahead of now
+        uint64_t now = 0;
+        gptimer_get_raw_count(sp->timer, &now);
+        int32_t elapsed = (int32_t)(now - sp->zc_count);
+
+        if ((int32_t)next_t > elapsed + SCHED_LEAD_US) {
+            sched_set_alarm(sp, next_t);
+            // Re-check: if a higher-priority ISR delayed us past the alarm
+            // time the hardware may never raise it — run the event here.
+            gptimer_get_raw_count(sp->timer, &now);
+            if ((int32_t)(now - sp->zc_count) < (int32_t)next_t) {
+                return;
+            }
+        }
+
+        // Lateness of this event against its slot (0 when run ahead by LEAD)
+        int32_t late = (int32_t)(now - sp->zc_count) - (int32_t)next_t;
+
+        if (next_t == release_t) {
+            // End TRIAC pulse / hold — every member of the group in one store
+            const rbdimmer_fire_entry_t* lead =
+                &sched->entries[sched->release_order[sp->next_release]];
+            sp->next_release++;
+            uint64_t mask = 0;
+            for (uint8_t i = 0; i < lead->group_len; i++) {
+                rbdimmer_channel_t* ch = lead[i].channel;
+                if (ch->timer_state == TIMER_STATE_PULSE_ON) {
+                    mask |= lead[i].gpio_mask;
+                    ch->timer_state = TIMER_STATE_IDLE;
+                }
+            }
+            rbdimmer_hal_gate_clear_mask(mask);
+            rbdimmer_instr_gate_release((uint8_t)(sp - sched_phases), late);
+        } else if (next_t == train_t) {
+            // Next edge of a pulse train; the release ends it
+            const rbdimmer_fire_entry_t* entry = &sched->entries[train->entry];
+            if (entry->channel->timer_state != TIMER_STATE_PULSE_ON) {
+                train->next_us = UINT32_MAX;        // cancelled by set_active(false)
+                continue;
+            }
+            if (train->high) {
+                rbdimmer_hal_gate_clear_mask(entry->gpio_mask);
+                train->next_us += RBDIMMER_GATE_TRAIN_PERIOD_US - entry->pulse_us;
+            } else {
+                rbdimmer_hal_gate_set_mask(entry->gpio_mask);
+                train->next_us += entry->pulse_us;
+            }
+            train->high = !train->high;
+            if (train->next_us >= entry->release_us) {
+                train->next_us = UINT32_MAX;
+            }
+        } else {
+            // Fire TRIAC — skip members cancelled by set_active(false)
+            const rbdimmer_fire_entry_t* lead = &sched->entries[sp->next_fire];
+            sp->next_fire += lead->group_len;
+            uint64_t mask = 0;
+            for (uint8_t i = 0; i < lead->group_len; i++) {
+                rbdimmer_channel_t* ch = lead[i].channel;
+                if (ch->timer_state == TIMER_STATE_DELAY) {
+                    mask |= lead[i].gpio_mask;
+                    ch->timer_state = TIMER_STATE_PULSE_ON;
+                }
+            }
+            rbdimmer_hal_gate_set_mask(mask);
+            rbdimmer_instr_gate_fire((uint8_t)(sp - sched_phases), late);
+        }
+    }
+}
+
+static IRAM_ATTR bool sched_alarm_cb(gptimer_handle_t timer,
+                                     const gptimer_alarm_event_data_t* edata,
+                                     void* user_ctx) {
+    (void)timer;
+    (void)edata;
+    sched_phase_t* sp = (sched_phase_t*)user_ctx;
+
+    portENTER_CRITICAL_ISR(&sched_spinlock);
+    sched_run(sp);
+    portEXIT_CRITICAL_ISR(&sched_spinlock);
+    return false;  // no task woken
+}
+
+// ---------------------------------------------------------------------------
+// ISR-context interface
+// ---------------------------------------------------------------------------
+
+void IRAM_ATTR rbdimmer_sched_halt_phase(uint8_t phase) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    sched_phase_t* sp = &sched_phases[phase];
+
+    // An alarm ISR running sched_run() holds the spinlock for its whole
+    // step, so once we own it nobody is inside the event list.
+    portENTER_CRITICAL_ISR(&sched_spinlock);
+    sp->count        = 0;
+    sp->next_fire    = 0;
+    sp->group_count  = 0;
+    sp->next_release = 0;
+    sp->train_count  = 0;
+    portEXIT_CRITICAL_ISR(&sched_spinlock);
+}
+
+void IRAM_ATTR rbdimmer_sched_arm_phase(uint8_t phase,
+                                        const rbdimmer_phase_schedule_t* sched,
+                                        uint32_t cross_time) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return;
+    }
+    sched_phase_t* sp = &sched_phases[phase];
+    if (sp->timer == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL_ISR(&sched_spinlock);
+
+    // Back-date the GPTimer reference to cross_time (esp_timer clock)
+    uint64_t count = 0;
+    gptimer_get_raw_count(sp->timer, &count);
+    int32_t elapsed = (int32_t)((uint32_t)esp_timer_get_time() - cross_time);
+    sp->zc_count = count - (uint64_t)(int64_t)elapsed;
+    sp->sched        = sched;
+    sp->count        = sched->count;
+    sp->next_fire    = sched->fire_start;
+    sp->group_count  = sched->group_count;
+    sp->next_release = 0;
+    sp->train_count  = 0;
+
+    for (int i = sched->fire_start; i < sched->count; i++) {
+        const rbdimmer_fire_entry_t* entry = &sched->entries[i];
+        entry->channel->timer_state = TIMER_STATE_DELAY;
+        if (entry->train) {
+            // First edge: the end of the pulse the fire event starts
+            sched_train_t* train = &sp->trains[sp->train_count++];
+            train->entry   = (uint8_t)i;
+            train->high    = true;
+            train->next_us = entry->delay_us + entry->pulse_us;
+            if (train->next_us >= entry->release_us) {
+                train->next_us = UINT32_MAX;
+            }
+        }
+    }
+
+    sched_run(sp);
+
+    portEXIT_CRITICAL_ISR(&sched_spinlock);
+}
+
+// ---------------------------------------------------------------------------
+// Task-context lifecycle
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    gptimer_handle_t timer;
+    sched_phase_t*   sp;
+} sched_register_t;
+
+static esp_err_t sched_register(void* arg) {
+    sched_register_t* reg = (sched_register_t*)arg;
+    gptimer_event_callbacks_t cbs = {
+        .on_alarm = sched_alarm_cb,
+    };
+    return gptimer_register_event_callbacks(reg->timer, &cbs, reg->sp);
+}
+
+rbdimmer_err_t rbdimmer_sched_phase_init(uint8_t phase) {
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    sched_phase_t* sp = &sched_phases[phase];
+    if (sp->timer != NULL) {
+        return RBDIMMER_OK;
+    }
+
+    gptimer_config_t timer_config = {
+        .clk_src       = GPTIMER_CLK_SRC_DEFAULT,
+        .direction     = GPTIMER_COUNT_UP,
+        .resolution_hz = SCHED_RESOLUTION_HZ,
+#if RBDIMMER_HAL_HAS_INTR_PRIORITY
+        .intr_priority = rbdimmer_affinity_intr_priority(),
+#endif
+    };
+    gptimer_handle_t timer = NULL;
+    if (gptimer_new_timer(&timer_config, &timer) != ESP_OK) {
+        ESP_LOGE(TAG, "No free GPTimer for phase %d", phase);
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+
+    // The interrupt is allocated here: register on the real-time core
+    sched_register_t reg = { timer, sp };
+    if (rbdimmer_affinity_call(sched_register, &reg) != ESP_OK ||
+        gptimer_enable(timer) != ESP_OK) {
+        gptimer_del_timer(timer);
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+    if (gptimer_start(timer) != ESP_OK) {
+        gptimer_disable(timer);
+        gptimer_del_timer(timer);
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+
+    portENTER_CRITICAL(&sched_spinlock);
+    sp->sched        = NULL;
+    sp->count        = 0;
+    sp->next_fire    = 0;
+    sp->group_count  = 0;
+    sp->next_release = 0;
+    sp->train_count  = 0;
+    sp->timer        = timer;
+    portEXIT_CRITICAL(&sched_spinlock);
+
+    ESP_LOGI(TAG, "GPTimer scheduler started for phase %d", phase);
+    return RBDIMMER_OK;
+}
+
+void rbdimmer_sched_deinit(void) {
+    for (int p = 0; p < RBDIMMER_MAX_PHASES; p++) {
+        sched_phase_t* sp = &sched_phases[p];
+        if (sp->timer == NULL) {
+            continue;
+        }
+        gptimer_handle_t timer = sp->timer;
+
+        portENTER_CRITICAL(&sched_spinlock);
+        sp->timer = NULL;
+        sp->count = 0;
+        sp->group_count = 0;
+        sp->train_count = 0;
+        portEXIT_CRITICAL(&sched_spinlock);
+
+        gptimer_stop(timer);
+        gptimer_disable(timer);
+        gptimer_del_timer(timer);
+    }
+    memset(sched_phases, 0, sizeof(sched_phases));
+}
+
+#endif /* RBDIMMER_HAL_USE_GPTIMER */
@@ -0,0 +1,73 @@
+/**
+ * @file rbdimmer_scheduler.h
+ * @brief Single-GPTimer firing scheduler (one hardware timer per phase)
+ * @internal
+ *
+ * Alternative to the per-channel esp_timer pair in rbdimmer_timer.c, selected
+ * with CONFIG_RBDIMMER_TIMER_BACKEND_GPTIMER.  Every zero-crossing the channel
+ * layer hands over the delay-sorted schedule of a phase as the event list; one
+ * free-running GPTimer then steps through the fire/release events with alarm
+ * reloads.  The channel timer_state_t FSM is driven exactly as in the
+ * esp_timer backend (IDLE → DELAY → PULSE_ON → IDLE).
+ *
+ * All functions compile to nothing useful unless RBDIMMER_HAL_USE_GPTIMER is 1.
+ */
+
+#ifndef RBDIMMER_SCHEDULER_H
+#define RBDIMMER_SCHEDULER_H
+
+#include "rbdimmerESP32.h"    // rbdimmer_err_t
+#include "rbdimmer_types.h"   // rbdimmer_channel_t (full struct)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ensure the GPTimer for @p phase exists and is running.
+ *
+ * Idempotent — the first call for a phase allocates, enables and starts a
+ * free-running 1 MHz up-counting GPTimer; later calls return immediately.
+ * Called from rbdimmer_create_channel() (task context).
+ *
+ * @return RBDIMMER_OK or RBDIMMER_ERR_TIMER_FAILED
+ */
+rbdimmer_err_t rbdimmer_sched_phase_init(uint8_t phase);
+
+/** @brief Stop and delete all phase timers. Called from rbdimmer_deinit(). */
+void rbdimmer_sched_deinit(void);
+
+// ---------------------------------------------------------------------------
+// ISR-context interface (called from on_zero_cross_phase, IRAM_ATTR)
+// ---------------------------------------------------------------------------
+
+/**
+ * @brief Stop walking the current schedule of @p phase.
+ *
+ * After return no alarm ISR references the schedule memory until the next
+ * rbdimmer_sched_arm_phase(), so the caller may reorder it.  Called by
+ * on_zero_cross_phase() before a ZC fade step re-sorts the entries.
+ */
+void rbdimmer_sched_halt_phase(uint8_t phase);
+
+/**
+ * @brief Start stepping the event list of one half-cycle (pass 2).
+ *
+ * Converts @p cross_time to a GPTimer count as the zero-cross reference,
+ * moves every firing channel of @p sched to TIMER_STATE_DELAY and arms the
+ * alarm for the first event.  @p sched must stay unmodified until the next zero-crossing — the
+ * double-buffered publish in rbdimmer_channel.c guarantees this.
+ *
+ * @param phase  Phase that just crossed zero
+ * @param sched  Delay-sorted schedule of that phase
+ * @param cross_time  Crossing the delays count from (esp_timer µs, low 32 bits)
+ */
+void rbdimmer_sched_arm_phase(uint8_t phase,
+                              const rbdimmer_phase_schedule_t* sched,
+                              uint32_t cross_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_SCHEDULER_H */
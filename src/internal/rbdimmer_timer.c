@@ -5,15 +5,35 @@
  *
  * Two one-shot timers per channel, both ESP_TIMER_ISR dispatched:
  *   delay_timer  — zero-cross → TRIAC gate HIGH
- *   pulse_timer  — TRIAC gate HIGH → LOW (fixed pulse width)
+ *   pulse_timer  — TRIAC gate HIGH → LOW (the leader's pulse width, or
+ *                  the rest of its gate hold — still one event)
  *
  * Sequential chain (Fix 1.2): pulse_timer is started from delay_timer
  * callback, never from the ISR, to guarantee constant pulse width.
  *
+ * Trailing-edge channels skip DELAY: the zero-cross ISR raises the gate,
+ * sets PULSE_ON and starts pulse_timer for the cut-off — one event per
+ * half-cycle.
+ *
  * Both callbacks are IRAM_ATTR (Fix 1.1 + Fix 1.5).
+ *
+ * Channels that fire together (same delay, or within
+ * CONFIG_RBDIMMER_GATE_BATCH_WINDOW_US) form a group: only the leader's
+ * timers are armed and each callback switches every gate of the group with a
+ * single GPIO_OUT_W1TS/W1TC register write.
+ *
+ * GPTimer backend (CONFIG_RBDIMMER_TIMER_BACKEND_GPTIMER): the lifecycle
+ * helpers delegate to rbdimmer_scheduler.c and no esp_timer is created.
+ *
+ * RBDIMMER_STATIC_ALLOC: both timers of every channel pool slot are created
+ * once at init (rbdimmer_timer_pool_init) with the slot as argument;
+ * create/delete only attach and detach them.
  */
 
 #include "rbdimmer_timer.h"
+#include "rbdimmer_hal.h"
+#include "rbdimmer_scheduler.h"
+#include "rbdimmer_instrument.h"
 #include "driver/gpio.h"
 #include "esp_timer.h"
 #include "esp_attr.h"
@@ -33,23 +53,88 @@
   #define RBDIMMER_TIMER_DISPATCH  ESP_TIMER_TASK
 #endif
 
+#if RBDIMMER_HAL_USE_GPTIMER
+
+// ---------------------------------------------------------------------------
+// Public API — GPTimer scheduler backend
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_timer_create(rbdimmer_channel_t* channel) {
+    channel->delay_timer = NULL;
+    channel->pulse_timer = NULL;
+    return rbdimmer_sched_phase_init(channel->phase);
+}
+
+// Events of the current half-cycle are skipped by the timer_state check
+// once the caller sets TIMER_STATE_IDLE; the channel drops out of the event
+// list with the next published schedule.
+void rbdimmer_timer_stop(rbdimmer_channel_t* channel) {
+    (void)channel;
+}
+
+void rbdimmer_timer_delete(rbdimmer_channel_t* channel) {
+    (void)channel;
+}
+
+rbdimmer_err_t rbdimmer_timer_pool_init(rbdimmer_channel_t* pool, uint8_t count) {
+    (void)pool;
+    (void)count;
+    return RBDIMMER_OK;
+}
+
+void rbdimmer_timer_pool_deinit(void) {
+}
+
+#else /* esp_timer backend */
+
+#if RBDIMMER_STATIC_ALLOC
+// Timers of each pool slot, [slot][0] = delay, [slot][1] = pulse
+static esp_timer_handle_t slot_timers[RBDIMMER_MAX_CHANNELS][2];
+#endif
+
 // ---------------------------------------------------------------------------
 // ISR-context callbacks
 // ---------------------------------------------------------------------------
 
+// Only group leaders have their timers armed; channel->armed_entry (set by
+// on_zero_cross_phase before esp_timer_start_once) points at the leader entry
+// of the adopted schedule, which stays valid until the next zero-crossing.
+// If the leader is deactivated mid-half-cycle its timers are stopped and the
+// rest of the group skips that one half-cycle.
+
 static void IRAM_ATTR delay_timer_callback(void* arg) {
     rbdimmer_channel_t* channel = (rbdimmer_channel_t*)arg;
 
     if (channel == NULL || channel->timer_state != TIMER_STATE_DELAY) {
         return;
     }
+    const rbdimmer_fire_entry_t* lead = channel->armed_entry;
+    if (lead == NULL) {
+        return;
+    }
 
-    // Fire TRIAC
-    gpio_set_level((gpio_num_t)channel->gpio_pin, 1);
-    channel->timer_state = TIMER_STATE_PULSE_ON;
+    // Fire TRIAC — one register store for the whole group
+    uint64_t mask = 0;
+    for (uint8_t i = 0; i < lead->group_len; i++) {
+        rbdimmer_channel_t* ch = lead[i].channel;
+        if (ch->timer_state == TIMER_STATE_DELAY) {
+            mask |= lead[i].gpio_mask;
+            ch->timer_state = TIMER_STATE_PULSE_ON;
+        }
+    }
+    rbdimmer_hal_gate_set_mask(mask);
+
+    // Pulse width, or the rest of the gate hold (RBDIMMER_GATE_HOLD)
+    uint32_t width = lead->release_us - lead->delay_us;
+
+#if RBDIMMER_INSTRUMENT
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    rbdimmer_instr_gate_fire(channel->phase, (int32_t)(now - channel->armed_due));
+    channel->armed_due = now + width;
+#endif
 
-    // Start pulse timer — guarantees fixed pulse width regardless of jitter
-    esp_timer_start_once(channel->pulse_timer, RBDIMMER_DEFAULT_PULSE_WIDTH_US);
+    // Start pulse timer — guarantees the gate width regardless of jitter
+    esp_timer_start_once(channel->pulse_timer, width);
 }
 
 static void IRAM_ATTR pulse_timer_callback(void* arg) {
@@ -58,17 +143,36 @@ static void IRAM_ATTR pulse_timer_callback(void* arg) {
     if (channel == NULL || channel->timer_state != TIMER_STATE_PULSE_ON) {
         return;
     }
+    const rbdimmer_fire_entry_t* lead = channel->armed_entry;
+    if (lead == NULL) {
+        return;
+    }
 
     // End TRIAC pulse
-    gpio_set_level((gpio_num_t)channel->gpio_pin, 0);
-    channel->timer_state = TIMER_STATE_IDLE;
+    uint64_t mask = 0;
+    for (uint8_t i = 0; i < lead->group_len; i++) {
+        rbdimmer_channel_t* ch = lead[i].channel;
+        if (ch->timer_state == TIMER_STATE_PULSE_ON) {
+            mask |= lead[i].gpio_mask;
+            ch->timer_state = TIMER_STATE_IDLE;
+        }
+    }
+    rbdimmer_hal_gate_clear_mask(mask);
+
+#if RBDIMMER_INSTRUMENT
+    rbdimmer_instr_gate_release(channel->phase,
+                                (int32_t)((uint32_t)esp_timer_get_time() - channel->armed_due));
+#endif
 }
 
 // ---------------------------------------------------------------------------
 // Public API
 // ---------------------------------------------------------------------------
 
-rbdimmer_err_t rbdimmer_timer_create(rbdimmer_channel_t* channel) {
+// Create the delay / pulse timer pair whose callbacks get @p channel.
+static rbdimmer_err_t timer_pair_create(rbdimmer_channel_t* channel,
+                                        esp_timer_handle_t* delay_timer,
+                                        esp_timer_handle_t* pulse_timer) {
     // delay timer: zero-cross offset → TRIAC gate HIGH
     esp_timer_create_args_t delay_args = {
         .callback = &delay_timer_callback,
@@ -77,7 +181,7 @@ rbdimmer_err_t rbdimmer_timer_create(rbdimmer_channel_t* channel) {
         .name = "dimmer_delay",
         .skip_unhandled_events = false
     };
-    if (esp_timer_create(&delay_args, &channel->delay_timer) != ESP_OK) {
+    if (esp_timer_create(&delay_args, delay_timer) != ESP_OK) {
         return RBDIMMER_ERR_TIMER_FAILED;
     }
 
@@ -89,24 +193,77 @@ rbdimmer_err_t rbdimmer_timer_create(rbdimmer_channel_t* channel) {
         .name = "dimmer_pulse",
         .skip_unhandled_events = false
     };
-    if (esp_timer_create(&pulse_args, &channel->pulse_timer) != ESP_OK) {
-        esp_timer_delete(channel->delay_timer);
-        channel->delay_timer = NULL;
+    if (esp_timer_create(&pulse_args, pulse_timer) != ESP_OK) {
+        esp_timer_delete(*delay_timer);
+        *delay_timer = NULL;
         return RBDIMMER_ERR_TIMER_FAILED;
     }
 
     return RBDIMMER_OK;
 }
 
+rbdimmer_err_t rbdimmer_timer_create(rbdimmer_channel_t* channel) {
+#if RBDIMMER_STATIC_ALLOC
+    if (slot_timers[channel->slot][0] == NULL) {
+        return RBDIMMER_ERR_TIMER_FAILED;   // rbdimmer_timer_pool_init() failed
+    }
+    channel->delay_timer = slot_timers[channel->slot][0];
+    channel->pulse_timer = slot_timers[channel->slot][1];
+    return RBDIMMER_OK;
+#else
+    return timer_pair_create(channel, &channel->delay_timer, &channel->pulse_timer);
+#endif
+}
+
+void rbdimmer_timer_stop(rbdimmer_channel_t* channel) {
+    esp_timer_stop(channel->delay_timer);
+    esp_timer_stop(channel->pulse_timer);
+}
+
 void rbdimmer_timer_delete(rbdimmer_channel_t* channel) {
     if (channel->delay_timer) {
         esp_timer_stop(channel->delay_timer);
+#if !RBDIMMER_STATIC_ALLOC
         esp_timer_delete(channel->delay_timer);
+#endif
         channel->delay_timer = NULL;
     }
     if (channel->pulse_timer) {
         esp_timer_stop(channel->pulse_timer);
+#if !RBDIMMER_STATIC_ALLOC
         esp_timer_delete(channel->pulse_timer);
+#endif
         channel->pulse_timer = NULL;
     }
 }
+
+rbdimmer_err_t rbdimmer_timer_pool_init(rbdimmer_channel_t* pool, uint8_t count) {
+#if RBDIMMER_STATIC_ALLOC
+    for (int i = 0; i < count; i++) {
+        if (slot_timers[i][0] == NULL &&
+            timer_pair_create(&pool[i], &slot_timers[i][0], &slot_timers[i][1]) != RBDIMMER_OK) {
+            return RBDIMMER_ERR_TIMER_FAILED;
+        }
+    }
+#else
+    (void)pool;
+    (void)count;
+#endif
+    return RBDIMMER_OK;
+}
+
+void rbdimmer_timer_pool_deinit(void) {
+#if RBDIMMER_STATIC_ALLOC
+    for (int i = 0; i < RBDIMMER_MAX_CHANNELS; i++) {
+        for (int t = 0; t < 2; t++) {
+            if (slot_timers[i][t] != NULL) {
+                esp_timer_stop(slot_timers[i][t]);
+                esp_timer_delete(slot_timers[i][t]);
+                slot_timers[i][t] = NULL;
+            }
+        }
+    }
+#endif
+}
+
+#endif /* RBDIMMER_HAL_USE_GPTIMER */
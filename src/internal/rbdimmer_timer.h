@@ -5,6 +5,11 @@
  *
  * Owns: delay_timer_callback, pulse_timer_callback (ISR-dispatched).
  * Provides lifecycle helpers: create and delete both timers for a channel.
+ *
+ * With CONFIG_RBDIMMER_TIMER_BACKEND_GPTIMER the per-channel esp_timers are
+ * not created; the same helpers attach the channel to the per-phase GPTimer
+ * scheduler (rbdimmer_scheduler.h) instead, so the channel layer stays
+ * backend-agnostic outside the ISR.
  */
 
 #ifndef RBDIMMER_TIMER_H
@@ -22,18 +27,44 @@ extern "C" {
  *
  * Both timers use ESP_TIMER_ISR dispatch to avoid FreeRTOS scheduler latency.
  * Stores timer handles in channel->delay_timer and channel->pulse_timer.
+ * GPTimer backend: starts the scheduler timer of channel->phase instead and
+ * leaves both handles NULL.
  *
- * @param channel  Fully initialised channel struct (gpio_pin must be set)
+ * @param channel  Fully initialised channel struct (gpio_pin and phase must be set)
  * @return RBDIMMER_OK or RBDIMMER_ERR_TIMER_FAILED
  */
 rbdimmer_err_t rbdimmer_timer_create(rbdimmer_channel_t* channel);
 
+/**
+ * @brief Stop any pending fire/release event of a channel (task context).
+ *
+ * After this returns no timer callback will touch the channel until the next
+ * zero-crossing re-arms it.  Caller sets timer_state and drives the gate LOW.
+ */
+void rbdimmer_timer_stop(rbdimmer_channel_t* channel);
+
 /**
  * @brief Stop and delete both timers for a channel.
  * Safe to call if timers were never started.
+ * RBDIMMER_STATIC_ALLOC: stops the timers and hands them back to the slot.
  */
 void rbdimmer_timer_delete(rbdimmer_channel_t* channel);
 
+/**
+ * @brief Pre-create the timers of every channel pool slot.
+ *
+ * RBDIMMER_STATIC_ALLOC with the esp_timer backend: creates both timers of
+ * each of the @p count slots in @p pool once, so rbdimmer_timer_create()
+ * never allocates.  Idempotent; no-op in every other configuration.
+ * Called from rbdimmer_channel_manager_init().
+ *
+ * @return RBDIMMER_OK or RBDIMMER_ERR_TIMER_FAILED
+ */
+rbdimmer_err_t rbdimmer_timer_pool_init(rbdimmer_channel_t* pool, uint8_t count);
+
+/** @brief Delete the timers created by rbdimmer_timer_pool_init(). */
+void rbdimmer_timer_pool_deinit(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,24 +1,51 @@
 /**
  * @file rbdimmer_transition.c
- * @brief Smooth brightness transition via FreeRTOS task
+ * @brief Smooth brightness transitions via a single fade engine task
  * @internal
  *
- * Implements rbdimmer_set_level_transition() (public API, declared in rbdimmerESP32.h).
+ * Implements rbdimmer_set_level_transition() and
+ * rbdimmer_set_level_transition_eased() (public API, declared in rbdimmerESP32.h).
  *
- * Fix 1.6: transition task pinned to CPU0 — same core as GPIO ISR and
+ * One engine task advances a fixed array of fade slots (indexed by the
+ * channel's pool slot) every FADE_INTERVAL_MS.  Starting, retargeting or cancelling a
+ * fade rewrites one slot — no allocation, no task creation per transition.
+ * The task is created on the first transition and blocks on a notification
+ * while no fade is running, so an idle library costs no wakeups.
+ *
+ * Easing maps the linear time progress (Q16) of a slot before it is applied
+ * to the level span: quadratics and smoothstep are evaluated with integer
+ * multiplies, the exponential through a 17-point interpolated table.  No
+ * float math — the ESP32-C3/C6 have no FPU.
+ *
+ * RBDIMMER_STATIC_ALLOC: the task runs on a static stack and TCB, is created
+ * by rbdimmer_transition_init() and never exits — deleting and re-creating a
+ * static task on the same buffers would race the idle task's cleanup.
+ *
+ * Fix 1.6: engine task pinned to CPU0 — same core as GPIO ISR and
  * esp_timer callbacks — to avoid cross-core race on channel->current_delay.
+ * With CONFIG_RBDIMMER_RT_CORE it follows the interrupts to that core
+ * (rbdimmer_affinity_task_core).
  * On single-core chips (ESP32-C3/S2/C6) pinning to CPU0 is a no-op.
+ *
+ * Lock order: fade_mutex → manager_mutex (rbdimmer_channel.c).  Public
+ * channel calls cancel a fade before taking manager_mutex, never while
+ * holding it.
  */
 
 #include "rbdimmer_transition.h"
+#include "rbdimmer_channel.h"
+#include "rbdimmer_curves.h"
+#include "rbdimmer_affinity.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include <stdlib.h>
+#include "freertos/semphr.h"
+#include <string.h>
 
 #define TAG "RBDIMMER"
 
-// Transition task parameters — use Kconfig values if available (ESP-IDF build),
+// Engine task parameters — use Kconfig values if available (ESP-IDF build),
 // fall back to compile-time defaults for Arduino builds.
 #ifdef CONFIG_RBDIMMER_TRANSITION_TASK_STACK_SIZE
   #define TRANSITION_STACK_SIZE  CONFIG_RBDIMMER_TRANSITION_TASK_STACK_SIZE
@@ -32,53 +59,236 @@
   #define TRANSITION_TASK_PRIO   5
 #endif
 
+#ifdef CONFIG_RBDIMMER_FADE_INTERVAL_MS
+  #define FADE_INTERVAL_MS       CONFIG_RBDIMMER_FADE_INTERVAL_MS
+#else
+  #define FADE_INTERVAL_MS       10
+#endif
+
+// Shorter transitions are applied immediately
+#define FADE_MIN_MS              50
+
 // ---------------------------------------------------------------------------
-// Internal types
+// Module-private state
 // ---------------------------------------------------------------------------
 
 typedef struct {
-    rbdimmer_channel_t* channel;
-    uint8_t  start_level;
-    uint8_t  target_level;
-    uint32_t transition_ms;
-    uint32_t step_ms;
-} transition_params_t;
+    rbdimmer_channel_t* channel;      // NULL = slot free
+    uint16_t start_level;             // Q16 level when the fade (re)started
+    uint16_t target_level;            // Q16 level at the end
+    int64_t  start_us;                // esp_timer_get_time() at (re)start
+    int64_t  duration_us;
+    rbdimmer_easing_t easing;
+} fade_slot_t;
+
+static fade_slot_t fade_slots[RBDIMMER_MAX_CHANNELS];
+static uint8_t     fade_active;       // Occupied slots (under fade_mutex)
+
+// Serialises slot access between API callers and the engine task.
+static StaticSemaphore_t fade_mutex_buf;
+static SemaphoreHandle_t fade_mutex = NULL;
+
+static TaskHandle_t  fade_task = NULL;
+static volatile bool fade_task_run = false;
+
+#if RBDIMMER_STATIC_ALLOC
+static StaticTask_t fade_task_tcb;
+static StackType_t  fade_task_stack[TRANSITION_STACK_SIZE];  // IDF: depth in bytes
+#endif
+
+// (2^(10t) - 1) / 1023 in Q16 at t = i/16 — RBDIMMER_EASING_EXPONENTIAL
+static const uint32_t ease_expo_table[17] = {
+        0,    35,    88,   171,   298,   495,   798,  1265,
+     1986,  3097,  4812,  7455, 11532, 17820, 27517, 42472,
+    65536
+};
+
+// ---------------------------------------------------------------------------
+// Internal helpers
+// ---------------------------------------------------------------------------
+
+// Map linear progress @p p (Q16, 0 … 65536) through @p easing.
+static uint32_t ease_apply(rbdimmer_easing_t easing, uint32_t p) {
+    switch (easing) {
+        case RBDIMMER_EASING_IN:
+            return (uint32_t)(((uint64_t)p * p) >> 16);
+        case RBDIMMER_EASING_OUT: {
+            uint32_t q = 65536 - p;
+            return 65536 - (uint32_t)(((uint64_t)q * q) >> 16);
+        }
+        case RBDIMMER_EASING_IN_OUT: {
+            // smoothstep: 3p² - 2p³ = p² (3 - 2p)
+            uint64_t p2 = (uint64_t)p * p;
+            return (uint32_t)((p2 * (3 * 65536 - 2 * (uint64_t)p)) >> 32);
+        }
+        case RBDIMMER_EASING_EXPONENTIAL: {
+            uint32_t i = p >> 12;            // 16 segments of 4096
+            if (i >= 16) {
+                return 65536;
+            }
+            uint32_t f = p & 0xFFF;
+            return ease_expo_table[i] +
+                   (((ease_expo_table[i + 1] - ease_expo_table[i]) * f) >> 12);
+        }
+        case RBDIMMER_EASING_LINEAR:
+        default:
+            return p;
+    }
+}
+
+// Release the slot of @p channel.  Caller holds fade_mutex.
+static void fade_slot_release(rbdimmer_channel_t* channel) {
+    uint8_t slot = channel->fade_slot;
+    if (slot >= RBDIMMER_MAX_CHANNELS) {
+        return;
+    }
+    fade_slots[slot].channel = NULL;
+    channel->fade_slot = RBDIMMER_FADE_SLOT_NONE;
+    fade_active--;
+}
+
+static uint16_t fade_level_at(const fade_slot_t* fs, int64_t now_us) {
+    int64_t elapsed = now_us - fs->start_us;
+    if (elapsed >= fs->duration_us) {
+        return fs->target_level;
+    }
+    if (elapsed <= 0) {
+        return fs->start_level;
+    }
+    uint32_t progress = (uint32_t)((elapsed << 16) / fs->duration_us);
+    uint32_t eased    = ease_apply(fs->easing, progress);
+    int32_t span = (int32_t)fs->target_level - (int32_t)fs->start_level;
+    return (uint16_t)((int32_t)fs->start_level +
+                      (int32_t)(((int64_t)span * eased) / 65536));
+}
 
 // ---------------------------------------------------------------------------
 // FreeRTOS task
 // ---------------------------------------------------------------------------
 
-static void level_transition_task(void* pvParameters) {
-    transition_params_t* params = (transition_params_t*)pvParameters;
-    rbdimmer_channel_t*  ch     = params->channel;
-
-    uint8_t  current   = params->start_level;
-    uint8_t  target    = params->target_level;
-    int8_t   step      = (target > current) ? 1 : -1;
-    uint32_t steps     = (uint32_t)abs((int)target - (int)current);
-    uint32_t step_time = (steps > 0) ? (params->transition_ms / steps)
-                                      : params->transition_ms;
-    if (step_time < params->step_ms) {
-        step_time = params->step_ms;
-    }
-
-    while (current != target) {
-        rbdimmer_set_level(ch, current);
-        current += step;
-        if ((step > 0 && current > target) ||
-            (step < 0 && current < target)) {
-            current = target;
+static void fade_engine_task(void* pvParameters) {
+    (void)pvParameters;
+    TickType_t interval  = pdMS_TO_TICKS(FADE_INTERVAL_MS);
+    TickType_t last_wake = xTaskGetTickCount();
+    if (interval == 0) {
+        interval = 1;
+    }
+
+    while (fade_task_run) {
+        if (fade_active == 0) {
+            // Idle: sleep until rbdimmer_set_level_transition() notifies
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last_wake = xTaskGetTickCount();
+            continue;
+        }
+        vTaskDelayUntil(&last_wake, interval);
+
+        xSemaphoreTake(fade_mutex, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < RBDIMMER_MAX_CHANNELS; i++) {
+            fade_slot_t* fs = &fade_slots[i];
+            if (fs->channel == NULL) {
+                continue;
+            }
+            rbdimmer_channel_t* ch = fs->channel;
+            uint16_t level = fade_level_at(fs, now);
+            rbdimmer_channel_set_level_q16(ch, level);
+            if (level == fs->target_level) {
+                fade_slot_release(ch);
+            }
         }
-        vTaskDelay(pdMS_TO_TICKS(step_time));
+        xSemaphoreGive(fade_mutex);
     }
-    rbdimmer_set_level(ch, target);
 
-    // W4: self-clear handle so the channel knows no transition is running.
-    ch->transition_task = NULL;
-    free(params);
+    fade_task = NULL;
     vTaskDelete(NULL);
 }
 
+// Create the engine task.  Caller holds fade_mutex.
+static bool fade_task_start(void) {
+    fade_task_run = true;
+#if RBDIMMER_STATIC_ALLOC
+    fade_task = xTaskCreateStaticPinnedToCore(
+        fade_engine_task,
+        "dimmer_fade",
+        TRANSITION_STACK_SIZE,
+        NULL,
+        TRANSITION_TASK_PRIO,
+        fade_task_stack,
+        &fade_task_tcb,
+        rbdimmer_affinity_task_core()   // same core as zero_cross ISR and timer callbacks (Fix 1.6)
+    );
+#else
+    BaseType_t created = xTaskCreatePinnedToCore(
+        fade_engine_task,
+        "dimmer_fade",
+        TRANSITION_STACK_SIZE,
+        NULL,
+        TRANSITION_TASK_PRIO,
+        &fade_task,
+        rbdimmer_affinity_task_core()   // same core as zero_cross ISR and timer callbacks (Fix 1.6)
+    );
+    if (created != pdPASS) {
+        fade_task = NULL;
+    }
+#endif
+    return fade_task != NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Module lifecycle
+// ---------------------------------------------------------------------------
+
+void rbdimmer_transition_init(void) {
+    if (fade_mutex == NULL) {
+        fade_mutex = xSemaphoreCreateMutexStatic(&fade_mutex_buf);
+    }
+    xSemaphoreTake(fade_mutex, portMAX_DELAY);
+    memset(fade_slots, 0, sizeof(fade_slots));
+    fade_active = 0;
+#if RBDIMMER_STATIC_ALLOC
+    if (fade_task == NULL) {
+        fade_task_start();   // idles on its notification until the first fade
+    }
+#endif
+    xSemaphoreGive(fade_mutex);
+}
+
+void rbdimmer_transition_deinit(void) {
+#if RBDIMMER_STATIC_ALLOC
+    // The task stays parked on its notification; only drop running fades
+    if (fade_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(fade_mutex, portMAX_DELAY);
+    for (int i = 0; i < RBDIMMER_MAX_CHANNELS; i++) {
+        if (fade_slots[i].channel != NULL) {
+            fade_slot_release(fade_slots[i].channel);
+        }
+    }
+    xSemaphoreGive(fade_mutex);
+#else
+    if (fade_task == NULL) {
+        return;
+    }
+    fade_task_run = false;
+    xTaskNotifyGive(fade_task);
+    // The task exits after its current tick (at most one interval)
+    for (int i = 0; i < 10 && fade_task != NULL; i++) {
+        vTaskDelay(pdMS_TO_TICKS(FADE_INTERVAL_MS) + 1);
+    }
+#endif
+}
+
+void rbdimmer_transition_cancel(rbdimmer_channel_t* channel) {
+    if (fade_mutex == NULL || channel->fade_slot == RBDIMMER_FADE_SLOT_NONE) {
+        return;
+    }
+    xSemaphoreTake(fade_mutex, portMAX_DELAY);
+    fade_slot_release(channel);
+    xSemaphoreGive(fade_mutex);
+}
+
 // ---------------------------------------------------------------------------
 // Public API
 // ---------------------------------------------------------------------------
@@ -86,57 +296,56 @@ static void level_transition_task(void* pvParameters) {
 rbdimmer_err_t rbdimmer_set_level_transition(rbdimmer_channel_t* channel,
                                                uint8_t level_percent,
                                                uint32_t transition_ms) {
-    if (channel == NULL) {
-        return RBDIMMER_ERR_INVALID_ARG;
-    }
     if (level_percent > 100) {
         level_percent = 100;
     }
-    if (channel->level_percent == level_percent) {
-        return RBDIMMER_OK;
+    return rbdimmer_set_level_transition_eased(channel,
+                                               RBDIMMER_CURVES_PCT_TO_Q16(level_percent),
+                                               transition_ms,
+                                               RBDIMMER_EASING_LINEAR);
+}
+
+rbdimmer_err_t rbdimmer_set_level_transition_eased(rbdimmer_channel_t* channel,
+                                                     uint16_t target,
+                                                     uint32_t transition_ms,
+                                                     rbdimmer_easing_t easing) {
+    if (channel == NULL || fade_mutex == NULL ||
+        easing > RBDIMMER_EASING_EXPONENTIAL) {
+        return RBDIMMER_ERR_INVALID_ARG;
     }
-    if (transition_ms < 50) {
-        return rbdimmer_set_level(channel, level_percent);
+    if (transition_ms < FADE_MIN_MS) {
+        return rbdimmer_set_level_q16(channel, target);  // also cancels a fade
     }
 
-    // W4: cancel any transition already running on this channel so only one
-    // task drives the channel at a time.  vTaskDelete() on a running task is
-    // safe — FreeRTOS cleans up the TCB at the next scheduler tick.
-    if (channel->transition_task != NULL) {
-        vTaskDelete(channel->transition_task);
-        channel->transition_task = NULL;
-    }
+    xSemaphoreTake(fade_mutex, portMAX_DELAY);
 
-    transition_params_t* params =
-        (transition_params_t*)malloc(sizeof(transition_params_t));
-    if (params == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for transition parameters");
+    if (fade_task == NULL && !fade_task_start()) {
+        xSemaphoreGive(fade_mutex);
+        ESP_LOGE(TAG, "Failed to create fade engine task");
         return RBDIMMER_ERR_NO_MEMORY;
     }
 
-    params->channel       = channel;
-    params->start_level   = channel->level_percent;
-    params->target_level  = level_percent;
-    params->transition_ms = transition_ms;
-    params->step_ms       = 20;
-
-    TaskHandle_t task_handle = NULL;
-    BaseType_t created = xTaskCreatePinnedToCore(
-        level_transition_task,
-        "dimmer_transition",
-        TRANSITION_STACK_SIZE,
-        params,
-        TRANSITION_TASK_PRIO,
-        &task_handle,
-        0   // CPU0: same core as zero_cross ISR and timer callbacks (Fix 1.6)
-    );
-    if (created != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create transition task");
-        free(params);
-        return RBDIMMER_ERR_NO_MEMORY;
+    // Retarget the running fade in place, or claim a free slot
+    uint8_t slot = channel->fade_slot;
+    if (slot == RBDIMMER_FADE_SLOT_NONE) {
+        if (channel->level_q16 == target) {
+            xSemaphoreGive(fade_mutex);
+            return RBDIMMER_OK;
+        }
+        slot = channel->slot;               // one fade slot per pool slot
+        fade_slots[slot].channel = channel;
+        channel->fade_slot = slot;
+        fade_active++;
     }
 
-    // W4: store handle so next call can cancel this task if needed.
-    channel->transition_task = task_handle;
+    fade_slot_t* fs = &fade_slots[slot];
+    fs->start_level  = channel->level_q16;   // continue from where we are now
+    fs->target_level = target;
+    fs->start_us     = esp_timer_get_time();
+    fs->duration_us  = (int64_t)transition_ms * 1000;
+    fs->easing       = easing;
+
+    xSemaphoreGive(fade_mutex);
+    xTaskNotifyGive(fade_task);
     return RBDIMMER_OK;
 }
@@ -1,10 +1,11 @@
 /**
  * @file rbdimmer_transition.h
- * @brief Smooth brightness transition via FreeRTOS task
+ * @brief Smooth brightness transitions via a single fade engine task
  * @internal
  *
- * Implements rbdimmer_set_level_transition() declared in rbdimmerESP32.h.
- * The transition task is pinned to CPU0 (Fix 1.6) to avoid cross-core races
+ * Implements rbdimmer_set_level_transition() and
+ * rbdimmer_set_level_transition_eased() declared in rbdimmerESP32.h.
+ * The engine task is pinned to CPU0 (Fix 1.6) to avoid cross-core races
  * with the GPIO ISR and esp_timer callbacks.
  */
 
@@ -18,8 +19,25 @@
 extern "C" {
 #endif
 
-// rbdimmer_set_level_transition() is declared in rbdimmerESP32.h (public API).
-// No additional internal symbols need to be exported from this module.
+/**
+ * @brief Reset the fade slots. Called from rbdimmer_init().
+ *
+ * The engine task itself is created on the first transition.
+ */
+void rbdimmer_transition_init(void);
+
+/**
+ * @brief Stop the engine task (if running). Called from rbdimmer_deinit().
+ */
+void rbdimmer_transition_deinit(void);
+
+/**
+ * @brief Drop the running fade of @p channel, if any.
+ *
+ * Called by rbdimmer_set_level*() and rbdimmer_delete_channel() before they
+ * take manager_mutex.  O(1).
+ */
+void rbdimmer_transition_cancel(rbdimmer_channel_t* channel);
 
 #ifdef __cplusplus
 }
@@ -13,7 +13,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_timer.h"
-#include "freertos/FreeRTOS.h"   // TaskHandle_t
+#include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "rbdimmerESP32.h"       // rbdimmer_curve_t, rbdimmer_channel_t (opaque forward decl)
 
@@ -25,6 +25,9 @@ extern "C" {
 // Timer state machine
 // ---------------------------------------------------------------------------
 
+// rbdimmer_channel_s.fade_slot value when no transition is running
+#define RBDIMMER_FADE_SLOT_NONE  0xFF
+
 typedef enum {
     TIMER_STATE_IDLE,        // Waiting for zero-crossing
     TIMER_STATE_DELAY,       // Delay timer running, waiting to fire TRIAC
@@ -38,15 +41,40 @@ typedef enum {
 typedef struct {
     uint8_t pin;                      // GPIO pin of the ZC detector
     uint8_t phase;                    // Phase number (0..RBDIMMER_MAX_PHASES-1)
-    uint16_t frequency;               // Measured mains frequency in Hz
-    uint32_t half_cycle_us;           // Half-cycle duration in microseconds
+    uint16_t frequency;               // Measured mains frequency in Hz (rounded)
+    volatile uint32_t half_cycle_us;  // Half-cycle duration in µs, tracked by the ISR
+    uint32_t period_q8;               // Tracker estimate of the half-cycle [µs << 8]
+    uint32_t edge_estimate;           // Predictive mode: filtered edge time (us), 0 = unlocked
+    int16_t  offset_us[2];            // Detector edge minus true crossing (us) per half-cycle
+                                      // polarity (index = polarity), + = edge late
     uint32_t last_cross_time;         // Timestamp of last zero-crossing (us)
-    void (*callback)(void*);          // User callback (rising edge)
+
+    // Edge mode (rbdimmer_set_zero_cross_edge)
+    uint8_t  edge_mode;               // rbdimmer_edge_t
+    uint8_t  polarity;                // Half-cycle started by the last crossing (0 = positive)
+    uint32_t pulse_start;             // RBDIMMER_EDGE_BOTH: rising edge of the open pulse, 0 = none
+    esp_timer_handle_t half_wave_timer; // RBDIMMER_EDGE_HALF_WAVE: synthesises the opposite crossing
+    struct rbdimmer_zc_capture_s* capture; // MCPWM capture input, NULL = GPIO ISR
+
+    // Edge statistics (ISR-written, read by rbdimmer_get_zero_cross_stats)
+    uint32_t edges_accepted;          // Detector edges that triggered a half-cycle
+    uint32_t edges_rejected;          // Dropped by the noise gate, pulse check or median filter
+    uint32_t edges_synthesized;       // Virtual crossings (missing edge, half-wave opposite side)
+
+    // Hand-off of the last crossing to the phase trigger (zc_dispatch)
+    uint32_t dispatch;                // ZC_DISPATCH_* claim word, CAS only
+    uint32_t cross_seq;               // Crossings published under zc_lock
+    uint32_t fired_seq;               // Last cross_seq handed to the trigger (claim holder)
+    uint32_t fire_half_cycle_us;      // Published: half-cycle of the crossing
+    uint32_t fire_cross_time;         // Published: delay origin (edge minus offset)
+
+    void (*callback)(void*);          // User callback (every real crossing)
     void* user_data;                  // User data passed to callback
     bool is_active;                   // Active flag
 
-    // Frequency auto-measurement
-    bool frequency_measured;          // True once frequency is determined
+    // Frequency auto-measurement (acquisition), then continuous tracking
+    volatile bool frequency_measured; // True once frequency is determined
+    volatile bool seeded;             // Period restored from NVS, acquisition verifying it
     uint8_t measurement_count;        // Number of half-periods accumulated
     uint32_t total_period_us;         // Sum of half-periods for averaging
 } rbdimmer_zero_cross_t;
@@ -59,22 +87,132 @@ struct rbdimmer_channel_s {
     uint8_t gpio_pin;                          // Output GPIO pin (TRIAC gate)
     uint8_t phase;                             // Phase this channel belongs to
 
+    // Static pool bookkeeping (rbdimmer_channel.c, task-only, manager_mutex)
+    uint8_t slot;                              // Index in the channel pool
+    uint8_t generation;                        // Bumped on every reuse of the slot (never 0)
+    bool    in_use;                            // False once deletion started
+    struct rbdimmer_channel_s* list_prev;      // Per-phase list
+    struct rbdimmer_channel_s* list_next;      // Per-phase list / free list
+
     // Fields shared between task and ISR context — must be volatile so the
     // compiler does not cache them in a register across context boundaries.
-    volatile uint8_t  level_percent;           // Current brightness (0-100)
+    volatile uint8_t  level_percent;           // Current brightness (0-100), rounded from level_q16
+    volatile uint16_t level_q16;               // Current brightness (0-RBDIMMER_LEVEL_Q16_MAX)
     uint8_t prev_level_percent;                // Previous brightness (change detection, task-only)
-    volatile uint32_t current_delay;           // Firing delay [µs]: written by task, read by ISR
-    volatile bool     is_active;               // Enable flag: written by task, read by ISR
+    volatile uint32_t current_delay;           // Firing delay [µs]: copied into the phase schedule (task-only writer)
+    volatile bool     is_active;               // Enable flag (task-only; ISR sees schedule membership)
     bool needs_update;                         // Delay recalc pending (task-only)
     rbdimmer_curve_t curve_type;               // Brightness curve (task-only)
+    rbdimmer_custom_curve_t custom_curve;      // Table used by RBDIMMER_CURVE_CUSTOM (task-only)
     esp_timer_handle_t delay_timer;            // One-shot: zero-cross → TRIAC fire
     esp_timer_handle_t pulse_timer;            // One-shot: TRIAC fire → pulse end
-    volatile timer_state_t timer_state;        // FSM state: read/written by ISR callbacks
+    volatile timer_state_t timer_state;        // FSM state: ISR callbacks; the task only cancels to IDLE
+    const struct rbdimmer_fire_entry_s* volatile armed_entry; // Group leader armed on our timers (ISR-only)
+#if RBDIMMER_INSTRUMENT
+    uint32_t armed_due;                        // Scheduled time of the next gate edge (ISR-only)
+#endif
+
+    // RBDIMMER_OUTPUT_MCPWM channels are not in the phase schedule: the
+    // peripheral generates every pulse, the task only updates compare values.
+    rbdimmer_output_t output;                  // Gate pulse generator (task-only)
+    struct rbdimmer_mcpwm_out_s* mcpwm;        // MCPWM handles, NULL for software output
+
+    // RBDIMMER_MODE_BURST channels sit in the delay-0 part of the schedule
+    // with their duty; the ZC ISR switches them, current_delay stays 0.
+    // RBDIMMER_MODE_TRAILING channels sit there too; current_delay is their
+    // cut-off, the ZC ISR raises the gate and the release event drops it.
+    rbdimmer_mode_t mode;                      // Firing mode (task-only)
+    uint16_t burst_duty_q16;                   // Share of conducting cycles (task-only)
+
+    // Gate drive (task-only).  hold_us is the release time after the
+    // crossing for RBDIMMER_GATE_HOLD / _TRAIN, recomputed with the delay.
+    rbdimmer_gate_t gate;                      // Gate drive of a firing
+    uint16_t pulse_us;                         // Gate pulse width [µs]
+    uint16_t hold_us;                          // Hold release [µs after ZC], 0 = pulse only
+
+    // W4: fade engine slot of the running transition (RBDIMMER_FADE_SLOT_NONE
+    // when idle).  Guarded by the fade engine mutex (rbdimmer_transition.c);
+    // a channel owns at most one slot, so a new transition retargets it.
+    uint8_t fade_slot;
+
+    // Phase-group member timing (rbdimmer_group.c, task-only): the line
+    // crosses lag_q16 of a half-cycle after the detector of `phase`; skew_us
+    // staggers members that would otherwise fire together.
+    uint16_t line_lag_q16;
+    int16_t  skew_us;
+
+    // Zero-cross-synchronised fade (rbdimmer_set_level_transition_zc).  The
+    // phase ISR adds zc_fade_step_q16 to the Q16 delay accumulator once per
+    // half-cycle and writes it into the schedule entry; the last step lands
+    // exactly on zc_fade_final_delay.  ISR-only: set from the phase command
+    // ring (rbdimmer_channel.c), read by the task only as a progress snapshot.
+    volatile uint32_t zc_fade_steps;           // Half-cycles left, 0 = no ZC fade
+    volatile uint32_t zc_fade_delay_q16;       // Delay accumulator [µs << 16]
+    int32_t  zc_fade_step_q16;                 // Per-half-cycle increment [µs << 16]
+    uint32_t zc_fade_final_delay;              // Delay after the last step [µs]
+    // Task-only (manager_mutex): what was last posted to the command ring.
+    bool     zc_fade_armed;                    // Last command was a fade start
+    uint32_t zc_fade_seq;                      // Ring position just after that command
+    uint32_t zc_fade_start;                    // Delay the posted fade starts from [µs]
+    bool     zc_fade_soft;                     // That fade is a soft-start ramp
+    uint16_t soft_start;                       // Soft-start ramp [half-cycles], 0 = off
+};
+
+// ---------------------------------------------------------------------------
+// Per-phase firing schedule (built in task context, read by the ZC ISR)
+// ---------------------------------------------------------------------------
+
+typedef struct rbdimmer_fire_entry_s {
+    uint64_t gpio_mask;                        // 1 << channel->gpio_pin
+    uint32_t delay_us;                         // Fire time after zero-cross [µs], 0 = reset only
+    rbdimmer_channel_t* channel;               // Channel driven by this entry
+    uint8_t group_len;                         // Leader: entries in its group (>= 1); member: 0
+    uint16_t burst_duty_q16;                   // Burst fire: share of conducting cycles, 0 = none
+    uint16_t burst_offset_q16;                 // Burst fire: position in the phase rotation
+    uint16_t pulse_us;                         // Gate pulse width [µs]
+    uint16_t hold_us;                          // Gate hold release [µs after ZC], 0 = none
+    uint32_t release_us;                       // Gate off [µs after ZC] (schedule_finalize)
+    bool train;                                // Pulse train up to release_us (GPTimer scheduler)
+    bool trailing;                             // Trailing edge: on at ZC, off at hold_us
+} rbdimmer_fire_entry_t;
+
+// Contiguous, delay-sorted list of the ACTIVE channels of one phase.
+// Entries [0, fire_start) have delay 0 (gate held LOW, never timer-fired;
+// burst-fire entries among them are switched by the ZC ISR itself, and
+// trailing-edge entries are raised by it and released at hold_us);
+// entries [fire_start, count) fire in ascending delay order.
+//
+// Firing groups: consecutive entries whose delays lie within
+// CONFIG_RBDIMMER_GATE_BATCH_WINDOW_US of the first one share one timer event.  The
+// first entry (leader) fires the whole group at its own (smallest) delay with
+// one register write of the members' gate bits.  Members must also release
+// within the window of the leader; pulse-train entries are never grouped.
+// Gates release at release_us, which follows the delay only for equal
+// pulse widths: release_order lists the group leaders (and the conducting
+// trailing-edge entries, one group each) by release time.
+typedef struct {
+    uint8_t count;                             // Number of valid entries
+    uint8_t fire_start;                        // First entry with delay_us > 0
+    uint8_t group_count;                       // Firing groups in release_order
+    uint8_t release_order[RBDIMMER_MAX_CHANNELS]; // Leader indices by release_us
+    uint64_t reset_mask;                       // Gate bits of every entry (LOW at ZC)
+    uint64_t burst_mask;                       // Gate bits of the burst-fire entries
+    uint64_t trailing_mask;                    // Gate bits raised at the crossing (trailing edge)
+    rbdimmer_fire_entry_t entries[RBDIMMER_MAX_CHANNELS];
+} rbdimmer_phase_schedule_t;
+
+// ---------------------------------------------------------------------------
+// Phase group (implements opaque rbdimmer_group_t from public header)
+// ---------------------------------------------------------------------------
 
-    // W4: active transition task handle (NULL when idle).
-    // rbdimmer_set_level_transition() checks this before spawning a new task
-    // to prevent two tasks fighting over the same channel.
-    TaskHandle_t transition_task;              // NULL = no transition in progress
+struct rbdimmer_group_s {
+    bool    in_use;
+    uint8_t count;                             // Members
+    uint8_t reference_phase;                   // Detector of the reference line
+    rbdimmer_channel_t* members[RBDIMMER_GROUP_MAX_MEMBERS];
+    uint8_t  member_phase[RBDIMMER_GROUP_MAX_MEMBERS];   // Own detector, or RBDIMMER_GROUP_PHASE_INFER
+    uint16_t member_lag_deg[RBDIMMER_GROUP_MAX_MEMBERS]; // Inferred members: configured lag
+    volatile uint16_t level_q16;               // Last group level
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,265 @@
+/**
+ * @file rbdimmer_zc_capture.c
+ * @brief Hardware-timestamped zero-cross input via the MCPWM capture unit
+ * @internal
+ *
+ *   ZC pin ──► capture channel (pos + neg edge) ──► latch capture timer
+ *                                                   (shared per group)
+ *
+ * The capture timer does not necessarily run at the requested 1 MHz: on
+ * ESP32 / ESP32-S3 it counts the 80 MHz APB clock whatever resolution_hz
+ * says.  The actual resolution is read back once per group; a resolution
+ * that is not a whole number of ticks per µs is refused and the caller falls
+ * back to the GPIO ISR.
+ *
+ * Time base: the capture timer and esp_timer run from the same crystal, so
+ * a latched count maps to esp_timer time through one anchor pair
+ * (count, µs) per group.  Every edge slides the anchor forward by the whole
+ * µs in the count difference; the sub-µs remainder stays in the next delta,
+ * so no rounding accumulates.  An
+ * edge cannot happen after the ISR that reports it, so a converted time
+ * later than "now" pulls the anchor back; the anchor thereby settles on the
+ * shortest ISR latency seen.  A gap larger than ZC_CAPTURE_RELOCK_US (first
+ * edge, clock glitch, counter wrap after a long outage) re-anchors on the
+ * ISR timestamp.
+ */
+
+#include "rbdimmer_zc_capture.h"
+#include "rbdimmer_hal.h"
+#include "rbdimmer_affinity.h"
+
+#if RBDIMMER_HAL_USE_ZC_CAPTURE
+
+#include "driver/mcpwm_prelude.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <stdlib.h>
+
+#define TAG "RBDIMMER"
+
+// Requested resolution; the driver may round it (or ignore it, see above).
+#define CAPTURE_RESOLUTION_HZ  1000000
+
+// Converted edge older than this at ISR entry → re-anchor on the ISR time.
+#define ZC_CAPTURE_RELOCK_US   1000
+
+typedef struct {
+    mcpwm_cap_timer_handle_t timer;     // NULL = group unused
+    uint8_t  users;                     // capture channels on this timer
+    bool     anchored;
+    uint32_t ticks_per_us;              // actual timer resolution / 1 MHz
+    uint32_t anchor_count;              // capture count …
+    uint32_t anchor_us;                 // … and its esp_timer time
+} cap_group_t;
+
+// DRAM_ATTR: anchor updated from the capture ISR.
+static DRAM_ATTR cap_group_t cap_groups[SOC_MCPWM_GROUPS];
+
+struct rbdimmer_zc_capture_s {
+    mcpwm_cap_channel_handle_t chan;
+    uint8_t group;
+    rbdimmer_zc_capture_cb_t cb;
+    void* arg;
+};
+
+#if RBDIMMER_STATIC_ALLOC
+// One capture per zero-cross input instead of calloc; cb == NULL = free.
+// DRAM_ATTR: cb / arg are read by the capture ISR.
+static DRAM_ATTR struct rbdimmer_zc_capture_s cap_pool[RBDIMMER_MAX_PHASES];
+#endif
+
+// ---------------------------------------------------------------------------
+// ISR
+// ---------------------------------------------------------------------------
+
+static IRAM_ATTR bool capture_cb(mcpwm_cap_channel_handle_t chan,
+                                 const mcpwm_capture_event_data_t* edata,
+                                 void* user_ctx) {
+    (void)chan;
+    struct rbdimmer_zc_capture_s* cap = (struct rbdimmer_zc_capture_s*)user_ctx;
+    cap_group_t* g = &cap_groups[cap->group];
+
+    uint32_t now   = (uint32_t)esp_timer_get_time();
+    uint32_t delta = (edata->cap_value - g->anchor_count) / g->ticks_per_us;
+    uint32_t edge  = g->anchor_us + delta;
+    int32_t  lat   = (int32_t)(now - edge);
+    if (!g->anchored || lat > ZC_CAPTURE_RELOCK_US || lat < 0) {
+        // First edge / gap: lock on the ISR time.  Negative latency: the
+        // anchor was late, move it back.
+        edge = now;
+        g->anchored     = true;
+        g->anchor_count = edata->cap_value;
+    } else {
+        g->anchor_count += delta * g->ticks_per_us;   // remainder carries over
+    }
+    g->anchor_us = edge;
+
+    cap->cb(cap->arg, edge, edata->cap_edge == MCPWM_CAP_EDGE_POS);
+    return false;  // no task woken
+}
+
+// ---------------------------------------------------------------------------
+// Internal helpers
+// ---------------------------------------------------------------------------
+
+// Capture timer of @p group, created and started on first use.
+static mcpwm_cap_timer_handle_t group_timer(int group) {
+    cap_group_t* g = &cap_groups[group];
+    if (g->timer != NULL) {
+        return g->timer;
+    }
+    mcpwm_capture_timer_config_t timer_config = {
+        .group_id      = group,
+        .clk_src       = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+        .resolution_hz = CAPTURE_RESOLUTION_HZ,
+    };
+    mcpwm_cap_timer_handle_t timer = NULL;
+    if (mcpwm_new_capture_timer(&timer_config, &timer) != ESP_OK) {
+        return NULL;
+    }
+    uint32_t resolution_hz = 0;
+    if (mcpwm_capture_timer_get_resolution(timer, &resolution_hz) != ESP_OK ||
+        resolution_hz == 0 || resolution_hz % 1000000 != 0) {
+        ESP_LOGW(TAG, "MCPWM capture timer at %lu Hz is not a whole number of "
+                 "ticks per us", (unsigned long)resolution_hz);
+        mcpwm_del_capture_timer(timer);
+        return NULL;
+    }
+    if (mcpwm_capture_timer_enable(timer) != ESP_OK) {
+        mcpwm_del_capture_timer(timer);
+        return NULL;
+    }
+    if (mcpwm_capture_timer_start(timer) != ESP_OK) {
+        mcpwm_capture_timer_disable(timer);
+        mcpwm_del_capture_timer(timer);
+        return NULL;
+    }
+    g->timer        = timer;
+    g->users        = 0;
+    g->anchored     = false;
+    g->ticks_per_us = resolution_hz / 1000000;
+    return timer;
+}
+
+static void cap_free(struct rbdimmer_zc_capture_s* cap) {
+#if RBDIMMER_STATIC_ALLOC
+    cap->cb = NULL;
+#else
+    free(cap);
+#endif
+}
+
+// Register the edge callback — allocates the interrupt, so it runs on the
+// real-time core (rbdimmer_affinity_call).
+static esp_err_t cap_register(void* arg) {
+    struct rbdimmer_zc_capture_s* cap = (struct rbdimmer_zc_capture_s*)arg;
+    mcpwm_capture_event_callbacks_t cbs = {
+        .on_cap = capture_cb,
+    };
+    return mcpwm_capture_channel_register_event_callbacks(cap->chan, &cbs, cap);
+}
+
+static void group_release(int group) {
+    cap_group_t* g = &cap_groups[group];
+    if (g->timer == NULL || g->users > 0) {
+        return;
+    }
+    mcpwm_capture_timer_stop(g->timer);
+    mcpwm_capture_timer_disable(g->timer);
+    mcpwm_del_capture_timer(g->timer);
+    g->timer = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public (internal) API
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_zc_capture_create(uint8_t pin, rbdimmer_zc_capture_cb_t cb,
+                                           void* arg, rbdimmer_zc_capture_t** out) {
+    if (cb == NULL || out == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+#if RBDIMMER_STATIC_ALLOC
+    struct rbdimmer_zc_capture_s* cap = NULL;
+    for (int i = 0; i < RBDIMMER_MAX_PHASES; i++) {
+        if (cap_pool[i].cb == NULL) {
+            cap = &cap_pool[i];
+            break;
+        }
+    }
+#else
+    struct rbdimmer_zc_capture_s* cap =
+        (struct rbdimmer_zc_capture_s*)calloc(1, sizeof(*cap));
+#endif
+    if (cap == NULL) {
+        return RBDIMMER_ERR_NO_MEMORY;
+    }
+    cap->cb  = cb;
+    cap->arg = arg;
+
+    mcpwm_capture_channel_config_t chan_config = {
+        .gpio_num       = pin,
+#if RBDIMMER_HAL_HAS_INTR_PRIORITY
+        .intr_priority  = rbdimmer_affinity_intr_priority(),
+#endif
+        .prescale       = 1,
+        .flags.pos_edge = true,
+        .flags.neg_edge = true,
+    };
+
+    // First group with a free capture channel wins
+    for (int group = 0; group < SOC_MCPWM_GROUPS; group++) {
+        mcpwm_cap_timer_handle_t timer = group_timer(group);
+        if (timer == NULL) {
+            continue;
+        }
+        if (mcpwm_new_capture_channel(timer, &chan_config, &cap->chan) != ESP_OK) {
+            group_release(group);
+            continue;
+        }
+        if (rbdimmer_affinity_call(cap_register, cap) != ESP_OK ||
+            mcpwm_capture_channel_enable(cap->chan) != ESP_OK) {
+            mcpwm_del_capture_channel(cap->chan);
+            group_release(group);
+            break;
+        }
+        cap->group = (uint8_t)group;
+        cap_groups[group].users++;
+        *out = cap;
+        ESP_LOGI(TAG, "Zero-cross GPIO %d on MCPWM capture (group %d)", pin, group);
+        return RBDIMMER_OK;
+    }
+
+    cap_free(cap);
+    ESP_LOGW(TAG, "No free MCPWM capture channel for GPIO %d", pin);
+    return RBDIMMER_ERR_TIMER_FAILED;
+}
+
+void rbdimmer_zc_capture_delete(rbdimmer_zc_capture_t* cap) {
+    if (cap == NULL) {
+        return;
+    }
+    mcpwm_capture_channel_disable(cap->chan);
+    mcpwm_del_capture_channel(cap->chan);
+    cap_groups[cap->group].users--;
+    group_release(cap->group);
+    cap_free(cap);
+}
+
+#else /* !RBDIMMER_HAL_USE_ZC_CAPTURE */
+
+rbdimmer_err_t rbdimmer_zc_capture_create(uint8_t pin, rbdimmer_zc_capture_cb_t cb,
+                                           void* arg, rbdimmer_zc_capture_t** out) {
+    (void)pin;
+    (void)cb;
+    (void)arg;
+    (void)out;
+    return RBDIMMER_ERR_INVALID_ARG;
+}
+
+void rbdimmer_zc_capture_delete(rbdimmer_zc_capture_t* cap) {
+    (void)cap;
+}
+
+#endif /* RBDIMMER_HAL_USE_ZC_CAPTURE */
@@ -0,0 +1,59 @@
+/**
+ * @file rbdimmer_zc_capture.h
+ * @brief Hardware-timestamped zero-cross input via the MCPWM capture unit
+ * @internal
+ *
+ * Alternative edge source for rbdimmer_zerocross.c, enabled with
+ * CONFIG_RBDIMMER_ZC_HW_CAPTURE.  The ZC pin is routed into an MCPWM capture
+ * channel: the capture timer value is latched by hardware on the edge, so
+ * interrupt latency no longer ends up in the edge timestamp.  The capture
+ * ISR converts the latched count to the esp_timer time base and hands it to
+ * the zero-cross layer together with the edge polarity.
+ *
+ * All functions return RBDIMMER_ERR_INVALID_ARG / do nothing unless
+ * RBDIMMER_HAL_USE_ZC_CAPTURE is 1 — the caller then keeps the GPIO ISR.
+ */
+
+#ifndef RBDIMMER_ZC_CAPTURE_H
+#define RBDIMMER_ZC_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rbdimmerESP32.h"    // rbdimmer_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct rbdimmer_zc_capture_s rbdimmer_zc_capture_t;
+
+/**
+ * @brief Edge callback, capture ISR context — MUST be IRAM_ATTR.
+ *
+ * @param arg        Pointer passed to rbdimmer_zc_capture_create()
+ * @param edge_time  Latched edge time (low 32 bits of esp_timer_get_time())
+ * @param rising     True for a rising edge
+ */
+typedef void (*rbdimmer_zc_capture_cb_t)(void* arg, uint32_t edge_time, bool rising);
+
+/**
+ * @brief Route @p pin into a free MCPWM capture channel (both edges).
+ *
+ * Configures the pin as input; no GPIO interrupt must be installed for it.
+ * The capture timer of an MCPWM group is shared by all its channels.
+ *
+ * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG (capture not available),
+ *         RBDIMMER_ERR_NO_MEMORY or RBDIMMER_ERR_TIMER_FAILED (no free
+ *         capture channel in any group)
+ */
+rbdimmer_err_t rbdimmer_zc_capture_create(uint8_t pin, rbdimmer_zc_capture_cb_t cb,
+                                           void* arg, rbdimmer_zc_capture_t** out);
+
+/** @brief Stop and free a capture channel (and its timer when unused). */
+void rbdimmer_zc_capture_delete(rbdimmer_zc_capture_t* cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_ZC_CAPTURE_H */
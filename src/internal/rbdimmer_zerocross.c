@@ -2,16 +2,78 @@
  * @file rbdimmer_zerocross.c
  * @brief Zero-crossing detection, frequency measurement, and ISR management
  * @internal
+ *
+ * Frequency: the first 50 half-periods are averaged to acquire the mains
+ * frequency (any value in RBDIMMER_FREQUENCY_MIN … MAX, no 50/60 Hz snap).
+ * After that every accepted edge feeds a first-order IIR on the half-cycle
+ * (Q8 µs, gain 2^-FREQ_TRACK_SHIFT), so half_cycle_us follows generator and
+ * weak-grid drift to the microsecond at O(1) cost per edge.  The channel
+ * layer rescales its delays when the estimate moves far enough.
+ *
+ * Crossing time: the phase trigger gets the timestamp the firing delays
+ * count from, so ISR time spent before arming no longer shifts the gates.
+ * It is the edge minus the per-phase detector offset; with
+ * CONFIG_RBDIMMER_ZC_PREDICTIVE the edge itself is predicted from the
+ * previous one plus the tracked half-cycle, and the ISR timestamp only
+ * corrects the phase by 1/2^ZC_PHASE_SHIFT of the error — interrupt latency
+ * jitter (Wi-Fi, flash-cache misses, other ISRs) drops out of gate timing.
+ *
+ * Glitch filter (CONFIG_RBDIMMER_ZC_FILTER): behind the noise gate, each
+ * edge interval is checked against the median of the last ZC_MEDIAN_WINDOW
+ * accepted intervals — early edges (double triggers of inductive loads) are
+ * dropped.  A per-phase esp_timer watchdog, re-armed on every accepted edge,
+ * synthesises the crossing at its expected time when the edge goes missing,
+ * up to ZC_SYNTH_MAX times in a row.  Fixed DRAM, no allocation, constant
+ * time per edge.
+ *
+ * Edge modes (rbdimmer_set_zero_cross_edge): RISING / FALLING take one edge
+ * per crossing.  BOTH listens to both edges of a pulse detector and uses the
+ * pulse centre — symmetric around the true crossing, independent of the
+ * optocoupler threshold.  HALF_WAVE detectors give one edge per mains
+ * period; a one-shot esp_timer synthesises the opposite crossing a tracked
+ * half-cycle later.  Half-cycle polarity alternates with every crossing and
+ * selects one of two detector offsets, so positive/negative asymmetry can
+ * be calibrated out.
+ *
+ * Edge source: the GPIO ISR timestamps an edge with esp_timer_get_time() at
+ * ISR entry.  With CONFIG_RBDIMMER_ZC_HW_CAPTURE (rbdimmer_zc_capture.c) the
+ * MCPWM capture unit latches the edge in hardware instead, so interrupt
+ * latency drops out of last_cross_time and the frequency estimate; phases
+ * without a free capture channel keep the GPIO ISR.
+ *
+ * Locking: zc_lock covers only the tracker update of a crossing.  The user
+ * callback and the channel layer's phase trigger run after it, so interrupt
+ * masking does not grow with the channel count; zc_dispatch() keeps the
+ * trigger of a phase single-entry with a CAS claim instead.
+ *
+ * Both interrupt sources are allocated through rbdimmer_affinity_call(), so
+ * they land on the real-time core (CONFIG_RBDIMMER_RT_CORE) at its priority.
+ *
+ * Fast boot (CONFIG_RBDIMMER_PERSIST, rbdimmer_persist.c): a phase with a
+ * stored half-cycle starts measured and seeded.  The acquisition average
+ * still runs beside the tracker; if it lands outside the tracker window the
+ * mains is not the stored one and the phase re-seeds from the average.  The
+ * filter watchdog waits for that check, it would synthesise crossings
+ * from a wrong period.
  */
 
 #include "rbdimmer_zerocross.h"
 #include "rbdimmer_hal.h"
+#include "rbdimmer_zc_capture.h"
+#include "rbdimmer_instrument.h"
+#include "rbdimmer_affinity.h"
+#include "rbdimmer_persist.h"
 #include "driver/gpio.h"
 #include "esp_intr_alloc.h"
 #include "esp_timer.h"
 #include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
 #include <string.h>
 
+#if RBDIMMER_INSTRUMENT
+#include "esp_cpu.h"
+#endif
+
 // ---------------------------------------------------------------------------
 // Module-private state
 // ---------------------------------------------------------------------------
@@ -24,10 +86,80 @@
 #  define ZC_DEBOUNCE_US  3000
 #endif
 
+// IIR gain of the frequency tracker: each edge moves the estimate by
+// 1/2^FREQ_TRACK_SHIFT of the error.  Larger = smoother, slower.
+#ifdef CONFIG_RBDIMMER_FREQ_TRACK_SHIFT
+#  define FREQ_TRACK_SHIFT  CONFIG_RBDIMMER_FREQ_TRACK_SHIFT
+#else
+#  define FREQ_TRACK_SHIFT  4
+#endif
+
+#ifdef CONFIG_RBDIMMER_ZC_PREDICTIVE
+#  define ZC_PREDICTIVE  1
+#else
+#  define ZC_PREDICTIVE  0
+#endif
+
+// Predictive mode: phase-correction gain of the edge estimate.
+#ifdef CONFIG_RBDIMMER_ZC_PHASE_SHIFT
+#  define ZC_PHASE_SHIFT  CONFIG_RBDIMMER_ZC_PHASE_SHIFT
+#else
+#  define ZC_PHASE_SHIFT  3
+#endif
+
+#ifdef CONFIG_RBDIMMER_ZC_FILTER
+#  define ZC_FILTER  1
+#else
+#  define ZC_FILTER  0
+#endif
+
+#ifdef CONFIG_RBDIMMER_ZC_MEDIAN_WINDOW
+#  define ZC_MEDIAN_WINDOW  CONFIG_RBDIMMER_ZC_MEDIAN_WINDOW
+#else
+#  define ZC_MEDIAN_WINDOW  5
+#endif
+
+// Glitch filter: accepted deviation from the median interval, and the
+// delay past the expected edge before a crossing is synthesised.
+#ifdef CONFIG_RBDIMMER_ZC_FILTER_TOLERANCE_US
+#  define ZC_FILTER_TOLERANCE_US  CONFIG_RBDIMMER_ZC_FILTER_TOLERANCE_US
+#else
+#  define ZC_FILTER_TOLERANCE_US  600
+#endif
+
+// Consecutive synthesised crossings before the phase is declared lost
+// (channels stay off until the next real edge).  0 disables synthesis.
+#ifdef CONFIG_RBDIMMER_ZC_SYNTH_MAX
+#  define ZC_SYNTH_MAX  CONFIG_RBDIMMER_ZC_SYNTH_MAX
+#else
+#  define ZC_SYNTH_MAX  2
+#endif
+
+// Half-wave and watchdog timers: same dispatch choice as the channel
+// timers (rbdimmer_timer.c)
+#ifdef CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#  define ZC_TIMER_DISPATCH  ESP_TIMER_ISR
+#else
+#  define ZC_TIMER_DISPATCH  ESP_TIMER_TASK
+#endif
+
+// Largest accepted detector offset (|us|)
+#define ZC_OFFSET_MAX_US  2000
+
+// Acquisition accepts half-cycles of RBDIMMER_FREQUENCY_MIN … MAX mains
+#define HALF_CYCLE_MIN_US  (1000000 / (2 * RBDIMMER_FREQUENCY_MAX))
+#define HALF_CYCLE_MAX_US  (1000000 / (2 * RBDIMMER_FREQUENCY_MIN))
+
+// Noise filter of the acquisition average: 5 ms .. 15 ms (33 .. 100 Hz)
+#define ACQUIRE_PERIOD_OK(p)  ((p) > 5000 && (p) < 15000)
+
 // O(1) ISR lookup: gpio_num → index in zero_cross_manager.zero_cross[]
 static DRAM_ATTR int8_t gpio_to_phase_map[GPIO_NUM_MAX];
 static volatile bool gpio_phase_map_initialized = false;
 
+// O(1) API lookup: phase → index in zero_cross_manager.zero_cross[], -1 = none
+static int8_t phase_to_index[RBDIMMER_MAX_PHASES];
+
 // DRAM_ATTR: read by find_by_pin() and zero_cross_isr_handler() in ISR context.
 static DRAM_ATTR struct {
     rbdimmer_zero_cross_t zero_cross[RBDIMMER_MAX_PHASES];
@@ -35,6 +167,38 @@ static DRAM_ATTR struct {
     bool isr_installed;
 } zero_cross_manager;
 
+#if ZC_FILTER
+// Per-phase filter state, indexed like zero_cross_manager.zero_cross[].
+typedef struct {
+    uint32_t intervals[ZC_MEDIAN_WINDOW];   // ring of accepted edge intervals
+    uint8_t  next;                          // ring write index
+    uint8_t  fill;                          // valid entries (< window while learning)
+    uint8_t  synth_run;                     // consecutive synthesised crossings
+    uint32_t armed_edge;                    // last_cross_time the watchdog was armed for
+    esp_timer_handle_t watchdog;
+} zc_filter_t;
+
+static DRAM_ATTR zc_filter_t zc_filters[RBDIMMER_MAX_PHASES];
+#endif
+
+// Serialises a real edge (GPIO ISR) with a synthesised one (half-wave timer,
+// filter watchdog — ISR or esp_timer task) while they update the tracker,
+// pulse_start and polarity and re-arm the phase's own one-shot: constant
+// work, independent of the channel count.  The user callback and the phase
+// trigger run after it is released (zc_dispatch).
+static DRAM_ATTR portMUX_TYPE zc_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// zero_cross_t.dispatch: one context at a time runs the phase trigger
+#define ZC_DISPATCH_BUSY   0x1u   // a context is running the trigger
+#define ZC_DISPATCH_AGAIN  0x2u   // a crossing was published meanwhile
+
+// Where a crossing came from (zc_crossing)
+typedef enum {
+    ZC_SRC_EDGE,        // detector edge (or pulse centre)
+    ZC_SRC_HALF_WAVE,   // half-wave mode: opposite crossing, one half-cycle later
+    ZC_SRC_WATCHDOG,    // glitch filter: stands in for a missing edge
+} zc_source_t;
+
 // Phase-trigger callback registered by the channel layer.
 // Called from ISR context on every zero-crossing.
 // DRAM_ATTR: function pointer read in ISR context.
@@ -63,19 +227,16 @@ static IRAM_ATTR void measure_frequency(rbdimmer_zero_cross_t* zc,
     }
     if (zc->last_cross_time > 0) {
         uint32_t period_us = current_time - zc->last_cross_time;
-        // Noise filter: valid half-cycle range (5ms .. 15ms covers 33..100 Hz)
-        if (period_us > 5000 && period_us < 15000) {
+        if (ACQUIRE_PERIOD_OK(period_us)) {
             zc->total_period_us += period_us;
             zc->measurement_count++;
             if (zc->measurement_count >= 50) {
                 uint32_t avg = zc->total_period_us / zc->measurement_count;
-                if (avg >= 9000 && avg <= 11000) {        // 50 Hz ±10%
-                    zc->frequency = 50;
-                    zc->half_cycle_us = 10000;
-                    zc->frequency_measured = true;
-                } else if (avg >= 7500 && avg <= 9166) {  // 60 Hz ±10%
-                    zc->frequency = 60;
-                    zc->half_cycle_us = 8333;
+                if (avg >= HALF_CYCLE_MIN_US && avg <= HALF_CYCLE_MAX_US) {
+                    // Seed the tracker with the measured value
+                    zc->period_q8 = avg << 8;
+                    zc->half_cycle_us = avg;
+                    zc->frequency = (uint16_t)((1000000 + avg) / (2 * avg));
                     zc->frequency_measured = true;
                 } else {
                     // Unknown — reset and retry
@@ -90,43 +251,428 @@ static IRAM_ATTR void measure_frequency(rbdimmer_zero_cross_t* zc,
     zc->last_cross_time = current_time;
 }
 
-// ---------------------------------------------------------------------------
-// GPIO ISR handler
-// ---------------------------------------------------------------------------
+// One IIR step on an accepted half-period.  Periods more than 1/8 off the
+// estimate (a missed edge, a spike that passed the noise gate) are ignored.
+static IRAM_ATTR void track_frequency(rbdimmer_zero_cross_t* zc,
+                                      uint32_t period_us) {
+    uint32_t est    = zc->half_cycle_us;
+    uint32_t window = est >> 3;
+    if (period_us + window < est || period_us > est + window) {
+        return;
+    }
+    int32_t err = (int32_t)(period_us << 8) - (int32_t)zc->period_q8;
+    zc->period_q8    += (uint32_t)(err >> FREQ_TRACK_SHIFT);
+    zc->half_cycle_us = (zc->period_q8 + 128) >> 8;
+}
 
-static void IRAM_ATTR zero_cross_isr_handler(void* arg) {
-    uint32_t gpio_num = (uint32_t)arg;
-    rbdimmer_zero_cross_t* zc = find_by_pin((uint8_t)gpio_num);
+// Seeded phase: one acquisition step on an accepted half-period.  After 50
+// the average is compared with the tracker; beyond its 1/8 window (which
+// track_frequency() could never close) the phase re-seeds from the
+// average, or falls back to a full acquisition if that is off the range.
+static IRAM_ATTR void verify_seed(rbdimmer_zero_cross_t* zc, uint32_t period_us) {
+    if (!ACQUIRE_PERIOD_OK(period_us)) {
+        return;
+    }
+    zc->total_period_us += period_us;
+    zc->measurement_count++;
+    if (zc->measurement_count < 50) {
+        return;
+    }
+    uint32_t avg    = zc->total_period_us / zc->measurement_count;
+    uint32_t est    = zc->half_cycle_us;
+    uint32_t window = est >> 3;
+    if (avg + window < est || avg > est + window) {
+        if (avg >= HALF_CYCLE_MIN_US && avg <= HALF_CYCLE_MAX_US) {
+            zc->period_q8     = avg << 8;
+            zc->half_cycle_us = avg;
+            zc->frequency     = (uint16_t)((1000000 + avg) / (2 * avg));
+        } else {
+            zc->frequency_measured = false;
+        }
+    }
+    zc->seeded            = false;
+    zc->measurement_count = 0;
+    zc->total_period_us   = 0;
+}
 
-    if (zc == NULL || !zc->is_active) {
+#if ZC_PREDICTIVE
+// Predict this edge from the last estimate plus one half-cycle and nudge the
+// estimate towards the ISR timestamp.  An error beyond 1/8 half-cycle (lost
+// edges, long outage) re-locks on the timestamp.
+static IRAM_ATTR uint32_t predict_edge(rbdimmer_zero_cross_t* zc, uint32_t now) {
+    uint32_t predicted = zc->edge_estimate + zc->half_cycle_us;
+    int32_t  err       = (int32_t)(now - predicted);
+    int32_t  window    = (int32_t)(zc->half_cycle_us >> 3);
+    if (zc->edge_estimate == 0 || err > window || err < -window) {
+        zc->edge_estimate = now;
+    } else {
+        zc->edge_estimate = predicted + (uint32_t)(err >> ZC_PHASE_SHIFT);
+    }
+    return zc->edge_estimate;
+}
+#endif
+
+#if ZC_FILTER
+// Median of the interval ring — insertion sort of a copy, window <= 9.
+static IRAM_ATTR uint32_t filter_median(const zc_filter_t* f) {
+    uint32_t v[ZC_MEDIAN_WINDOW];
+    for (int i = 0; i < ZC_MEDIAN_WINDOW; i++) {
+        uint32_t x = f->intervals[i];
+        int j = i;
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+    return v[ZC_MEDIAN_WINDOW / 2];
+}
+
+// Returns false for an edge that came too early to be a crossing.  Late
+// edges are accepted (re-sync) but not learned.
+static IRAM_ATTR bool filter_accept(zc_filter_t* f, uint32_t interval) {
+    if (f->fill == ZC_MEDIAN_WINDOW) {
+        uint32_t median = filter_median(f);
+        if (interval + ZC_FILTER_TOLERANCE_US < median) {
+            return false;
+        }
+        if (interval > median + ZC_FILTER_TOLERANCE_US) {
+            return true;
+        }
+    } else {
+        f->fill++;
+    }
+    f->intervals[f->next] = interval;
+    f->next = (uint8_t)((f->next + 1) % ZC_MEDIAN_WINDOW);
+    return true;
+}
+
+// (Re)start the missing-edge watchdog: expires ZC_FILTER_TOLERANCE_US after
+// the crossing expected one half-cycle after last_cross_time.
+static IRAM_ATTR void filter_arm_watchdog(rbdimmer_zero_cross_t* zc, zc_filter_t* f,
+                                          uint32_t now) {
+    if (ZC_SYNTH_MAX == 0 || f->watchdog == NULL || zc->seeded) {
         return;
     }
+    int32_t due = (int32_t)(zc->last_cross_time + zc->half_cycle_us +
+                            ZC_FILTER_TOLERANCE_US - now);
+    f->armed_edge = zc->last_cross_time;
+    esp_timer_stop(f->watchdog);
+    esp_timer_start_once(f->watchdog, (uint64_t)(due > 1 ? due : 1));
+}
+#endif
 
-    uint32_t now = (uint32_t)esp_timer_get_time();
+// Process one crossing at time @p t and publish it for zc_dispatch().
+// Returns false when the noise gate or the glitch filter rejected it.
+// Caller holds zc_lock.
+static IRAM_ATTR bool zc_crossing(rbdimmer_zero_cross_t* zc, uint32_t t,
+                                  zc_source_t src) {
+    uint32_t edge    = t;
+    uint32_t elapsed = t - zc->last_cross_time;
+    bool     first   = zc->last_cross_time == 0;
 
     if (!zc->frequency_measured) {
         // Auto-measure frequency until determined
-        measure_frequency(zc, now);
+        measure_frequency(zc, t);
     } else {
         // Noise gate: reject edges closer than ZC_DEBOUNCE_US.
         // Eliminates TRIAC-induced spikes and optocoupler bounce that would
         // otherwise reset the delay timer mid-half-cycle → missed pulses → flicker.
-        uint32_t elapsed = now - zc->last_cross_time;
-        if (zc->last_cross_time > 0 && elapsed < ZC_DEBOUNCE_US) {
+        if (src == ZC_SRC_EDGE && !first && elapsed < ZC_DEBOUNCE_US) {
+            return false;
+        }
+        bool learn = !first;
+#if ZC_FILTER
+        zc_filter_t* f = &zc_filters[zc - zero_cross_manager.zero_cross];
+        if (src == ZC_SRC_EDGE) {
+            if (!first && !filter_accept(f, elapsed)) {
+                return false;
+            }
+            // An interval measured from a watchdog crossing says nothing
+            // about the mains period
+            learn = learn && f->synth_run == 0;
+            f->synth_run = 0;
+        } else {
+            if (src == ZC_SRC_WATCHDOG) {
+                f->synth_run++;
+            }
+            learn = false;
+        }
+#else
+        learn = learn && src == ZC_SRC_EDGE;
+#endif
+        if (src == ZC_SRC_EDGE && !first) {
+            uint32_t hc = zc->half_cycle_us;
+            rbdimmer_instr_zc_jitter(zc->phase, elapsed > hc ? elapsed - hc : hc - elapsed);
+        }
+        if (learn) {
+            track_frequency(zc, elapsed);
+            if (zc->seeded) {
+                verify_seed(zc, elapsed);
+            }
+        }
+        zc->last_cross_time = t;
+#if ZC_PREDICTIVE
+        edge = predict_edge(zc, t);
+#endif
+#if ZC_FILTER
+        filter_arm_watchdog(zc, f, (uint32_t)esp_timer_get_time());
+#endif
+    }
+
+    if (zc->edge_mode == RBDIMMER_EDGE_HALF_WAVE) {
+        // Only one polarity has a detector edge; the opposite crossing
+        // follows one half-cycle later
+        zc->polarity = (src == ZC_SRC_HALF_WAVE) ? 1 : 0;
+        if (src != ZC_SRC_HALF_WAVE && zc->half_wave_timer != NULL) {
+            int32_t due = (int32_t)(t + zc->half_cycle_us -
+                                    (uint32_t)esp_timer_get_time());
+            esp_timer_stop(zc->half_wave_timer);
+            esp_timer_start_once(zc->half_wave_timer, (uint64_t)(due > 1 ? due : 1));
+        }
+    } else {
+        // Polarity alternates; count the half-cycles since the last crossing
+        // so a lost edge does not swap the positive/negative offsets
+        uint32_t hc = zc->half_cycle_us;
+        uint32_t n  = (first || hc == 0) ? 1 : (elapsed + hc / 2) / hc;
+        zc->polarity ^= (uint8_t)(n & 1U);
+    }
+
+    if (src == ZC_SRC_EDGE) {
+        zc->edges_accepted++;
+    } else {
+        zc->edges_synthesized++;
+    }
+
+    zc->fire_half_cycle_us = zc->half_cycle_us;
+    zc->fire_cross_time    = edge - (uint32_t)(int32_t)zc->offset_us[zc->polarity];
+    zc->cross_seq++;
+    return true;
+}
+
+// Run the phase trigger for the newest published crossing, outside zc_lock.
+// Sources of one phase can overlap (a real edge preempting a synthesised
+// crossing on the esp_timer task, or running on the other core), and the
+// trigger is not reentrant.  Whoever finds the claim held leaves AGAIN and
+// returns; the holder repeats with the newest crossing before it lets go.
+// A crossing the holder has already handed over is not fired twice.
+// ISR or esp_timer task context.
+static IRAM_ATTR void zc_dispatch(rbdimmer_zero_cross_t* zc) {
+    uint32_t st = __atomic_load_n(&zc->dispatch, __ATOMIC_RELAXED);
+    uint32_t claim;
+    do {
+        claim = (st & ZC_DISPATCH_BUSY) ? (st | ZC_DISPATCH_AGAIN) : ZC_DISPATCH_BUSY;
+    } while (!__atomic_compare_exchange_n(&zc->dispatch, &st, claim, false,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    if (st & ZC_DISPATCH_BUSY) {
+        return;
+    }
+
+    for (;;) {
+        portENTER_CRITICAL_SAFE(&zc_lock);
+        uint32_t seq        = zc->cross_seq;
+        uint32_t half_cycle = zc->fire_half_cycle_us;
+        uint32_t cross_time = zc->fire_cross_time;
+        portEXIT_CRITICAL_SAFE(&zc_lock);
+
+        // Notify channel layer: fire all channels on this phase
+        if (seq != zc->fired_seq && phase_trigger_cb) {
+            zc->fired_seq = seq;
+            phase_trigger_cb(zc->phase, half_cycle, cross_time);
+        }
+
+        st = ZC_DISPATCH_BUSY;
+        if (__atomic_compare_exchange_n(&zc->dispatch, &st, 0, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+            return;
+        }
+        // AGAIN set: only the holder clears it, the others only set it
+        __atomic_store_n(&zc->dispatch, ZC_DISPATCH_BUSY, __ATOMIC_RELAXED);
+    }
+}
+
+// Half-wave mode: the opposite crossing, one half-cycle after the edge that
+// armed the timer.  ISR or esp_timer task context.
+static IRAM_ATTR void half_wave_cb(void* arg) {
+    rbdimmer_zero_cross_t* zc = (rbdimmer_zero_cross_t*)arg;
+
+    bool fire = false;
+    portENTER_CRITICAL_SAFE(&zc_lock);
+    if (zc->is_active && zc->edge_mode == RBDIMMER_EDGE_HALF_WAVE &&
+        zc->polarity == 0 && zc->last_cross_time != 0) {
+        fire = zc_crossing(zc, zc->last_cross_time + zc->half_cycle_us, ZC_SRC_HALF_WAVE);
+    }
+    portEXIT_CRITICAL_SAFE(&zc_lock);
+    if (fire) {
+        zc_dispatch(zc);
+    }
+}
+
+// Start @p zc measured from a stored half-cycle (task context, before the
+// ISR sees the phase or under zc_lock).  A period off the acquisition range,
+// or more than 1/8 away from a configured frequency, is not used.
+static void zc_seed(rbdimmer_zero_cross_t* zc, uint32_t period_q8) {
+    uint32_t half = (period_q8 + 128) >> 8;
+    if (half < HALF_CYCLE_MIN_US || half > HALF_CYCLE_MAX_US) {
+        return;
+    }
+    if (zc->frequency != 0) {
+        uint32_t nominal = 1000000 / (2 * zc->frequency);
+        if (half + (nominal >> 3) < nominal || half > nominal + (nominal >> 3)) {
             return;
         }
-        zc->last_cross_time = now;
     }
+    zc->period_q8          = period_q8;
+    zc->half_cycle_us      = half;
+    zc->frequency          = (uint16_t)((1000000 + half) / (2 * half));
+    zc->measurement_count  = 0;
+    zc->total_period_us    = 0;
+    zc->seeded             = true;
+    zc->frequency_measured = true;
+}
+
+// Create the opposite-crossing timer of RBDIMMER_EDGE_HALF_WAVE if missing.
+static rbdimmer_err_t half_wave_timer_create(rbdimmer_zero_cross_t* zc) {
+    if (zc->half_wave_timer != NULL) {
+        return RBDIMMER_OK;
+    }
+    esp_timer_create_args_t hw_args = {
+        .callback        = half_wave_cb,
+        .arg             = zc,
+        .dispatch_method = ZC_TIMER_DISPATCH,
+        .name            = "dimmer_zc_half",
+    };
+    if (esp_timer_create(&hw_args, &zc->half_wave_timer) != ESP_OK) {
+        zc->half_wave_timer = NULL;
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+    return RBDIMMER_OK;
+}
+
+// GPIO ISR service install, run on the real-time core by rbdimmer_affinity_call()
+static esp_err_t isr_service_install(void* arg) {
+    (void)arg;
+    return gpio_install_isr_service(ESP_INTR_FLAG_IRAM | rbdimmer_affinity_intr_flags());
+}
+
+#if ZC_FILTER
+// Watchdog expiry: no edge since armed_edge — synthesise the crossing at
+// the time it was expected.  ISR or esp_timer task context.
+static IRAM_ATTR void filter_watchdog_cb(void* arg) {
+    rbdimmer_zero_cross_t* zc = (rbdimmer_zero_cross_t*)arg;
+    zc_filter_t* f = &zc_filters[zc - zero_cross_manager.zero_cross];
+
+    bool fire = false;
+    portENTER_CRITICAL_SAFE(&zc_lock);
+    if (zc->is_active && zc->last_cross_time == f->armed_edge &&
+        f->synth_run < ZC_SYNTH_MAX) {
+        fire = zc_crossing(zc, zc->last_cross_time + zc->half_cycle_us, ZC_SRC_WATCHDOG);
+    }
+    portEXIT_CRITICAL_SAFE(&zc_lock);
+    if (fire) {
+        zc_dispatch(zc);
+    }
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// GPIO ISR handler
+// ---------------------------------------------------------------------------
+
+// One detector edge at @p now; @p rising is the pin level after the edge.
+// GPIO ISR or capture ISR context.
+static IRAM_ATTR void zc_edge(rbdimmer_zero_cross_t* zc, uint32_t now, bool rising) {
+    portENTER_CRITICAL_ISR(&zc_lock);
+
+    switch (zc->edge_mode) {
+        case RBDIMMER_EDGE_BOTH: {
+            // Pulse detector: the crossing is the centre of the pulse.  The
+            // rising edge only opens it; one left open by a lost falling edge
+            // is replaced after half a half-cycle.
+            uint32_t limit = zc->half_cycle_us / 2;
+            if (rising) {
+                if (zc->pulse_start == 0 || now - zc->pulse_start > limit) {
+                    zc->pulse_start = now;
+                }
+                portEXIT_CRITICAL_ISR(&zc_lock);
+                return;
+            }
+            uint32_t start = zc->pulse_start;
+            zc->pulse_start = 0;
+            if (start == 0 || now - start > limit) {
+                zc->edges_rejected++;
+                portEXIT_CRITICAL_ISR(&zc_lock);
+                return;
+            }
+            now = start + (now - start) / 2;
+            break;
+        }
+        case RBDIMMER_EDGE_FALLING:
+            if (rising) {                 // capture input sees both edges
+                portEXIT_CRITICAL_ISR(&zc_lock);
+                return;
+            }
+            break;
+        default:
+            if (!rising) {
+                portEXIT_CRITICAL_ISR(&zc_lock);
+                return;
+            }
+            break;
+    }
+
+    bool fire = zc_crossing(zc, now, ZC_SRC_EDGE);
+    if (!fire) {
+        zc->edges_rejected++;
+    }
+    portEXIT_CRITICAL_ISR(&zc_lock);
+
+    if (fire) {
+        // User zero-cross callback (must be IRAM_ATTR if provided)
+        if (zc->callback) {
+            zc->callback(zc->user_data);
+        }
+        zc_dispatch(zc);
+    }
+}
+
+static void IRAM_ATTR zero_cross_isr_handler(void* arg) {
+    uint32_t gpio_num = (uint32_t)arg;
+    rbdimmer_zero_cross_t* zc = find_by_pin((uint8_t)gpio_num);
 
-    // User zero-cross callback (must be IRAM_ATTR if provided)
-    if (zc->callback) {
-        zc->callback(zc->user_data);
+    if (zc == NULL || !zc->is_active) {
+        return;
     }
 
-    // Notify channel layer: fire all channels on this phase
-    if (phase_trigger_cb) {
-        phase_trigger_cb(zc->phase);
+    uint32_t now = (uint32_t)esp_timer_get_time();
+#if RBDIMMER_INSTRUMENT
+    uint32_t cycles = esp_cpu_get_cycle_count();
+#endif
+
+    // The interrupt type already selects the edge; only BOTH needs the level
+    bool rising = zc->edge_mode == RBDIMMER_EDGE_BOTH
+                ? rbdimmer_hal_gpio_read(zc->pin) != 0
+                : zc->edge_mode != RBDIMMER_EDGE_FALLING;
+    zc_edge(zc, now, rising);
+#if RBDIMMER_INSTRUMENT
+    rbdimmer_instr_zc_isr_cycles(zc->phase, esp_cpu_get_cycle_count() - cycles);
+#endif
+}
+
+// Capture input: the timestamp was latched by hardware on the edge.
+static void IRAM_ATTR zero_cross_capture_cb(void* arg, uint32_t edge_time, bool rising) {
+    rbdimmer_zero_cross_t* zc = (rbdimmer_zero_cross_t*)arg;
+    if (!zc->is_active) {
+        return;
     }
+#if RBDIMMER_INSTRUMENT
+    uint32_t cycles = esp_cpu_get_cycle_count();
+    rbdimmer_instr_zc_latency(zc->phase, (uint32_t)esp_timer_get_time() - edge_time);
+#endif
+    zc_edge(zc, edge_time, rising);
+#if RBDIMMER_INSTRUMENT
+    rbdimmer_instr_zc_isr_cycles(zc->phase, esp_cpu_get_cycle_count() - cycles);
+#endif
 }
 
 // ---------------------------------------------------------------------------
@@ -140,6 +686,7 @@ void rbdimmer_zc_set_phase_trigger(rbdimmer_zc_phase_trigger_t cb) {
 void rbdimmer_zc_init(void) {
     memset(&zero_cross_manager, 0, sizeof(zero_cross_manager));
     memset(gpio_to_phase_map, -1, sizeof(gpio_to_phase_map));
+    memset(phase_to_index, -1, sizeof(phase_to_index));
     gpio_phase_map_initialized = true;
 }
 
@@ -150,59 +697,113 @@ rbdimmer_err_t rbdimmer_zc_register(uint8_t pin, uint8_t phase,
     }
 
     // Check for duplicate phase
-    for (int i = 0; i < zero_cross_manager.count; i++) {
-        if (zero_cross_manager.zero_cross[i].phase == phase) {
-            return RBDIMMER_ERR_ALREADY_EXIST;
-        }
+    if (rbdimmer_zc_get_by_phase(phase) != NULL) {
+        return RBDIMMER_ERR_ALREADY_EXIST;
     }
 
     if (zero_cross_manager.count >= RBDIMMER_MAX_PHASES) {
         return RBDIMMER_ERR_NO_MEMORY;
     }
 
-    // Configure GPIO input
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << pin),
-        .mode = GPIO_MODE_INPUT,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_POSEDGE
-    };
-    if (gpio_config(&io_conf) != ESP_OK) {
-        return RBDIMMER_ERR_GPIO_FAILED;
+    rbdimmer_zero_cross_t* zc =
+        &zero_cross_manager.zero_cross[zero_cross_manager.count];
+
+    // Hardware-timestamped input if a capture channel is free, GPIO ISR
+    // otherwise.  The descriptor is still inactive: early edges are ignored.
+    rbdimmer_zc_capture_t* capture = NULL;
+    if (RBDIMMER_HAL_USE_ZC_CAPTURE &&
+        rbdimmer_zc_capture_create(pin, zero_cross_capture_cb, zc, &capture) != RBDIMMER_OK) {
+        capture = NULL;
     }
 
-    // Install ISR service once (ESP_INTR_FLAG_IRAM: ISR must be IRAM-resident)
-    if (!zero_cross_manager.isr_installed) {
-        esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
-        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+    if (capture == NULL) {
+        // Configure GPIO input
+        gpio_config_t io_conf = {
+            .pin_bit_mask = (1ULL << pin),
+            .mode = GPIO_MODE_INPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_POSEDGE
+        };
+        if (gpio_config(&io_conf) != ESP_OK) {
             return RBDIMMER_ERR_GPIO_FAILED;
         }
-        zero_cross_manager.isr_installed = true;
-    }
 
-    if (gpio_isr_handler_add((gpio_num_t)pin, zero_cross_isr_handler,
-                              (void*)(uint32_t)pin) != ESP_OK) {
-        return RBDIMMER_ERR_GPIO_FAILED;
+        // Install ISR service once (ESP_INTR_FLAG_IRAM: ISR must be IRAM-resident).
+        // ESP_ERR_INVALID_STATE: the application installed it, core and level stay its own.
+        if (!zero_cross_manager.isr_installed) {
+            esp_err_t err = rbdimmer_affinity_call(isr_service_install, NULL);
+            if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+                return RBDIMMER_ERR_GPIO_FAILED;
+            }
+            zero_cross_manager.isr_installed = true;
+        }
+
+        if (gpio_isr_handler_add((gpio_num_t)pin, zero_cross_isr_handler,
+                                  (void*)(uint32_t)pin) != ESP_OK) {
+            return RBDIMMER_ERR_GPIO_FAILED;
+        }
     }
 
     // Fill ZC descriptor
-    rbdimmer_zero_cross_t* zc =
-        &zero_cross_manager.zero_cross[zero_cross_manager.count];
     zc->pin = pin;
     zc->phase = phase;
     zc->frequency = frequency;
     zc->half_cycle_us = (frequency > 0) ? (1000000 / (2 * frequency)) : 10000;
+    zc->period_q8 = zc->half_cycle_us << 8;
+    zc->edge_estimate = 0;
+    zc->offset_us[0] = 0;
+    zc->offset_us[1] = 0;
+    zc->edge_mode = RBDIMMER_EDGE_RISING;
+    zc->polarity = 0;
+    zc->pulse_start = 0;
+    zc->half_wave_timer = NULL;
+    zc->capture = capture;
     zc->last_cross_time = 0;
     zc->callback = NULL;
     zc->user_data = NULL;
     zc->is_active = true;
     zc->frequency_measured = false;
+    zc->seeded = false;
     zc->measurement_count = 0;
     zc->total_period_us = 0;
+    uint32_t stored_q8;
+    if (rbdimmer_persist_phase(phase, &stored_q8, zc->offset_us)) {
+        zc_seed(zc, stored_q8);
+    }
+    zc->edges_accepted = 0;
+    zc->edges_rejected = 0;
+    zc->edges_synthesized = 0;
+    zc->dispatch = 0;
+    zc->cross_seq = 0;
+    zc->fired_seq = 0;
+    (void)rbdimmer_reset_timing_stats(phase);   // histograms count from here too
+
+#if ZC_FILTER
+    // Missing-edge watchdog; without it the filter still rejects glitches
+    zc_filter_t* f = &zc_filters[zero_cross_manager.count];
+    memset(f, 0, sizeof(*f));
+    if (ZC_SYNTH_MAX > 0) {
+        esp_timer_create_args_t wd_args = {
+            .callback        = filter_watchdog_cb,
+            .arg             = zc,
+            .dispatch_method = ZC_TIMER_DISPATCH,
+            .name            = "dimmer_zc_wd",
+        };
+        if (esp_timer_create(&wd_args, &f->watchdog) != ESP_OK) {
+            f->watchdog = NULL;
+        }
+    }
+#endif
+
+#if RBDIMMER_STATIC_ALLOC
+    // Created up front so rbdimmer_set_zero_cross_edge() never allocates
+    half_wave_timer_create(zc);
+#endif
 
     // Register O(1) lookup entry
     gpio_to_phase_map[pin] = (int8_t)zero_cross_manager.count;
+    phase_to_index[phase]  = (int8_t)zero_cross_manager.count;
     zero_cross_manager.count++;
 
     return RBDIMMER_OK;
@@ -210,30 +811,184 @@ rbdimmer_err_t rbdimmer_zc_register(uint8_t pin, uint8_t phase,
 
 void rbdimmer_zc_deinit(void) {
     for (int i = 0; i < zero_cross_manager.count; i++) {
-        gpio_isr_handler_remove(
-            (gpio_num_t)zero_cross_manager.zero_cross[i].pin);
+        rbdimmer_zero_cross_t* zc = &zero_cross_manager.zero_cross[i];
+        zc->is_active = false;
+        if (zc->capture != NULL) {
+            rbdimmer_zc_capture_delete(zc->capture);
+        } else {
+            gpio_isr_handler_remove((gpio_num_t)zc->pin);
+        }
+        esp_timer_handle_t half_wave = zero_cross_manager.zero_cross[i].half_wave_timer;
+        if (half_wave != NULL) {
+            esp_timer_stop(half_wave);
+            esp_timer_delete(half_wave);
+        }
+#if ZC_FILTER
+        if (zc_filters[i].watchdog != NULL) {
+            esp_timer_stop(zc_filters[i].watchdog);
+            esp_timer_delete(zc_filters[i].watchdog);
+        }
+#endif
     }
+#if ZC_FILTER
+    memset(zc_filters, 0, sizeof(zc_filters));
+#endif
     if (zero_cross_manager.isr_installed) {
         gpio_uninstall_isr_service();
         zero_cross_manager.isr_installed = false;
     }
     memset(&zero_cross_manager, 0, sizeof(zero_cross_manager));
     memset(gpio_to_phase_map, -1, sizeof(gpio_to_phase_map));
+    memset(phase_to_index, -1, sizeof(phase_to_index));
     gpio_phase_map_initialized = false;
 }
 
 rbdimmer_zero_cross_t* rbdimmer_zc_get_by_phase(uint8_t phase) {
-    for (int i = 0; i < zero_cross_manager.count; i++) {
-        if (zero_cross_manager.zero_cross[i].phase == phase) {
-            return &zero_cross_manager.zero_cross[i];
-        }
+    if (phase >= RBDIMMER_MAX_PHASES) {
+        return NULL;
     }
-    return NULL;
+    int8_t idx = phase_to_index[phase];
+    if (idx < 0 || idx >= (int8_t)zero_cross_manager.count) {
+        return NULL;                  // also covers the map before init
+    }
+    return &zero_cross_manager.zero_cross[idx];
 }
 
 uint16_t rbdimmer_zc_get_frequency(uint8_t phase) {
     rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
-    return zc ? zc->frequency : 0;
+    if (zc == NULL) {
+        return 0;
+    }
+    if (!zc->frequency_measured) {
+        return zc->frequency;
+    }
+    return (uint16_t)((rbdimmer_zc_get_frequency_centihz(phase) + 50) / 100);
+}
+
+uint16_t rbdimmer_zc_get_frequency_centihz(uint8_t phase) {
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
+    if (zc == NULL || !zc->frequency_measured) {
+        return 0;
+    }
+    // f = 1e6 / (2 * half_cycle) Hz = 1e8 * 256 / (2 * period_q8) cHz
+    uint32_t period_q8 = zc->period_q8;
+    return (uint16_t)((12800000000ULL + period_q8 / 2) / period_q8);
+}
+
+rbdimmer_err_t rbdimmer_zc_set_offset(uint8_t phase, int16_t offset_us) {
+    if (offset_us > ZC_OFFSET_MAX_US || offset_us < -ZC_OFFSET_MAX_US) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
+    if (zc == NULL) {
+        return RBDIMMER_ERR_NOT_FOUND;
+    }
+    zc->offset_us[0] = offset_us;   // 16-bit stores: the ISR sees old or new
+    zc->offset_us[1] = offset_us;
+    return RBDIMMER_OK;
+}
+
+rbdimmer_err_t rbdimmer_zc_set_half_offsets(uint8_t phase, int16_t positive_us,
+                                              int16_t negative_us) {
+    if (positive_us > ZC_OFFSET_MAX_US || positive_us < -ZC_OFFSET_MAX_US ||
+        negative_us > ZC_OFFSET_MAX_US || negative_us < -ZC_OFFSET_MAX_US) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
+    if (zc == NULL) {
+        return RBDIMMER_ERR_NOT_FOUND;
+    }
+    zc->offset_us[0] = positive_us;
+    zc->offset_us[1] = negative_us;
+    return RBDIMMER_OK;
+}
+
+static gpio_int_type_t zc_intr_type(uint8_t edge) {
+    switch (edge) {
+        case RBDIMMER_EDGE_FALLING: return GPIO_INTR_NEGEDGE;
+        case RBDIMMER_EDGE_BOTH:    return GPIO_INTR_ANYEDGE;
+        default:                    return GPIO_INTR_POSEDGE;
+    }
+}
+
+rbdimmer_err_t rbdimmer_zc_set_edge(uint8_t phase, rbdimmer_edge_t edge) {
+    if (edge > RBDIMMER_EDGE_HALF_WAVE) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
+    if (zc == NULL) {
+        return RBDIMMER_ERR_NOT_FOUND;
+    }
+
+    if (edge == RBDIMMER_EDGE_HALF_WAVE && half_wave_timer_create(zc) != RBDIMMER_OK) {
+        return RBDIMMER_ERR_TIMER_FAILED;
+    }
+    // The capture input always latches both edges; zc_edge() filters them
+    if (zc->capture == NULL &&
+        gpio_set_intr_type((gpio_num_t)zc->pin, zc_intr_type(edge)) != ESP_OK) {
+        return RBDIMMER_ERR_GPIO_FAILED;
+    }
+
+    // The edge timestamps move (pulse width, half-wave intervals):
+    // re-acquire frequency and phase from scratch.  The mains period does
+    // not change with the edge, so a stored one still seeds it.
+    uint32_t stored_q8;
+    bool stored = rbdimmer_persist_phase(phase, &stored_q8, NULL);
+    portENTER_CRITICAL(&zc_lock);
+    zc->edge_mode = (uint8_t)edge;
+    zc->polarity = 0;
+    zc->pulse_start = 0;
+    zc->last_cross_time = 0;
+    zc->edge_estimate = 0;
+    zc->frequency_measured = false;
+    zc->seeded = false;
+    zc->measurement_count = 0;
+    zc->total_period_us = 0;
+    if (stored) {
+        zc_seed(zc, stored_q8);
+    }
+#if ZC_FILTER
+    zc_filter_t* f = &zc_filters[zc - zero_cross_manager.zero_cross];
+    f->fill = 0;
+    f->next = 0;
+    f->synth_run = 0;
+#endif
+    portEXIT_CRITICAL(&zc_lock);
+
+    if (edge != RBDIMMER_EDGE_HALF_WAVE && zc->half_wave_timer != NULL) {
+        esp_timer_stop(zc->half_wave_timer);
+    }
+    return RBDIMMER_OK;
+}
+
+uint8_t rbdimmer_zc_get_edge_by_pin(uint8_t pin) {
+    rbdimmer_zero_cross_t* zc = find_by_pin(pin);
+    return zc ? zc->edge_mode : (uint8_t)RBDIMMER_EDGE_RISING;
+}
+
+void rbdimmer_zc_restore_intr(uint8_t pin) {
+    rbdimmer_zero_cross_t* zc = find_by_pin(pin);
+    if (zc == NULL || zc->capture != NULL) {
+        return;   // capture input: no GPIO interrupt to restore
+    }
+    gpio_set_intr_type((gpio_num_t)pin, zc_intr_type(zc->edge_mode));
+    gpio_intr_enable((gpio_num_t)pin);
+}
+
+rbdimmer_err_t rbdimmer_zc_get_stats(uint8_t phase, rbdimmer_zc_stats_t* stats) {
+    if (stats == NULL) {
+        return RBDIMMER_ERR_INVALID_ARG;
+    }
+    rbdimmer_zero_cross_t* zc = rbdimmer_zc_get_by_phase(phase);
+    if (zc == NULL) {
+        return RBDIMMER_ERR_NOT_FOUND;
+    }
+    // Word-sized ISR counters: each read is consistent on its own
+    stats->edges       = zc->edges_accepted;
+    stats->rejected    = zc->edges_rejected;
+    stats->synthesized = zc->edges_synthesized;
+    stats->missed      = 0;                  // channel layer fills this in
+    return RBDIMMER_OK;
 }
 
 rbdimmer_err_t rbdimmer_zc_set_callback(uint8_t phase,
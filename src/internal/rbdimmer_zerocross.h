@@ -21,11 +21,15 @@ extern "C" {
 
 // ---------------------------------------------------------------------------
 // Phase-trigger callback
-// Called from ISR context on every zero-crossing for the given phase.
+// Called from ISR context on every zero-crossing for the given phase, with
+// the tracker's current half-cycle estimate and the crossing time the
+// firing delays count from (low 32 bits of esp_timer_get_time(), detector
+// offset and — in predictive mode — ISR latency already removed).
 // The registered function MUST be IRAM_ATTR.
 // ---------------------------------------------------------------------------
 
-typedef void (*rbdimmer_zc_phase_trigger_t)(uint8_t phase);
+typedef void (*rbdimmer_zc_phase_trigger_t)(uint8_t phase, uint32_t half_cycle_us,
+                                             uint32_t cross_time);
 
 /**
  * @brief Register a phase-trigger callback.
@@ -77,6 +81,51 @@ rbdimmer_zero_cross_t* rbdimmer_zc_get_by_phase(uint8_t phase);
  */
 uint16_t rbdimmer_zc_get_frequency(uint8_t phase);
 
+/**
+ * @brief Return the tracked mains frequency in 0.01 Hz units.
+ * @return e.g. 4987 for 49.87 Hz, or 0 if not yet measured.
+ */
+uint16_t rbdimmer_zc_get_frequency_centihz(uint8_t phase);
+
+/**
+ * @brief Set the detector offset of a phase (edge time minus true crossing).
+ * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND or RBDIMMER_ERR_INVALID_ARG
+ *         (|offset_us| > 2000)
+ */
+rbdimmer_err_t rbdimmer_zc_set_offset(uint8_t phase, int16_t offset_us);
+
+/**
+ * @brief Set separate detector offsets for positive and negative half-cycles.
+ * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND or RBDIMMER_ERR_INVALID_ARG
+ */
+rbdimmer_err_t rbdimmer_zc_set_half_offsets(uint8_t phase, int16_t positive_us,
+                                             int16_t negative_us);
+
+/**
+ * @brief Switch the edge mode of a phase and restart frequency acquisition.
+ * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND, RBDIMMER_ERR_INVALID_ARG,
+ *         RBDIMMER_ERR_TIMER_FAILED or RBDIMMER_ERR_GPIO_FAILED
+ */
+rbdimmer_err_t rbdimmer_zc_set_edge(uint8_t phase, rbdimmer_edge_t edge);
+
+/**
+ * @brief Edge mode of the phase whose detector is on @p pin
+ *        (RBDIMMER_EDGE_RISING if none).  Used by the MCPWM backend.
+ */
+uint8_t rbdimmer_zc_get_edge_by_pin(uint8_t pin);
+
+/**
+ * @brief Re-install the edge interrupt of the detector on @p pin after a
+ *        peripheral reconfigured the pin.  No-op for capture inputs.
+ */
+void rbdimmer_zc_restore_intr(uint8_t pin);
+
+/**
+ * @brief Copy the edge counters of a phase.
+ * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND or RBDIMMER_ERR_INVALID_ARG
+ */
+rbdimmer_err_t rbdimmer_zc_get_stats(uint8_t phase, rbdimmer_zc_stats_t* stats);
+
 /**
  * @brief Set user zero-cross callback for a phase.
  * @note  Callback runs in ISR context — must be IRAM_ATTR.
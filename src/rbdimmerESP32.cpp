@@ -5,15 +5,23 @@
  * After Sprint 2 modularisation this file is intentionally thin:
  *   - rbdimmer_init / rbdimmer_deinit   — orchestrate module lifecycle
  *   - rbdimmer_register_zero_cross      — input validation + delegation
- *   - rbdimmer_get_frequency            — direct delegation
+ *   - rbdimmer_get_frequency[_centihz]  — direct delegation
  *   - rbdimmer_set_callback             — direct delegation
- *   - rbdimmer_set_level_transition     — FreeRTOS smooth-transition task
- *                                         (Story 2.6: will move to rbdimmer_transition.c)
+ *   - rbdimmer_set_zero_cross_offset    — direct delegation
+ *   - rbdimmer_get_zero_cross_stats     — zero-cross counters + channel misses
+ *   - rbdimmer_set_zero_cross_edge / _half_offsets — direct delegation
+ *   - rbdimmer_register_custom_curve    — delegation to rbdimmer_curves.c
+ *
+ * With CONFIG_RBDIMMER_PERSIST the NVS store (rbdimmer_persist.c) is loaded
+ * first, so zero-cross registration and channel creation can seed from it,
+ * and flushed first on deinit, while channels and phases still exist.
  *
  * All channel lifecycle and control functions live in rbdimmer_channel.c.
  * Zero-cross detection lives in rbdimmer_zerocross.c.
  * Timer state machine lives in rbdimmer_timer.c.
  * Brightness curves live in rbdimmer_curves.c.
+ * The fade engine (rbdimmer_set_level_transition) lives in rbdimmer_transition.c.
+ * Phase groups (rbdimmer_group_*) live in rbdimmer_group.c.
  *
  * @author dev@rbdimmer.com
  * @version 1.0.0
@@ -26,6 +34,10 @@
 #include "internal/rbdimmer_zerocross.h"
 #include "internal/rbdimmer_curves.h"
 #include "internal/rbdimmer_channel.h"
+#include "internal/rbdimmer_transition.h"
+#include "internal/rbdimmer_affinity.h"
+#include "internal/rbdimmer_group.h"
+#include "internal/rbdimmer_persist.h"
 #include <esp_log.h>
 
 #define TAG "RBDIMMER"
@@ -35,16 +47,27 @@
 // ---------------------------------------------------------------------------
 
 rbdimmer_err_t rbdimmer_init(void) {
+    rbdimmer_affinity_init();
+    rbdimmer_persist_init();           // before anything seeds from it
     rbdimmer_zc_init();
-    rbdimmer_channel_manager_init();   // also registers ZC phase-trigger
+    rbdimmer_err_t err = rbdimmer_channel_manager_init();  // also registers ZC phase-trigger
+    if (err != RBDIMMER_OK) {
+        return err;
+    }
     rbdimmer_curves_init();
+    rbdimmer_transition_init();
+    rbdimmer_group_init();
     ESP_LOGI(TAG, "RBDimmer library initialized");
     return RBDIMMER_OK;
 }
 
 rbdimmer_err_t rbdimmer_deinit(void) {
+    rbdimmer_persist_deinit();         // last write needs channels and phases
+    rbdimmer_transition_deinit();      // stop stepping before channels go away
+    rbdimmer_group_deinit();           // member channels go with the channel manager
     rbdimmer_channel_manager_deinit(); // deletes all channels first
     rbdimmer_zc_deinit();
+    rbdimmer_curves_deinit();          // no channel references a curve any more
     ESP_LOGI(TAG, "RBDimmer library deinitialized");
     return RBDIMMER_OK;
 }
@@ -78,10 +101,51 @@ uint16_t rbdimmer_get_frequency(uint8_t phase) {
     return rbdimmer_zc_get_frequency(phase);
 }
 
+uint16_t rbdimmer_get_frequency_centihz(uint8_t phase) {
+    return rbdimmer_zc_get_frequency_centihz(phase);
+}
+
+rbdimmer_err_t rbdimmer_set_zero_cross_offset(uint8_t phase, int16_t offset_us) {
+    return rbdimmer_zc_set_offset(phase, offset_us);
+}
+
+rbdimmer_err_t rbdimmer_set_zero_cross_half_offsets(uint8_t phase, int16_t positive_us,
+                                                     int16_t negative_us) {
+    return rbdimmer_zc_set_half_offsets(phase, positive_us, negative_us);
+}
+
+rbdimmer_err_t rbdimmer_set_zero_cross_edge(uint8_t phase, rbdimmer_edge_t edge) {
+    return rbdimmer_zc_set_edge(phase, edge);
+}
+
+rbdimmer_err_t rbdimmer_get_zero_cross_stats(uint8_t phase, rbdimmer_zc_stats_t* stats) {
+    rbdimmer_err_t err = rbdimmer_zc_get_stats(phase, stats);
+    if (err == RBDIMMER_OK) {
+        stats->missed = rbdimmer_channel_get_missed(phase);
+    }
+    return err;
+}
+
 rbdimmer_err_t rbdimmer_set_callback(uint8_t phase,
                                       void (*callback)(void*),
                                       void* user_data) {
     return rbdimmer_zc_set_callback(phase, callback, user_data);
 }
 
+// ---------------------------------------------------------------------------
+// Custom curves
+// ---------------------------------------------------------------------------
+
+rbdimmer_err_t rbdimmer_register_custom_curve(const rbdimmer_curve_point_t* points,
+                                               uint8_t count,
+                                               rbdimmer_custom_curve_t* curve) {
+    rbdimmer_err_t err = rbdimmer_curves_register_custom(points, count, curve);
+    if (err != RBDIMMER_OK) {
+        ESP_LOGE(TAG, "Custom curve registration failed: %d", err);
+        return err;
+    }
+    ESP_LOGI(TAG, "Custom curve %d registered (%d points)", *curve, count);
+    return RBDIMMER_OK;
+}
+
 // rbdimmer_set_level_transition() implemented in rbdimmer_transition.c
@@ -51,12 +51,68 @@
    #define RBDIMMER_MAX_CHANNELS            8
  #endif
 
+ // Phase groups (rbdimmer_group_create), a static pool
+ #ifdef CONFIG_RBDIMMER_MAX_GROUPS
+   #define RBDIMMER_MAX_GROUPS              CONFIG_RBDIMMER_MAX_GROUPS
+ #else
+   #define RBDIMMER_MAX_GROUPS              2
+ #endif
+
+ // 1: every object is statically sized, no heap use after setup
+ #ifdef CONFIG_RBDIMMER_STATIC_ALLOC
+   #define RBDIMMER_STATIC_ALLOC            1
+ #else
+   #define RBDIMMER_STATIC_ALLOC            0
+ #endif
+
+ // 1: hot-path timing histograms (rbdimmer_get_timing_stats)
+ #ifdef CONFIG_RBDIMMER_INSTRUMENT
+   #define RBDIMMER_INSTRUMENT              1
+ #else
+   #define RBDIMMER_INSTRUMENT              0
+ #endif
+
+ // 1: calibration and channel state kept in NVS for fast boot (rbdimmer_persist.c)
+ #ifdef CONFIG_RBDIMMER_PERSIST
+   #define RBDIMMER_PERSIST                 1
+ #else
+   #define RBDIMMER_PERSIST                 0
+ #endif
+
+ // Core for the real-time interrupts and the fade engine (-1 = not pinned)
+ #ifdef CONFIG_RBDIMMER_RT_CORE
+   #define RBDIMMER_RT_CORE                 CONFIG_RBDIMMER_RT_CORE
+ #else
+   #define RBDIMMER_RT_CORE                 -1
+ #endif
+
+ // Interrupt priority level of the real-time interrupts (0 = driver default)
+ #ifdef CONFIG_RBDIMMER_RT_INTR_PRIORITY
+   #define RBDIMMER_RT_INTR_PRIORITY        CONFIG_RBDIMMER_RT_INTR_PRIORITY
+ #else
+   #define RBDIMMER_RT_INTR_PRIORITY        0
+ #endif
+
  #ifdef CONFIG_RBDIMMER_DEFAULT_PULSE_WIDTH_US
    #define RBDIMMER_DEFAULT_PULSE_WIDTH_US  CONFIG_RBDIMMER_DEFAULT_PULSE_WIDTH_US
  #else
    #define RBDIMMER_DEFAULT_PULSE_WIDTH_US  100
  #endif
 
+ // Gate hold / pulse train: release this long before the next zero-cross
+ #ifdef CONFIG_RBDIMMER_GATE_HOLD_GUARD_US
+   #define RBDIMMER_GATE_HOLD_GUARD_US      CONFIG_RBDIMMER_GATE_HOLD_GUARD_US
+ #else
+   #define RBDIMMER_GATE_HOLD_GUARD_US      300
+ #endif
+
+ // Gate pulse train: period of the repeated pulses
+ #ifdef CONFIG_RBDIMMER_GATE_TRAIN_PERIOD_US
+   #define RBDIMMER_GATE_TRAIN_PERIOD_US    CONFIG_RBDIMMER_GATE_TRAIN_PERIOD_US
+ #else
+   #define RBDIMMER_GATE_TRAIN_PERIOD_US    500
+ #endif
+
  #ifdef CONFIG_RBDIMMER_MIN_DELAY_US
    #define RBDIMMER_MIN_DELAY_US            CONFIG_RBDIMMER_MIN_DELAY_US
  #else
@@ -67,20 +123,54 @@
  #define RBDIMMER_FREQUENCY_MIN 45             // Minimum allowed frequency
  #define RBDIMMER_FREQUENCY_MAX 65             // Maximum allowed frequency
  #define RBDIMMER_MEASURE_CYCLES 10            // Number of cycles for frequency measurement
+ #define RBDIMMER_LEVEL_Q16_MAX 65535          // Full level for the *_q16 API
+ #define RBDIMMER_PULSE_WIDTH_MAX_US 2000      // Longest per-channel gate pulse
  
  // Enumerations
  typedef enum {
      RBDIMMER_CURVE_LINEAR,                    // Linear curve (no RMS consideration)
      RBDIMMER_CURVE_RMS,                       // RMS-compensated curve
      RBDIMMER_CURVE_LOGARITHMIC,               // Logarithmic curve (for LEDs)
-     RBDIMMER_CURVE_CUSTOM                     // Custom curve
+     RBDIMMER_CURVE_CUSTOM                     // Custom curve (see rbdimmer_register_custom_curve)
  } rbdimmer_curve_t;
  
+ // Zero-cross detector edge mode (rbdimmer_set_zero_cross_edge)
  typedef enum {
      RBDIMMER_EDGE_FALLING,                    // Falling edge
-     RBDIMMER_EDGE_RISING                      // Rising edge
+     RBDIMMER_EDGE_RISING,                     // Rising edge (default)
+     RBDIMMER_EDGE_BOTH,                       // Both edges, crossing = pulse centre
+     RBDIMMER_EDGE_HALF_WAVE                   // One rising edge per period, opposite crossing synthesised
  } rbdimmer_edge_t;
  
+ // Progress profile of a timed transition (rbdimmer_set_level_transition_eased)
+ typedef enum {
+     RBDIMMER_EASING_LINEAR = 0,               // Constant rate
+     RBDIMMER_EASING_IN,                       // Quadratic: slow start, fast end
+     RBDIMMER_EASING_OUT,                      // Quadratic: fast start, slow end
+     RBDIMMER_EASING_IN_OUT,                   // S-curve (smoothstep): slow at both ends
+     RBDIMMER_EASING_EXPONENTIAL               // Exponential ease-in: (2^(10t) - 1) / 1023
+ } rbdimmer_easing_t;
+ 
+ // Gate pulse generator of a channel
+ typedef enum {
+     RBDIMMER_OUTPUT_TIMER = 0,                // Software timers (esp_timer or GPTimer scheduler)
+     RBDIMMER_OUTPUT_MCPWM                     // MCPWM peripheral synced to the ZC input (no CPU per pulse)
+ } rbdimmer_output_t;
+ 
+ // Firing mode of a channel
+ typedef enum {
+     RBDIMMER_MODE_PHASE = 0,                  // Phase angle: fire at the curve's delay every half-cycle
+     RBDIMMER_MODE_BURST,                      // Burst fire: whole mains cycles switched at the crossing
+     RBDIMMER_MODE_TRAILING                    // Trailing edge: gate on at the crossing, off at the curve's cut-off
+ } rbdimmer_mode_t;
+ 
+ // Gate drive of a firing (phase-angle channels)
+ typedef enum {
+     RBDIMMER_GATE_PULSE = 0,                  // One pulse of pulse_width_us at the firing angle
+     RBDIMMER_GATE_HOLD,                       // Gate on from the firing angle to just before the next crossing
+     RBDIMMER_GATE_TRAIN                       // Pulses every RBDIMMER_GATE_TRAIN_PERIOD_US over the same span
+ } rbdimmer_gate_t;
+ 
  typedef enum {
      RBDIMMER_OK = 0,                          // Operation completed successfully
      RBDIMMER_ERR_INVALID_ARG,                 // Invalid argument
@@ -94,14 +184,86 @@
  // Forward declarations for opaque types
  typedef struct rbdimmer_channel_s rbdimmer_channel_t;
  
+ // Custom curve breakpoint: firing delay at a given level, both Q16.
+ // delay_q16 is the fraction of the half-cycle (65535 = end of half-cycle).
+ typedef struct {
+     uint16_t level_q16;               // Input level (0 … RBDIMMER_LEVEL_Q16_MAX)
+     uint16_t delay_q16;               // Firing delay fraction at that level
+ } rbdimmer_curve_point_t;
+ 
+ // Generation-checked channel id: stays invalid after the channel is deleted,
+ // even when its storage is reused (rbdimmer_get_channel_by_id)
+ typedef uint16_t rbdimmer_channel_id_t;
+ #define RBDIMMER_CHANNEL_ID_NONE 0
+ 
+ // Handle of a registered custom curve (shareable between channels)
+ typedef uint8_t rbdimmer_custom_curve_t;
+ #define RBDIMMER_CUSTOM_CURVE_NONE 0xFF       // No custom curve assigned
+ #define RBDIMMER_CUSTOM_CURVE_MAX_POINTS 64   // Breakpoints per custom curve
+ 
+ // Zero-cross edge counters of one phase (since registration)
+ typedef struct {
+     uint32_t edges;                   // Accepted edges (each started a half-cycle)
+     uint32_t rejected;                // Dropped by the noise gate / glitch filter
+     uint32_t synthesized;             // Missing edges replaced by a virtual crossing
+     uint32_t missed;                  // Channel firings still pending at the next crossing
+ } rbdimmer_zc_stats_t;
+ 
+ // Timing histogram: buckets[0] counts 0, buckets[i] 2^(i-1) … 2^i - 1,
+ // the last bucket everything above
+ #define RBDIMMER_TIMING_BUCKETS 16
+ typedef struct {
+     uint32_t count;
+     uint32_t min;
+     uint32_t max;
+     uint64_t sum;                     // mean = sum / count
+     uint32_t buckets[RBDIMMER_TIMING_BUCKETS];
+ } rbdimmer_histogram_t;
+ 
+ // Hot-path timing of one phase (CONFIG_RBDIMMER_INSTRUMENT)
+ typedef struct {
+     rbdimmer_histogram_t zc_latency_us;    // Latched edge → ISR entry (capture input only)
+     rbdimmer_histogram_t zc_jitter_us;     // |edge interval − tracked half-cycle|
+     rbdimmer_histogram_t zc_isr_cycles;    // Zero-cross ISR run time, CPU cycles
+     rbdimmer_histogram_t fire_late_us;     // Gate on: actual − scheduled time
+     rbdimmer_histogram_t release_late_us;  // Gate off: actual − scheduled time
+ } rbdimmer_timing_stats_t;
+ 
  // Public configuration structure
  typedef struct {
      uint8_t gpio_pin;                 // Output signal pin
      uint8_t phase;                    // Phase number (for multi-phase systems)
      uint8_t initial_level;            // Initial level percentage (0-100)
      rbdimmer_curve_t curve_type;      // Level curve type
+     rbdimmer_output_t output;         // Gate pulse generator (0 = software timers)
+     rbdimmer_mode_t mode;             // Firing mode (0 = phase angle)
+     uint16_t soft_start_half_cycles;  // Inrush ramp when leaving OFF (0 = off)
+     rbdimmer_gate_t gate;             // Gate drive (0 = single pulse)
+     uint16_t pulse_width_us;          // Gate pulse width (0 = RBDIMMER_DEFAULT_PULSE_WIDTH_US)
  } rbdimmer_config_t;
  
+ // Phase group: one logical load on several lines (e.g. a 3-phase heater bank)
+ typedef struct rbdimmer_group_s rbdimmer_group_t;
+ 
+ #define RBDIMMER_GROUP_MAX_MEMBERS 6          // Members per group
+ #define RBDIMMER_GROUP_PHASE_INFER 0xFF       // Member line has no detector of its own
+ 
+ typedef struct {
+     uint8_t  gpio_pin;                // Gate pin of this member
+     uint8_t  phase;                   // Detector of the member's line, or RBDIMMER_GROUP_PHASE_INFER
+     uint16_t lag_deg;                 // Inferred lines: lag behind the reference line, 0 … 359°
+                                       // (0 = 120° × member index)
+ } rbdimmer_group_member_t;
+ 
+ typedef struct {
+     uint8_t reference_phase;          // Detector the inferred members are timed from
+     uint8_t member_count;             // 1 … RBDIMMER_GROUP_MAX_MEMBERS
+     rbdimmer_group_member_t members[RBDIMMER_GROUP_MAX_MEMBERS];
+     uint8_t initial_level;            // Initial level percentage (0-100)
+     rbdimmer_curve_t curve_type;      // Level curve of every member
+     uint16_t stagger_us;              // Spacing of members that would fire together (0 = off)
+ } rbdimmer_group_config_t;
+ 
  /**
   * @brief Initialize the RBDimmer library
   * 
@@ -111,6 +273,22 @@
   */
  rbdimmer_err_t rbdimmer_init(void);
  
+ /**
+  * @brief Choose the core and interrupt priority of the real-time work
+  *
+  * Overrides CONFIG_RBDIMMER_RT_CORE / CONFIG_RBDIMMER_RT_INTR_PRIORITY
+  * (the only way to set them in Arduino builds).  Applies to the
+  * zero-cross interrupt, the GPTimer scheduler interrupt and the fade
+  * engine task.  Call before rbdimmer_init(); interrupts and the task
+  * keep the placement they were created with.
+  *
+  * @param core Core index, or -1 to leave the work unpinned
+  * @param intr_priority Interrupt level 1-3, or 0 for the driver default
+  * @return RBDIMMER_OK, or RBDIMMER_ERR_INVALID_ARG for a core this build
+  *         cannot use or a level above 3
+  */
+ rbdimmer_err_t rbdimmer_set_rt_affinity(int8_t core, uint8_t intr_priority);
+ 
  /**
   * @brief Register a zero-cross detector
   * 
@@ -124,6 +302,31 @@
  /**
   * @brief Create a dimmer channel
   * 
+  * RBDIMMER_MODE_BURST channels (resistive loads such as heaters) do not
+  * phase-cut: the level is the share of whole mains cycles that conduct.
+  * The zero-cross ISR switches the gate on at the crossing and holds it for
+  * both half-cycles of a conducting cycle; the curve does not apply and no
+  * timer is armed.  Burst channels of a phase are spread over the cycles.
+  * Requires RBDIMMER_OUTPUT_TIMER.
+  *
+  * RBDIMMER_MODE_TRAILING channels drive MOSFET / IGBT stages in reverse
+  * phase: the gate goes on at the crossing and off at the cut-off, which
+  * the curves give as the mirror of the leading-edge angle (same power).
+  * The zero-cross ISR raises the gate, so a firing costs one timer event
+  * (the cut-off) instead of two.  Works with both outputs;
+  * rbdimmer_set_level_transition_zc() and soft start use the fade engine.
+  *
+  * Drivers that do not latch on a short pulse (many leading-edge LED
+  * drivers) take RBDIMMER_GATE_HOLD, which keeps the gate on until
+  * RBDIMMER_GATE_HOLD_GUARD_US before the next crossing, or
+  * RBDIMMER_GATE_TRAIN, which repeats the pulse over the same span.  Either
+  * costs no more timer events than a pulse: the release is one event at a
+  * later time, the train is stepped by the GPTimer scheduler.  TRAIN needs
+  * the GPTimer backend and RBDIMMER_OUTPUT_TIMER; pulse_width_us (up to
+  * RBDIMMER_PULSE_WIDTH_MAX_US) must then be below
+  * RBDIMMER_GATE_TRAIN_PERIOD_US.  Burst-fire and trailing-edge channels
+  * ignore both fields.
+  * 
   * @param config Configuration structure with channel parameters
   * @param channel Pointer to store the created channel handle
   * @return RBDIMMER_OK if successful, otherwise an error code
@@ -139,6 +342,19 @@
   */
  rbdimmer_err_t rbdimmer_set_level(rbdimmer_channel_t* channel, uint8_t level_percent);
  
+ /**
+  * @brief Set channel level with 16-bit resolution
+  * 
+  * The curve tables are interpolated between entries, so consecutive levels
+  * give distinct firing delays (~0.15 µs per step at 50 Hz) instead of the
+  * 100 µs steps of the percent API.  rbdimmer_set_level() maps onto this call.
+  * 
+  * @param channel Channel handle
+  * @param level_q16 Level 0 (off) … RBDIMMER_LEVEL_Q16_MAX (full)
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_set_level_q16(rbdimmer_channel_t* channel, uint16_t level_q16);
+ 
  /**
   * @brief Set channel level with smooth transition
   * 
@@ -149,6 +365,44 @@
   */
  rbdimmer_err_t rbdimmer_set_level_transition(rbdimmer_channel_t* channel, uint8_t level_percent, uint32_t transition_ms);
  
+ /**
+  * @brief Set channel level with a transition that follows an easing profile
+  * 
+  * Same fade engine as rbdimmer_set_level_transition() (which is this call
+  * with RBDIMMER_EASING_LINEAR), but with a 16-bit target and the progress
+  * of each step mapped through @p easing.  Easing is integer-only — no FPU
+  * use, constant cost per step on every chip.
+  * 
+  * @param channel Channel handle
+  * @param level_q16 Target level 0 … RBDIMMER_LEVEL_Q16_MAX
+  * @param transition_ms Transition time in milliseconds
+  * @param easing Progress profile
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_set_level_transition_eased(rbdimmer_channel_t* channel, uint16_t level_q16, uint32_t transition_ms, rbdimmer_easing_t easing);
+ 
+ /**
+  * @brief Fade to a level in lock-step with the mains, one step per half-cycle
+  * 
+  * The zero-cross ISR moves the firing delay once per half-cycle along a
+  * straight line from the current delay to the target, so every half-cycle
+  * gets a new angle and none gets two.  No task wakes up while the fade
+  * runs.  Any other level, curve or active-state call stops the fade.
+  * A transition shorter than one half-cycle is applied immediately.
+  * MCPWM-output channels fall back to rbdimmer_set_level_transition().
+  * 
+  * rbdimmer_get_level_q16() reports the target as soon as the fade starts.
+  * Start and stop are posted to a per-phase command queue that the ISR
+  * drains at the next crossing; while a fade runs, the calls that stop it
+  * return RBDIMMER_ERR_TIMER_FAILED if the queue stays full (no mains).
+  * 
+  * @param channel Channel handle
+  * @param level_q16 Target level 0 … RBDIMMER_LEVEL_Q16_MAX
+  * @param transition_ms Transition time in milliseconds
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_set_level_transition_zc(rbdimmer_channel_t* channel, uint16_t level_q16, uint32_t transition_ms);
+ 
  /**
   * @brief Set level curve type
   * 
@@ -158,6 +412,51 @@
   */
  rbdimmer_err_t rbdimmer_set_curve(rbdimmer_channel_t* channel, rbdimmer_curve_t curve_type);
  
+ /**
+  * @brief Register a custom curve from a breakpoint table
+  * 
+  * The breakpoints are read once and expanded into a dense delay table; the
+  * array may be const (flash) and need not outlive the call.  Levels must be
+  * strictly increasing; below the first / above the last breakpoint the
+  * curve is flat.  One registered curve can be assigned to any number of
+  * channels.  Curves stay registered until rbdimmer_deinit().
+  * 
+  * @param points Breakpoint table
+  * @param count Number of breakpoints (2 … RBDIMMER_CUSTOM_CURVE_MAX_POINTS)
+  * @param curve Pointer to store the curve handle
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_register_custom_curve(const rbdimmer_curve_point_t* points, uint8_t count, rbdimmer_custom_curve_t* curve);
+ 
+ /**
+  * @brief Assign a registered custom curve to a channel
+  * 
+  * Also switches the channel to RBDIMMER_CURVE_CUSTOM.  A channel set to
+  * RBDIMMER_CURVE_CUSTOM without an assigned curve behaves as LINEAR.
+  * 
+  * @param channel Channel handle
+  * @param curve Handle from rbdimmer_register_custom_curve()
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_set_custom_curve(rbdimmer_channel_t* channel, rbdimmer_custom_curve_t curve);
+ 
+ /**
+  * @brief Set the soft-start ramp of a channel
+  * 
+  * A phase-angle channel that leaves OFF — a level from 0, re-enable with
+  * rbdimmer_set_active(), creation at a non-zero level — does not jump to
+  * its angle: the zero-cross ISR moves the delay from the end of the
+  * half-cycle to the target over @p half_cycles half-cycles, which spreads
+  * the inrush of cold filaments and transformers.  A level change during
+  * the ramp continues it from the current angle.  No task is involved.
+  * Ignored for burst-fire and MCPWM-output channels.
+  * 
+  * @param channel Channel handle
+  * @param half_cycles Ramp length (0 = off)
+  * @return RBDIMMER_OK or RBDIMMER_ERR_INVALID_ARG
+  */
+ rbdimmer_err_t rbdimmer_set_soft_start(rbdimmer_channel_t* channel, uint16_t half_cycles);
+ 
  /**
   * @brief Enable or disable a channel
   * 
@@ -175,6 +474,14 @@
   */
  uint8_t rbdimmer_get_level(rbdimmer_channel_t* channel);
  
+ /**
+  * @brief Get current channel level with 16-bit resolution
+  * 
+  * @param channel Channel handle
+  * @return Current level 0 … RBDIMMER_LEVEL_Q16_MAX
+  */
+ uint16_t rbdimmer_get_level_q16(rbdimmer_channel_t* channel);
+ 
  /**
   * @brief Get measured mains frequency for specified phase
   * 
@@ -183,6 +490,120 @@
   */
  uint16_t rbdimmer_get_frequency(uint8_t phase);
  
+ /**
+  * @brief Get the tracked mains frequency in 0.01 Hz units
+  * 
+  * The zero-cross ISR refines the half-cycle estimate on every edge, so this
+  * follows generator / weak-grid drift.
+  * 
+  * @param phase Phase number
+  * @return Frequency × 100 (e.g. 4987 = 49.87 Hz), or 0 if not measured yet
+  */
+ uint16_t rbdimmer_get_frequency_centihz(uint8_t phase);
+ 
+ /**
+  * @brief Compensate the fixed edge offset of a zero-cross detector
+  * 
+  * Many detector modules switch before or after the true zero-crossing
+  * (optocoupler threshold, RC filter).  Firing delays are counted from the
+  * edge minus this offset.
+  * 
+  * @param phase Phase number
+  * @param offset_us Detector edge time minus true crossing, -2000 … 2000 µs
+  *                  (positive: edge arrives late)
+  * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND or RBDIMMER_ERR_INVALID_ARG
+  */
+ rbdimmer_err_t rbdimmer_set_zero_cross_offset(uint8_t phase, int16_t offset_us);
+ 
+ /**
+  * @brief Calibrate positive/negative half-cycle asymmetry of a detector
+  * 
+  * Like rbdimmer_set_zero_cross_offset(), but with one offset per half-cycle
+  * polarity.  In HALF_WAVE mode the detector edge starts the positive
+  * half-cycle; in the other modes polarity alternates from the first
+  * crossing after rbdimmer_set_zero_cross_edge() — swap the values if the
+  * measurement shows the opposite.
+  * 
+  * @param phase Phase number
+  * @param positive_us Offset of crossings into the positive half-cycle, -2000 … 2000 µs
+  * @param negative_us Offset of crossings into the negative half-cycle, -2000 … 2000 µs
+  * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND or RBDIMMER_ERR_INVALID_ARG
+  */
+ rbdimmer_err_t rbdimmer_set_zero_cross_half_offsets(uint8_t phase, int16_t positive_us,
+                                                      int16_t negative_us);
+ 
+ /**
+  * @brief Select which detector edges mark a zero-crossing
+  * 
+  * RISING (default) and FALLING take one edge per crossing.  BOTH captures
+  * both edges of a pulse detector and uses the pulse centre.  HALF_WAVE is
+  * for detectors with one pulse per mains period: the opposite crossing is
+  * synthesised one tracked half-cycle after each edge.  Frequency
+  * acquisition restarts.  Set the mode before creating MCPWM channels on
+  * the phase; those sync on the falling edge for FALLING, rising otherwise.
+  * 
+  * @param phase Phase number
+  * @param edge Edge mode
+  * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND, RBDIMMER_ERR_INVALID_ARG,
+  *         RBDIMMER_ERR_TIMER_FAILED or RBDIMMER_ERR_GPIO_FAILED
+  */
+ rbdimmer_err_t rbdimmer_set_zero_cross_edge(uint8_t phase, rbdimmer_edge_t edge);
+ 
+ /**
+  * @brief Read the zero-cross edge counters of a phase
+  * 
+  * A rising rejected count points at a noisy detector; synthesized is only
+  * non-zero with CONFIG_RBDIMMER_ZC_FILTER, when the watchdog had to stand
+  * in for a missing edge.  missed counts gate pulses that never happened
+  * because their timer had not run by the next crossing (since
+  * rbdimmer_init()).
+  * 
+  * @param phase Phase number
+  * @param stats Receives the counters
+  * @return RBDIMMER_OK, RBDIMMER_ERR_NOT_FOUND or RBDIMMER_ERR_INVALID_ARG
+  */
+ rbdimmer_err_t rbdimmer_get_zero_cross_stats(uint8_t phase, rbdimmer_zc_stats_t* stats);
+ 
+ /**
+  * @brief Snapshot the hot-path timing histograms of a phase
+  * 
+  * Lock-free: the ISRs keep recording while the snapshot is taken, and the
+  * copy is consistent per block.  Only available with
+  * CONFIG_RBDIMMER_INSTRUMENT; the histograms count from registration or
+  * the last rbdimmer_reset_timing_stats().
+  * 
+  * @param phase Phase number
+  * @param stats Receives the histograms
+  * @return RBDIMMER_OK or RBDIMMER_ERR_INVALID_ARG (also when disabled)
+  */
+ rbdimmer_err_t rbdimmer_get_timing_stats(uint8_t phase, rbdimmer_timing_stats_t* stats);
+ 
+ /**
+  * @brief Clear the timing histograms of a phase
+  * 
+  * The ISRs apply the reset with their next sample.
+  * 
+  * @param phase Phase number
+  * @return RBDIMMER_OK or RBDIMMER_ERR_INVALID_ARG (also when disabled)
+  */
+ rbdimmer_err_t rbdimmer_reset_timing_stats(uint8_t phase);
+ 
+ /**
+  * @brief Write the calibration and channel state to NVS now
+  * 
+  * With CONFIG_RBDIMMER_PERSIST the tracked half-cycle and detector offsets
+  * of every phase and the level and curve of every channel are stored in
+  * NVS once they have been stable for CONFIG_RBDIMMER_PERSIST_INTERVAL_MS.
+  * rbdimmer_register_zero_cross() and rbdimmer_create_channel() start from
+  * the stored values.  Call this before a planned restart (OTA update) so a
+  * change from the last interval is not lost; rbdimmer_deinit() does too.
+  * Task context; nvs_flash_init() must have been called.
+  * 
+  * @return RBDIMMER_OK, RBDIMMER_ERR_NO_MEMORY (NVS write failed) or
+  *         RBDIMMER_ERR_INVALID_ARG (disabled, or NVS not available)
+  */
+ rbdimmer_err_t rbdimmer_persist_flush(void);
+ 
  /**
   * @brief Set callback function for zero-cross events
   * 
@@ -200,6 +621,61 @@
   */
  rbdimmer_err_t rbdimmer_update_all(void);
  
+ /**
+  * @brief Open a batch of level / curve changes
+  * 
+  * Changes staged with rbdimmer_batch_set_*() are only recorded.
+  * rbdimmer_batch_commit() computes all delays in one pass and publishes one
+  * schedule per phase, so every channel of a phase switches at the same
+  * zero-crossing — no ripple across a scene.  Only one batch can be open;
+  * a second task blocks here until the first commits.
+  * 
+  * @return RBDIMMER_OK, or RBDIMMER_ERR_ALREADY_EXIST if this task already
+  *         has a batch open
+  */
+ rbdimmer_err_t rbdimmer_batch_begin(void);
+ 
+ /**
+  * @brief Stage a level change in the open batch
+  * 
+  * @param channel Channel handle
+  * @param level_percent Level percentage (0-100)
+  * @return RBDIMMER_OK, or RBDIMMER_ERR_INVALID_ARG if the calling task has
+  *         no batch open
+  */
+ rbdimmer_err_t rbdimmer_batch_set_level(rbdimmer_channel_t* channel, uint8_t level_percent);
+ 
+ /**
+  * @brief Stage a 16-bit level change in the open batch
+  * 
+  * @param channel Channel handle
+  * @param level_q16 Level 0 … RBDIMMER_LEVEL_Q16_MAX
+  * @return RBDIMMER_OK, or RBDIMMER_ERR_INVALID_ARG if the calling task has
+  *         no batch open
+  */
+ rbdimmer_err_t rbdimmer_batch_set_level_q16(rbdimmer_channel_t* channel, uint16_t level_q16);
+ 
+ /**
+  * @brief Stage a curve change in the open batch
+  * 
+  * @param channel Channel handle
+  * @param curve_type Curve type
+  * @return RBDIMMER_OK, or RBDIMMER_ERR_INVALID_ARG if the calling task has
+  *         no batch open
+  */
+ rbdimmer_err_t rbdimmer_batch_set_curve(rbdimmer_channel_t* channel, rbdimmer_curve_t curve_type);
+ 
+ /**
+  * @brief Apply all staged changes and close the batch
+  * 
+  * Cancels running transitions of the staged channels, recalculates their
+  * delays under one lock and publishes each affected phase once.
+  * 
+  * @return RBDIMMER_OK, or RBDIMMER_ERR_INVALID_ARG if the calling task has
+  *         no batch open
+  */
+ rbdimmer_err_t rbdimmer_batch_commit(void);
+ 
  /**
   * @brief Delete a dimmer channel and release resources
   * 
@@ -208,6 +684,125 @@
   */
  rbdimmer_err_t rbdimmer_delete_channel(rbdimmer_channel_t* channel);
  
+ /**
+  * @brief Get the generation-checked id of a channel
+  * 
+  * Channels live in a static pool, so a deleted channel's handle may later
+  * point at a new channel.  Code that keeps channel references across
+  * deletion (UI state, network commands) should store the id instead.
+  * 
+  * @param channel Channel handle
+  * @return Channel id, or RBDIMMER_CHANNEL_ID_NONE for an invalid handle
+  */
+ rbdimmer_channel_id_t rbdimmer_get_channel_id(rbdimmer_channel_t* channel);
+ 
+ /**
+  * @brief Resolve a channel id
+  * 
+  * @param id Id from rbdimmer_get_channel_id()
+  * @return Channel handle, or NULL if the channel was deleted
+  */
+ rbdimmer_channel_t* rbdimmer_get_channel_by_id(rbdimmer_channel_id_t id);
+ 
+ /**
+  * @brief Find the channel driving a gate GPIO
+  * 
+  * @param gpio_pin Output pin
+  * @return Channel handle, or NULL if no channel uses the pin
+  */
+ rbdimmer_channel_t* rbdimmer_get_channel_by_gpio(uint8_t gpio_pin);
+ 
+ /**
+  * @brief Create a phase group: one level for the channels of several lines
+  * 
+  * Creates one software-output channel per member.  A member with its own
+  * detector fires from it; an inferred member (RBDIMMER_GROUP_PHASE_INFER)
+  * fires from the reference detector, shifted by its line lag and the
+  * tracked half-cycle.  Members firing from the same detector at the same
+  * lag are spread by stagger_us around the level's delay so their TRIACs do
+  * not switch at one instant.  Every level change recomputes all members in
+  * one pass and publishes each detector phase once.
+  * 
+  * @param config Member list, reference phase, level, curve and stagger
+  * @param group Pointer to store the group handle
+  * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG, RBDIMMER_ERR_NOT_FOUND
+  *         (detector not registered), RBDIMMER_ERR_NO_MEMORY (group or
+  *         channel pool full) or a rbdimmer_create_channel() error
+  */
+ rbdimmer_err_t rbdimmer_group_create(const rbdimmer_group_config_t* config, rbdimmer_group_t** group);
+ 
+ /**
+  * @brief Delete a phase group and its member channels
+  * 
+  * @param group Group handle
+  * @return RBDIMMER_OK or RBDIMMER_ERR_INVALID_ARG
+  */
+ rbdimmer_err_t rbdimmer_group_delete(rbdimmer_group_t* group);
+ 
+ /**
+  * @brief Set the level of every member of a group
+  * 
+  * @param group Group handle
+  * @param level_percent Level percentage (0-100)
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_group_set_level(rbdimmer_group_t* group, uint8_t level_percent);
+ 
+ /**
+  * @brief Set the level of every member of a group with 16-bit resolution
+  * 
+  * @param group Group handle
+  * @param level_q16 Level 0 … RBDIMMER_LEVEL_Q16_MAX
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_group_set_level_q16(rbdimmer_group_t* group, uint16_t level_q16);
+ 
+ /**
+  * @brief Enable or disable every member of a group
+  * 
+  * @param group Group handle
+  * @param active true to enable, false to disable
+  * @return RBDIMMER_OK if successful, otherwise an error code
+  */
+ rbdimmer_err_t rbdimmer_group_set_active(rbdimmer_group_t* group, bool active);
+ 
+ /**
+  * @brief Get the level of a group
+  * 
+  * @param group Group handle
+  * @return Level 0 … RBDIMMER_LEVEL_Q16_MAX (0 for an invalid handle)
+  */
+ uint16_t rbdimmer_group_get_level_q16(rbdimmer_group_t* group);
+ 
+ /**
+  * @brief Get the channel of a group member
+  * 
+  * For per-member queries (rbdimmer_get_delay()) and diagnostics.  Level,
+  * curve and active calls on it bypass the group.
+  * 
+  * @param group Group handle
+  * @param member Member index as in rbdimmer_group_config_t.members
+  * @return Channel handle, or NULL
+  */
+ rbdimmer_channel_t* rbdimmer_group_get_channel(rbdimmer_group_t* group, uint8_t member);
+ 
+ /**
+  * @brief Lag of a member's line behind the reference line
+  * 
+  * Measured from the last crossings of both detectors (detector offsets
+  * removed) for members with their own detector, the configured lag for
+  * inferred members.  A detector cannot tell the half-cycle polarity, so
+  * the lag is reported modulo 180°: a correctly wired L2 / L3 reads 120 /
+  * 60, swapped rotation reads 60 / 120.
+  * 
+  * @param group Group handle
+  * @param member Member index
+  * @param lag_deg Receives the lag, 0 … 179°
+  * @return RBDIMMER_OK, RBDIMMER_ERR_INVALID_ARG or RBDIMMER_ERR_NOT_FOUND
+  *         (no crossing seen yet)
+  */
+ rbdimmer_err_t rbdimmer_group_get_phase_lag(rbdimmer_group_t* group, uint8_t member, uint16_t* lag_deg);
+ 
  /**
   * @brief Deinitialize the RBDimmer library
   * 
@@ -0,0 +1,137 @@
+/**
+ * @file bench.c
+ * @brief Zero-cross ISR cost and firing accuracy versus channel count
+ *
+ * Usage: sim_bench_<variant> [--quick]
+ *
+ * For 1 … 24 channels on one phase (levels spread over the half-cycle,
+ * 0 … 10 µs ISR latency) prints:
+ *   - zero-cross ISR host time, median / p99 (ns) — relative cost only: the
+ *     host is not an Xtensa core, compare variants and channel counts
+ *   - firing-angle error against the true crossing, mean / max (µs)
+ *   - GPIO writes per half-cycle (gate batching)
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbdimmerESP32.h"
+#include "sim.h"
+
+#define ZC_PIN     4
+
+// 24 output-capable pins (ESP32: GPIO 34-39 are input-only)
+static const uint8_t gate_pins[] = {
+    2, 5, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21,
+    22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33,
+};
+
+typedef struct {
+    int channels;
+    int64_t measure_us;
+    int ok;
+} bench_run_t;
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_main(void* arg) {
+    bench_run_t* run = (bench_run_t*)arg;
+    rbdimmer_channel_t* ch[RBDIMMER_MAX_CHANNELS];
+
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 50.0, .phase_us = 1000,
+        .latency_min_us = 0, .latency_max_us = 10,
+    };
+    int src = sim_add_zc_source(&mains);
+    if (rbdimmer_init() != RBDIMMER_OK ||
+        rbdimmer_register_zero_cross(ZC_PIN, 0, 50) != RBDIMMER_OK) {
+        return;
+    }
+    for (int i = 0; i < run->channels; i++) {
+        rbdimmer_config_t cfg = {
+            .gpio_pin      = gate_pins[i],
+            .phase         = 0,
+            .initial_level = (uint8_t)(10 + (80 * i) / run->channels),
+            .curve_type    = RBDIMMER_CURVE_LINEAR,
+        };
+        if (rbdimmer_create_channel(&cfg, &ch[i]) != RBDIMMER_OK) {
+            return;
+        }
+    }
+    sim_run_for(1500000);
+
+    size_t isr_from;
+    sim_zc_isr_ns(&isr_from);
+    uint64_t writes_from = sim_gate_writes();
+    int64_t from = sim_now();
+    sim_run_for(run->measure_us);
+    int64_t to = sim_now() - 20000;
+
+    // ISR host time over the measurement window
+    size_t isr_n;
+    const uint32_t* isr = sim_zc_isr_ns(&isr_n);
+    size_t n = isr_n - isr_from;
+    uint32_t* sorted = malloc(n * sizeof(uint32_t));
+    memcpy(sorted, isr + isr_from, n * sizeof(uint32_t));
+    qsort(sorted, n, sizeof(uint32_t), cmp_u32);
+
+    // Firing-angle error of every gate pulse
+    size_t cross_n;
+    const int64_t* cross = sim_zc_crossings(src, &cross_n);
+    double sum = 0.0, worst = 0.0;
+    size_t pulses = 0;
+    for (int i = 0; i < run->channels; i++) {
+        size_t pn;
+        const sim_pulse_t* p = sim_gate_pulses(gate_pins[i], &pn);
+        uint32_t delay = rbdimmer_get_delay(ch[i]);
+        for (size_t k = 0; k < pn; k++) {
+            if (p[k].rise < from || p[k].rise >= to) {
+                continue;
+            }
+            double err = (double)(p[k].rise - cross[sim_crossing_before(src, p[k].rise)]) - delay;
+            sum += err;
+            worst = fmax(worst, fabs(err));
+            pulses++;
+        }
+    }
+    long halves = sim_crossing_before(src, to) - sim_crossing_before(src, from);
+
+    printf("%8d  %10u  %10u  %10.2f  %9.1f  %12.1f\n",
+           run->channels, n ? sorted[n / 2] : 0, n ? sorted[(n * 99) / 100] : 0,
+           pulses ? sum / (double)pulses : 0.0, worst,
+           halves > 0 ? (double)(sim_gate_writes() - writes_from) / (double)halves : 0.0);
+    free(sorted);
+
+    run->ok = pulses + (size_t)run->channels * 2 >= (size_t)(halves * run->channels);
+    rbdimmer_deinit();
+}
+
+int main(int argc, char** argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    static const int full[]  = { 1, 2, 4, 8, 16, 24 };
+    static const int short_[] = { 1, 8 };
+    const int* counts = quick ? short_ : full;
+    size_t runs = quick ? 2 : sizeof(full) / sizeof(full[0]);
+
+    printf("[%s] zero-cross ISR cost and firing accuracy\n", SIM_VARIANT);
+    printf("channels  isr p50 ns  isr p99 ns  err mean us  err max us  writes/half\n");
+    int failed = 0;
+    for (size_t i = 0; i < runs; i++) {
+        if (counts[i] > RBDIMMER_MAX_CHANNELS ||
+            counts[i] > (int)sizeof(gate_pins)) {
+            continue;
+        }
+        bench_run_t run = { counts[i], quick ? 500000 : 5000000, 0 };
+        sim_reset(42);
+        if (sim_main(bench_main, &run) != 0 || !run.ok) {
+            printf("%8d  run failed\n", counts[i]);
+            failed = 1;
+        }
+    }
+    return failed;
+}
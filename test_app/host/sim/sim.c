@@ -0,0 +1,1490 @@
+/**
+ * @file sim.c
+ * @brief Virtual clock, event loop and ESP-IDF / FreeRTOS stand-ins
+ *
+ * Event order at one instant: zero-cross edges, then GPTimer alarms and
+ * esp_timer expiries by arm order, then task wake-ups.  After every event
+ * all ready tasks run (highest priority first) until they block again.
+ */
+
+#define _GNU_SOURCE
+#include "sim.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "driver/gpio.h"
+#include "driver/gptimer.h"
+#include "driver/mcpwm_prelude.h"
+#include "esp_cpu.h"
+#include "esp_intr_alloc.h"
+#include "esp_ipc.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#include "soc/soc_caps.h"
+
+#define SIM_MAX_TASKS     16
+#define SIM_MAX_TIMERS    256
+#define SIM_MAX_GPTIMERS  4
+#define SIM_CAP_CHANNELS  (SOC_MCPWM_GROUPS * SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER)
+// ESP32 capture timers count APB (80 MHz) whatever resolution_hz asks for.
+#define SIM_CAP_RESOLUTION_HZ  80000000u
+// Count at the first start: wraps ~3.4 s in at 80 MHz
+#define SIM_CAP_COUNT_START    0xF0000000u
+#define SIM_NVS_ENTRIES   8
+#define SIM_NVS_BLOB_MAX  4000
+#define SIM_PINS          GPIO_NUM_MAX
+#define SIM_CORES         SOC_CPU_CORES_NUM
+#define SIM_TASK_STACK    (256 * 1024)
+#define SIM_FOREVER       INT64_MAX
+
+static void sim_fatal(const char* msg) {
+    fprintf(stderr, "sim: %s\n", msg);
+    abort();
+}
+
+// ---------------------------------------------------------------------------
+// Growable arrays
+// ---------------------------------------------------------------------------
+
+#define VEC(type) struct { type* v; size_t n; size_t cap; }
+
+#define VEC_PUSH(vec, item) do {                                          \
+        if ((vec).n == (vec).cap) {                                       \
+            (vec).cap = (vec).cap ? (vec).cap * 2 : 256;                  \
+            (vec).v = realloc((vec).v, (vec).cap * sizeof(*(vec).v));     \
+            if ((vec).v == NULL) sim_fatal("out of memory");              \
+        }                                                                 \
+        (vec).v[(vec).n++] = (item);                                      \
+    } while (0)
+
+#define VEC_FREE(vec) do { free((vec).v); (vec).v = NULL; (vec).n = (vec).cap = 0; } while (0)
+
+// ---------------------------------------------------------------------------
+// State
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    TASK_FREE,
+    TASK_READY,
+    TASK_DELAYED,       // wake at wake_us
+    TASK_NOTIFY_WAIT,   // until notified or wake_us
+    TASK_MUTEX_WAIT,    // until the mutex is handed over or wake_us
+    TASK_DONE,
+} task_state_t;
+
+struct sim_task {
+    ucontext_t ctx;
+    void* stack;
+    TaskFunction_t fn;
+    void* arg;
+    const char* name;
+    UBaseType_t priority;
+    int core;           // pinned core, -1 = no affinity
+    task_state_t state;
+    int64_t wake_us;
+    uint64_t ready_seq;
+    uint32_t notify;
+    struct sim_mutex* waiting;
+};
+
+struct sim_mutex {
+    struct sim_task* owner;
+};
+
+struct esp_timer {
+    esp_timer_cb_t cb;
+    void* arg;
+    esp_timer_dispatch_t dispatch;
+    bool armed;
+    bool queued;        // task dispatch: expired, waiting for the esp_timer task
+    int64_t due_us;
+    uint64_t seq;
+};
+
+struct gptimer_t {
+    bool in_use;
+    bool enabled;
+    bool running;
+    int64_t base_us;    // simulated time of count 0
+    uint64_t stopped_count;
+    gptimer_alarm_cb_t cb;
+    void* user;
+    bool alarm_armed;
+    uint64_t alarm_count;
+    int64_t fire_us;
+    uint64_t seq;
+    sim_intr_t intr;    // set when the callback (interrupt) is registered
+};
+
+struct mcpwm_cap_timer_t {
+    bool in_use;
+    bool enabled;
+    bool running;
+    uint32_t resolution_hz;
+    int64_t base_us;    // simulated time of base_count
+    uint32_t base_count;
+};
+
+struct mcpwm_cap_channel_t {
+    bool in_use;
+    bool enabled;
+    struct mcpwm_cap_timer_t* timer;
+    uint8_t pin;
+    bool pos_edge;
+    bool neg_edge;
+    mcpwm_capture_event_cb_t cb;
+    void* user;
+    sim_intr_t intr;    // set when the callback (interrupt) is registered
+};
+
+typedef struct {
+    int64_t at_us;      // dispatch time (edge + ISR latency)
+    int64_t edge_us;    // edge time (what a capture channel latches)
+    uint8_t level;
+} zc_edge_t;
+
+typedef struct {
+    sim_zc_source_t cfg;
+    double next_cross_us;
+    uint64_t crossings_made;
+    zc_edge_t queue[8];
+    int q_head;
+    int q_len;
+    int64_t last_at_us;
+    VEC(int64_t) crossings;
+} zc_gen_t;
+
+typedef struct {
+    gpio_isr_t handler;
+    void* arg;
+    gpio_int_type_t intr_type;
+    bool intr_enabled;
+    uint8_t in_level;
+    uint8_t out_level;
+    VEC(sim_pulse_t) pulses;
+} sim_pin_t;
+
+static int64_t now_us;
+static uint64_t seq_counter;
+static uint64_t rng_state = 1;
+
+static struct sim_task tasks[SIM_MAX_TASKS];
+static struct sim_task* current;          // NULL = scheduler / interrupt context
+static struct sim_task* main_task;
+static ucontext_t sched_ctx;
+
+static struct esp_timer* timers[SIM_MAX_TIMERS];
+static int timer_count;
+static struct sim_task* timer_task;       // runs ESP_TIMER_TASK callbacks
+static struct esp_timer* timer_queue[SIM_MAX_TIMERS];
+static int timer_queue_len;
+static uint32_t timer_lat_min, timer_lat_max;
+
+static struct gptimer_t gptimers[SIM_MAX_GPTIMERS];
+
+static struct mcpwm_cap_timer_t cap_timers[SOC_MCPWM_GROUPS];
+static struct mcpwm_cap_channel_t cap_channels[SIM_CAP_CHANNELS];
+static uint32_t cap_resolution_hz;
+
+static zc_gen_t sources[SIM_MAX_SOURCES];
+static int source_count;
+
+static sim_pin_t pins[SIM_PINS];
+static bool isr_service;
+static sim_intr_t isr_service_intr;
+static int ipc_core = -1;                 // core of the running esp_ipc call
+static uint32_t ipc_calls;
+static uint64_t gate_writes;
+
+typedef struct {
+    char     ns[16];
+    char     key[16];
+    uint8_t  data[SIM_NVS_BLOB_MAX];
+    size_t   len;
+    bool     used;
+} sim_nvs_entry_t;
+
+static sim_nvs_entry_t nvs_entries[SIM_NVS_ENTRIES];
+static const char* nvs_handles[SIM_NVS_ENTRIES + 1];   // handle → namespace
+static uint32_t nvs_writes;
+static uint32_t nvs_commit_us;      // simulated flash program / erase per commit
+static bool nvs_ready;
+static VEC(uint32_t) isr_ns;
+
+// ---------------------------------------------------------------------------
+// Random numbers (xorshift64*, deterministic per seed)
+// ---------------------------------------------------------------------------
+
+static double rnd(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (double)((rng_state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+static uint32_t rnd_range(uint32_t lo, uint32_t hi) {
+    if (hi <= lo) {
+        return lo;
+    }
+    return lo + (uint32_t)(rnd() * (double)(hi - lo + 1));
+}
+
+// ---------------------------------------------------------------------------
+// Public setup
+// ---------------------------------------------------------------------------
+
+uint64_t sim_host_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void sim_reset(uint32_t seed) {
+    for (int i = 0; i < SIM_MAX_TASKS; i++) {
+        free(tasks[i].stack);
+    }
+    memset(tasks, 0, sizeof(tasks));
+    current = NULL;
+    main_task = NULL;
+    timer_task = NULL;
+    for (int i = 0; i < timer_count; i++) {
+        free(timers[i]);
+    }
+    timer_count = 0;
+    timer_queue_len = 0;
+    timer_lat_min = timer_lat_max = 0;
+    memset(gptimers, 0, sizeof(gptimers));
+    memset(cap_timers, 0, sizeof(cap_timers));
+    memset(cap_channels, 0, sizeof(cap_channels));
+    cap_resolution_hz = SIM_CAP_RESOLUTION_HZ;
+    for (int i = 0; i < source_count; i++) {
+        VEC_FREE(sources[i].crossings);
+    }
+    memset(sources, 0, sizeof(sources));
+    source_count = 0;
+    for (int i = 0; i < SIM_PINS; i++) {
+        VEC_FREE(pins[i].pulses);
+    }
+    memset(pins, 0, sizeof(pins));
+    isr_service = false;
+    memset(&isr_service_intr, 0, sizeof(isr_service_intr));
+    ipc_core = -1;
+    ipc_calls = 0;
+    gate_writes = 0;
+    memset(nvs_entries, 0, sizeof(nvs_entries));
+    memset(nvs_handles, 0, sizeof(nvs_handles));
+    nvs_writes = 0;
+    nvs_commit_us = 0;
+    nvs_ready = true;
+    VEC_FREE(isr_ns);
+    now_us = 0;
+    seq_counter = 0;
+    rng_state = 0x9E3779B97F4A7C15ULL ^ seed;
+    if (rng_state == 0) {
+        rng_state = 1;
+    }
+}
+
+int sim_add_zc_source(const sim_zc_source_t* src) {
+    if (source_count >= SIM_MAX_SOURCES || src->pin >= SIM_PINS || src->freq_hz <= 0) {
+        return -1;
+    }
+    zc_gen_t* g = &sources[source_count];
+    memset(g, 0, sizeof(*g));
+    g->cfg = *src;
+    if (g->cfg.pulse_width_us == 0) {
+        g->cfg.pulse_width_us = 300;
+    }
+    g->next_cross_us = src->phase_us;
+    return source_count++;
+}
+
+sim_zc_source_t* sim_zc_source(int src) {
+    return (src >= 0 && src < source_count) ? &sources[src].cfg : NULL;
+}
+
+void sim_set_capture_resolution(uint32_t hz) {
+    cap_resolution_hz = hz;
+}
+
+void sim_set_timer_latency(uint32_t min_us, uint32_t max_us) {
+    timer_lat_min = min_us;
+    timer_lat_max = max_us;
+}
+
+int64_t sim_now(void) {
+    return now_us;
+}
+
+// ---------------------------------------------------------------------------
+// Zero-cross generator
+// ---------------------------------------------------------------------------
+
+static void zc_push(zc_gen_t* g, int64_t edge_us, uint8_t level) {
+    int64_t at = edge_us + rnd_range(g->cfg.latency_min_us, g->cfg.latency_max_us);
+    if (at < g->last_at_us) {
+        at = g->last_at_us;         // interrupts are taken in order
+    }
+    g->last_at_us = at;
+    g->queue[(g->q_head + g->q_len) % 8] = (zc_edge_t){ at, edge_us, level };
+    g->q_len++;
+}
+
+// Generate the pulses of the next crossing (skipping dropped ones).
+static void zc_refill(zc_gen_t* g) {
+    while (g->q_len == 0) {
+        double t = g->next_cross_us;
+        double f = g->cfg.freq_hz + g->cfg.drift_hz_per_s * (t / 1e6);
+        double half = 1e6 / (2.0 * f);
+        int64_t cross = llround(t);
+        VEC_PUSH(g->crossings, cross);
+        g->next_cross_us = t + half;
+        g->crossings_made++;
+
+        bool drop = rnd() < g->cfg.dropout_rate ||
+                    (g->cfg.dropout_every > 0 &&
+                     g->crossings_made % g->cfg.dropout_every == 0);
+        if (!drop) {
+            int64_t rise = cross + g->cfg.edge_offset_us;
+            zc_push(g, rise, 1);
+            zc_push(g, rise + g->cfg.pulse_width_us, 0);
+        }
+        if (rnd() < g->cfg.glitch_rate) {
+            int64_t glitch = cross + llround(half * (0.35 + 0.5 * rnd()));
+            zc_push(g, glitch, 1);
+            zc_push(g, glitch + 20, 0);
+        }
+    }
+}
+
+static uint32_t cap_timer_count(const struct mcpwm_cap_timer_t* t, int64_t at_us);
+
+static void zc_dispatch(zc_gen_t* g) {
+    zc_edge_t e = g->queue[g->q_head];
+    g->q_head = (g->q_head + 1) % 8;
+    g->q_len--;
+
+    sim_pin_t* p = &pins[g->cfg.pin];
+    p->in_level = e.level;
+    bool fire = p->handler != NULL && p->intr_enabled &&
+                (p->intr_type == GPIO_INTR_ANYEDGE ||
+                 (p->intr_type == GPIO_INTR_POSEDGE && e.level) ||
+                 (p->intr_type == GPIO_INTR_NEGEDGE && !e.level));
+    if (fire) {
+        uint64_t t0 = sim_host_ns();
+        p->handler(p->arg);
+        uint64_t dt = sim_host_ns() - t0;
+        VEC_PUSH(isr_ns, (uint32_t)(dt > UINT32_MAX ? UINT32_MAX : dt));
+    }
+
+    // Capture channels latch the count at the edge, the ISR runs later
+    for (int i = 0; i < SIM_CAP_CHANNELS; i++) {
+        struct mcpwm_cap_channel_t* c = &cap_channels[i];
+        if (!c->in_use || !c->enabled || c->cb == NULL || c->pin != g->cfg.pin ||
+            !c->timer->running || !(e.level ? c->pos_edge : c->neg_edge)) {
+            continue;
+        }
+        mcpwm_capture_event_data_t edata = {
+            .cap_value = cap_timer_count(c->timer, e.edge_us),
+            .cap_edge  = e.level ? MCPWM_CAP_EDGE_POS : MCPWM_CAP_EDGE_NEG,
+        };
+        uint64_t t0 = sim_host_ns();
+        c->cb(c, &edata, c->user);
+        uint64_t dt = sim_host_ns() - t0;
+        VEC_PUSH(isr_ns, (uint32_t)(dt > UINT32_MAX ? UINT32_MAX : dt));
+    }
+}
+
+const int64_t* sim_zc_crossings(int src, size_t* count) {
+    if (src < 0 || src >= source_count) {
+        *count = 0;
+        return NULL;
+    }
+    *count = sources[src].crossings.n;
+    return sources[src].crossings.v;
+}
+
+long sim_crossing_before(int src, int64_t t) {
+    size_t n;
+    const int64_t* c = sim_zc_crossings(src, &n);
+    long lo = 0, hi = (long)n - 1, found = -1;
+    while (lo <= hi) {
+        long mid = (lo + hi) / 2;
+        if (c[mid] <= t) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+const uint32_t* sim_zc_isr_ns(size_t* count) {
+    *count = isr_ns.n;
+    return isr_ns.v;
+}
+
+// ---------------------------------------------------------------------------
+// GPIO matrix
+// ---------------------------------------------------------------------------
+
+static void pin_out(uint8_t pin, uint8_t level) {
+    if (pin >= SIM_PINS) {
+        return;
+    }
+    sim_pin_t* p = &pins[pin];
+    if (level && !p->out_level) {
+        VEC_PUSH(p->pulses, ((sim_pulse_t){ now_us, -1 }));
+    } else if (!level && p->out_level && p->pulses.n > 0) {
+        p->pulses.v[p->pulses.n - 1].fall = now_us;
+    }
+    p->out_level = level;
+}
+
+static void bank_write(int first_pin, uint32_t mask, uint8_t level) {
+    gate_writes++;
+    for (int bit = 0; bit < 32; bit++) {
+        if (mask & (1u << bit)) {
+            pin_out((uint8_t)(first_pin + bit), level);
+        }
+    }
+}
+
+void sim_reg_write(uint32_t reg, uint32_t value) {
+    switch (reg) {
+        case GPIO_OUT_W1TS_REG:  bank_write(0, value, 1);  break;
+        case GPIO_OUT_W1TC_REG:  bank_write(0, value, 0);  break;
+        case GPIO_OUT1_W1TS_REG: bank_write(32, value, 1); break;
+        case GPIO_OUT1_W1TC_REG: bank_write(32, value, 0); break;
+        default: sim_fatal("write to unmodelled register");
+    }
+}
+
+uint32_t sim_reg_read(uint32_t reg) {
+    int first = (reg == GPIO_IN_REG) ? 0 : (reg == GPIO_IN1_REG) ? 32 : -1;
+    if (first < 0) {
+        sim_fatal("read of unmodelled register");
+    }
+    uint32_t v = 0;
+    for (int bit = 0; bit < 32 && first + bit < SIM_PINS; bit++) {
+        v |= (uint32_t)pins[first + bit].in_level << bit;
+    }
+    return v;
+}
+
+const sim_pulse_t* sim_gate_pulses(uint8_t pin, size_t* count) {
+    if (pin >= SIM_PINS) {
+        *count = 0;
+        return NULL;
+    }
+    *count = pins[pin].pulses.n;
+    return pins[pin].pulses.v;
+}
+
+uint64_t sim_gate_writes(void) {
+    return gate_writes;
+}
+
+esp_err_t gpio_config(const gpio_config_t* config) {
+    for (int pin = 0; pin < SIM_PINS; pin++) {
+        if (config->pin_bit_mask & (1ULL << pin)) {
+            pins[pin].intr_type    = config->intr_type;
+            pins[pin].intr_enabled = config->intr_type != GPIO_INTR_DISABLE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    if (pin < 0 || pin >= SIM_PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gate_writes++;
+    pin_out((uint8_t)pin, level ? 1 : 0);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type) {
+    if (pin < 0 || pin >= SIM_PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pins[pin].intr_type = type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin) {
+    if (pin < 0 || pin >= SIM_PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pins[pin].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags) {
+    if (isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    isr_service = true;
+    isr_service_intr.core  = (int)xPortGetCoreID();
+    isr_service_intr.level = (flags & ESP_INTR_FLAG_LEVEL3) ? 3 :
+                             (flags & ESP_INTR_FLAG_LEVEL2) ? 2 :
+                             (flags & ESP_INTR_FLAG_LEVEL1) ? 1 : 0;
+    return ESP_OK;
+}
+
+void gpio_uninstall_isr_service(void) {
+    isr_service = false;
+    for (int pin = 0; pin < SIM_PINS; pin++) {
+        pins[pin].handler = NULL;
+    }
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void* arg) {
+    if (!isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (pin < 0 || pin >= SIM_PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pins[pin].handler = handler;
+    pins[pin].arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin) {
+    if (pin < 0 || pin >= SIM_PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pins[pin].handler = NULL;
+    return ESP_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Tasks
+// ---------------------------------------------------------------------------
+
+static void task_ready(struct sim_task* t) {
+    t->state = TASK_READY;
+    t->waiting = NULL;
+    t->ready_seq = ++seq_counter;
+}
+
+// Give the CPU back to the scheduler until the task is made ready again.
+static void task_block(void) {
+    if (current == NULL) {
+        sim_fatal("blocking call from interrupt context");
+    }
+    swapcontext(&current->ctx, &sched_ctx);
+}
+
+static void task_entry(void) {
+    current->fn(current->arg);
+    current->state = TASK_DONE;
+    swapcontext(&current->ctx, &sched_ctx);
+}
+
+static void task_context(struct sim_task* volatile t) {
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack;
+    t->ctx.uc_stack.ss_size = SIM_TASK_STACK;
+    t->ctx.uc_link = NULL;
+    makecontext(&t->ctx, task_entry, 0);
+}
+
+static struct sim_task* task_create(TaskFunction_t fn, const char* name, void* arg,
+                                    UBaseType_t priority) {
+    for (int i = 0; i < SIM_MAX_TASKS; i++) {
+        struct sim_task* t = &tasks[i];
+        if (t->state != TASK_FREE && t->state != TASK_DONE) {
+            continue;
+        }
+        if (t->stack == NULL) {
+            t->stack = malloc(SIM_TASK_STACK);
+            if (t->stack == NULL) {
+                return NULL;
+            }
+        }
+        task_context(t);
+        t->fn = fn;
+        t->arg = arg;
+        t->name = name;
+        t->priority = priority;
+        t->core = 0;
+        t->notify = 0;
+        task_ready(t);
+        return t;
+    }
+    return NULL;
+}
+
+// Run every ready task (priority, then FIFO) until all are blocked.
+static void run_ready(void) {
+    for (;;) {
+        struct sim_task* best = NULL;
+        for (int i = 0; i < SIM_MAX_TASKS; i++) {
+            struct sim_task* t = &tasks[i];
+            if (t->state == TASK_READY &&
+                (best == NULL || t->priority > best->priority ||
+                 (t->priority == best->priority && t->ready_seq < best->ready_seq))) {
+                best = t;
+            }
+        }
+        if (best == NULL) {
+            return;
+        }
+        current = best;
+        swapcontext(&sched_ctx, &best->ctx);
+        current = NULL;
+    }
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack_depth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* out,
+                                   BaseType_t core) {
+    (void)stack_depth;
+    struct sim_task* t = task_create(fn, name, arg, priority);
+    if (t != NULL) {
+        t->core = core == tskNO_AFFINITY ? -1 : core;
+    }
+    if (out != NULL) {
+        *out = t;
+    }
+    return t != NULL ? pdPASS : pdFAIL;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name,
+                                           uint32_t stack_depth, void* arg,
+                                           UBaseType_t priority, StackType_t* stack,
+                                           StaticTask_t* tcb, BaseType_t core) {
+    (void)stack_depth;
+    (void)stack;    // host code needs more stack than the target budget
+    (void)tcb;
+    struct sim_task* t = task_create(fn, name, arg, priority);
+    if (t != NULL) {
+        t->core = core == tskNO_AFFINITY ? -1 : core;
+    }
+    return t;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    struct sim_task* t = task != NULL ? task : current;
+    if (t == NULL) {
+        return;
+    }
+    t->state = TASK_DONE;
+    if (t == current) {
+        task_block();
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    sim_run_for((int64_t)ticks * (1000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment) {
+    *previous_wake += increment;
+    int64_t wake = (int64_t)*previous_wake * (1000000 / configTICK_RATE_HZ);
+    if (wake > now_us) {
+        sim_run_for(wake - now_us);
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(now_us / (1000000 / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait) {
+    if (current->notify == 0 && ticks_to_wait > 0) {
+        current->state = TASK_NOTIFY_WAIT;
+        current->wake_us = (ticks_to_wait == portMAX_DELAY)
+            ? SIM_FOREVER : now_us + (int64_t)ticks_to_wait * (1000000 / configTICK_RATE_HZ);
+        task_block();
+    }
+    uint32_t value = current->notify;
+    if (clear_on_exit) {
+        current->notify = 0;
+    } else if (value > 0) {
+        current->notify--;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    task->notify++;
+    if (task->state == TASK_NOTIFY_WAIT) {
+        task_ready(task);
+    }
+    return pdPASS;
+}
+
+void sim_run_for(int64_t us) {
+    if (current == NULL) {
+        sim_fatal("sim_run_for() outside a task");
+    }
+    if (us <= 0) {
+        task_ready(current);        // yield
+    } else {
+        current->state = TASK_DELAYED;
+        current->wake_us = now_us + us;
+    }
+    task_block();
+}
+
+// ---------------------------------------------------------------------------
+// Mutexes
+// ---------------------------------------------------------------------------
+
+_Static_assert(sizeof(struct sim_mutex) <= sizeof(StaticSemaphore_t),
+               "sim_mutex must fit into StaticSemaphore_t");
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer) {
+    struct sim_mutex* m = (struct sim_mutex*)buffer;
+    m->owner = NULL;
+    return m;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks_to_wait) {
+    if (current == NULL) {
+        sim_fatal("mutex taken from interrupt context");
+    }
+    if (mutex->owner == NULL) {
+        mutex->owner = current;
+        return pdTRUE;
+    }
+    if (mutex->owner == current) {
+        sim_fatal("recursive take of a non-recursive mutex");
+    }
+    if (ticks_to_wait == 0) {
+        return pdFALSE;
+    }
+    current->state = TASK_MUTEX_WAIT;
+    current->waiting = mutex;
+    current->wake_us = (ticks_to_wait == portMAX_DELAY)
+        ? SIM_FOREVER : now_us + (int64_t)ticks_to_wait * (1000000 / configTICK_RATE_HZ);
+    task_block();
+    return mutex->owner == current ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    if (mutex->owner != current) {
+        return pdFALSE;
+    }
+    struct sim_task* next = NULL;
+    for (int i = 0; i < SIM_MAX_TASKS; i++) {
+        struct sim_task* t = &tasks[i];
+        if (t->state == TASK_MUTEX_WAIT && t->waiting == mutex &&
+            (next == NULL || t->priority > next->priority)) {
+            next = t;
+        }
+    }
+    mutex->owner = next;
+    if (next != NULL) {
+        task_ready(next);
+    }
+    return pdTRUE;
+}
+
+// ---------------------------------------------------------------------------
+// esp_timer
+// ---------------------------------------------------------------------------
+
+// The esp_timer task: runs expired ESP_TIMER_TASK callbacks in expiry order.
+static void timer_task_fn(void* arg) {
+    (void)arg;
+    for (;;) {
+        while (timer_queue_len > 0) {
+            struct esp_timer* t = timer_queue[0];
+            memmove(timer_queue, timer_queue + 1, (size_t)(timer_queue_len - 1) * sizeof(t));
+            timer_queue_len--;
+            if (t != NULL) {
+                t->queued = false;
+                t->cb(t->arg);
+            }
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    if (args == NULL || args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer_count >= SIM_MAX_TIMERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    struct esp_timer* t = calloc(1, sizeof(*t));
+    if (t == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->cb = args->callback;
+    t->arg = args->arg;
+    t->dispatch = args->dispatch_method;
+    if (t->dispatch == ESP_TIMER_TASK && timer_task == NULL) {
+        timer_task = task_create(timer_task_fn, "esp_timer", NULL, 22);
+        if (timer_task == NULL) {
+            free(t);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    timers[timer_count++] = t;
+    *out_handle = t;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = true;
+    timer->due_us = now_us + (int64_t)timeout_us + rnd_range(timer_lat_min, timer_lat_max);
+    timer->seq = ++seq_counter;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < timer_queue_len; i++) {
+        if (timer_queue[i] == timer) {
+            timer_queue[i] = NULL;
+        }
+    }
+    for (int i = 0; i < timer_count; i++) {
+        if (timers[i] == timer) {
+            timers[i] = timers[--timer_count];
+            break;
+        }
+    }
+    free(timer);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timer != NULL && timer->armed;
+}
+
+int64_t esp_timer_get_time(void) {
+    return now_us;
+}
+
+static void timer_dispatch(struct esp_timer* t) {
+    t->armed = false;
+    if (t->dispatch == ESP_TIMER_ISR) {
+        t->cb(t->arg);
+        return;
+    }
+    if (timer_queue_len >= SIM_MAX_TIMERS) {
+        sim_fatal("esp_timer task queue overflow");
+    }
+    t->queued = true;
+    timer_queue[timer_queue_len++] = t;
+    xTaskNotifyGive(timer_task);
+}
+
+// ---------------------------------------------------------------------------
+// GPTimer (1 MHz, counts simulated µs)
+// ---------------------------------------------------------------------------
+
+static uint64_t gptimer_count(const struct gptimer_t* g) {
+    return g->running ? (uint64_t)(now_us - g->base_us) : g->stopped_count;
+}
+
+esp_err_t gptimer_new_timer(const gptimer_config_t* config, gptimer_handle_t* ret_timer) {
+    if (config == NULL || ret_timer == NULL || config->resolution_hz != 1000000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < SIM_MAX_GPTIMERS; i++) {
+        if (!gptimers[i].in_use) {
+            memset(&gptimers[i], 0, sizeof(gptimers[i]));
+            gptimers[i].in_use = true;
+            gptimers[i].intr.core  = -1;
+            gptimers[i].intr.level = config->intr_priority;
+            *ret_timer = &gptimers[i];
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t gptimer_del_timer(gptimer_handle_t timer) {
+    if (timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_register_event_callbacks(gptimer_handle_t timer,
+                                           const gptimer_event_callbacks_t* cbs,
+                                           void* user_data) {
+    if (timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->cb = cbs->on_alarm;
+    timer->user = user_data;
+    timer->intr.core = (int)xPortGetCoreID();
+    return ESP_OK;
+}
+
+esp_err_t gptimer_set_alarm_action(gptimer_handle_t timer, const gptimer_alarm_config_t* config) {
+    if (config == NULL) {
+        timer->alarm_armed = false;
+        return ESP_OK;
+    }
+    timer->alarm_count = config->alarm_count;
+    timer->alarm_armed = true;
+    // An alarm value already passed triggers at once
+    int64_t at = timer->base_us + (int64_t)config->alarm_count;
+    timer->fire_us = (at > now_us ? at : now_us) + rnd_range(timer_lat_min, timer_lat_max);
+    timer->seq = ++seq_counter;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_enable(gptimer_handle_t timer) {
+    if (timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_disable(gptimer_handle_t timer) {
+    if (!timer->enabled || timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_start(gptimer_handle_t timer) {
+    if (!timer->enabled || timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->base_us = now_us - (int64_t)timer->stopped_count;
+    timer->running = true;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_stop(gptimer_handle_t timer) {
+    if (!timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->stopped_count = gptimer_count(timer);
+    timer->running = false;
+    return ESP_OK;
+}
+
+esp_err_t gptimer_get_raw_count(gptimer_handle_t timer, uint64_t* value) {
+    *value = gptimer_count(timer);
+    return ESP_OK;
+}
+
+static void gptimer_dispatch(struct gptimer_t* g) {
+    g->alarm_armed = false;
+    gptimer_alarm_event_data_t edata = {
+        .count_value = gptimer_count(g),
+        .alarm_value = g->alarm_count,
+    };
+    if (g->cb != NULL) {
+        g->cb(g, &edata, g->user);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// MCPWM capture (timer per group, channels latch it on ZC edges)
+// ---------------------------------------------------------------------------
+
+static uint32_t cap_timer_count(const struct mcpwm_cap_timer_t* t, int64_t at_us) {
+    if (!t->running) {
+        return t->base_count;
+    }
+    return t->base_count + (uint32_t)((uint64_t)(at_us - t->base_us) * t->resolution_hz / 1000000);
+}
+
+esp_err_t mcpwm_new_capture_timer(const mcpwm_capture_timer_config_t* config,
+                                  mcpwm_cap_timer_handle_t* ret_cap_timer) {
+    if (config == NULL || ret_cap_timer == NULL ||
+        config->group_id < 0 || config->group_id >= SOC_MCPWM_GROUPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct mcpwm_cap_timer_t* t = &cap_timers[config->group_id];
+    if (t->in_use) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(t, 0, sizeof(*t));
+    t->in_use = true;
+    t->resolution_hz = cap_resolution_hz ? cap_resolution_hz : config->resolution_hz;
+    t->base_count = SIM_CAP_COUNT_START;
+    *ret_cap_timer = t;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_capture_timer(mcpwm_cap_timer_handle_t cap_timer) {
+    if (cap_timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < SIM_CAP_CHANNELS; i++) {
+        if (cap_channels[i].in_use && cap_channels[i].timer == cap_timer) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    cap_timer->in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_enable(mcpwm_cap_timer_handle_t cap_timer) {
+    if (cap_timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_timer->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_disable(mcpwm_cap_timer_handle_t cap_timer) {
+    if (!cap_timer->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_timer->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_start(mcpwm_cap_timer_handle_t cap_timer) {
+    if (!cap_timer->enabled || cap_timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_timer->base_us = now_us;
+    cap_timer->running = true;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_stop(mcpwm_cap_timer_handle_t cap_timer) {
+    if (!cap_timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_timer->base_count = cap_timer_count(cap_timer, now_us);
+    cap_timer->running = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_timer_get_resolution(mcpwm_cap_timer_handle_t cap_timer,
+                                             uint32_t* out_resolution) {
+    *out_resolution = cap_timer->resolution_hz;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_new_capture_channel(mcpwm_cap_timer_handle_t cap_timer,
+                                    const mcpwm_capture_channel_config_t* config,
+                                    mcpwm_cap_channel_handle_t* ret_cap_channel) {
+    if (config == NULL || ret_cap_channel == NULL || config->gpio_num < 0 ||
+        config->gpio_num >= SIM_PINS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int used = 0;
+    struct mcpwm_cap_channel_t* free_chan = NULL;
+    for (int i = 0; i < SIM_CAP_CHANNELS; i++) {
+        struct mcpwm_cap_channel_t* c = &cap_channels[i];
+        if (c->in_use) {
+            used += c->timer == cap_timer;
+        } else if (free_chan == NULL) {
+            free_chan = c;
+        }
+    }
+    if (free_chan == NULL || used >= SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memset(free_chan, 0, sizeof(*free_chan));
+    free_chan->in_use     = true;
+    free_chan->timer      = cap_timer;
+    free_chan->pin        = (uint8_t)config->gpio_num;
+    free_chan->pos_edge   = config->flags.pos_edge;
+    free_chan->neg_edge   = config->flags.neg_edge;
+    free_chan->intr.core  = -1;
+    free_chan->intr.level = config->intr_priority;
+    *ret_cap_channel = free_chan;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_del_capture_channel(mcpwm_cap_channel_handle_t cap_channel) {
+    if (cap_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_channel->in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_channel_enable(mcpwm_cap_channel_handle_t cap_channel) {
+    if (cap_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_channel_disable(mcpwm_cap_channel_handle_t cap_channel) {
+    if (!cap_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t mcpwm_capture_channel_register_event_callbacks(mcpwm_cap_channel_handle_t cap_channel,
+                                                         const mcpwm_capture_event_callbacks_t* cbs,
+                                                         void* user_data) {
+    if (cap_channel->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    cap_channel->cb = cbs->on_cap;
+    cap_channel->user = user_data;
+    cap_channel->intr.core = (int)xPortGetCoreID();
+    return ESP_OK;
+}
+
+// Output backend: not modelled, every channel build fails at the timer
+esp_err_t mcpwm_new_timer(const mcpwm_timer_config_t* config, mcpwm_timer_handle_t* ret_timer) {
+    (void)config;
+    (void)ret_timer;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#define SIM_MCPWM_UNMODELLED(name, ...) \
+    esp_err_t name(__VA_ARGS__) { sim_fatal(#name " is not modelled"); return ESP_FAIL; }
+
+SIM_MCPWM_UNMODELLED(mcpwm_del_timer, mcpwm_timer_handle_t t)
+SIM_MCPWM_UNMODELLED(mcpwm_timer_enable, mcpwm_timer_handle_t t)
+SIM_MCPWM_UNMODELLED(mcpwm_timer_disable, mcpwm_timer_handle_t t)
+SIM_MCPWM_UNMODELLED(mcpwm_timer_start_stop, mcpwm_timer_handle_t t, mcpwm_timer_start_stop_cmd_t c)
+SIM_MCPWM_UNMODELLED(mcpwm_timer_set_phase_on_sync, mcpwm_timer_handle_t t,
+                     const mcpwm_timer_sync_phase_config_t* c)
+SIM_MCPWM_UNMODELLED(mcpwm_new_gpio_sync_src, const mcpwm_gpio_sync_src_config_t* c,
+                     mcpwm_sync_handle_t* s)
+SIM_MCPWM_UNMODELLED(mcpwm_del_sync_src, mcpwm_sync_handle_t s)
+SIM_MCPWM_UNMODELLED(mcpwm_new_operator, const mcpwm_operator_config_t* c, mcpwm_oper_handle_t* o)
+SIM_MCPWM_UNMODELLED(mcpwm_del_operator, mcpwm_oper_handle_t o)
+SIM_MCPWM_UNMODELLED(mcpwm_operator_connect_timer, mcpwm_oper_handle_t o, mcpwm_timer_handle_t t)
+SIM_MCPWM_UNMODELLED(mcpwm_new_comparator, mcpwm_oper_handle_t o,
+                     const mcpwm_comparator_config_t* c, mcpwm_cmpr_handle_t* r)
+SIM_MCPWM_UNMODELLED(mcpwm_del_comparator, mcpwm_cmpr_handle_t c)
+SIM_MCPWM_UNMODELLED(mcpwm_comparator_set_compare_value, mcpwm_cmpr_handle_t c, uint32_t v)
+SIM_MCPWM_UNMODELLED(mcpwm_new_generator, mcpwm_oper_handle_t o,
+                     const mcpwm_generator_config_t* c, mcpwm_gen_handle_t* g)
+SIM_MCPWM_UNMODELLED(mcpwm_del_generator, mcpwm_gen_handle_t g)
+SIM_MCPWM_UNMODELLED(mcpwm_generator_set_force_level, mcpwm_gen_handle_t g, int l, bool h)
+SIM_MCPWM_UNMODELLED(mcpwm_generator_set_action_on_compare_event, mcpwm_gen_handle_t g,
+                     mcpwm_gen_compare_event_action_t a)
+SIM_MCPWM_UNMODELLED(mcpwm_generator_set_action_on_timer_event, mcpwm_gen_handle_t g,
+                     mcpwm_gen_timer_event_action_t a)
+#pragma GCC diagnostic pop
+
+// ---------------------------------------------------------------------------
+// Event loop
+// ---------------------------------------------------------------------------
+
+typedef enum { EV_NONE, EV_EDGE, EV_GPTIMER, EV_TIMER, EV_TASK } event_kind_t;
+
+typedef struct {
+    event_kind_t kind;
+    int64_t at;
+    uint64_t seq;
+    void* obj;
+} event_t;
+
+static void consider(event_t* best, event_kind_t kind, int64_t at, uint64_t seq, void* obj) {
+    if (best->kind == EV_NONE || at < best->at ||
+        (at == best->at && (kind < best->kind ||
+                            (kind == best->kind && seq < best->seq)))) {
+        *best = (event_t){ kind, at, seq, obj };
+    }
+}
+
+static event_t next_event(void) {
+    event_t best = { EV_NONE, 0, 0, NULL };
+    for (int i = 0; i < source_count; i++) {
+        zc_gen_t* g = &sources[i];
+        zc_refill(g);
+        consider(&best, EV_EDGE, g->queue[g->q_head].at_us, (uint64_t)i, g);
+    }
+    for (int i = 0; i < SIM_MAX_GPTIMERS; i++) {
+        struct gptimer_t* g = &gptimers[i];
+        if (g->in_use && g->running && g->alarm_armed) {
+            consider(&best, EV_GPTIMER, g->fire_us, g->seq, g);
+        }
+    }
+    for (int i = 0; i < timer_count; i++) {
+        if (timers[i]->armed) {
+            consider(&best, EV_TIMER, timers[i]->due_us, timers[i]->seq, timers[i]);
+        }
+    }
+    for (int i = 0; i < SIM_MAX_TASKS; i++) {
+        struct sim_task* t = &tasks[i];
+        bool timed = t->state == TASK_DELAYED || t->state == TASK_NOTIFY_WAIT ||
+                     t->state == TASK_MUTEX_WAIT;
+        if (timed && t->wake_us != SIM_FOREVER) {
+            consider(&best, EV_TASK, t->wake_us, (uint64_t)i, t);
+        }
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Cores
+// ---------------------------------------------------------------------------
+
+BaseType_t xPortGetCoreID(void) {
+    if (ipc_core >= 0) {
+        return ipc_core;
+    }
+    return (current != NULL && current->core > 0) ? current->core : 0;
+}
+
+esp_err_t esp_ipc_call_blocking(uint32_t cpu_id, esp_ipc_func_t func, void* arg) {
+    if (cpu_id >= SIM_CORES || ipc_core >= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ipc_calls++;
+    ipc_core = (int)cpu_id;
+    func(arg);
+    ipc_core = -1;
+    return ESP_OK;
+}
+
+bool sim_isr_service_intr(sim_intr_t* out) {
+    if (isr_service) {
+        *out = isr_service_intr;
+    }
+    return isr_service;
+}
+
+bool sim_gptimer_intr(int index, sim_intr_t* out) {
+    int n = 0;
+    for (int i = 0; i < SIM_MAX_GPTIMERS; i++) {
+        if (gptimers[i].in_use && gptimers[i].intr.core >= 0 && n++ == index) {
+            *out = gptimers[i].intr;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sim_capture_intr(int index, sim_intr_t* out) {
+    int n = 0;
+    for (int i = 0; i < SIM_CAP_CHANNELS; i++) {
+        if (cap_channels[i].in_use && cap_channels[i].intr.core >= 0 && n++ == index) {
+            *out = cap_channels[i].intr;
+            return true;
+        }
+    }
+    return false;
+}
+
+int sim_task_core(const char* name) {
+    for (int i = 0; i < SIM_MAX_TASKS; i++) {
+        struct sim_task* t = &tasks[i];
+        if (t->state != TASK_FREE && t->state != TASK_DONE && strcmp(t->name, name) == 0) {
+            return t->core;
+        }
+    }
+    return -2;
+}
+
+uint32_t sim_ipc_calls(void) {
+    return ipc_calls;
+}
+
+// ---------------------------------------------------------------------------
+// NVS (in memory)
+// ---------------------------------------------------------------------------
+
+static sim_nvs_entry_t* nvs_find(nvs_handle_t handle, const char* key, bool create) {
+    if (handle == 0 || handle > SIM_NVS_ENTRIES || nvs_handles[handle] == NULL) {
+        return NULL;
+    }
+    const char* ns = nvs_handles[handle];
+    sim_nvs_entry_t* free_entry = NULL;
+    for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+        sim_nvs_entry_t* e = &nvs_entries[i];
+        if (e->used && strcmp(e->ns, ns) == 0 && strcmp(e->key, key) == 0) {
+            return e;
+        }
+        if (!e->used && free_entry == NULL) {
+            free_entry = e;
+        }
+    }
+    if (!create || free_entry == NULL) {
+        return NULL;
+    }
+    snprintf(free_entry->ns, sizeof(free_entry->ns), "%s", ns);
+    snprintf(free_entry->key, sizeof(free_entry->key), "%s", key);
+    free_entry->used = true;
+    free_entry->len = 0;
+    return free_entry;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    (void)open_mode;
+    if (!nvs_ready) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    for (nvs_handle_t h = 1; h <= SIM_NVS_ENTRIES; h++) {
+        if (nvs_handles[h] == NULL) {
+            nvs_handles[h] = name;
+            *out_handle = h;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    sim_nvs_entry_t* e = nvs_find(handle, key, false);
+    if (e == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value == NULL) {
+        *length = e->len;
+        return ESP_OK;
+    }
+    if (*length < e->len) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out_value, e->data, e->len);
+    *length = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    if (length > SIM_NVS_BLOB_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim_nvs_entry_t* e = nvs_find(handle, key, true);
+    if (e == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(e->data, value, length);
+    e->len = length;
+    nvs_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    if (handle < 1 || handle > SIM_NVS_ENTRIES || nvs_handles[handle] == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (nvs_commit_us > 0 && current != NULL) {
+        sim_run_for(nvs_commit_us);     // the calling task is busy in the flash
+    }
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    if (handle >= 1 && handle <= SIM_NVS_ENTRIES) {
+        nvs_handles[handle] = NULL;
+    }
+}
+
+uint32_t sim_nvs_writes(void) {
+    return nvs_writes;
+}
+
+void sim_set_nvs_commit_us(uint32_t us) {
+    nvs_commit_us = us;
+}
+
+int sim_main(void (*fn)(void* arg), void* arg) {
+    main_task = task_create(fn, "main", arg, 1);
+    if (main_task == NULL) {
+        return -1;
+    }
+    for (;;) {
+        run_ready();
+        if (main_task->state == TASK_DONE) {
+            return 0;
+        }
+        event_t ev = next_event();
+        if (ev.kind == EV_NONE) {
+            fprintf(stderr, "sim: deadlock at t=%lld us\n", (long long)now_us);
+            return -1;
+        }
+        if (ev.at > now_us) {
+            now_us = ev.at;
+        }
+        switch (ev.kind) {
+            case EV_EDGE:    zc_dispatch((zc_gen_t*)ev.obj); break;
+            case EV_GPTIMER: gptimer_dispatch((struct gptimer_t*)ev.obj); break;
+            case EV_TIMER:   timer_dispatch((struct esp_timer*)ev.obj); break;
+            case EV_TASK: {
+                struct sim_task* t = (struct sim_task*)ev.obj;
+                if (t->state == TASK_MUTEX_WAIT) {
+                    t->waiting = NULL;    // timed out
+                }
+                task_ready(t);
+                break;
+            }
+            case EV_NONE:
+                break;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Misc stand-ins
+// ---------------------------------------------------------------------------
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    return (esp_cpu_cycle_count_t)sim_host_ns();
+}
+
+void sim_log(int level, const char* tag, const char* fmt, ...) {
+    static int threshold = -1;
+    if (threshold < 0) {
+        const char* env = getenv("RBDIMMER_SIM_LOG");
+        threshold = env != NULL ? atoi(env) : 2;
+    }
+    if (level > threshold) {
+        return;
+    }
+    static const char letters[] = "?EWIDV";
+    fprintf(stderr, "%c (%lld) %s: ", letters[level < 6 ? level : 0], (long long)now_us, tag);
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
@@ -0,0 +1,172 @@
+/**
+ * @file sim.h
+ * @brief Host-side simulation of the ESP-IDF services used by rbdimmerESP32
+ *
+ * The real library sources are compiled against the headers in ../stubs,
+ * which route into this simulator:
+ *
+ *   virtual clock (1 µs)  ── esp_timer_get_time(), xTaskGetTickCount()
+ *   event loop            ── zero-cross edges, esp_timer expiries, GPTimer
+ *                            alarms, task wake-ups, in time order
+ *   GPIO matrix           ── GPIO ISR dispatch, GPIO_IN reads, gate writes
+ *                            (W1TS/W1TC, gpio_set_level) into a pulse trace
+ *   MCPWM capture         ── capture timer per group, channels latch it at
+ *                            the ZC edge and call back at dispatch time
+ *   FreeRTOS              ── tasks as cooperative coroutines, mutexes,
+ *                            notifications and delays on the virtual clock
+ *
+ * Interrupt handlers execute in zero simulated time at their dispatch
+ * instant (edge or alarm time plus the configured latency).  Tasks are never
+ * preempted by them — the simulator checks timing, not data races.
+ */
+
+#ifndef RBDIMMER_SIM_H
+#define RBDIMMER_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_MAX_SOURCES  4
+
+// ---------------------------------------------------------------------------
+// Zero-cross signal generator
+// ---------------------------------------------------------------------------
+
+/**
+ * One detector output: a pulse at every mains zero-crossing.
+ *
+ * The true crossing times are recorded as the reference for firing-angle
+ * analysis; the detector rising edge is crossing + edge_offset_us, the
+ * falling edge pulse_width_us later.
+ */
+typedef struct {
+    uint8_t  pin;                // ZC input GPIO
+    double   freq_hz;            // Mains frequency at t = 0
+    double   drift_hz_per_s;     // Linear frequency ramp
+    double   phase_us;           // First crossing (relative to t = 0)
+    int32_t  edge_offset_us;     // Detector rising edge - true crossing
+    uint32_t pulse_width_us;     // Detector pulse width (0 = 300 µs)
+    uint32_t latency_min_us;     // GPIO ISR latency, uniform [min, max]
+    uint32_t latency_max_us;
+    double   glitch_rate;        // Probability of a spurious pulse per half-cycle
+    double   dropout_rate;       // Probability that a crossing gives no pulse
+    uint32_t dropout_every;      // Additionally drop every Nth pulse (0 = off)
+} sim_zc_source_t;
+
+/** Reset the whole simulation: clock, events, traces, tasks. */
+void sim_reset(uint32_t seed);
+
+/** Attach a ZC signal source; returns its index or -1. */
+int sim_add_zc_source(const sim_zc_source_t* src);
+
+/**
+ * Live parameters of source @p src (NULL if out of range).  Changes apply
+ * from the next generated crossing, e.g. to start glitches after lock.
+ */
+sim_zc_source_t* sim_zc_source(int src);
+
+/**
+ * Resolution every MCPWM capture timer created from now on runs at,
+ * whatever it was configured with; 0 = the configured one.  Default
+ * 80 MHz, as the APB-clocked capture timer of an ESP32.
+ */
+void sim_set_capture_resolution(uint32_t hz);
+
+/** Dispatch latency added to every esp_timer / GPTimer alarm, uniform [min, max]. */
+void sim_set_timer_latency(uint32_t min_us, uint32_t max_us);
+
+// ---------------------------------------------------------------------------
+// Execution
+// ---------------------------------------------------------------------------
+
+/**
+ * Run @p fn as the "main" task and the event loop until it returns.
+ * Inside @p fn, vTaskDelay() / sim_run_for() advance the virtual clock.
+ *
+ * @return 0, or -1 if the task set deadlocked (no task runnable, no event)
+ */
+int sim_main(void (*fn)(void* arg), void* arg);
+
+/** Advance simulated time by @p us from the calling task. */
+void sim_run_for(int64_t us);
+
+/** Current simulated time, µs. */
+int64_t sim_now(void);
+
+// ---------------------------------------------------------------------------
+// Traces
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int64_t rise;                // Gate HIGH, µs
+    int64_t fall;                // Gate LOW, µs (-1 while still high)
+} sim_pulse_t;
+
+/** Gate pulses recorded on @p pin. */
+const sim_pulse_t* sim_gate_pulses(uint8_t pin, size_t* count);
+
+/** True crossing times of source @p src, µs (rounded). */
+const int64_t* sim_zc_crossings(int src, size_t* count);
+
+/** Index of the last crossing of @p src at or before @p t, or -1. */
+long sim_crossing_before(int src, int64_t t);
+
+/** Number of GPIO writes that switched a gate (count, not per pin). */
+uint64_t sim_gate_writes(void);
+
+// ---------------------------------------------------------------------------
+// Cores and interrupt allocation
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int core;                    // core that allocated the interrupt
+    int level;                   // requested priority level, 0 = driver default
+} sim_intr_t;
+
+/** GPIO ISR service allocation; false if it is not installed. */
+bool sim_isr_service_intr(sim_intr_t* out);
+
+/** Interrupt of the @p index-th GPTimer with a registered callback. */
+bool sim_gptimer_intr(int index, sim_intr_t* out);
+
+/** Interrupt of the @p index-th MCPWM capture channel with a registered callback. */
+bool sim_capture_intr(int index, sim_intr_t* out);
+
+/** Pinned core of the live task named @p name: -1 = no affinity, -2 = no such task. */
+int sim_task_core(const char* name);
+
+/** esp_ipc_call_blocking() calls since sim_reset(). */
+uint32_t sim_ipc_calls(void);
+
+/** nvs_set_blob() calls since sim_reset() (the NVS store is cleared there too). */
+uint32_t sim_nvs_writes(void);
+
+/**
+ * Time nvs_commit() keeps the calling task busy (flash program and page
+ * erase), 0 by default.  Other tasks and interrupts run meanwhile.
+ */
+void sim_set_nvs_commit_us(uint32_t us);
+
+// ---------------------------------------------------------------------------
+// Host-cost measurement
+// ---------------------------------------------------------------------------
+
+/**
+ * Host wall time of every zero-cross ISR invocation, ns.  Absolute values
+ * depend on the host; use them to compare builds and channel counts.
+ */
+const uint32_t* sim_zc_isr_ns(size_t* count);
+
+/** Host monotonic clock, ns. */
+uint64_t sim_host_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RBDIMMER_SIM_H */
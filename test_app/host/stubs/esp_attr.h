@@ -0,0 +1,4 @@
+/* Host simulation stub — see test_app/host/README.md */
+#pragma once
+#define IRAM_ATTR
+#define DRAM_ATTR
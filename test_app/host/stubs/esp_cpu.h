@@ -0,0 +1,16 @@
+/* Host simulation stub — see test_app/host/README.md */
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+/** Host nanosecond clock (wall time, not simulated time). */
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,7 @@
+/* Host simulation stub — see test_app/host/README.md */
+#pragma once
+#include "esp_err.h"
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define ESP_INTR_FLAG_LEVEL2 (1 << 2)
+#define ESP_INTR_FLAG_LEVEL3 (1 << 3)
+#define ESP_INTR_FLAG_IRAM   (1 << 10)
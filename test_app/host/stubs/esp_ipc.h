@@ -0,0 +1,19 @@
+/* Host simulation stub — see test_app/host/README.md
+ *
+ * Runs @p func at once with xPortGetCoreID() reporting @p cpu_id, so the
+ * core an interrupt was allocated on can be checked. */
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*esp_ipc_func_t)(void* arg);
+
+esp_err_t esp_ipc_call_blocking(uint32_t cpu_id, esp_ipc_func_t func, void* arg);
+
+#ifdef __cplusplus
+}
+#endif
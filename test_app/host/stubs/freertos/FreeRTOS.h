@@ -0,0 +1,47 @@
+/* Host simulation stub — see test_app/host/README.md
+ *
+ * Tasks are cooperative coroutines on the simulated clock: a task runs until
+ * it blocks, and interrupts are only dispatched between task steps, so
+ * critical sections need no locking. */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int          BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t     TickType_t;
+typedef uint8_t      StackType_t;
+
+#define pdFALSE  0
+#define pdTRUE   1
+#define pdFAIL   0
+#define pdPASS   1
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFu)
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY      0x7FFFFFFF
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED  { 0 }
+
+#define portENTER_CRITICAL(mux)       ((void)(mux))
+#define portEXIT_CRITICAL(mux)        ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux)   ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux)    ((void)(mux))
+#define portENTER_CRITICAL_SAFE(mux)  ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux)   ((void)(mux))
+
+/* Core of the running code: the task's pinned core, or the target of the
+ * esp_ipc call in progress.  One simulated CPU executes everything. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+BaseType_t xPortGetCoreID(void);
+#ifdef __cplusplus
+}
+#endif
+
+typedef struct { void* unused[16]; } StaticTask_t;
+typedef struct { void* unused[8]; }  StaticSemaphore_t;
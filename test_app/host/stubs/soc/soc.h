@@ -0,0 +1,18 @@
+/* Host simulation stub — see test_app/host/README.md */
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Gate and ZC register accesses go to the simulated GPIO matrix. */
+void sim_reg_write(uint32_t reg, uint32_t value);
+uint32_t sim_reg_read(uint32_t reg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define REG_WRITE(reg, value) sim_reg_write((uint32_t)(reg), (uint32_t)(value))
+#define REG_READ(reg)         sim_reg_read((uint32_t)(reg))
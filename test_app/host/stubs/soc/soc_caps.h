@@ -0,0 +1,13 @@
+/* Host simulation stub — see test_app/host/README.md
+ *
+ * ESP32 pin map.  MCPWM: the capture input is simulated, the output
+ * backend is not (see stubs/driver/mcpwm_prelude.h). */
+#pragma once
+#define SOC_GPIO_PIN_COUNT               40
+#define SOC_GPIO_VALID_GPIO_MASK         0xFFFFFFFFFFULL
+#define SOC_GPIO_VALID_OUTPUT_GPIO_MASK  0x03FFFFFFFFULL   /* GPIO 34-39 input-only */
+#define SOC_CPU_CORES_NUM                2
+#define SOC_GPTIMER_SUPPORTED            1
+#define SOC_MCPWM_SUPPORTED              1
+#define SOC_MCPWM_GROUPS                 2
+#define SOC_MCPWM_CAPTURE_CHANNELS_PER_TIMER 3
@@ -0,0 +1,1365 @@
+/**
+ * @file tests.c
+ * @brief Timing-core scenarios on the host simulator
+ *
+ * Usage: sim_tests_<variant> <scenario>
+ *
+ * Every scenario drives the real library through the public API, feeds it
+ * a synthetic zero-cross signal and checks the recorded gate pulses against
+ * the true mains crossings.  Exit status 0 = pass, 1 = fail, 77 = scenario
+ * does not apply to this build variant.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rbdimmerESP32.h"
+#include "sim.h"
+
+#define SKIP 77
+
+#define ZC_PIN     4
+#define GATE_PIN0  16
+#define WARMUP_US  1500000          // frequency acquisition (50 half-cycles) + settle
+
+static int failures;
+
+#define CHECK(cond, ...) do {                                           \
+        if (!(cond)) {                                                  \
+            printf("FAIL %s:%d: " #cond "\n    ", __FILE__, __LINE__);  \
+            printf(__VA_ARGS__);                                        \
+            printf("\n");                                               \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#define REQUIRE_OK(expr) do {                                           \
+        rbdimmer_err_t err_ = (expr);                                   \
+        if (err_ != RBDIMMER_OK) {                                      \
+            printf("FAIL %s:%d: " #expr " = %d\n", __FILE__, __LINE__,  \
+                   (int)err_);                                          \
+            failures++;                                                 \
+            return;                                                     \
+        }                                                               \
+    } while (0)
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    size_t pulses;
+    double mean;                    // firing-angle error, µs
+    double sd;
+    double max_abs;
+    uint32_t width_min;
+    uint32_t width_max;
+} angle_stats_t;
+
+// Gate pulses on @p pin that rose in [from, to): error of each rise against
+// true crossing + @p delay_us.
+static angle_stats_t angle_errors(uint8_t pin, int src, uint32_t delay_us,
+                                  int64_t from, int64_t to) {
+    angle_stats_t st = { 0, 0.0, 0.0, 0.0, UINT32_MAX, 0 };
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(pin, &n);
+    const int64_t* cross = sim_zc_crossings(src, &(size_t){ 0 });
+    double sum = 0.0, sum2 = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i].rise < from || p[i].rise >= to) {
+            continue;
+        }
+        long k = sim_crossing_before(src, p[i].rise);
+        if (k < 0) {
+            continue;
+        }
+        double err = (double)(p[i].rise - cross[k]) - (double)delay_us;
+        sum  += err;
+        sum2 += err * err;
+        if (fabs(err) > st.max_abs) {
+            st.max_abs = fabs(err);
+        }
+        if (p[i].fall >= 0) {
+            uint32_t w = (uint32_t)(p[i].fall - p[i].rise);
+            st.width_min = w < st.width_min ? w : st.width_min;
+            st.width_max = w > st.width_max ? w : st.width_max;
+        }
+        st.pulses++;
+    }
+    if (st.pulses > 0) {
+        st.mean = sum / (double)st.pulses;
+        double var = sum2 / (double)st.pulses - st.mean * st.mean;
+        st.sd = var > 0.0 ? sqrt(var) : 0.0;
+    }
+    return st;
+}
+
+// True crossings in [from, to).
+static size_t crossings_in(int src, int64_t from, int64_t to) {
+    return (size_t)(sim_crossing_before(src, to - 1) - sim_crossing_before(src, from - 1));
+}
+
+static void print_stats(const char* what, const angle_stats_t* st) {
+    printf("  %-14s pulses %5zu  error mean %+7.2f sd %6.2f max %6.1f us  width %u..%u us\n",
+           what, st->pulses, st->mean, st->sd, st->max_abs,
+           st->width_min == UINT32_MAX ? 0 : st->width_min, st->width_max);
+}
+
+static int start_mains(double freq_hz) {
+    sim_zc_source_t src = {
+        .pin = ZC_PIN,
+        .freq_hz = freq_hz,
+        .phase_us = 1000,
+    };
+    return sim_add_zc_source(&src);
+}
+
+static rbdimmer_err_t setup(uint16_t freq_hz, uint8_t channels, const uint8_t* levels,
+                            rbdimmer_channel_t** out) {
+    rbdimmer_err_t err = rbdimmer_init();
+    if (err != RBDIMMER_OK) {
+        return err;
+    }
+    err = rbdimmer_register_zero_cross(ZC_PIN, 0, freq_hz);
+    if (err != RBDIMMER_OK) {
+        return err;
+    }
+    for (uint8_t i = 0; i < channels; i++) {
+        rbdimmer_config_t cfg = {
+            .gpio_pin      = (uint8_t)(GATE_PIN0 + i),
+            .phase         = 0,
+            .initial_level = levels[i],
+            .curve_type    = RBDIMMER_CURVE_LINEAR,
+        };
+        err = rbdimmer_create_channel(&cfg, &out[i]);
+        if (err != RBDIMMER_OK) {
+            return err;
+        }
+    }
+    return RBDIMMER_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Scenarios
+// ---------------------------------------------------------------------------
+
+// Clean 50 Hz mains, no latency: every half-cycle fires every channel at
+// exactly crossing + delay with the configured pulse width.
+static void scenario_steady(void* arg) {
+    (void)arg;
+    static const uint8_t levels[4] = { 20, 45, 70, 95 };
+    rbdimmer_channel_t* ch[4];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 4, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    int64_t from = sim_now();
+    sim_run_for(2000000);
+    int64_t to = sim_now() - 20000;         // last half-cycle may be in progress
+    size_t expected = crossings_in(src, from, to);
+
+    CHECK(rbdimmer_get_frequency(0) == 50, "frequency %u", rbdimmer_get_frequency(0));
+    for (int i = 0; i < 4; i++) {
+        uint32_t delay = rbdimmer_get_delay(ch[i]);
+        angle_stats_t st = angle_errors((uint8_t)(GATE_PIN0 + i), src, delay, from, to);
+        char name[24];
+        snprintf(name, sizeof(name), "level %u", levels[i]);
+        print_stats(name, &st);
+        CHECK(st.pulses + 1 >= expected && st.pulses <= expected + 1,
+              "%zu pulses for %zu crossings", st.pulses, expected);
+        CHECK(st.max_abs <= 2.0, "angle error %.1f us", st.max_abs);
+        CHECK(st.width_min >= RBDIMMER_DEFAULT_PULSE_WIDTH_US &&
+              st.width_max <= RBDIMMER_DEFAULT_PULSE_WIDTH_US + 2,
+              "pulse width %u..%u us", st.width_min, st.width_max);
+    }
+
+    rbdimmer_zc_stats_t zs;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &zs));
+    CHECK(zs.rejected == 0 && zs.synthesized == 0 && zs.missed == 0,
+          "rejected %u synthesized %u missed %u", (unsigned)zs.rejected,
+          (unsigned)zs.synthesized, (unsigned)zs.missed);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Mains frequency ramps 49.0 → 50.9 Hz at 0.25 Hz/s: the tracker follows and the firing
+// angle (delay as a fraction of the half-cycle) stays where the level put it.
+static void scenario_drift(void* arg) {
+    (void)arg;
+    static const uint8_t levels[1] = { 50 };
+    rbdimmer_channel_t* ch[1];
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 49.0, .drift_hz_per_s = 0.25, .phase_us = 1000,
+    };
+    int src = sim_add_zc_source(&mains);
+    REQUIRE_OK(setup(0, 1, levels, ch));
+    sim_run_for(WARMUP_US);
+    double frac0 = rbdimmer_get_delay(ch[0]) / (1e6 / (2.0 * (49.0 + 0.25 * sim_now() / 1e6)));
+
+    double worst_hz = 0.0, worst_frac = 0.0;
+    for (int step = 0; step < 60; step++) {
+        sim_run_for(100000);
+        double true_hz = 49.0 + 0.25 * (double)sim_now() / 1e6;
+        double hz      = rbdimmer_get_frequency_centihz(0) / 100.0;
+        double frac    = rbdimmer_get_delay(ch[0]) / (1e6 / (2.0 * true_hz));
+        worst_hz   = fmax(worst_hz, fabs(hz - true_hz));
+        worst_frac = fmax(worst_frac, fabs(frac - frac0));
+    }
+    printf("  final %.2f Hz: tracking error max %.3f Hz, firing-angle drift max %.4f\n",
+           49.0 + 0.25 * (double)sim_now() / 1e6, worst_hz, worst_frac);
+    CHECK(worst_hz < 0.05, "frequency tracking error %.3f Hz", worst_hz);
+    CHECK(worst_frac < 0.005, "firing angle moved by %.4f of a half-cycle", worst_frac);
+
+    // Gate timing itself stays locked to the (moving) crossings
+    int64_t to = sim_now() - 20000;
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), to - 200000, to);
+    print_stats("last 200 ms", &st);
+#ifdef CONFIG_RBDIMMER_ZC_PREDICTIVE
+    // The predicted edge trails a ramping half-cycle (type-1 loop):
+    // ~50 µs at 0.25 Hz/s, constant, no divergence
+    CHECK(st.max_abs <= 80.0 && st.sd < 5.0, "angle error %.1f us", st.max_abs);
+#else
+    CHECK(st.max_abs <= 15.0, "angle error %.1f us", st.max_abs);
+#endif
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// 0 … 40 µs random ISR latency (Wi-Fi / flash-cache misses).  Plain edge
+// timestamps pass it through to the gates; the predictive timer removes
+// most of the spread.
+static void scenario_jitter(void* arg) {
+    (void)arg;
+    static const uint8_t levels[1] = { 50 };
+    rbdimmer_channel_t* ch[1];
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 50.0, .phase_us = 1000,
+        .latency_min_us = 0, .latency_max_us = 40,
+    };
+    int src = sim_add_zc_source(&mains);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_run_for(WARMUP_US + 1000000);       // predictor settles
+
+    int64_t from = sim_now();
+    sim_run_for(4000000);
+    int64_t to = sim_now() - 20000;
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("jitter 0-40us", &st);
+    CHECK(st.pulses + 1 >= crossings_in(src, from, to), "%zu pulses", st.pulses);
+#if RBDIMMER_INSTRUMENT
+    rbdimmer_timing_stats_t ts;
+    REQUIRE_OK(rbdimmer_get_timing_stats(0, &ts));
+    printf("  zc jitter histogram: %u samples, max %u us\n",
+           (unsigned)ts.zc_jitter_us.count, (unsigned)ts.zc_jitter_us.max);
+    CHECK(ts.zc_jitter_us.count > 0, "no jitter samples recorded");
+#endif
+#ifdef CONFIG_RBDIMMER_ZC_PREDICTIVE
+    CHECK(st.sd < 5.0, "predictive spread %.2f us", st.sd);
+#else
+    // Uniform 0..40 µs → sd ≈ 11.5 µs, all of it on the gate
+    CHECK(st.sd > 8.0 && st.sd < 15.0, "edge-timestamp spread %.2f us", st.sd);
+#endif
+    CHECK(st.max_abs <= 42.0, "angle error %.1f us", st.max_abs);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// One spurious detector pulse in five half-cycles, well past the debounce
+// window, once the filter is locked: it drops them and the gates never
+// double-fire.
+static void scenario_glitch(void* arg) {
+    (void)arg;
+#ifndef CONFIG_RBDIMMER_ZC_FILTER
+    exit(SKIP);
+#endif
+    static const uint8_t levels[1] = { 60 };
+    rbdimmer_channel_t* ch[1];
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 50.0, .phase_us = 1000,
+    };
+    int src = sim_add_zc_source(&mains);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_run_for(WARMUP_US);
+    sim_zc_source(src)->glitch_rate = 0.2;
+
+    rbdimmer_zc_stats_t before, after;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &before));
+    int64_t from = sim_now();
+    sim_run_for(3000000);
+    int64_t to = sim_now() - 20000;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &after));
+
+    size_t expected = crossings_in(src, from, to);
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("glitch 20%", &st);
+    printf("  rejected %u, synthesized %u\n",
+           (unsigned)(after.rejected - before.rejected),
+           (unsigned)(after.synthesized - before.synthesized));
+    CHECK(after.rejected - before.rejected > expected / 10, "only %u glitches rejected",
+          (unsigned)(after.rejected - before.rejected));
+    CHECK(st.pulses + 1 >= expected && st.pulses <= expected + 1,
+          "%zu pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "angle error %.1f us", st.max_abs);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Every 7th detector pulse is missing: the watchdog synthesises the
+// crossing, so the lamp keeps firing every half-cycle.
+static void scenario_dropout(void* arg) {
+    (void)arg;
+#ifndef CONFIG_RBDIMMER_ZC_FILTER
+    exit(SKIP);
+#endif
+    static const uint8_t levels[1] = { 50 };
+    rbdimmer_channel_t* ch[1];
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 50.0, .phase_us = 1000, .dropout_every = 7,
+    };
+    int src = sim_add_zc_source(&mains);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    rbdimmer_zc_stats_t before, after;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &before));
+    int64_t from = sim_now();
+    sim_run_for(3000000);
+    int64_t to = sim_now() - 20000;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &after));
+
+    size_t expected = crossings_in(src, from, to);
+    uint32_t synth = after.synthesized - before.synthesized;
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("dropout 1/7", &st);
+    printf("  synthesized %u of %zu crossings\n", (unsigned)synth, expected);
+    CHECK(synth + 2 >= expected / 7 && synth <= expected / 7 + 2,
+          "%u synthesized crossings", (unsigned)synth);
+    CHECK(st.pulses + 1 >= expected && st.pulses <= expected + 1,
+          "%zu pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "angle error %.1f us", st.max_abs);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Step of consecutive firing delays during a fade, and monotonicity.
+static void fade_profile(uint8_t pin, int64_t from, int64_t to, int src,
+                         int sign, uint32_t* max_step, int* reversals) {
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(pin, &n);
+    const int64_t* cross = sim_zc_crossings(src, &(size_t){ 0 });
+    int64_t prev = -1;
+    *max_step = 0;
+    *reversals = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i].rise < from || p[i].rise >= to) {
+            continue;
+        }
+        int64_t d = p[i].rise - cross[sim_crossing_before(src, p[i].rise)];
+        if (prev >= 0) {
+            int64_t step = d - prev;
+            if (step * sign < -1) {
+                (*reversals)++;
+            }
+            uint32_t a = (uint32_t)llabs(step);
+            *max_step = a > *max_step ? a : *max_step;
+        }
+        prev = d;
+    }
+}
+
+// Half-cycle-synchronised fade 10 % → 90 % over 1 s: one delay step per
+// crossing, evenly spread, no reversal, exact final level.
+static void scenario_fade_zc(void* arg) {
+    (void)arg;
+    static const uint8_t levels[1] = { 10 };
+    rbdimmer_channel_t* ch[1];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    uint32_t d0 = rbdimmer_get_delay(ch[0]);
+    int64_t from = sim_now();
+    REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[0], (uint16_t)(0.9 * RBDIMMER_LEVEL_Q16_MAX),
+                                                1000));
+    sim_run_for(1300000);
+    uint32_t d1 = rbdimmer_get_delay(ch[0]);
+
+    uint32_t max_step;
+    int reversals;
+    fade_profile(GATE_PIN0, from, sim_now(), src, -1, &max_step, &reversals);
+    uint32_t ideal = (d0 - d1) / 100;       // 100 half-cycles in 1 s
+    printf("  delay %u -> %u us, step max %u us (ideal %u), reversals %d\n",
+           (unsigned)d0, (unsigned)d1, (unsigned)max_step, (unsigned)ideal, reversals);
+    CHECK(rbdimmer_get_level(ch[0]) == 90, "final level %u", rbdimmer_get_level(ch[0]));
+    CHECK(reversals == 0, "%d reversals", reversals);
+    CHECK(max_step <= ideal + ideal / 4 + 2, "step %u us", (unsigned)max_step);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Task-driven fade 90 % → 20 % over 500 ms on the fade task.
+static void scenario_fade_task(void* arg) {
+    (void)arg;
+    static const uint8_t levels[1] = { 90 };
+    rbdimmer_channel_t* ch[1];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    uint32_t d0 = rbdimmer_get_delay(ch[0]);
+    int64_t from = sim_now();
+    REQUIRE_OK(rbdimmer_set_level_transition(ch[0], 20, 500));
+    sim_run_for(250000);
+    uint8_t mid = rbdimmer_get_level(ch[0]);
+    sim_run_for(450000);
+    uint32_t d1 = rbdimmer_get_delay(ch[0]);
+
+    uint32_t max_step;
+    int reversals;
+    fade_profile(GATE_PIN0, from, sim_now(), src, +1, &max_step, &reversals);
+    printf("  delay %u -> %u us, level %u at half time, step max %u us, reversals %d\n",
+           (unsigned)d0, (unsigned)d1, mid, (unsigned)max_step, reversals);
+    CHECK(mid > 30 && mid < 80, "level %u half way through", mid);
+    CHECK(rbdimmer_get_level(ch[0]) == 20, "final level %u", rbdimmer_get_level(ch[0]));
+    CHECK(reversals == 0, "%d reversals", reversals);
+    CHECK(max_step <= (d1 - d0) / 10, "step %u us", (unsigned)max_step);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// ZC fade commands: a retarget mid-fade continues from the current position,
+// an explicit level stops the fade for good, and a burst of calls larger
+// than the command ring waits for the ISR instead of losing commands.
+static void scenario_commands(void* arg) {
+    (void)arg;
+    static const uint8_t levels[1] = { 10 };
+    rbdimmer_channel_t* ch[1];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    int64_t from = sim_now();
+    REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[0], (uint16_t)(0.8 * RBDIMMER_LEVEL_Q16_MAX),
+                                                1000));
+    sim_run_for(300000);
+    REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[0], (uint16_t)(0.2 * RBDIMMER_LEVEL_Q16_MAX),
+                                                300));
+    sim_run_for(500000);
+    uint32_t max_step;
+    int reversals;
+    fade_profile(GATE_PIN0, from, sim_now(), src, -1, &max_step, &reversals);
+    uint32_t d20 = rbdimmer_get_delay(ch[0]);
+    printf("  retarget: step max %u us, final delay %u us\n",
+           (unsigned)max_step, (unsigned)d20);
+    CHECK(rbdimmer_get_level(ch[0]) == 20, "final level %u", rbdimmer_get_level(ch[0]));
+    CHECK(max_step < 200, "jump of %u us at the retarget", (unsigned)max_step);
+
+    REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[0], (uint16_t)(0.9 * RBDIMMER_LEVEL_Q16_MAX),
+                                                1000));
+    sim_run_for(400000);
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 40));
+    from = sim_now() + 20000;
+    sim_run_for(600000);
+    int64_t to = sim_now() - 20000;
+    size_t expected = crossings_in(src, from, to);
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("stopped at 40", &st);
+    CHECK(rbdimmer_get_level(ch[0]) == 40, "level %u", rbdimmer_get_level(ch[0]));
+    CHECK(st.pulses + 1 >= expected, "%zu pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "fade kept running: angle error %.1f us", st.max_abs);
+
+    for (int i = 0; i < 40; i++) {
+        uint16_t level = (uint16_t)(((i & 1) ? 0.3 : 0.7) * RBDIMMER_LEVEL_Q16_MAX);
+        REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[0], level, 200));
+    }
+    REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[0], (uint16_t)(0.6 * RBDIMMER_LEVEL_Q16_MAX),
+                                                200));
+    sim_run_for(300000);
+    from = sim_now();
+    sim_run_for(500000);
+    to = sim_now() - 20000;
+    expected = crossings_in(src, from, to);
+    st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("after burst", &st);
+    CHECK(rbdimmer_get_level(ch[0]) == 60, "level %u", rbdimmer_get_level(ch[0]));
+    CHECK(st.pulses + 1 >= expected, "%zu pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "angle error %.1f us", st.max_abs);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Firing timers dispatched later than a whole half-cycle: every channel
+// firing is still pending at the next crossing and counted as missed.
+static void scenario_missed(void* arg) {
+    (void)arg;
+    static const uint8_t levels[2] = { 50, 80 };
+    rbdimmer_channel_t* ch[2];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 2, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    rbdimmer_zc_stats_t before, after;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &before));
+    CHECK(before.missed == 0, "%u missed with no latency", (unsigned)before.missed);
+
+    sim_set_timer_latency(11000, 11000);
+    int64_t from = sim_now();
+    sim_run_for(500000);
+    int64_t to = sim_now();
+    sim_set_timer_latency(0, 0);
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &after));
+
+    uint32_t missed = after.missed - before.missed;
+    size_t expected = crossings_in(src, from, to);
+    printf("  missed %u firings over %zu crossings x 2 channels\n", (unsigned)missed, expected);
+    CHECK(missed + 4 >= 2 * expected && missed <= 2 * expected + 2, "missed %u", (unsigned)missed);
+
+    // Back to normal: firing resumes, the counter stops
+    sim_run_for(200000);
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &before));
+    from = sim_now();
+    sim_run_for(500000);
+    to = sim_now() - 20000;
+    REQUIRE_OK(rbdimmer_get_zero_cross_stats(0, &after));
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("recovered", &st);
+    CHECK(after.missed == before.missed, "still missing %u", (unsigned)(after.missed - before.missed));
+    CHECK(st.pulses + 1 >= crossings_in(src, from, to), "%zu pulses", st.pulses);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Channels created and deleted while the mains runs: deleted gates go quiet,
+// slots are reused with a new id, survivors keep their timing.
+static void scenario_lifecycle(void* arg) {
+    (void)arg;
+    static const uint8_t levels[4] = { 30, 50, 70, 90 };
+    rbdimmer_channel_t* ch[4];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 4, levels, ch));
+    sim_run_for(WARMUP_US);
+
+    rbdimmer_channel_id_t id1 = rbdimmer_get_channel_id(ch[1]);
+    REQUIRE_OK(rbdimmer_delete_channel(ch[1]));
+    REQUIRE_OK(rbdimmer_delete_channel(ch[3]));
+    int64_t deleted_at = sim_now();
+    CHECK(rbdimmer_get_channel_by_id(id1) == NULL, "stale id resolves");
+    sim_run_for(300000);
+
+    rbdimmer_config_t cfg = {
+        .gpio_pin = GATE_PIN0 + 4, .phase = 0, .initial_level = 60,
+        .curve_type = RBDIMMER_CURVE_LINEAR,
+    };
+    rbdimmer_channel_t* fresh;
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &fresh));
+    CHECK(rbdimmer_get_channel_id(fresh) != id1, "id reused");
+    CHECK(rbdimmer_get_channel_by_gpio(GATE_PIN0 + 4) == fresh, "gpio lookup");
+    int64_t from = sim_now() + 20000;
+    sim_run_for(1000000);
+    int64_t to = sim_now() - 20000;
+
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(GATE_PIN0 + 1, &n);
+    CHECK(n == 0 || p[n - 1].rise < deleted_at, "deleted gate still fires");
+    p = sim_gate_pulses(GATE_PIN0 + 3, &n);
+    CHECK(n == 0 || p[n - 1].rise < deleted_at, "deleted gate still fires");
+
+    size_t expected = crossings_in(src, from, to);
+    angle_stats_t a = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    angle_stats_t b = angle_errors(GATE_PIN0 + 4, src, rbdimmer_get_delay(fresh), from, to);
+    print_stats("survivor", &a);
+    print_stats("new channel", &b);
+    CHECK(a.pulses + 1 >= expected && b.pulses + 1 >= expected, "%zu / %zu pulses for %zu",
+          a.pulses, b.pulses, expected);
+    CHECK(a.max_abs <= 2.0 && b.max_abs <= 2.0, "angle error %.1f / %.1f us",
+          a.max_abs, b.max_abs);
+
+    // Channels deleted while staged in a batch take their entries along:
+    // channels re-created in the same slots keep their own level unless
+    // staged themselves
+    REQUIRE_OK(rbdimmer_batch_begin());
+    REQUIRE_OK(rbdimmer_batch_set_level(ch[0], 10));
+    REQUIRE_OK(rbdimmer_batch_set_level(fresh, 15));
+    uint8_t slot_a = (uint8_t)rbdimmer_get_channel_id(ch[0]);
+    uint8_t slot_b = (uint8_t)rbdimmer_get_channel_id(fresh);
+    REQUIRE_OK(rbdimmer_delete_channel(ch[0]));
+    REQUIRE_OK(rbdimmer_delete_channel(fresh));
+    rbdimmer_channel_t* reborn[2];
+    cfg.gpio_pin = GATE_PIN0 + 5;
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &reborn[0]));
+    cfg.gpio_pin = GATE_PIN0 + 6;
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &reborn[1]));
+    uint8_t slot_c = (uint8_t)rbdimmer_get_channel_id(reborn[0]);
+    uint8_t slot_d = (uint8_t)rbdimmer_get_channel_id(reborn[1]);
+    CHECK((slot_c == slot_a && slot_d == slot_b) || (slot_c == slot_b && slot_d == slot_a),
+          "slots %u %u not reused (%u %u)", slot_c, slot_d, slot_a, slot_b);
+    REQUIRE_OK(rbdimmer_batch_set_level(reborn[1], 80));
+    REQUIRE_OK(rbdimmer_batch_commit());
+    CHECK(rbdimmer_get_level(reborn[0]) == 60, "unstaged channel at %u%%",
+          rbdimmer_get_level(reborn[0]));
+    CHECK(rbdimmer_get_level(reborn[1]) == 80, "staged channel at %u%%",
+          rbdimmer_get_level(reborn[1]));
+
+    // More delete / re-create rounds in one batch than the table has entries
+    REQUIRE_OK(rbdimmer_batch_begin());
+    for (int i = 0; i < 2 * RBDIMMER_MAX_CHANNELS; i++) {
+        REQUIRE_OK(rbdimmer_batch_set_level(reborn[0], (uint8_t)i));
+        REQUIRE_OK(rbdimmer_delete_channel(reborn[0]));
+        cfg.gpio_pin = GATE_PIN0 + 5;
+        REQUIRE_OK(rbdimmer_create_channel(&cfg, &reborn[0]));
+    }
+    REQUIRE_OK(rbdimmer_batch_set_level(reborn[1], 40));
+    REQUIRE_OK(rbdimmer_batch_commit());
+    CHECK(rbdimmer_get_level(reborn[0]) == 60 && rbdimmer_get_level(reborn[1]) == 40,
+          "levels %u%% / %u%% after re-create rounds", rbdimmer_get_level(reborn[0]),
+          rbdimmer_get_level(reborn[1]));
+
+    REQUIRE_OK(rbdimmer_deinit());
+    int64_t stopped = sim_now();
+    sim_run_for(200000);
+    p = sim_gate_pulses(GATE_PIN0, &n);
+    CHECK(n == 0 || p[n - 1].rise < stopped, "gate fires after deinit");
+}
+
+// Real-time work pinned to core 1 at level 3: the ZC interrupt (and the
+// GPTimer scheduler) are allocated there through esp_ipc, the fade engine
+// task is pinned to it, and timing is unchanged.
+static void scenario_affinity(void* arg) {
+    (void)arg;
+    static const uint8_t levels[2] = { 30, 70 };
+    rbdimmer_channel_t* ch[2];
+    CHECK(rbdimmer_set_rt_affinity(2, 0) == RBDIMMER_ERR_INVALID_ARG, "core 2 accepted");
+    CHECK(rbdimmer_set_rt_affinity(-2, 0) == RBDIMMER_ERR_INVALID_ARG, "core -2 accepted");
+    CHECK(rbdimmer_set_rt_affinity(1, 4) == RBDIMMER_ERR_INVALID_ARG, "level 4 accepted");
+    REQUIRE_OK(rbdimmer_set_rt_affinity(1, 3));
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 2, levels, ch));
+
+    sim_intr_t intr;
+    if (sim_capture_intr(0, &intr)) {
+        CHECK(intr.core == 1 && intr.level == 3,
+              "capture interrupt on core %d level %d", intr.core, intr.level);
+    } else {
+        CHECK(sim_isr_service_intr(&intr) && intr.core == 1 && intr.level == 3,
+              "GPIO ISR service on core %d level %d", intr.core, intr.level);
+    }
+    if (sim_gptimer_intr(0, &intr)) {
+        CHECK(intr.core == 1 && intr.level == 3,
+              "GPTimer interrupt on core %d level %d", intr.core, intr.level);
+    }
+    CHECK(sim_ipc_calls() > 0, "allocation did not go through esp_ipc");
+
+    sim_run_for(WARMUP_US);
+    REQUIRE_OK(rbdimmer_set_level_transition(ch[1], 50, 500));
+    sim_run_for(100000);
+    CHECK(sim_task_core("dimmer_fade") == 1, "fade task on core %d",
+          sim_task_core("dimmer_fade"));
+    sim_run_for(500000);
+
+    int64_t from = sim_now();
+    sim_run_for(1000000);
+    int64_t to = sim_now() - 20000;
+    size_t expected = crossings_in(src, from, to);
+    for (int i = 0; i < 2; i++) {
+        angle_stats_t st = angle_errors((uint8_t)(GATE_PIN0 + i), src,
+                                        rbdimmer_get_delay(ch[i]), from, to);
+        print_stats(i == 0 ? "level 30" : "faded to 50", &st);
+        CHECK(st.pulses + 1 >= expected, "%zu pulses for %zu crossings", st.pulses, expected);
+        CHECK(st.max_abs <= 2.0, "angle error %.1f us", st.max_abs);
+    }
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// ---------------------------------------------------------------------------
+
+// Phase group on three lines 120° apart: L1 and L2 with their own
+// detectors, L3 inferred from L1.  Every member fires at the group's angle
+// against its own line, at a level where L3's firing wraps into the next L1
+// half-cycle and at one where it does not; two members on L1 are staggered.
+static void scenario_group(void* arg) {
+    (void)arg;
+    int line[3];
+    line[0] = start_mains(50.0);
+    sim_zc_source_t src = {
+        .pin = ZC_PIN + 1, .freq_hz = 50.0, .phase_us = 1000 + 20000.0 / 3,
+    };
+    line[1] = sim_add_zc_source(&src);
+    src.pin      = ZC_PIN + 2;           // no detector registered: reference only
+    src.phase_us = 1000 + 2 * 20000.0 / 3;
+    line[2] = sim_add_zc_source(&src);
+
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 50));
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN + 1, 1, 50));
+    rbdimmer_group_config_t cfg = {
+        .reference_phase = 0,
+        .member_count    = 4,
+        .members = {
+            { .gpio_pin = GATE_PIN0,     .phase = 0 },
+            { .gpio_pin = GATE_PIN0 + 1, .phase = 1 },
+            { .gpio_pin = GATE_PIN0 + 2, .phase = RBDIMMER_GROUP_PHASE_INFER, .lag_deg = 240 },
+            { .gpio_pin = GATE_PIN0 + 3, .phase = 0 },
+        },
+        .initial_level = 50,
+        .curve_type    = RBDIMMER_CURVE_LINEAR,
+        .stagger_us    = 200,
+    };
+    rbdimmer_group_t* group;
+    rbdimmer_group_config_t bad = cfg;
+    bad.member_count = 0;
+    CHECK(rbdimmer_group_create(&bad, &group) == RBDIMMER_ERR_INVALID_ARG, "0 members");
+    bad = cfg;
+    bad.members[1].phase = 2;
+    CHECK(rbdimmer_group_create(&bad, &group) == RBDIMMER_ERR_NOT_FOUND, "phase 2");
+    REQUIRE_OK(rbdimmer_group_create(&cfg, &group));
+    sim_run_for(WARMUP_US);
+
+    // Member on L2 has no lag and no stagger: its delay is the group angle
+    static const uint8_t levels[2] = { 50, 20 };
+    static const int32_t skew[4] = { -100, 0, 0, +100 };
+    for (int l = 0; l < 2; l++) {
+        REQUIRE_OK(rbdimmer_group_set_level(group, levels[l]));
+        sim_run_for(100000);
+        uint32_t angle = rbdimmer_get_delay(rbdimmer_group_get_channel(group, 1));
+        int64_t from = sim_now();
+        sim_run_for(500000);
+        int64_t to = sim_now() - 20000;
+        printf("  level %u: angle %u us\n", levels[l], (unsigned)angle);
+        for (uint8_t m = 0; m < 4; m++) {
+            int src_line = (m == 3) ? line[0] : line[m];
+            size_t expected = crossings_in(src_line, from, to);
+            angle_stats_t st = angle_errors((uint8_t)(GATE_PIN0 + m), src_line,
+                                            (uint32_t)((int32_t)angle + skew[m]), from, to);
+            char what[16];
+            snprintf(what, sizeof(what), "member %u", m);
+            print_stats(what, &st);
+            CHECK(st.pulses + 1 >= expected, "member %u: %zu pulses for %zu crossings",
+                  m, st.pulses, expected);
+            CHECK(st.max_abs <= 2.0, "member %u: angle error %.1f us", m, st.max_abs);
+        }
+    }
+
+    uint16_t lag;
+    REQUIRE_OK(rbdimmer_group_get_phase_lag(group, 1, &lag));
+    CHECK(lag == 120, "L2 measured lag %u", lag);
+    REQUIRE_OK(rbdimmer_group_get_phase_lag(group, 2, &lag));
+    CHECK(lag == 60, "L3 configured lag %u", lag);
+    CHECK(rbdimmer_group_get_level_q16(group) == (uint16_t)((20u * RBDIMMER_LEVEL_Q16_MAX + 50u) / 100u),
+          "group level %u", rbdimmer_group_get_level_q16(group));
+
+    REQUIRE_OK(rbdimmer_group_delete(group));
+    int64_t deleted = sim_now();
+    sim_run_for(100000);
+    for (uint8_t m = 0; m < 4; m++) {
+        size_t n;
+        const sim_pulse_t* p = sim_gate_pulses((uint8_t)(GATE_PIN0 + m), &n);
+        CHECK(n == 0 || p[n - 1].rise < deleted + 20000, "member %u fires after delete", m);
+    }
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Burst fire: whole mains cycles switched at the crossing, no timers.
+// Checks the conducting share, that both half-cycles of a cycle conduct,
+// that two channels at 50 % take turns and that a phase-angle channel on
+// the same phase is unaffected.
+typedef struct {
+    size_t halves;                  // conducting half-cycles
+    size_t odd_runs;                // runs of conducting half-cycles with odd length
+    double max_rise_us;             // gate on after the crossing
+    double max_fall_us;             // gate off against the next crossing (absolute)
+} burst_stats_t;
+
+static burst_stats_t burst_profile(uint8_t pin, int src, int64_t from, int64_t to,
+                                   uint8_t* on, size_t n_halves, long first) {
+    burst_stats_t st = { 0, 0, 0.0, 0.0 };
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(pin, &n);
+    const int64_t* cross = sim_zc_crossings(src, &(size_t){ 0 });
+    memset(on, 0, n_halves);
+    for (size_t i = 0; i < n; i++) {
+        if (p[i].rise < from || p[i].rise >= to) {
+            continue;
+        }
+        long k = sim_crossing_before(src, p[i].rise);
+        if (k < first || (size_t)(k - first) >= n_halves) {
+            continue;
+        }
+        on[k - first] = 1;
+        st.halves++;
+        double rise = (double)(p[i].rise - cross[k]);
+        st.max_rise_us = rise > st.max_rise_us ? rise : st.max_rise_us;
+        if (p[i].fall >= 0) {
+            double fall = fabs((double)(p[i].fall - cross[k + 1]));
+            st.max_fall_us = fall > st.max_fall_us ? fall : st.max_fall_us;
+        }
+    }
+    // Interior runs only: the window edges may cut a cycle in half
+    size_t run = 0;
+    bool leading = true;
+    for (size_t k = 0; k < n_halves; k++) {
+        if (on[k]) {
+            run++;
+            continue;
+        }
+        if (run % 2 != 0 && !leading) {
+            st.odd_runs++;
+        }
+        run = 0;
+        leading = false;
+    }
+    return st;
+}
+
+static void scenario_burst(void* arg) {
+    (void)arg;
+    enum { HALVES = 200 };
+    static uint8_t on[4][HALVES];
+    int src = start_mains(50.0);
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 50));
+
+    rbdimmer_config_t cfg = {
+        .gpio_pin = GATE_PIN0, .phase = 0, .initial_level = 50,
+        .curve_type = RBDIMMER_CURVE_LINEAR, .mode = (rbdimmer_mode_t)7,
+    };
+    rbdimmer_channel_t* ch[4];
+    CHECK(rbdimmer_create_channel(&cfg, &ch[0]) == RBDIMMER_ERR_INVALID_ARG, "mode 7");
+    static const uint8_t levels[4] = { 50, 50, 25, 50 };
+    for (uint8_t i = 0; i < 4; i++) {
+        cfg.gpio_pin      = (uint8_t)(GATE_PIN0 + i);
+        cfg.initial_level = levels[i];
+        cfg.mode          = (i < 3) ? RBDIMMER_MODE_BURST : RBDIMMER_MODE_PHASE;
+        REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch[i]));
+    }
+    CHECK(rbdimmer_get_delay(ch[0]) == 0, "burst delay %u", (unsigned)rbdimmer_get_delay(ch[0]));
+    sim_run_for(WARMUP_US);
+
+    int64_t from = sim_now();
+    long first = sim_crossing_before(src, from) + 1;
+    sim_run_for(HALVES * 10000 + 5000);
+    int64_t to = sim_now() - 20000;
+    for (uint8_t i = 0; i < 3; i++) {
+        burst_stats_t st = burst_profile((uint8_t)(GATE_PIN0 + i), src, from, to,
+                                         on[i], HALVES - 2, first);
+        size_t expected = (size_t)(levels[i] * (HALVES - 2) / 100);
+        printf("  burst %u%%: %zu of %d half-cycles, odd runs %zu, rise %.1f us, fall %.1f us\n",
+               levels[i], st.halves, HALVES - 2, st.odd_runs, st.max_rise_us, st.max_fall_us);
+        CHECK(st.halves + 2 >= expected && st.halves <= expected + 2,
+              "channel %u: %zu conducting half-cycles, expected %zu", i, st.halves, expected);
+        CHECK(st.odd_runs == 0, "channel %u: %zu runs cut a mains cycle", i, st.odd_runs);
+        CHECK(st.max_rise_us <= 2.0, "channel %u: gate on %.1f us after the crossing",
+              i, st.max_rise_us);
+        CHECK(st.max_fall_us <= 2.0, "channel %u: gate off %.1f us from the crossing",
+              i, st.max_fall_us);
+    }
+    size_t both = 0;
+    for (size_t k = 0; k < HALVES - 2; k++) {
+        both += on[0][k] && on[1][k];
+    }
+    CHECK(both == 0, "50 %% channels conduct together in %zu half-cycles", both);
+    angle_stats_t st = angle_errors(GATE_PIN0 + 3, src, rbdimmer_get_delay(ch[3]), from, to);
+    print_stats("phase 50%", &st);
+    CHECK(st.pulses + 1 >= crossings_in(src, from, to) && st.max_abs <= 2.0,
+          "phase channel: %zu pulses, error %.1f us", st.pulses, st.max_abs);
+
+    // Level API: full, off, disabled; a transition falls back to the fade engine
+    REQUIRE_OK(rbdimmer_set_level(ch[2], 100));
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 0));
+    REQUIRE_OK(rbdimmer_set_active(ch[1], false));
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(GATE_PIN0 + 1, &n);
+    CHECK(n > 0 && p[n - 1].fall >= 0, "disabled burst gate left HIGH");
+    sim_run_for(50000);
+    from = sim_now();
+    first = sim_crossing_before(src, from) + 1;
+    sim_run_for(500000);
+    to = sim_now() - 20000;
+    burst_stats_t full = burst_profile(GATE_PIN0 + 2, src, from, to, on[2], 45, first);
+    burst_stats_t off  = burst_profile(GATE_PIN0, src, from, to, on[0], 45, first);
+    burst_stats_t dis  = burst_profile(GATE_PIN0 + 1, src, from, to, on[1], 45, first);
+    CHECK(full.halves == 45, "100 %%: %zu of 45 half-cycles", full.halves);
+    CHECK(off.halves == 0 && dis.halves == 0, "off %zu / disabled %zu half-cycles",
+          off.halves, dis.halves);
+
+    REQUIRE_OK(rbdimmer_set_level_transition_zc(ch[2], 0, 200));
+    sim_run_for(400000);
+    CHECK(rbdimmer_get_level(ch[2]) == 0, "transition ended at %u %%", rbdimmer_get_level(ch[2]));
+    int64_t faded = sim_now();
+    sim_run_for(100000);
+    p = sim_gate_pulses(GATE_PIN0 + 2, &n);
+    CHECK(n == 0 || p[n - 1].rise < faded, "burst channel conducts after fading out");
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Soft start: leaving OFF ramps from the dark end of the half-cycle to the
+// target over the configured half-cycles — level from 0, a retarget during
+// the ramp (no jump), a re-enable — and jumps straight there once disabled.
+static uint32_t first_delay_after(uint8_t pin, int src, int64_t t) {
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(pin, &n);
+    const int64_t* cross = sim_zc_crossings(src, &(size_t){ 0 });
+    for (size_t i = 0; i < n; i++) {
+        if (p[i].rise >= t) {
+            return (uint32_t)(p[i].rise - cross[sim_crossing_before(src, p[i].rise)]);
+        }
+    }
+    return 0;
+}
+
+static void scenario_soft_start(void* arg) {
+    (void)arg;
+    enum { RAMP = 20 };
+    static const uint8_t levels[1] = { 0 };
+    rbdimmer_channel_t* ch[1];
+    int src = start_mains(50.0);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    REQUIRE_OK(rbdimmer_set_soft_start(ch[0], RAMP));
+    sim_run_for(WARMUP_US);
+
+    int64_t from = sim_now();
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 90));
+    sim_run_for((RAMP + 5) * 10000);
+    uint32_t target = rbdimmer_get_delay(ch[0]);
+    uint32_t first = first_delay_after(GATE_PIN0, src, from);
+    uint32_t max_step;
+    int reversals;
+    fade_profile(GATE_PIN0, from, sim_now(), src, -1, &max_step, &reversals);
+    uint32_t ideal = (10000 - 100 - target) / RAMP;
+    printf("  from 0: first %u us, target %u us, step max %u us (ideal %u), reversals %d\n",
+           (unsigned)first, (unsigned)target, (unsigned)max_step, (unsigned)ideal, reversals);
+    CHECK(first >= 10000 - 100 - ideal - 2, "first firing at %u us", (unsigned)first);
+    CHECK(reversals == 0 && max_step <= ideal + 2, "step %u us, %d reversals",
+          (unsigned)max_step, reversals);
+    angle_stats_t st = angle_errors(GATE_PIN0, src, target, sim_now() - 50000, sim_now() - 10000);
+    CHECK(st.pulses >= 3 && st.max_abs <= 2.0, "not at the target after the ramp");
+
+    // Off, on again, retarget halfway: the ramp continues from where it is
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 0));
+    sim_run_for(50000);
+    from = sim_now();
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 90));
+    sim_run_for(RAMP / 2 * 10000);
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 60));
+    sim_run_for((RAMP + 5) * 10000);
+    fade_profile(GATE_PIN0, from, sim_now(), src, -1, &max_step, &reversals);
+    printf("  retarget: step max %u us, reversals %d\n", (unsigned)max_step, reversals);
+    CHECK(reversals == 0 && max_step <= ideal + 2, "retarget jumped %u us", (unsigned)max_step);
+
+    // Re-enable starts dark again
+    REQUIRE_OK(rbdimmer_set_active(ch[0], false));
+    sim_run_for(50000);
+    from = sim_now();
+    REQUIRE_OK(rbdimmer_set_active(ch[0], true));
+    sim_run_for(50000);
+    first = first_delay_after(GATE_PIN0, src, from);
+    CHECK(first >= 10000 - 100 - ideal - 2, "re-enable fired first at %u us", (unsigned)first);
+
+    // Disabled: straight to the angle
+    REQUIRE_OK(rbdimmer_set_soft_start(ch[0], 0));
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 0));
+    sim_run_for(50000);
+    from = sim_now();
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 90));
+    sim_run_for(50000);
+    first = first_delay_after(GATE_PIN0, src, from);
+    CHECK(first == target, "without soft start first firing at %u us, target %u",
+          (unsigned)first, (unsigned)target);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Gate drive: a stretched pulse, a default pulse at the same angle (no longer
+// one firing group: they release apart), a gate hold released
+// RBDIMMER_GATE_HOLD_GUARD_US before the next crossing and, on the GPTimer
+// backend, a pulse train over the same span.
+static void scenario_gate(void* arg) {
+    (void)arg;
+    enum { WIDE = 300, TRAIN_PULSE = 100 };
+    int src = start_mains(50.0);
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 50));
+
+    rbdimmer_config_t cfg = {
+        .gpio_pin = GATE_PIN0, .phase = 0, .initial_level = 50,
+        .curve_type = RBDIMMER_CURVE_LINEAR,
+        .pulse_width_us = RBDIMMER_PULSE_WIDTH_MAX_US + 1,
+    };
+    rbdimmer_channel_t* ch[4];
+    CHECK(rbdimmer_create_channel(&cfg, &ch[0]) == RBDIMMER_ERR_INVALID_ARG, "pulse too long");
+    cfg.gate           = RBDIMMER_GATE_TRAIN;
+    cfg.pulse_width_us = RBDIMMER_GATE_TRAIN_PERIOD_US;
+    CHECK(rbdimmer_create_channel(&cfg, &ch[0]) == RBDIMMER_ERR_INVALID_ARG,
+          "train pulse as long as its period");
+
+    static const rbdimmer_gate_t gates[4] = {
+        RBDIMMER_GATE_PULSE, RBDIMMER_GATE_PULSE, RBDIMMER_GATE_HOLD, RBDIMMER_GATE_TRAIN,
+    };
+    static const uint16_t widths[4] = { WIDE, 0, 0, TRAIN_PULSE };
+    static const uint8_t levels[4] = { 50, 50, 50, 70 };
+#ifdef CONFIG_RBDIMMER_TIMER_BACKEND_GPTIMER
+    const int channels = 4;
+#else
+    const int channels = 3;
+#endif
+    for (int i = 0; i < 4; i++) {
+        cfg.gpio_pin       = (uint8_t)(GATE_PIN0 + i);
+        cfg.initial_level  = levels[i];
+        cfg.gate           = gates[i];
+        cfg.pulse_width_us = widths[i];
+        if (i >= channels) {
+            CHECK(rbdimmer_create_channel(&cfg, &ch[i]) == RBDIMMER_ERR_INVALID_ARG,
+                  "pulse train accepted without the GPTimer backend");
+            break;
+        }
+        REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch[i]));
+    }
+    sim_run_for(WARMUP_US);
+
+    int64_t from = sim_now();
+    sim_run_for(1000000);
+    int64_t to = sim_now() - 20000;
+    size_t expected = crossings_in(src, from, to);
+    const int64_t* cross = sim_zc_crossings(src, &(size_t){ 0 });
+
+    static const uint32_t want[2] = { WIDE, RBDIMMER_DEFAULT_PULSE_WIDTH_US };
+    for (int i = 0; i < 2; i++) {
+        angle_stats_t st = angle_errors((uint8_t)(GATE_PIN0 + i), src,
+                                        rbdimmer_get_delay(ch[i]), from, to);
+        print_stats(i == 0 ? "wide pulse" : "default pulse", &st);
+        CHECK(st.pulses + 1 >= expected && st.max_abs <= 2.0,
+              "%zu pulses, angle error %.1f us", st.pulses, st.max_abs);
+        CHECK(st.width_min >= want[i] && st.width_max <= want[i] + 2,
+              "pulse width %u..%u us, want %u", st.width_min, st.width_max, (unsigned)want[i]);
+    }
+
+    // Hold: on at the angle, off a guard before the next crossing
+    angle_stats_t st = angle_errors(GATE_PIN0 + 2, src, rbdimmer_get_delay(ch[2]), from, to);
+    print_stats("hold", &st);
+    CHECK(st.pulses + 1 >= expected && st.max_abs <= 2.0,
+          "%zu holds, angle error %.1f us", st.pulses, st.max_abs);
+    size_t n;
+    const sim_pulse_t* p = sim_gate_pulses(GATE_PIN0 + 2, &n);
+    int bad = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (p[i].rise < from || p[i].rise >= to) {
+            continue;
+        }
+        long k = sim_crossing_before(src, p[i].rise);
+        int64_t end = p[i].fall - cross[k];
+        int64_t hold = 10000 - RBDIMMER_GATE_HOLD_GUARD_US;
+        if (p[i].fall < 0 || end < hold - 2 || end > hold + 2) {
+            bad++;
+        }
+    }
+    CHECK(bad == 0, "%d holds not released %d us before the crossing", bad,
+          RBDIMMER_GATE_HOLD_GUARD_US);
+
+    if (channels == 4) {
+        // Train: pulses every period from the angle until the hold release
+        uint32_t d = rbdimmer_get_delay(ch[3]);
+        uint32_t release = 10000 - RBDIMMER_GATE_HOLD_GUARD_US;
+        size_t per_half = (release - d - 1) / RBDIMMER_GATE_TRAIN_PERIOD_US + 1;
+        p = sim_gate_pulses(GATE_PIN0 + 3, &n);
+        size_t pulses = 0;
+        bad = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (p[i].rise < from || p[i].rise >= to) {
+                continue;
+            }
+            long k = sim_crossing_before(src, p[i].rise);
+            int64_t at = p[i].rise - cross[k] - d;
+            int64_t slot = (at + RBDIMMER_GATE_TRAIN_PERIOD_US / 2) / RBDIMMER_GATE_TRAIN_PERIOD_US;
+            int64_t err = at - slot * RBDIMMER_GATE_TRAIN_PERIOD_US;
+            int64_t w = p[i].fall - p[i].rise;
+            int64_t cut = (int64_t)release - (int64_t)d - at;   // last pulse may end at the release
+            if (err < -2 || err > 2 || p[i].fall < 0 ||
+                w < (cut < TRAIN_PULSE ? cut : TRAIN_PULSE) - 2 || w > TRAIN_PULSE + 2) {
+                bad++;
+            }
+            pulses++;
+        }
+        printf("  train          pulses %5zu  (%zu per half-cycle), %d off slot\n",
+               pulses, per_half, bad);
+        CHECK(bad == 0, "%d train pulses off their slot or width", bad);
+        CHECK(pulses + per_half >= expected * per_half && pulses <= (expected + 1) * per_half,
+              "%zu train pulses for %zu crossings", pulses, expected);
+    }
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// Trailing edge: the gate is on from the crossing to the mirrored cut-off,
+// conducting as long as a leading-edge channel at the same level, with one
+// timed event (the release) per half-cycle.  OFF and set_active(false) keep
+// the gate low.
+static void scenario_trailing(void* arg) {
+    (void)arg;
+    int src = start_mains(50.0);
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 50));
+
+    rbdimmer_config_t cfg = {
+        .gpio_pin = GATE_PIN0, .phase = 0, .initial_level = 50,
+        .curve_type = RBDIMMER_CURVE_RMS, .mode = RBDIMMER_MODE_TRAILING,
+    };
+    rbdimmer_channel_t* ch[2];
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch[0]));
+    cfg.gpio_pin = GATE_PIN0 + 1;
+    cfg.mode     = RBDIMMER_MODE_PHASE;
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch[1]));
+    sim_run_for(WARMUP_US);
+
+    uint32_t cutoff = rbdimmer_get_delay(ch[0]);
+    uint32_t delay  = rbdimmer_get_delay(ch[1]);
+    CHECK(cutoff == 10000 - delay, "cut-off %u for leading delay %u",
+          (unsigned)cutoff, (unsigned)delay);
+
+#if RBDIMMER_INSTRUMENT
+    REQUIRE_OK(rbdimmer_reset_timing_stats(0));
+#endif
+    int64_t from = sim_now();
+    sim_run_for(1000000);
+    int64_t to = sim_now() - 20000;
+    size_t expected = crossings_in(src, from, to);
+    angle_stats_t st = angle_errors(GATE_PIN0, src, 0, from, to);
+    print_stats("trailing on", &st);
+    CHECK(st.pulses + 1 >= expected && st.pulses <= expected + 1,
+          "%zu gate pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "gate on %.1f us off the crossing", st.max_abs);
+    CHECK(st.width_min + 2 >= cutoff && st.width_max <= cutoff + 2,
+          "conduction %u..%u us, cut-off %u", st.width_min, st.width_max, (unsigned)cutoff);
+#if RBDIMMER_INSTRUMENT
+    rbdimmer_timing_stats_t ts;
+    REQUIRE_OK(rbdimmer_get_timing_stats(0, &ts));
+    uint32_t halves = (uint32_t)crossings_in(src, from, sim_now());
+    printf("  events: %u fires, %u releases over %u half-cycles\n",
+           (unsigned)ts.fire_late_us.count, (unsigned)ts.release_late_us.count,
+           (unsigned)halves);
+    // The leading-edge channel fires and releases; trailing adds a release only
+    CHECK(ts.fire_late_us.count <= halves + 1 && ts.release_late_us.count <= 2 * halves + 2,
+          "%u fires / %u releases for %u half-cycles", (unsigned)ts.fire_late_us.count,
+          (unsigned)ts.release_late_us.count, (unsigned)halves);
+#endif
+
+    // Brighter = later cut-off
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 80));
+    CHECK(rbdimmer_get_delay(ch[0]) > cutoff, "cut-off %u at 80%% not after %u",
+          (unsigned)rbdimmer_get_delay(ch[0]), (unsigned)cutoff);
+    cutoff = rbdimmer_get_delay(ch[0]);
+    sim_run_for(50000);
+    from = sim_now();
+    sim_run_for(200000);
+    st = angle_errors(GATE_PIN0, src, 0, from, sim_now() - 20000);
+    CHECK(st.pulses > 0 && st.width_min + 2 >= cutoff && st.width_max <= cutoff + 2,
+          "80%%: conduction %u..%u us, cut-off %u", st.width_min, st.width_max,
+          (unsigned)cutoff);
+
+    // OFF, then disabled: no conduction
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 0));
+    sim_run_for(50000);
+    from = sim_now();
+    sim_run_for(200000);
+    st = angle_errors(GATE_PIN0, src, 0, from, sim_now());
+    CHECK(st.pulses == 0 && rbdimmer_get_delay(ch[0]) == 0, "%zu pulses while OFF", st.pulses);
+    REQUIRE_OK(rbdimmer_set_level(ch[0], 50));
+    REQUIRE_OK(rbdimmer_set_active(ch[0], false));
+    sim_run_for(50000);
+    from = sim_now();
+    sim_run_for(200000);
+    st = angle_errors(GATE_PIN0, src, 0, from, sim_now());
+    CHECK(st.pulses == 0, "%zu pulses while disabled", st.pulses);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+#ifdef CONFIG_RBDIMMER_PERSIST_INTERVAL_MS
+#define PERSIST_US  ((int64_t)CONFIG_RBDIMMER_PERSIST_INTERVAL_MS * 1000)
+#else
+#define PERSIST_US  5000000
+#endif
+
+// Fast boot: a second boot starts from the stored 60 Hz half-cycle,
+// detector offset, level and curve, so the first crossings already fire at
+// the calibrated angle.  A fade is written once, after it settled.  A
+// stored period that does not match the mains is replaced by the
+// background acquisition.
+static void scenario_persist(void* arg) {
+    (void)arg;
+#ifndef CONFIG_RBDIMMER_PERSIST
+    exit(SKIP);
+#endif
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 60.0, .phase_us = 1000, .edge_offset_us = 150,
+    };
+    int src = sim_add_zc_source(&mains);
+    rbdimmer_config_t cfg = {
+        .gpio_pin = GATE_PIN0, .phase = 0, .initial_level = 20,
+        .curve_type = RBDIMMER_CURVE_LINEAR,
+    };
+    rbdimmer_channel_t* ch;
+
+    // Boot 1: acquire and calibrate, then fade to the level to restore
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 0));
+    REQUIRE_OK(rbdimmer_set_zero_cross_offset(0, 150));
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch));
+    sim_run_for(WARMUP_US + 3 * PERSIST_US);
+    uint32_t writes = sim_nvs_writes();
+    CHECK(writes >= 1, "calibration never written");
+    REQUIRE_OK(rbdimmer_set_curve(ch, RBDIMMER_CURVE_RMS));
+    REQUIRE_OK(rbdimmer_set_level_transition(ch, 70, 2000));
+    sim_run_for(2000000 + 3 * PERSIST_US);
+    CHECK(sim_nvs_writes() - writes == 1, "%u writes for a fade",
+          (unsigned)(sim_nvs_writes() - writes));
+
+    // A slow write (program + page erase) must not move the gates.  In the
+    // static variant they are timed on the esp_timer task.
+    sim_set_nvs_commit_us(30000);
+    writes = sim_nvs_writes();
+    REQUIRE_OK(rbdimmer_set_level(ch, 50));
+    int64_t from = sim_now() + 20000;
+    sim_run_for(3 * PERSIST_US);
+    size_t expected = crossings_in(src, from, sim_now() - 10000);
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch), from,
+                                    sim_now() - 10000);
+    print_stats("during write", &st);
+    CHECK(sim_nvs_writes() - writes == 1, "%u writes for a level change",
+          (unsigned)(sim_nvs_writes() - writes));
+    CHECK(st.pulses + 2 >= expected, "%zu pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "angle error %.1f us around the write", st.max_abs);
+    uint32_t delay = rbdimmer_get_delay(ch);
+    REQUIRE_OK(rbdimmer_deinit());
+    sim_run_for(100000);
+
+    // Boot 2: no acquisition, no default half-cycle
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 0));
+    CHECK(rbdimmer_get_frequency(0) == 60, "seeded %u Hz", rbdimmer_get_frequency(0));
+    cfg.initial_level = 0;
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch));
+    CHECK(rbdimmer_get_level(ch) == 50 && rbdimmer_get_curve(ch) == RBDIMMER_CURVE_RMS,
+          "restored level %u curve %d", rbdimmer_get_level(ch), rbdimmer_get_curve(ch));
+    CHECK(rbdimmer_get_delay(ch) + 2 >= delay && rbdimmer_get_delay(ch) <= delay + 2,
+          "restored delay %u, was %u", (unsigned)rbdimmer_get_delay(ch), (unsigned)delay);
+    int64_t boot = sim_now();
+    sim_run_for(200000);                // well inside a cold acquisition
+    expected = crossings_in(src, boot, sim_now() - 10000);
+    st = angle_errors(GATE_PIN0, src, delay, boot, sim_now() - 10000);
+    print_stats("first 200 ms", &st);
+    CHECK(st.pulses + 2 >= expected, "%zu pulses for %zu crossings", st.pulses, expected);
+    CHECK(st.max_abs <= 2.0, "angle error %.1f us after boot", st.max_abs);
+    REQUIRE_OK(rbdimmer_deinit());
+
+    // Boot 3 on 50 Hz mains: the stored 60 Hz is verified and replaced
+    sim_zc_source(src)->freq_hz = 50.0;
+    sim_run_for(100000);
+    writes = sim_nvs_writes();
+    REQUIRE_OK(rbdimmer_init());
+    REQUIRE_OK(rbdimmer_register_zero_cross(ZC_PIN, 0, 0));
+    REQUIRE_OK(rbdimmer_create_channel(&cfg, &ch));
+    sim_run_for(WARMUP_US);
+    CHECK(rbdimmer_get_frequency(0) == 50, "re-seeded %u Hz", rbdimmer_get_frequency(0));
+    from = sim_now();
+    sim_run_for(300000);
+    st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch), from, sim_now() - 10000);
+    print_stats("re-seeded", &st);
+    CHECK(st.pulses > 0 && st.max_abs <= 2.0, "angle error %.1f us after re-seed", st.max_abs);
+    sim_run_for(3 * PERSIST_US);
+    CHECK(sim_nvs_writes() > writes, "50 Hz period not stored");
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+// MCPWM capture input on a timer that ignores the requested 1 MHz and
+// counts at 80 MHz (ESP32 APB), wrapping mid-run: the latched edge is
+// converted at the real resolution, so 5 … 40 µs ISR latency leaves only
+// the shortest latency as a constant offset.  A resolution that is not a
+// whole number of ticks per µs is refused and the GPIO ISR takes over.
+static void scenario_capture(void* arg) {
+    (void)arg;
+#ifndef CONFIG_RBDIMMER_ZC_HW_CAPTURE
+    exit(SKIP);
+#endif
+    static const uint8_t levels[1] = { 50 };
+    rbdimmer_channel_t* ch[1];
+    sim_zc_source_t mains = {
+        .pin = ZC_PIN, .freq_hz = 50.0, .phase_us = 1000,
+        .latency_min_us = 5, .latency_max_us = 40,
+    };
+    int src = sim_add_zc_source(&mains);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    sim_intr_t intr;
+    CHECK(sim_capture_intr(0, &intr), "ZC input not on a capture channel");
+    CHECK(!sim_isr_service_intr(&intr), "GPIO ISR service installed");
+    sim_run_for(WARMUP_US + 1000000);
+
+    int64_t from = sim_now();
+    sim_run_for(2000000);                   // capture count wraps in here
+    int64_t to = sim_now() - 20000;
+    angle_stats_t st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("capture 80 MHz", &st);
+    CHECK(st.pulses + 1 >= crossings_in(src, from, to), "%zu pulses", st.pulses);
+    CHECK(st.sd < 1.0, "latency reached the gate: spread %.2f us", st.sd);
+    CHECK(st.max_abs <= mains.latency_min_us + 2.0, "angle error %.1f us", st.max_abs);
+#if RBDIMMER_INSTRUMENT
+    rbdimmer_timing_stats_t ts;
+    REQUIRE_OK(rbdimmer_get_timing_stats(0, &ts));
+    printf("  zc latency histogram: %u samples, max %u us\n",
+           (unsigned)ts.zc_latency_us.count, (unsigned)ts.zc_latency_us.max);
+    // max 0 = every edge re-anchored on the ISR time: timestamp lost
+    CHECK(ts.zc_latency_us.count > 0 && ts.zc_latency_us.max > 0 &&
+          ts.zc_latency_us.max <= mains.latency_max_us,
+          "latency %u samples, max %u us", (unsigned)ts.zc_latency_us.count,
+          (unsigned)ts.zc_latency_us.max);
+#endif
+    REQUIRE_OK(rbdimmer_deinit());
+
+    // 1.5 ticks per µs cannot be converted exactly: GPIO ISR fallback
+    sim_set_capture_resolution(1500000);
+    REQUIRE_OK(setup(50, 1, levels, ch));
+    CHECK(!sim_capture_intr(0, &intr), "capture channel kept at 1.5 MHz");
+    CHECK(sim_isr_service_intr(&intr), "no GPIO ISR service after the fallback");
+    sim_run_for(WARMUP_US);
+    from = sim_now();
+    sim_run_for(500000);
+    to = sim_now() - 20000;
+    st = angle_errors(GATE_PIN0, src, rbdimmer_get_delay(ch[0]), from, to);
+    print_stats("GPIO ISR fallback", &st);
+    CHECK(st.pulses + 1 >= crossings_in(src, from, to), "%zu pulses", st.pulses);
+    CHECK(st.max_abs <= mains.latency_max_us + 2.0, "angle error %.1f us", st.max_abs);
+    REQUIRE_OK(rbdimmer_deinit());
+}
+
+static const struct {
+    const char* name;
+    void (*fn)(void* arg);
+} scenarios[] = {
+    { "steady",    scenario_steady },
+    { "drift",     scenario_drift },
+    { "jitter",    scenario_jitter },
+    { "glitch",    scenario_glitch },
+    { "dropout",   scenario_dropout },
+    { "fade_zc",   scenario_fade_zc },
+    { "fade_task", scenario_fade_task },
+    { "commands",  scenario_commands },
+    { "missed",    scenario_missed },
+    { "lifecycle", scenario_lifecycle },
+    { "affinity",  scenario_affinity },
+    { "group",     scenario_group },
+    { "burst",     scenario_burst },
+    { "soft_start", scenario_soft_start },
+    { "gate",      scenario_gate },
+    { "trailing",  scenario_trailing },
+    { "persist",   scenario_persist },
+    { "capture",   scenario_capture },
+};
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <scenario>\n", argv[0]);
+        return 2;
+    }
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        if (strcmp(argv[1], scenarios[i].name) == 0) {
+            printf("[%s] %s\n", SIM_VARIANT, scenarios[i].name);
+            sim_reset(1234);
+            if (sim_main(scenarios[i].fn, NULL) != 0) {
+                printf("FAIL simulation deadlocked\n");
+                return 1;
+            }
+            printf("%s\n", failures ? "FAILED" : "passed");
+            return failures ? 1 : 0;
+        }
+    }
+    fprintf(stderr, "unknown scenario '%s'\n", argv[1]);
+    return 2;
+}
@@ -0,0 +1,515 @@
+/**
+ * @file bench.c
+ * @brief On-target timing benchmark (CONFIG_TEST_APP_BENCH)
+ *
+ *   LEDC ──► ZC_OUT ══jumper══► ZC_IN ──► rbdimmer zero-cross ISR
+ *                                  │
+ *                                  └──► probe: reference edge
+ *   gate[0], gate[n-1] ────────────────► probes: gate rising edge
+ *
+ * LEDC generates one short pulse per simulated half-cycle.  The first and
+ * the last gate of the sweep step (earliest and latest delay) are probed
+ * against the zero-cross input edge:
+ *   - chips with MCPWM: capture channels of one capture timer — hardware
+ *     timestamps, exact to 1 µs
+ *   - ESP32-S2 / C3: GPIO interrupts on the gate pins against the
+ *     zero-cross callback — both ISR timestamps, so the error includes the
+ *     difference of two interrupt latencies
+ *
+ * Reported per channel count: ZC ISR cycles (CONFIG_RBDIMMER_INSTRUMENT),
+ * CPU load of the ISR core from an idle-hook counter against a baseline
+ * (includes the probe ISRs), gate error (measured edge-to-gate time minus
+ * rbdimmer_get_delay()) and pulses missed by the probes and by the library.
+ */
+
+#include "bench.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "driver/ledc.h"
+#include "esp_attr.h"
+#include "esp_freertos_hooks.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "soc/soc_caps.h"
+#include "rbdimmerESP32.h"
+
+#if SOC_MCPWM_SUPPORTED
+#include "driver/mcpwm_cap.h"
+#define BENCH_USE_CAPTURE 1
+#else
+#define BENCH_USE_CAPTURE 0
+#endif
+
+#define TAG "BENCH"
+
+// Free, non-strapping output GPIOs per chip (not ZC_OUT / ZC_IN)
+#if CONFIG_IDF_TARGET_ESP32
+static const uint8_t gate_pins[] = { 16, 17, 18, 19, 21, 22, 23, 27 };
+#elif CONFIG_IDF_TARGET_ESP32S2
+static const uint8_t gate_pins[] = { 3, 4, 5, 6, 7, 8, 9, 10 };
+#elif CONFIG_IDF_TARGET_ESP32S3
+static const uint8_t gate_pins[] = { 4, 5, 6, 7, 15, 16, 17, 18 };
+#elif CONFIG_IDF_TARGET_ESP32C3
+static const uint8_t gate_pins[] = { 3, 4, 5, 6, 7, 10 };
+#elif CONFIG_IDF_TARGET_ESP32C6
+static const uint8_t gate_pins[] = { 2, 3, 4, 5, 6, 7, 10, 11 };
+#else
+#error "bench.c: add a gate pin table for this target"
+#endif
+
+#define GATE_PIN_COUNT   (sizeof(gate_pins) / sizeof(gate_pins[0]))
+#define ZC_PULSE_US      300
+#define LEDC_DUTY_BITS   14
+#define SETTLE_MS        1500            // frequency acquisition + first schedule
+#define PROBES           2               // gate probes per run
+#define ERR_BUCKETS      256             // |error| histogram, 1 µs per bucket
+
+// ---------------------------------------------------------------------------
+// Probe events (ISR → analysis task)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint8_t  probe;                     // 0 = zero-cross reference, 1.. = gates
+    uint32_t time;                      // probe clock, probe_ticks_per_us per µs
+} probe_event_t;
+
+typedef struct {
+    uint32_t expected_us;               // rbdimmer_get_delay() of the gate
+    bool     seen;                      // rose in the current half-cycle
+    uint32_t pulses;
+    uint32_t missed;
+    uint32_t extra;                     // second rise in one half-cycle
+    int64_t  err_sum;
+    uint32_t err_max;
+    uint32_t hist[ERR_BUCKETS + 1];     // last bucket: overflow
+} probe_stats_t;
+
+static QueueHandle_t event_queue;
+static SemaphoreHandle_t stats_mutex;
+static probe_stats_t probe_stats[PROBES];
+static uint8_t probe_count;
+static bool have_ref;
+static uint32_t ref_time;
+static uint32_t probe_ticks_per_us = 1;   // esp_timer, or the capture timer
+static uint32_t halves;
+static volatile uint32_t queue_overflows;
+
+static volatile uint32_t idle_count;
+
+static bool idle_hook(void) {
+    idle_count++;
+    return false;                       // keep calling: count = idle time
+}
+
+static IRAM_ATTR bool probe_post(uint8_t probe, uint32_t time) {
+    probe_event_t ev = { probe, time };
+    BaseType_t woken = pdFALSE;
+    if (xQueueSendFromISR(event_queue, &ev, &woken) != pdTRUE) {
+        queue_overflows++;
+    }
+    return woken == pdTRUE;
+}
+
+#if BENCH_USE_CAPTURE
+
+static mcpwm_cap_timer_handle_t cap_timer;
+static mcpwm_cap_channel_handle_t cap_ref;
+static mcpwm_cap_channel_handle_t cap_gate[PROBES];
+
+static IRAM_ATTR bool on_capture(mcpwm_cap_channel_handle_t chan,
+                                 const mcpwm_capture_event_data_t* edata, void* ctx) {
+    (void)chan;
+    return probe_post((uint8_t)(uintptr_t)ctx, edata->cap_value);
+}
+
+static esp_err_t capture_add(uint8_t pin, uint8_t probe, mcpwm_cap_channel_handle_t* out) {
+    mcpwm_capture_channel_config_t config = {
+        .gpio_num       = pin,
+        .prescale       = 1,
+        .flags.pos_edge = true,
+        .flags.neg_edge = false,
+    };
+    mcpwm_capture_event_callbacks_t cbs = { .on_cap = on_capture };
+    esp_err_t err = mcpwm_new_capture_channel(cap_timer, &config, out);
+    if (err == ESP_OK) {
+        err = mcpwm_capture_channel_register_event_callbacks(*out, &cbs,
+                                                             (void*)(uintptr_t)probe);
+    }
+    if (err == ESP_OK) {
+        err = mcpwm_capture_channel_enable(*out);
+    }
+    return err;
+}
+
+static void capture_remove(mcpwm_cap_channel_handle_t* chan) {
+    if (*chan != NULL) {
+        mcpwm_capture_channel_disable(*chan);
+        mcpwm_del_capture_channel(*chan);
+        *chan = NULL;
+    }
+}
+
+// Runs before the library touches the zero-cross pin: gpio_config() inside
+// mcpwm_new_capture_channel() would otherwise disable its interrupt.
+static esp_err_t probes_init(void) {
+    mcpwm_capture_timer_config_t config = {
+        .group_id      = 0,
+        .clk_src       = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
+        .resolution_hz = 1000000,
+    };
+    esp_err_t err = mcpwm_new_capture_timer(&config, &cap_timer);
+    // The capture timer may ignore the requested resolution (80 MHz APB
+    // on ESP32 / S3): convert at the one it runs at
+    uint32_t resolution_hz = 0;
+    if (err == ESP_OK) {
+        err = mcpwm_capture_timer_get_resolution(cap_timer, &resolution_hz);
+    }
+    if (err == ESP_OK && (resolution_hz == 0 || resolution_hz % 1000000 != 0)) {
+        ESP_LOGE(TAG, "Capture timer at %" PRIu32 " Hz is not a whole number of "
+                 "ticks per us", resolution_hz);
+        err = ESP_ERR_NOT_SUPPORTED;
+    }
+    if (err == ESP_OK) {
+        probe_ticks_per_us = resolution_hz / 1000000;
+        err = mcpwm_capture_timer_enable(cap_timer);
+    }
+    if (err == ESP_OK) {
+        err = mcpwm_capture_timer_start(cap_timer);
+    }
+    if (err == ESP_OK) {
+        err = capture_add(CONFIG_TEST_APP_BENCH_ZC_IN_GPIO, 0, &cap_ref);
+    }
+    return err;
+}
+
+// Gate probes are attached before the channels exist (see probes_attach())
+static esp_err_t probes_prepare(const uint8_t* pins, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        esp_err_t err = capture_add(pins[i], (uint8_t)(i + 1), &cap_gate[i]);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t probes_attach(const uint8_t* pins, uint8_t count) {
+    (void)pins;
+    (void)count;
+    return ESP_OK;
+}
+
+static void probes_detach(const uint8_t* pins, uint8_t count) {
+    (void)pins;
+    for (uint8_t i = 0; i < count; i++) {
+        capture_remove(&cap_gate[i]);
+    }
+}
+
+#else /* !BENCH_USE_CAPTURE */
+
+static IRAM_ATTR void on_zero_cross(void* arg) {
+    (void)arg;
+    if (probe_post(0, (uint32_t)esp_timer_get_time())) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static IRAM_ATTR void on_gate(void* arg) {
+    if (probe_post((uint8_t)(uintptr_t)arg, (uint32_t)esp_timer_get_time())) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static esp_err_t probes_init(void) {
+    return ESP_OK;                      // reference: zero-cross callback
+}
+
+static esp_err_t probes_prepare(const uint8_t* pins, uint8_t count) {
+    (void)pins;
+    (void)count;
+    return ESP_OK;
+}
+
+// The gates are plain GPIO outputs; the interrupt needs the input path.
+static esp_err_t probes_attach(const uint8_t* pins, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        esp_err_t err = gpio_set_intr_type(pins[i], GPIO_INTR_POSEDGE);
+        if (err == ESP_OK) {
+            err = gpio_isr_handler_add(pins[i], on_gate, (void*)(uintptr_t)(i + 1));
+        }
+        if (err == ESP_OK) {
+            err = gpio_intr_enable(pins[i]);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static void probes_detach(const uint8_t* pins, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        gpio_intr_disable(pins[i]);
+        gpio_isr_handler_remove(pins[i]);
+    }
+}
+
+#endif /* BENCH_USE_CAPTURE */
+
+// ---------------------------------------------------------------------------
+// Analysis task
+// ---------------------------------------------------------------------------
+
+static void probe_event(const probe_event_t* ev) {
+    if (ev->probe == 0) {
+        if (have_ref) {
+            halves++;
+            for (uint8_t i = 0; i < probe_count; i++) {
+                if (!probe_stats[i].seen) {
+                    probe_stats[i].missed++;
+                }
+                probe_stats[i].seen = false;
+            }
+        }
+        have_ref = true;
+        ref_time = ev->time;
+        return;
+    }
+    uint8_t i = (uint8_t)(ev->probe - 1);
+    if (!have_ref || i >= probe_count) {
+        return;
+    }
+    probe_stats_t* ps = &probe_stats[i];
+    if (ps->seen) {
+        ps->extra++;
+        return;
+    }
+    ps->seen = true;
+    ps->pulses++;
+    int32_t err = (int32_t)(ev->time - ref_time) / (int32_t)probe_ticks_per_us -
+                  (int32_t)ps->expected_us;
+    uint32_t mag = (uint32_t)(err < 0 ? -err : err);
+    ps->err_sum += err;
+    ps->err_max = mag > ps->err_max ? mag : ps->err_max;
+    ps->hist[mag < ERR_BUCKETS ? mag : ERR_BUCKETS]++;
+}
+
+static void analysis_task(void* arg) {
+    (void)arg;
+    probe_event_t ev;
+    for (;;) {
+        if (xQueueReceive(event_queue, &ev, portMAX_DELAY) == pdTRUE) {
+            xSemaphoreTake(stats_mutex, portMAX_DELAY);
+            probe_event(&ev);
+            xSemaphoreGive(stats_mutex);
+        }
+    }
+}
+
+static uint32_t hist_percentile(const probe_stats_t* ps, uint32_t permille) {
+    uint32_t rank = (uint32_t)(((uint64_t)ps->pulses * permille + 999) / 1000);
+    uint32_t cum = 0;
+    for (uint32_t b = 0; b <= ERR_BUCKETS; b++) {
+        cum += ps->hist[b];
+        if (cum >= rank && cum > 0) {
+            return b < ERR_BUCKETS ? b : ps->err_max;
+        }
+    }
+    return ps->err_max;
+}
+
+// ---------------------------------------------------------------------------
+// Sweep
+// ---------------------------------------------------------------------------
+
+static esp_err_t zc_generator_start(void) {
+    uint32_t half_us = 1000000 / (2 * CONFIG_TEST_APP_BENCH_MAINS_HZ);
+    ledc_timer_config_t timer = {
+        .speed_mode      = LEDC_LOW_SPEED_MODE,
+        .duty_resolution = LEDC_DUTY_BITS,
+        .timer_num       = LEDC_TIMER_0,
+        .freq_hz         = 2 * CONFIG_TEST_APP_BENCH_MAINS_HZ,
+        .clk_cfg         = LEDC_AUTO_CLK,
+    };
+    ledc_channel_config_t channel = {
+        .gpio_num   = CONFIG_TEST_APP_BENCH_ZC_OUT_GPIO,
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .channel    = LEDC_CHANNEL_0,
+        .intr_type  = LEDC_INTR_DISABLE,
+        .timer_sel  = LEDC_TIMER_0,
+        .duty       = (ZC_PULSE_US << LEDC_DUTY_BITS) / half_us,
+        .hpoint     = 0,
+    };
+    esp_err_t err = ledc_timer_config(&timer);
+    return err == ESP_OK ? ledc_channel_config(&channel) : err;
+}
+
+static uint32_t idle_rate_per_s(uint32_t ms) {
+    idle_count = 0;
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    return (uint32_t)((uint64_t)idle_count * 1000 / ms);
+}
+
+static void bench_step(uint8_t n, uint32_t idle_baseline) {
+    rbdimmer_channel_t* ch[GATE_PIN_COUNT];
+    uint8_t probe_pins[PROBES] = { gate_pins[0], gate_pins[n - 1] };
+    uint8_t probe_idx[PROBES]  = { 0, (uint8_t)(n - 1) };
+    uint8_t probes = n > 1 ? 2 : 1;
+
+    if (probes_prepare(probe_pins, probes) != ESP_OK) {
+        ESP_LOGE(TAG, "%2u channels: gate probes unavailable", n);
+        probes_detach(probe_pins, probes);
+        return;
+    }
+    uint8_t created = 0;
+    for (; created < n; created++) {
+        rbdimmer_config_t cfg = {
+            .gpio_pin      = gate_pins[created],
+            .phase         = 0,
+            .initial_level = (uint8_t)(n > 1 ? 10 + (80 * created) / (n - 1) : 50),
+            .curve_type    = RBDIMMER_CURVE_LINEAR,
+        };
+        if (rbdimmer_create_channel(&cfg, &ch[created]) != RBDIMMER_OK) {
+            ESP_LOGE(TAG, "%2u channels: channel %u not created", n, created);
+            break;
+        }
+    }
+    if (created == n) {
+        // Re-enable the input path that gpio_config(OUTPUT) switched off
+        for (uint8_t i = 0; i < probes; i++) {
+            gpio_set_direction(probe_pins[i], GPIO_MODE_INPUT_OUTPUT);
+        }
+        if (probes_attach(probe_pins, probes) != ESP_OK) {
+            ESP_LOGE(TAG, "%2u channels: gate probes unavailable", n);
+            created = 0;                // skip the measurement, still clean up
+        }
+    }
+
+    if (created == n) {
+        vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+
+        rbdimmer_zc_stats_t zc0, zc1;
+        rbdimmer_get_zero_cross_stats(0, &zc0);
+        rbdimmer_reset_timing_stats(0);
+        xSemaphoreTake(stats_mutex, portMAX_DELAY);
+        memset(probe_stats, 0, sizeof(probe_stats));
+        for (uint8_t i = 0; i < probes; i++) {
+            probe_stats[i].expected_us = rbdimmer_get_delay(ch[probe_idx[i]]);
+        }
+        probe_count = probes;
+        have_ref = false;
+        halves = 0;
+        queue_overflows = 0;
+        xSemaphoreGive(stats_mutex);
+
+        uint32_t idle = idle_rate_per_s(CONFIG_TEST_APP_BENCH_SECONDS * 1000);
+        rbdimmer_get_zero_cross_stats(0, &zc1);
+
+        xSemaphoreTake(stats_mutex, portMAX_DELAY);
+        probe_stats_t ps[PROBES];
+        memcpy(ps, probe_stats, sizeof(ps));
+        uint32_t h = halves;
+        probe_count = 0;
+        xSemaphoreGive(stats_mutex);
+
+        uint32_t load_pm = idle >= idle_baseline ? 0
+                         : (uint32_t)(1000 - (uint64_t)idle * 1000 / idle_baseline);
+        uint32_t cyc_mean = 0, cyc_max = 0, late_max = 0;
+#if RBDIMMER_INSTRUMENT
+        rbdimmer_timing_stats_t ts;
+        if (rbdimmer_get_timing_stats(0, &ts) == RBDIMMER_OK) {
+            cyc_mean = ts.zc_isr_cycles.count
+                     ? (uint32_t)(ts.zc_isr_cycles.sum / ts.zc_isr_cycles.count) : 0;
+            cyc_max  = ts.zc_isr_cycles.max;
+            late_max = ts.fire_late_us.max;
+        }
+#endif
+        ESP_LOGI(TAG, "%2u ch | isr %5" PRIu32 "/%5" PRIu32 " cyc | load %2" PRIu32 ".%" PRIu32
+                 "%% | late max %4" PRIu32 " us | missed lib %" PRIu32 " | halves %" PRIu32,
+                 n, cyc_mean, cyc_max, load_pm / 10, load_pm % 10, late_max,
+                 zc1.missed - zc0.missed, h);
+        for (uint8_t i = 0; i < probes; i++) {
+            const probe_stats_t* p = &ps[i];
+            int32_t mean10 = p->pulses ? (int32_t)(p->err_sum * 10 / (int64_t)p->pulses) : 0;
+            ESP_LOGI(TAG, "     gate %2u (delay %5" PRIu32 " us): err mean %+" PRId32 ".%" PRIu32
+                     " p50 %3" PRIu32 " p99 %3" PRIu32 " max %4" PRIu32 " us | missed %" PRIu32
+                     " extra %" PRIu32,
+                     probe_pins[i], p->expected_us, mean10 / 10, (uint32_t)abs(mean10 % 10),
+                     hist_percentile(p, 500), hist_percentile(p, 990), p->err_max,
+                     p->missed, p->extra);
+        }
+        if (queue_overflows) {
+            ESP_LOGW(TAG, "     %" PRIu32 " probe events dropped (queue full)", queue_overflows);
+        }
+    }
+
+    probes_detach(probe_pins, probes);
+    for (uint8_t i = 0; i < created; i++) {
+        rbdimmer_delete_channel(ch[i]);
+    }
+}
+
+void test_app_bench_run(void) {
+    uint8_t max_n = CONFIG_TEST_APP_BENCH_CHANNELS;
+    if (max_n > GATE_PIN_COUNT) {
+        max_n = GATE_PIN_COUNT;
+    }
+    if (max_n > RBDIMMER_MAX_CHANNELS) {
+        max_n = RBDIMMER_MAX_CHANNELS;
+    }
+
+    event_queue = xQueueCreate(256, sizeof(probe_event_t));
+    stats_mutex = xSemaphoreCreateMutex();
+    if (event_queue == NULL || stats_mutex == NULL) {
+        ESP_LOGE(TAG, "Out of memory");
+        return;
+    }
+    // Analysis off the ISR core where there is a second one
+    xTaskCreatePinnedToCore(analysis_task, "bench", 4096, NULL, 5, NULL,
+                            SOC_CPU_CORES_NUM - 1);
+
+    BaseType_t core = xPortGetCoreID();    // GPIO ISR service lands here
+    if (esp_register_freertos_idle_hook_for_cpu(idle_hook, core) != ESP_OK) {
+        ESP_LOGE(TAG, "Idle hook registration failed");
+        return;
+    }
+    if (probes_init() != ESP_OK || zc_generator_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Zero-cross generator / probe setup failed");
+        return;
+    }
+    uint32_t baseline = idle_rate_per_s(1000);
+
+    if (rbdimmer_init() != RBDIMMER_OK ||
+        rbdimmer_register_zero_cross(CONFIG_TEST_APP_BENCH_ZC_IN_GPIO, 0, 0) != RBDIMMER_OK) {
+        ESP_LOGE(TAG, "Library setup failed");
+        return;
+    }
+#if !BENCH_USE_CAPTURE
+    rbdimmer_set_callback(0, on_zero_cross, NULL);
+#endif
+    vTaskDelay(pdMS_TO_TICKS(SETTLE_MS));
+    ESP_LOGI(TAG, "GPIO %d -> %d, %u Hz (measured %u.%02u Hz), core %d, probes: %s",
+             CONFIG_TEST_APP_BENCH_ZC_OUT_GPIO, CONFIG_TEST_APP_BENCH_ZC_IN_GPIO,
+             CONFIG_TEST_APP_BENCH_MAINS_HZ, rbdimmer_get_frequency_centihz(0) / 100,
+             rbdimmer_get_frequency_centihz(0) % 100, (int)core,
+             BENCH_USE_CAPTURE ? "MCPWM capture" : "GPIO interrupt");
+    if (rbdimmer_get_frequency(0) == 0) {
+        ESP_LOGE(TAG, "No zero-cross signal: connect GPIO %d to GPIO %d",
+                 CONFIG_TEST_APP_BENCH_ZC_OUT_GPIO, CONFIG_TEST_APP_BENCH_ZC_IN_GPIO);
+        return;
+    }
+
+    for (uint8_t n = 1; n <= max_n; n = (n * 2 <= max_n || n == max_n) ? n * 2 : max_n) {
+        bench_step(n, baseline);
+    }
+    ESP_LOGI(TAG, "Done");
+}
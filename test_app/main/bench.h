@@ -0,0 +1,9 @@
+/**
+ * @file bench.h
+ * @brief On-target timing benchmark (CONFIG_TEST_APP_BENCH)
+ */
+
+#pragma once
+
+/** Run the channel-count sweep and log one report per step; returns when done. */
+void test_app_bench_run(void);
@@ -4,12 +4,20 @@
  *
  * Not intended to run on hardware — just exercises the public API surface
  * so that every chip × framework combination is compile-tested in CI.
+ * With CONFIG_TEST_APP_BENCH it runs the on-target timing benchmark
+ * (bench.c) instead.
  */
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "rbdimmerESP32.h"
+#if CONFIG_RBDIMMER_PERSIST
+#include "nvs_flash.h"
+#endif
+#if CONFIG_TEST_APP_BENCH
+#include "bench.h"
+#endif
 
 #define TAG "CI"
 
@@ -21,8 +29,15 @@ void app_main(void)
     ESP_LOGI(TAG, "LEVEL_MIN       : %d", CONFIG_RBDIMMER_LEVEL_MIN);
     ESP_LOGI(TAG, "LEVEL_MAX       : %d", CONFIG_RBDIMMER_LEVEL_MAX);
 
+#if CONFIG_TEST_APP_BENCH
+    test_app_bench_run();
+#else
+#if CONFIG_RBDIMMER_PERSIST
+    ESP_ERROR_CHECK(nvs_flash_init());   // fast-boot store
+#endif
     rbdimmer_err_t err = rbdimmer_init();
     ESP_LOGI(TAG, "rbdimmer_init: %d", (int)err);
+#endif
 
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Print the static memory footprint of the rbdimmerESP32 component library.
+
+Run by the component CMakeLists.txt after the archive is linked when
+CONFIG_RBDIMMER_MEMORY_REPORT is set:
+
+    rbdimmer_mem_report.py <objdump> <libcomponent.a>
+
+Section sizes of every object are summed into IRAM (code placed with
+IRAM_ATTR), DRAM (initialised data and bss, DRAM_ATTR included) and flash
+(code and read-only data).  Heap use is not part of the report — with
+CONFIG_RBDIMMER_STATIC_ALLOC the only heap objects are the esp_timer and
+driver handles created during setup.
+"""
+
+import re
+import subprocess
+import sys
+
+# Most specific prefix first: .iram1.literal is IRAM, not flash
+CATEGORIES = (
+    ('iram',  ('.iram',)),
+    ('dram',  ('.dram', '.data', '.sdata', '.bss', '.sbss')),
+    ('flash', ('.text', '.literal', '.rodata', '.srodata')),
+)
+
+SECTION_RE = re.compile(r'^\s*\d+\s+(\S+)\s+([0-9a-fA-F]+)\s')
+MEMBER_RE = re.compile(r'^(\S+\.o(?:bj)?):\s+file format')
+
+
+def category(name):
+    for cat, prefixes in CATEGORIES:
+        if name.startswith(prefixes):
+            return cat
+    return None
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit('usage: rbdimmer_mem_report.py <objdump> <archive>')
+    out = subprocess.run([sys.argv[1], '-h', sys.argv[2]],
+                         check=True, capture_output=True, text=True).stdout
+
+    objects = {}
+    current = None
+    for line in out.splitlines():
+        m = MEMBER_RE.match(line)
+        if m:
+            current = objects.setdefault(m.group(1), dict.fromkeys(('iram', 'dram', 'flash'), 0))
+            continue
+        m = SECTION_RE.match(line)
+        if m and current is not None:
+            cat = category(m.group(1))
+            if cat:
+                current[cat] += int(m.group(2), 16)
+
+    total = dict.fromkeys(('iram', 'dram', 'flash'), 0)
+    print('rbdimmerESP32 memory footprint (bytes)')
+    print('  %-28s %8s %8s %8s' % ('object', 'IRAM', 'DRAM', 'flash'))
+    for name in sorted(objects):
+        sizes = objects[name]
+        print('  %-28s %8d %8d %8d' % (name, sizes['iram'], sizes['dram'], sizes['flash']))
+        for cat in total:
+            total[cat] += sizes[cat]
+    print('  %-28s %8d %8d %8d' % ('total', total['iram'], total['dram'], total['flash']))
+
+
+if __name__ == '__main__':
+    main()